@@ -39,15 +39,21 @@
 // all-zero dummy timestep instead of a truly empty one, and mask it out
 // forever via attention_mask=0 at that position. It never gets attended to,
 // so it's numerically a no-op, but it keeps every Mat non-empty.
+//
+// dnn.KVCache does the bookkeeping natively: it preallocates every layer's
+// key/value storage for MAX_CONTEXT timesteps (dummy slot included), feeds
+// views of the filled prefix as past_key_values.*, builds attention_mask and
+// position_ids, and copies only the new timesteps out of present.* - instead
+// of cloning all 48 tensors on every step.
 import * as std from 'std';
-import { Mat, CV_32FC1, CV_64SC1, dnn, readNetFromONNX } from 'opencv';
+import { Mat, CV_64SC1, dnn, readNetFromONNX } from 'opencv';
 
 const NUM_LAYERS = 24;
 const NUM_KV_HEADS = 2;
 const HEAD_DIM = 64;
-const VOCAB_SIZE = 151936*8;
 const EOS = 151645*32; // <|im_end|>
 const MAX_NEW_TOKENS = 200;
+const MAX_CONTEXT = 2048;
 
 const MODEL_PATH = 'examples/models/qwen2.5-0.5b-instruct/model_q4.onnx';
 const TOKENIZER_CONFIG = 'tests/qwen2.5-tokenizer/config.json';
@@ -61,33 +67,9 @@ function i64Mat(rows, values) {
   return m;
 }
 
-function zeroKV(len) {
-  const m = new Mat(4, [1, NUM_KV_HEADS, len, HEAD_DIM], CV_32FC1);
-  new Float32Array(m.buffer).fill(0);
-  return m;
-}
-
-function argmaxLastPosition(logits, seqLen) {
-  const f = new Float32Array(logits.buffer);
-  const off = (seqLen - 1) * VOCAB_SIZE;
-  let best = 0, bestValue = -Infinity;
-  for(let i = 0; i < VOCAB_SIZE; i++) {
-    const v = f[off + i];
-    if(v > bestValue) {
-      bestValue = v;
-      best = i;
-    }
-  }
-  return best;
-}
-
 function generate(net, tok, promptIds) {
-  let past = [];
-  for(let l = 0; l < NUM_LAYERS; l++)
-    past.push([zeroKV(1), zeroKV(1)]);
-
-  let attn = [0]; // one dummy masked-out timestep, permanently 0
-  let realLen = 0;
+  // one dummy masked-out timestep in slot 0 (see the gotcha above)
+  const cache = new dnn.KVCache(NUM_LAYERS, NUM_KV_HEADS, HEAD_DIM, MAX_CONTEXT, true);
   let curIds = promptIds;
   const generated = [];
 
@@ -99,30 +81,20 @@ function generate(net, tok, promptIds) {
 
   for(let step = 0; step < MAX_NEW_TOKENS; step++) {
     const seqLen = curIds.length;
-    attn = attn.concat(new Array(seqLen).fill(1));
 
-    const posIds = [];
-    for(let i = 0; i < seqLen; i++)
-      posIds.push(realLen + i);
+    if(cache.length + seqLen > cache.capacity)
+      break;
 
     net.setInput(i64Mat(1, curIds), 'input_ids');
-    net.setInput(i64Mat(1, attn), 'attention_mask');
-    net.setInput(i64Mat(1, posIds), 'position_ids');
-    for(let l = 0; l < NUM_LAYERS; l++) {
-      net.setInput(past[l][0], `past_key_values.${l}.key`);
-      net.setInput(past[l][1], `past_key_values.${l}.value`);
-    }
+    cache.setInputs(net, seqLen);
 
     const outs = [];
     net.forward(outs, outputNames);
-    const logits = outs[0];
-    const nextId = argmaxLastPosition(logits, seqLen);
-
-    for(let l = 0; l < NUM_LAYERS; l++) {
-      past[l][0] = outs[1 + l * 2].clone();
-      past[l][1] = outs[2 + l * 2].clone();
-    }
-    realLen += seqLen;
+    // greedy decoding over the last position; pass temperature/topK/topP
+    // (and history + repetitionPenalty) here for sampled generation
+    const nextId = dnn.sample(outs[0], { temperature: 0 });
+
+    cache.append(outs, seqLen, 1);
 
     if(nextId === EOS)
       break;
@@ -0,0 +1,81 @@
+#ifndef BINARY_MATCHER_HPP
+#define BINARY_MATCHER_HPP
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Hamming-distance matcher for binary descriptors (ORB, BRISK,
+ * FREAK, LATCH, BRIEF, AKAZE/MLDB).
+ *
+ * Train rows are stored zero-padded to whole 64-bit words, so distances
+ * are XORs and popcounts a word at a time. The brute-force kNN search
+ * compares blocks of queries against cache-sized blocks of train rows,
+ * with the query blocks spread over OpenCV's thread pool. On x86 the
+ * inner kernel is compiled twice, with and without POPCNT, and picked at
+ * load time.
+ *
+ * The multi-probe LSH index hashes `keyBits` sampled bits per table.
+ * Probing also visits the buckets 1 (probes = 1) or up to 2 (probes = 2)
+ * bit flips away, and the candidates are ranked by exact distance. It is
+ * built on first use after add().
+ */
+class BinaryMatcher {
+public:
+  struct LshParams {
+    int tables = 8;
+    int keyBits = 16;
+    int probes = 1;
+    uint32_t seed = 0x2545f491;
+  };
+
+  struct Match {
+    int32_t queryIdx, trainIdx, distance;
+  };
+
+  BinaryMatcher() : BinaryMatcher(LshParams()) {}
+  explicit BinaryMatcher(const LshParams& params);
+
+  /** @brief Appends CV_8U rows; all adds share one width. */
+  void add(const cv::Mat& descriptors);
+  void clear();
+
+  int size() const { return rows; }
+  int descriptorSize() const { return bytes; }
+
+  /**
+   * @brief The k nearest train rows of every query row, nearest first, as
+   * query rows x k tables. Missing neighbours are -1 in both.
+   */
+  void knnMatch(const cv::Mat& query, int k, bool lsh, std::vector<int32_t>& trainIdx, std::vector<int32_t>& distance);
+
+  /**
+   * @brief Best match per query, kept when it is within `maxDistance`
+   * (negative: any), passes the ratio test against the second best
+   * (ratio <= 0 or >= 1: off) and, with `crossCheck`, when the query is
+   * also the train row's nearest query.
+   */
+  void match(const cv::Mat& query, float ratio, bool crossCheck, int maxDistance, bool lsh, std::vector<Match>& matches);
+
+private:
+  struct Table {
+    std::vector<uint16_t> bits; // sampled bit positions
+    std::vector<uint32_t> keys; // sorted
+    std::vector<int32_t> ids;   // train row per key
+  };
+
+  LshParams params;
+  int bytes = 0, words = 0, rows = 0;
+  std::vector<uint64_t> train;
+  std::vector<Table> tables;
+  bool lsh_built = false;
+
+  void pack_query(const cv::Mat& query, std::vector<uint64_t>& packed) const;
+  void search(const uint64_t* query, int nq, int k, bool lsh, int32_t* idx, int32_t* dist);
+  void build_lsh();
+  void lsh_knn(const uint64_t* query, int nq, int k, int32_t* idx, int32_t* dist) const;
+  uint32_t hash(const Table& table, const uint64_t* row) const;
+};
+
+#endif /* defined(BINARY_MATCHER_HPP) */
@@ -0,0 +1,48 @@
+#ifndef BLOB_BUILDER_HPP
+#define BLOB_BUILDER_HPP
+
+#include <opencv2/core/mat.hpp>
+#include <vector>
+
+/**
+ * @brief blobFromImages() that keeps its output blob and the per-image
+ * resize/convert buffers between calls.
+ *
+ * Preprocessing follows cv::dnn::Image2BlobParams: resize to `size`
+ * (stretched, center-cropped or letterboxed), optional R/B swap, then
+ * (pixel - mean) * scale per output channel. Images of a batch are
+ * processed in parallel, each written straight into its slice of the blob.
+ * Once the batch shape has been seen, build() allocates nothing.
+ */
+struct BlobBuilder {
+  cv::Scalar scale = cv::Scalar::all(1), mean, borderValue;
+  cv::Size size;
+  bool swapRB = false;
+  /* NHWC instead of NCHW */
+  bool nhwc = false;
+  /* CV_32F, CV_16F, CV_8U or CV_8S (saturated) */
+  int ddepth = CV_32F;
+  /* cv::dnn::ImagePaddingMode */
+  int paddingMode = 0;
+
+  cv::Mat blob;
+
+  /**
+   * @brief Fill `blob` from `images` and return it. The returned Mat shares
+   * memory with the builder, the next call overwrites it.
+   */
+  const cv::Mat& build(const std::vector<cv::Mat>& images);
+
+private:
+  struct Slot {
+    cv::Mat resized, canvas, swapped, work;
+    std::vector<cv::Mat> channels;
+  };
+
+  std::vector<Slot> slots;
+
+  cv::Mat resize(const cv::Mat& image, Slot& slot, cv::Size target) const;
+  void convert(const cv::Mat& src, Slot& slot, int index) const;
+};
+
+#endif /* defined(BLOB_BUILDER_HPP) */
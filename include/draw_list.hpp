@@ -0,0 +1,79 @@
+#ifndef DRAW_LIST_HPP
+#define DRAW_LIST_HPP
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Recorded drawing primitives, replayed onto a Mat in one call.
+ *
+ * Commands are kept in flat arrays (points, scalar parameters and strings
+ * are shared pools indexed by the command), each with the bounding box of
+ * the pixels it may touch. replay() can split the target into horizontal
+ * bands drawn in parallel; a band only replays the commands whose box
+ * crosses it, in recording order, so overlapping primitives stack the same
+ * way as when drawn one by one. Pixels on antialiased or thick edges that
+ * cross a band boundary are rasterized per band and may differ by rounding
+ * from a sequential replay.
+ *
+ * A list is not modified by replay() and can be replayed any number of
+ * times, onto different Mats and from several threads at once.
+ */
+class DrawList {
+public:
+  enum Op : uint8_t {
+    LINE = 0,
+    RECTANGLE,
+    CIRCLE,
+    ELLIPSE,
+    POLYLINES,
+    FILL_POLY,
+    TEXT,
+  };
+
+  struct Command {
+    uint8_t op;
+    uint8_t line_type;
+    bool flag; // polylines: closed, text: bottomLeftOrigin
+    int thickness;
+    uint32_t point, count; // range in points
+    uint32_t param;        // first value in params, index in texts for TEXT
+    cv::Scalar color;
+    cv::Rect bounds;
+  };
+
+  void line(cv::Point a, cv::Point b, const cv::Scalar& color, int thickness, int lineType);
+  void rectangle(cv::Point a, cv::Point b, const cv::Scalar& color, int thickness, int lineType);
+  void circle(cv::Point center, int radius, const cv::Scalar& color, int thickness, int lineType);
+  void ellipse(cv::Point center, cv::Size axes, double angle, double startAngle, double endAngle, const cv::Scalar& color, int thickness, int lineType);
+  void polylines(const cv::Point* pts, size_t n, bool closed, const cv::Scalar& color, int thickness, int lineType);
+  void fillPoly(const cv::Point* pts, size_t n, const cv::Scalar& color, int lineType);
+  void text(const std::string& str, cv::Point org, int fontFace, double fontScale, const cv::Scalar& color, int thickness, int lineType, bool bottomLeftOrigin);
+
+  void clear();
+  size_t size() const { return commands.size(); }
+  bool empty() const { return commands.empty(); }
+
+  /** @brief Union of the command bounding boxes. */
+  cv::Rect bounds() const;
+
+  /**
+   * @brief Draw every command onto `dst`, translated by `offset` and
+   * restricted to `clip` (the whole image when empty), in up to `bands`
+   * horizontal bands on OpenCV's thread pool (0 picks the thread count).
+   */
+  void replay(cv::Mat& dst, cv::Point offset = cv::Point(), cv::Rect clip = cv::Rect(), int bands = 1) const;
+
+private:
+  std::vector<Command> commands;
+  std::vector<cv::Point> points;
+  std::vector<double> params;
+  std::vector<std::string> texts;
+
+  Command& push(Op op, const cv::Scalar& color, int thickness, int lineType, cv::Rect bounds);
+  void draw(const Command& cmd, cv::Mat& dst, cv::Point shift) const;
+};
+
+#endif /* defined(DRAW_LIST_HPP) */
@@ -0,0 +1,81 @@
+#ifndef FLANN_INDEX_MATCHER_HPP
+#define FLANN_INDEX_MATCHER_HPP
+
+#include "mapped_file.hpp"
+#include <opencv2/features2d.hpp>
+#include <opencv2/flann.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief FLANN descriptor matcher whose index persists and grows in place.
+ *
+ * cv::FlannBasedMatcher rebuilds its whole index after every add(). Here,
+ * descriptors added after the last build are kept in a pending block. That
+ * block is searched exhaustively and merged with the index results. The
+ * index is only rebuilt once the pending block exceeds `rebuildRatio` of
+ * the indexed rows.
+ *
+ * saveIndex() writes FLANN's own index file and appends the training
+ * descriptors, page-aligned, plus a footer. loadIndex() maps that file:
+ * the descriptors the index searches alias the mapping, so processes
+ * loading the same index share those pages. The KD-tree/k-means
+ * structure itself is read into memory. LSH indexes store their own copy
+ * of the data and rehash it on load, which is fast.
+ */
+class FlannIndexMatcher : public cv::DescriptorMatcher {
+public:
+  enum Algorithm : int32_t {
+    AUTO = 0, // KDTREE for float descriptors, LSH for binary ones
+    KDTREE,
+    KMEANS,
+    LSH,
+  };
+
+  struct Config {
+    int32_t algorithm = AUTO;
+    int32_t trees = 4;
+    int32_t branching = 32, iterations = 11;
+    int32_t tableNumber = 12, keySize = 20, multiProbeLevel = 2;
+  };
+
+  explicit FlannIndexMatcher(const Config& config, int checks = 32, double rebuildRatio = 0.1);
+
+  void add(cv::InputArrayOfArrays descriptors) override;
+  void clear() override;
+  bool empty() const override;
+  bool isMaskSupported() const override { return false; }
+  void train() override;
+  cv::Ptr<cv::DescriptorMatcher> clone(bool emptyTrainData = false) const override;
+
+  /** @brief Builds first if anything is pending; throws on I/O errors. */
+  void saveIndex(const std::string& path);
+  void loadIndex(const std::string& path);
+
+  int indexedCount() const { return indexed.rows; }
+  int pendingCount() const { return pending.rows; }
+
+protected:
+  void knnMatchImpl(cv::InputArray queryDescriptors, std::vector<std::vector<cv::DMatch>>& matches, int k, cv::InputArrayOfArrays masks = cv::noArray(), bool compactResult = false) override;
+  void radiusMatchImpl(cv::InputArray queryDescriptors, std::vector<std::vector<cv::DMatch>>& matches, float maxDistance, cv::InputArrayOfArrays masks = cv::noArray(), bool compactResult = false) override;
+
+private:
+  Config config;
+  int checks;
+  double rebuild_ratio;
+  cv::Ptr<cv::flann::Index> index;
+  /* `indexed` may alias `mapping`; rows are numbered across indexed, then pending */
+  cv::Mat indexed, pending;
+  std::vector<int32_t> starts;
+  std::shared_ptr<const MappedFile> mapping;
+
+  bool binary() const;
+  void build();
+  cv::DMatch to_match(int row, float distance) const;
+  void append(const cv::Mat& descriptors);
+  void collect();
+};
+
+#endif /* defined(FLANN_INDEX_MATCHER_HPP) */
@@ -0,0 +1,72 @@
+#ifndef HOMOGRAPHY_TRACKER_HPP
+#define HOMOGRAPHY_TRACKER_HPP
+
+#include "binary_matcher.hpp"
+#include <opencv2/core.hpp>
+#include <opencv2/features2d.hpp>
+#include <vector>
+
+/**
+ * @brief Tracks a planar reference image through a video, one homography
+ * per frame.
+ *
+ * setReference() detects ORB keypoints on the reference and indexes their
+ * descriptors. Each frame, the tracker follows the points paired with the
+ * reference using pyramidal Lucas-Kanade from the previous frame. That
+ * frame's pyramid is kept, so only the new frame's pyramid is built. The
+ * homography is fitted with RANSAC to the (reference, tracked) pairs, so
+ * tracking drift doesn't compound through the estimate.
+ *
+ * The frame is redetected and matched against the reference when too few
+ * points survive, when the inlier ratio drops, or every
+ * `redetectInterval` frames. Only the RANSAC inliers are tracked on.
+ */
+class HomographyTracker {
+public:
+  struct Params {
+    int features = 1000;
+    int minTracked = 40;          // fewer tracked points: redetect
+    double minInlierRatio = 0.5;  // lower inlier share: redetect
+    int redetectInterval = 0;     // frames; 0: only when tracking degrades
+    float ratio = 0.8f;           // descriptor ratio test
+    double ransacThreshold = 3;   // pixels
+    int winSize = 21, maxLevel = 3;
+  };
+
+  struct Result {
+    cv::Matx33d H;
+    bool found = false, redetected = false;
+    int tracked = 0, inliers = 0;
+  };
+
+  HomographyTracker() : HomographyTracker(Params()) {}
+  explicit HomographyTracker(const Params& params);
+
+  /** @brief Replaces the reference; returns the number of keypoints found. */
+  int setReference(const cv::Mat& image, const cv::Mat& mask = cv::Mat());
+
+  /** @brief Reference -> frame homography; frames are 8-bit gray or BGR(A). */
+  Result update(const cv::Mat& frame);
+
+  /** @brief Forgets the tracked points, the next update() redetects. */
+  void reset();
+
+  int referenceSize() const { return int(ref_keypoints.size()); }
+  int trackedCount() const { return int(cur_points.size()); }
+
+private:
+  Params params;
+  cv::Ptr<cv::ORB> orb;
+  BinaryMatcher matcher;
+  std::vector<cv::KeyPoint> ref_keypoints;
+  /* pairs being tracked: a reference point and where it is in the previous frame */
+  std::vector<cv::Point2f> ref_points, cur_points;
+  std::vector<cv::Mat> prev_pyramid;
+  int since_detection = 0;
+
+  bool redetect(const cv::Mat& gray, Result& result);
+  bool track(const cv::Mat& gray, const std::vector<cv::Mat>& pyramid, Result& result);
+  bool fit(std::vector<cv::Point2f>& ref, std::vector<cv::Point2f>& cur, Result& result) const;
+};
+
+#endif /* defined(HOMOGRAPHY_TRACKER_HPP) */
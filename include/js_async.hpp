@@ -0,0 +1,49 @@
+#ifndef JS_ASYNC_HPP
+#define JS_ASYNC_HPP
+
+#include <quickjs.h>
+#include <functional>
+
+/**
+ * @brief Take setTimeout and setReadHandler from QuickJS's 'os' module;
+ * called from the init of the modules that use the functions below.
+ *
+ * Nothing is taken when the host didn't register 'os' (e.g. a bare
+ * JSContext without quickjs-libc), and the fallbacks below apply.
+ */
+void js_async_init(JSContext* ctx);
+
+/**
+ * @brief os.setTimeout(fn, ms). When 'os' is unavailable, `fn` is queued as
+ * a job instead, i.e. it runs once the current synchronous code returns.
+ */
+void js_set_timeout(JSContext* ctx, JSValueConst fn, double ms);
+
+/**
+ * @brief New pending Promise; its resolving functions are stored in
+ * `funcs[0]` (resolve) and `funcs[1]` (reject) and must be freed by the
+ * caller, usually through js_promise_settle().
+ */
+JSValue js_promise_new(JSContext* ctx, JSValue funcs[2]);
+
+/**
+ * @brief Call funcs[0] with `value`, or funcs[1] if `reject` is set, then free
+ * both resolving functions and `value`.
+ */
+void js_promise_settle(JSContext* ctx, JSValue funcs[2], JSValue value, bool reject = false);
+
+/**
+ * @brief Run `work` on a native thread and return a Promise for its outcome.
+ *
+ * Once `work` returns, `done` is called back on the JS thread (from an
+ * os.setReadHandler callback on an internal pipe) and its return value
+ * resolves the Promise; an exception thrown by `work` rejects it instead.
+ * The read handler is only installed while tasks are outstanding, so it
+ * doesn't keep the event loop alive.
+ *
+ * Without the 'os' module (or on Windows), `work` runs synchronously and
+ * the returned Promise is already settled.
+ */
+JSValue js_async_run(JSContext* ctx, std::function<void()> work, std::function<JSValue(JSContext*)> done);
+
+#endif /* defined(JS_ASYNC_HPP) */
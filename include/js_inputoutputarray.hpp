@@ -4,6 +4,7 @@
 #include "include/js_array.hpp"
 #include "include/js_typed_array.hpp"
 #include "include/jsbindings.hpp"
+#include "js_point_array.hpp"
 #include "js_umat.hpp"
 #include "js_vector.hpp"
 
@@ -13,15 +14,17 @@ JSInputArray js_vector_inputarray(JSValueConst value);
 JSInputOutputArray js_vector_inputoutputarray(JSValueConst value);
 
 /**
- * @brief Look up a JS Mat/UMat and wrap it as ArrayT (JSInputArray,
- * JSInputOutputArray or JSOutputArray - all zero-copy aliases). Shared by
- * every JS-argument-to-cv::_InputArray-family resolver in this file.
+ * @brief Look up a JS Mat/UMat/PointArray and wrap it as ArrayT
+ * (JSInputArray, JSInputOutputArray or JSOutputArray - all zero-copy
+ * aliases). Shared by every JS-argument-to-cv::_InputArray-family resolver
+ * in this file.
  */
 template<class ArrayT>
 static inline bool
 js_mat_umat_array(JSValueConst value, ArrayT& out) {
   cv::Mat* mat;
   cv::UMat* umat;
+  JSPointArrayData* points;
 
   if((mat = js_mat_data_nothrow(value))) {
     out = ArrayT(*mat);
@@ -33,6 +36,11 @@ js_mat_umat_array(JSValueConst value, ArrayT& out) {
     return true;
   }
 
+  if(js_point_array_class_id && (points = js_point_array_data(value))) {
+    out = ArrayT(points->mat);
+    return true;
+  }
+
   return false;
 }
 
@@ -330,4 +338,19 @@ private:
   JSValue m_val;
 };
 
+/**
+ * @brief One point Mat per contour of a contour set, N x 1 2-channel:
+ * CV_32S and CV_32F as they are, CV_64F too if `keep_double`, anything
+ * else converted to CV_32F.
+ *
+ * `value` is an array (of Mat, PointVector, Point2fVector, PointArray,
+ * Contour or point arrays), a MatVector, PointVectorVector,
+ * Point2fVectorVector, or a packed { points, offsets } with offsets in
+ * points (n + 1 entries) as returned by cv.psimpl.*Batch(). Packed and
+ * vector input is aliased, not copied; `keep` receives the packed points
+ * array, to be freed once the contours are no longer used. Throws and
+ * returns false on anything else.
+ */
+bool js_contours_read(JSContext* ctx, JSValueConst value, std::vector<cv::Mat>& contours, JSValue& keep, bool keep_double = false);
+
 #endif // JS_INPUTOUTPUTARRAY_HPP
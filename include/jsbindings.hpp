@@ -21,7 +21,6 @@ typedef cv::_InputArray JSInputArray;
 typedef cv::_InputOutputArray JSInputOutputArray;
 typedef cv::_OutputArray JSOutputArray;
 
-typedef cv::VideoCapture JSVideoCaptureData;
 typedef cv::VideoWriter JSVideoWraiterData;
 typedef cv::TickMeter JSTickMeterData;
 typedef cv::Ptr<cv::CLAHE> JSCLAHEData;
@@ -73,6 +72,13 @@ int js_range_size(JSContext* ctx, JSValueConst value);
 bool js_range_empty(JSContext* ctx, JSValueConst value);
 bool js_range_valid(JSContext* ctx, JSValueConst value);
 
+/**
+ * Pixel buffers live outside the QuickJS heap, so the runtime's own GC
+ * trigger doesn't see them. Called before wrapping a new Mat, UMat or
+ * vector: collects once they have grown past the accounting threshold.
+ */
+void js_external_memory_check(JSContext* ctx);
+
 /** @defgroup number
  *  @{
  */
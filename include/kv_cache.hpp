@@ -0,0 +1,52 @@
+#ifndef KV_CACHE_HPP
+#define KV_CACHE_HPP
+
+#include <opencv2/core/mat.hpp>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Key/value history of a decoder-only transformer whose ONNX export
+ * takes the cache as past_key_values.<layer>.{key,value} inputs and returns
+ * it grown by the new timesteps as present.<layer>.{key,value}.
+ *
+ * Storage for `capacity` timesteps is allocated once per layer as
+ * [1, heads, capacity, headDim] float; append() copies only the new
+ * timesteps out of the present tensors. key()/value() are views of the
+ * filled prefix, strided across heads. The network copies every input it
+ * is given, so feeding them still copies the whole prefix on every step:
+ * the cache keeps the history in fixed storage, it doesn't make a step
+ * cheaper than the prefix. With `dummy` set, slot 0 holds an all-zero
+ * timestep that the attention mask hides, because some backends reject
+ * the empty past tensors of the prefill step.
+ */
+struct KVCache {
+  int layers = 0, heads = 0, headDim = 0, capacity = 0;
+  bool dummy = true;
+  /* real timesteps cached, not counting the dummy slot */
+  int length = 0;
+  std::vector<cv::Mat> keys, values;
+
+  KVCache() = default;
+  KVCache(int layers, int heads, int headDim, int capacity, bool dummy = true);
+
+  int offset() const { return dummy ? 1 : 0; }
+
+  cv::Mat key(int layer) const;
+  cv::Mat value(int layer) const;
+
+  /* int64 (int32 before OpenCV 5) [1, offset + length + n], 0 for the dummy slot, 1 elsewhere */
+  cv::Mat attentionMask(int n) const;
+  /* int64 (int32 before OpenCV 5) [1, n], length .. length + n - 1 */
+  cv::Mat positionIds(int n) const;
+
+  /**
+   * @brief Take the last `n` timesteps of every present tensor; `present`
+   * holds key and value of layer 0, then of layer 1, and so on.
+   */
+  void append(const std::vector<cv::Mat>& present, int n);
+
+  void reset() { length = 0; }
+};
+
+#endif /* defined(KV_CACHE_HPP) */
@@ -0,0 +1,78 @@
+#ifndef LINE_INDEX_HPP
+#define LINE_INDEX_HPP
+
+#include "line.hpp"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Uniform-grid spatial index over line segments.
+ *
+ * Every segment is registered in each grid cell it passes through, so a
+ * query only inspects the cells around it instead of the whole collection
+ * (see find_nearest_line() for the linear scan this replaces). Ids are
+ * insertion indices and stay valid across remove().
+ *
+ * Queries use scratch state of the index and must not run concurrently on
+ * the same instance.
+ */
+class LineIndex {
+public:
+  typedef Line<double> line_type;
+  typedef cv::Point2d point_type;
+
+  /** @brief cellSize 0 picks the mean segment length on the first build(). */
+  explicit LineIndex(double cellSize = 0) : cell_size(cellSize) {}
+
+  void build(const std::vector<line_type>& lines);
+  int insert(const line_type& line);
+  bool remove(int id);
+  void clear();
+
+  bool contains(int id) const { return id >= 0 && size_t(id) < lines.size() && alive[id]; }
+  const line_type& at(int id) const { return lines[id]; }
+  size_t size() const { return count; }
+  double cellSize() const { return cell_size; }
+
+  /**
+   * @brief The `k` segments nearest to `query` (a point being a zero-length
+   * segment), closest first. Segment `exclude` is skipped.
+   */
+  std::vector<int> nearest(const line_type& query, int k, int exclude = -1, std::vector<double>* distances = nullptr) const;
+
+  /** @brief Segments within `radius` of `query`, in id order. */
+  std::vector<int> radius(const line_type& query, double radius, int exclude = -1) const;
+
+  /** @brief Segments intersecting `box`, in id order. */
+  std::vector<int> box(const cv::Rect2d& box) const;
+
+  /**
+   * @brief Segments with an endpoint within `radius` of `pt`, nearest first.
+   * `ends` receives 0 for the start point, 1 for the end point.
+   */
+  std::vector<int> endpoints(const point_type& pt, double radius, std::vector<int>* ends = nullptr) const;
+
+  static double distance(const line_type& s, const line_type& t);
+
+private:
+  double cell_size;
+  size_t count = 0;
+  std::vector<line_type> lines;
+  std::vector<bool> alive;
+  std::unordered_map<int64_t, std::vector<int>> cells;
+  /* occupied cell range, only ever grows */
+  int min_cx = 0, min_cy = 0, max_cx = -1, max_cy = -1;
+
+  mutable std::vector<uint32_t> seen;
+  mutable uint32_t epoch = 0;
+
+  int cell(double v) const { return int(std::floor(v / cell_size)); }
+  static int64_t key(int cx, int cy) { return (int64_t(cx) << 32) | uint32_t(cy); }
+
+  template<class F> void traverse(const line_type& line, F&& f) const;
+  template<class F> void visit(int x0, int y0, int x1, int y1, F&& f) const;
+  void next_epoch() const;
+};
+
+#endif /* defined(LINE_INDEX_HPP) */
@@ -0,0 +1,41 @@
+#ifndef LINE_MERGE_HPP
+#define LINE_MERGE_HPP
+
+#include "line.hpp"
+#include <cstdint>
+#include <vector>
+
+struct SegmentMergeParams {
+  /* radians between the (undirected) segment directions */
+  double angleTol = CV_PI / 90;
+  /* gap along the common direction */
+  double gapTol = 2;
+  /* distance of the shorter segment's endpoints from the longer one's line */
+  double offsetTol = 1;
+};
+
+/**
+ * @brief Merge runs of collinear segments (e.g. fragmented LSD output) into
+ * single segments.
+ *
+ * Candidates come from a LineIndex, so each segment only meets its
+ * neighbourhood. Groups grow from the longest free segment: a segment joins
+ * when it is within the tolerances of a member and also of the group's
+ * current fitted line, so chains that curve slowly are not straightened.
+ * Every group is replaced by the length-weighted fit spanning all of its
+ * endpoints, in the order of the group's first segment.
+ */
+std::vector<cv::Vec4f> merge_segments(const std::vector<Line<double>>& lines, const SegmentMergeParams& params = SegmentMergeParams());
+
+/**
+ * @brief Chain segments whose endpoints lie within `tol` of each other into
+ * polylines.
+ *
+ * Endpoints are paired closest first, each endpoint with at most one other,
+ * and joints become the midpoint of the paired endpoints. Closed chains
+ * repeat their first point. `offsets` receives n + 1 entries delimiting the
+ * n polylines in `points`.
+ */
+void join_segments(const std::vector<Line<double>>& lines, double tol, std::vector<cv::Point2f>& points, std::vector<uint32_t>& offsets);
+
+#endif /* defined(LINE_MERGE_HPP) */
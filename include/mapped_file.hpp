@@ -0,0 +1,34 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A whole file, mapped read-only. The pages are shared with every
+ * other process mapping the same file. Where mmap() is unavailable the
+ * contents are read into memory instead.
+ *
+ * With `copyOnWrite` the mapping is private and writable: pages are still
+ * shared until written to, and writes never reach the file.
+ */
+struct MappedFile {
+  std::string path;
+  const char* data = nullptr;
+  size_t size = 0;
+
+  explicit MappedFile(const std::string& path, bool copyOnWrite = false);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool isMapped() const { return mapped; }
+
+private:
+  std::vector<char> buffer;
+  bool mapped = false;
+};
+
+#endif /* defined(MAPPED_FILE_HPP) */
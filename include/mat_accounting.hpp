@@ -0,0 +1,54 @@
+#ifndef MAT_ACCOUNTING_HPP
+#define MAT_ACCOUNTING_HPP
+
+#include <opencv2/core.hpp>
+#include <cstddef>
+
+/**
+ * @brief Accounting of pixel memory allocated outside the QuickJS heap.
+ *
+ * matAccountingInstall() makes a counting wrapper around OpenCV's
+ * standard allocator the default MatAllocator. Every Mat buffer, and
+ * every UMat buffer while OpenCL is off, is then counted when it is
+ * allocated and again when the last reference releases it. That happens
+ * whether the release comes from a finalizer, release(), an ArrayBuffer
+ * free function, or OpenCV itself. Buffers allocated before installation
+ * keep their own allocator and are never counted.
+ *
+ * The bindings ask matAccountingPressure() before they wrap a new Mat,
+ * UMat or vector. When live bytes exceed the threshold, they run the
+ * garbage collector and call matAccountingCollected(). The threshold
+ * then becomes 1.5 times the bytes still alive, but never less than the
+ * base set with matAccountingSetThreshold().
+ *
+ * Vector element storage comes from std::allocator, not a MatAllocator,
+ * so it never reaches the live bytes: vectors are counted as objects only.
+ */
+enum MatAccountingKind {
+  MAT_ACCOUNTING_MAT = 0,
+  MAT_ACCOUNTING_UMAT,
+  MAT_ACCOUNTING_VECTOR,
+  MAT_ACCOUNTING_KINDS,
+};
+
+struct MatAccountingStats {
+  size_t live, peak, buffers;
+  size_t allocations, collections;
+  size_t threshold;
+  ptrdiff_t objects[MAT_ACCOUNTING_KINDS];
+};
+
+void matAccountingInstall();
+
+/** @brief Counts live binding objects of a kind: +1 when wrapped, -1 when finalized. */
+void matAccountingObject(MatAccountingKind kind, int delta);
+
+bool matAccountingPressure();
+void matAccountingCollected();
+
+/** @brief Base GC threshold in bytes; 0 never asks for a collection. */
+void matAccountingSetThreshold(size_t bytes);
+
+MatAccountingStats matAccountingStats();
+
+#endif /* defined(MAT_ACCOUNTING_HPP) */
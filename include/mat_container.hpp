@@ -0,0 +1,35 @@
+#ifndef MAT_CONTAINER_HPP
+#define MAT_CONTAINER_HPP
+
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Binary container of named Mats, for caches too big for
+ * FileStorage's text formats.
+ *
+ * The file holds a header, a directory with each entry's name, type,
+ * sizes, steps, offset and codec, then the payloads. Each payload starts
+ * on a 64-byte boundary. Values are in the writer's byte order, and
+ * loading rejects files from a host with another byte order.
+ *
+ * Uncompressed entries are loaded as Mats aliasing a private mapping of
+ * the file. Pages are read on first access and shared between processes
+ * until written to. Writes are never stored back. zstd entries are
+ * decompressed into memory.
+ */
+struct MatEntry {
+  std::string name;
+  cv::Mat mat;
+};
+
+/** @brief zstdLevel > 0 compresses each payload; throws without zstd support. */
+void saveMats(const std::string& path, const std::vector<MatEntry>& entries, int zstdLevel = 0);
+
+/** @brief With `map` false, even uncompressed entries are copied into memory. */
+std::vector<MatEntry> loadMats(const std::string& path, bool map = true);
+
+bool matContainerHasZstd();
+
+#endif /* defined(MAT_CONTAINER_HPP) */
@@ -0,0 +1,62 @@
+#ifndef MODEL_CACHE_HPP
+#define MODEL_CACHE_HPP
+
+#include "mapped_file.hpp"
+#include <opencv2/dnn.hpp>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The read-only contents of a model file, mapped once per process
+ * and released when the last user drops it.
+ */
+struct ModelBytes : MappedFile {
+  int64_t mtime = 0;
+
+  ModelBytes(const std::string& path, int64_t mtime) : MappedFile(path), mtime(mtime) {}
+};
+
+/**
+ * @brief A parsed network handed to every caller asking for the same model.
+ * Weights exist once; setInput()/forward() must be done while holding `lock`.
+ */
+struct SharedNet {
+  cv::dnn::Net net;
+  std::shared_ptr<std::mutex> lock = std::make_shared<std::mutex>();
+};
+
+struct ModelCacheEntry {
+  std::string path;
+  int64_t mtime = 0;
+  size_t size = 0;
+  int backend = -1, target = -1;
+  bool shared = false;
+  long refs = 0;
+};
+
+/**
+ * @brief Mapping of `path` as it is now on disk. Callers asking for an
+ * unchanged file share one mapping; a newer mtime gets a fresh one.
+ */
+std::shared_ptr<const ModelBytes> model_cache_bytes(const std::string& path);
+
+/**
+ * @brief A new Net for `path`, parsed from the shared mapping where the
+ * format can be read from memory (ONNX), from the file otherwise. `bytes`
+ * receives the mapping so the caller can keep it alive alongside the Net.
+ */
+cv::dnn::Net model_cache_read(const std::string& path, int backend, int target, std::shared_ptr<const ModelBytes>* bytes = nullptr);
+
+/**
+ * @brief The one network for (path, mtime, backend, target), loaded on
+ * first use and unloaded after its last reference is gone.
+ */
+std::shared_ptr<SharedNet> model_cache_shared(const std::string& path, int backend, int target);
+
+/** @brief Everything currently held by the cache, with reference counts. */
+std::vector<ModelCacheEntry> model_cache_entries();
+
+#endif /* defined(MODEL_CACHE_HPP) */
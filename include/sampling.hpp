@@ -0,0 +1,33 @@
+#ifndef SAMPLING_HPP
+#define SAMPLING_HPP
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Next-token selection parameters, with the usual meaning from
+ * text generation: temperature <= 0 (or topK == 1) is greedy argmax, topK
+ * and topP restrict sampling to the most likely tokens, repetitionPenalty
+ * > 1 discourages the token ids in `history`.
+ */
+struct SampleOptions {
+  float temperature = 1, topP = 1, repetitionPenalty = 1;
+  int topK = 0;
+  /* number of most likely candidates to report, 0 for none */
+  int candidates = 0;
+  bool seeded = false;
+  uint64_t seed = 0;
+  std::vector<int32_t> history;
+};
+
+/**
+ * @brief Pick a token from `n` logits.
+ *
+ * Only the candidate set is ever sorted (partial selection), the full
+ * vocabulary is touched by the max/exp passes only. With
+ * options.candidates > 0, `ids` and `probs` receive the most likely tokens
+ * and their probabilities under the distribution that was sampled from.
+ */
+int32_t sample_logits(const float* logits, int n, const SampleOptions& options, std::vector<int32_t>* ids = nullptr, std::vector<float>* probs = nullptr);
+
+#endif /* defined(SAMPLING_HPP) */
@@ -0,0 +1,85 @@
+#ifndef SVG_WRITER_HPP
+#define SVG_WRITER_HPP
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Streaming SVG serializer for point data.
+ *
+ * Shapes go straight from point Mats (N x 1 CV_32SC2, CV_32FC2 or
+ * CV_64FC2) into path data, placed by an optional affine or perspective
+ * transform. Coordinates are quantized to `precision` decimals first, so
+ * relative commands are exact differences of the absolute positions and
+ * never drift. Path data is compressed: repeated commands are implied,
+ * separators are left out where a sign or decimal point delimits numbers,
+ * axis-aligned steps use h/v and repeated vertices are dropped.
+ *
+ * Output is buffered and handed to `sink` whenever `chunkSize` bytes have
+ * accumulated, and on finish().
+ */
+class SvgWriter {
+public:
+  typedef std::function<void(const char*, size_t)> sink_type;
+  typedef std::vector<std::pair<std::string, std::string>> attributes_type;
+
+  SvgWriter(sink_type sink, int precision = 3, bool relative = true, size_t chunkSize = 1 << 16);
+
+  /** @brief The <svg> element; width/height 0 leave them out. */
+  void begin(double width, double height, const attributes_type& attrs = attributes_type());
+  void finish();
+
+  void beginGroup(const attributes_type& attrs = attributes_type());
+  void endGroup();
+
+  /** @brief Placement for everything written after it (3x3 or 2x3 CV_64F). */
+  void setTransform(const cv::Matx33d& matrix);
+  void resetTransform();
+
+  /** @brief One <path>, a subpath per point list. */
+  void path(const std::vector<cv::Mat>& polylines, bool closed, const attributes_type& attrs);
+  /** @brief One <path> of segments, a Vec4 x1,y1,x2,y2 per element of `lines`. */
+  void lines(const cv::Mat& lines, const attributes_type& attrs);
+  /** @brief An <ellipse> per cx, cy, width, height, angle (degrees) row. */
+  void ellipses(const cv::Mat& ellipses, const attributes_type& attrs);
+  /** @brief Verbatim markup, e.g. <defs>. */
+  void raw(const std::string& text);
+
+  size_t bytesWritten() const { return written + buffer.size(); }
+  int depth() const { return int(groups); }
+
+  static std::string escape(const std::string& text);
+
+private:
+  sink_type sink;
+  std::string buffer;
+  size_t chunk_size, written = 0, groups = 0;
+  int precision;
+  bool relative, open = false;
+  double scale;
+  cv::Matx33d transform = cv::Matx33d::eye();
+  bool affine = true, identity = true;
+
+  /* path data state */
+  int64_t cur_x = 0, cur_y = 0, start_x = 0, start_y = 0;
+  char command = 0;
+  bool number_has_point = false, after_number = false;
+
+  void flush(bool force = false);
+  void element(const char* name, const attributes_type& attrs, bool close);
+  void attribute(const std::string& name, const std::string& value);
+  void number(int64_t q);
+  void op(char c);
+  void moveTo(int64_t x, int64_t y);
+  void lineTo(int64_t x, int64_t y);
+  void closePath();
+  cv::Point2d place(double x, double y) const;
+
+  template<class T> void subpath(const cv::Mat& points, bool closed);
+};
+
+#endif /* defined(SVG_WRITER_HPP) */
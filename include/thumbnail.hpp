@@ -0,0 +1,37 @@
+#ifndef THUMBNAIL_HPP
+#define THUMBNAIL_HPP
+
+#include <opencv2/core/mat.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A decoded thumbnail, no larger than max_size on its longer side,
+ * together with the dimensions of the source it was made from.
+ */
+struct Thumbnail {
+  cv::Mat image;
+  int width = 0, height = 0;
+};
+
+bool jpeg_dimensions(const uint8_t* data, size_t len, int& width, int& height);
+uint64_t thumbnail_hash(const std::string& filename);
+std::string thumbnail_cache_dir();
+
+bool thumbnail_make(const std::string& filename, int max_size, Thumbnail& out);
+bool thumbnail_load(const std::string& cache_file, Thumbnail& out);
+bool thumbnail_save(const std::string& cache_file, const Thumbnail& thumb);
+
+/**
+ * @brief Decode thumbnails for all `paths` on OpenCV's thread pool.
+ *
+ * JPEGs are decoded at 1/2, 1/4 or 1/8 scale (IMREAD_REDUCED_*) whenever
+ * that still yields at least max_size pixels; videos contribute a single
+ * frame from 10% into the stream. With a non-empty `cache_dir`, results are
+ * stored under a hash of the file content and max_size, so an unchanged
+ * file is never decoded twice.
+ */
+std::vector<Thumbnail> thumbnails(const std::vector<std::string>& paths, int max_size, const std::string& cache_dir);
+
+#endif /* defined(THUMBNAIL_HPP) */
@@ -0,0 +1,61 @@
+#ifndef VIDEO_INDEX_HPP
+#define VIDEO_INDEX_HPP
+
+#include <opencv2/videoio.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Identity of a video file on disk: a sidecar index is only reused
+ * when path, size and mtime all still match.
+ */
+struct VideoFileKey {
+  std::string path;
+  uint64_t size = 0;
+  int64_t mtime = 0;
+
+  bool stat(const std::string& filename);
+
+  bool operator==(const VideoFileKey& other) const { return size == other.size && mtime == other.mtime && path == other.path; }
+  bool operator!=(const VideoFileKey& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Frame number -> nearest preceding keyframe and presentation
+ * timestamp, built once per file by scanning its packets without decoding
+ * them (FFmpeg raw mode, CAP_PROP_FORMAT = -1).
+ *
+ * build() fails when raw mode isn't available rather than decode the file;
+ * callers then seek with CAP_PROP_POS_FRAMES. When the packets carry no
+ * keyframe flags, every frame is recorded as its own keyframe, which makes
+ * video_seek() degrade to that same plain seek.
+ */
+struct VideoSeekIndex {
+  VideoFileKey key;
+  double fps = 0;
+  std::vector<int32_t> keyframe;
+  std::vector<double> msec;
+
+  size_t size() const { return keyframe.size(); }
+  bool empty() const { return keyframe.empty(); }
+
+  bool build(const std::string& filename);
+  bool load(const std::string& sidecar);
+  bool save(const std::string& sidecar) const;
+
+  std::vector<int32_t> keyframes() const;
+
+  static std::string sidecar_path(const std::string& filename);
+  static std::shared_ptr<VideoSeekIndex> get(const std::string& filename, const std::string& sidecar = std::string(), bool rebuild = false);
+};
+
+/**
+ * @brief Position `cap` so that its next read() returns `frame`, grabbing
+ * forward from the current position when that is already between the
+ * frame's keyframe and the frame, otherwise seeking to the keyframe first.
+ */
+bool video_seek(cv::VideoCapture& cap, const VideoSeekIndex& index, int32_t frame);
+
+#endif /* defined(VIDEO_INDEX_HPP) */
@@ -7,7 +7,7 @@
 
 import * as fs from 'fs';
 import * as path from 'path';
-import { Mat, imread, VideoCapture, CAP_PROP_FRAME_COUNT, CAP_PROP_POS_FRAMES } from 'opencv.so';
+import { Mat, imread, thumbnails, VideoCapture, CAP_PROP_FRAME_COUNT, CAP_PROP_POS_FRAMES } from 'opencv.so';
 
 const IMAGE_EXT = new Set(['.png', '.jpg', '.jpeg', '.bmp', '.webp', '.tif', '.tiff', '.gif', '.ppm', '.pgm']);
 const VIDEO_EXT = new Set(['.mp4', '.avi', '.mov', '.mkv', '.webm', '.m4v', '.mpg', '.mpeg']);
@@ -47,14 +47,25 @@ export class Loader {
     }
   }
 
+  // Reduced-size previews for a batch of sources, decoded in parallel
+  // natively (JPEGs at 1/2..1/8 scale, one frame per video) and served from
+  // the on-disk thumbnail cache on later runs. Each entry is
+  // { image, width, height } with the source's intrinsic size, or null.
+  thumbnails(sources, maxSize = 256) {
+    return thumbnails(sources.map(s => s.uri), maxSize);
+  }
+
   // Extract one frame as a fresh Mat. Video captures are cached per-uri so
-  // scrubbing in the GUI does not reopen the file each time.
+  // scrubbing in the GUI does not reopen the file each time; seek() goes
+  // through the capture's keyframe index (sidecar <uri>.seekidx) and only
+  // decodes forward from the nearest keyframe.
   extractFrame(source, index = 0) {
     if(source.kind === 'image') return imread(source.uri);
     const cap = this._cap(source.uri);
     const mat = new Mat();
     try {
-      cap.set(CAP_PROP_POS_FRAMES, index);
+      if(cap.seek) cap.seek(index);
+      else cap.set(CAP_PROP_POS_FRAMES, index);
       cap.read(mat);
     } catch(_) {}
     return mat;
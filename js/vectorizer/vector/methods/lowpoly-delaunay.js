@@ -5,7 +5,7 @@
 // colour sampled at its centroid. Produces the classic faceted "low-poly" look.
 
 import {
-  Mat, Rect, Point, Subdiv2D, goodFeaturesToTrack, Canny,
+  Mat, Rect, Subdiv2D, goodFeaturesToTrack, Canny,
 } from 'opencv.so';
 
 import { VectorMethod } from '../base.js';
@@ -46,15 +46,17 @@ export class LowPolyDelaunay extends VectorMethod {
         }
     }
 
+    const xy = new Float32Array(pts.length * 2);
+    pts.forEach(([x, y], i) => { xy[2 * i] = x; xy[2 * i + 1] = y; });
+
+    // One native call for the whole point set; points outside the rect are skipped.
     const subdiv = new Subdiv2D(new Rect(0, 0, W, H));
-    for (const [x, y] of pts) {
-      try { subdiv.insert(new Point(x, y)); } catch (_) {}
-    }
-    const tris = subdiv.getTriangleList();   // -> rows of [x1,y1,x2,y2,x3,y3]
+    subdiv.insert(xy);
+    const tris = subdiv.getTriangleList();   // -> Float32Array, x1,y1,x2,y2,x3,y3 per triangle
 
     const shapes = [];
-    for (const t of tris) {
-      const a = [t[0], t[1]], b = [t[2], t[3]], c = [t[4], t[5]];
+    for (let i = 0; i < tris.length; i += 6) {
+      const a = [tris[i], tris[i + 1]], b = [tris[i + 2], tris[i + 3]], c = [tris[i + 4], tris[i + 5]];
       if (![a, b, c].every((q) => q[0] >= 0 && q[1] >= 0 && q[0] <= W && q[1] <= H)) continue;
       const cx = (a[0] + b[0] + c[0]) / 3, cy = (a[1] + b[1] + c[1]) / 3;
       const fill = colorAt(mat, cx, cy, 1);
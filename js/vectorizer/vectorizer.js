@@ -90,7 +90,7 @@ async function main(...args) {
   const pipeline = new Pipeline(model, { loader, registry, composer });
 
   // Stage 1 discovery: turn CLI paths into sources, then attach a cheap
-  // first-frame preview (and intrinsic w/h) so the loader grid can render
+  // reduced-size preview (and intrinsic w/h) so the loader grid can render
   // thumbnails without re-reading on every draw.
   const fallbackMethod = registry.has(opts.method) ? opts.method : registry.first().id;
   const sources = pipeline.discover(opts.paths);
@@ -99,17 +99,23 @@ async function main(...args) {
     return 1;
   }
 
-  for(const s of sources) {
-    const src = model.addSource(s.kind, s.uri, s.frameCount);
-    try {
-      const prev = loader.extractFrame(src, 0);
-      src._preview = prev;
-      src._w = prev.cols ?? prev.width;
-      src._h = prev.rows ?? prev.height;
-    } catch(e) {
-      console.log('preview failed for', s.uri, String((e && e.message) || e));
-    }
+  const added = sources.map(s => model.addSource(s.kind, s.uri, s.frameCount));
+  let previews = [];
+  try {
+    previews = loader.thumbnails(added);
+  } catch(e) {
+    console.log('previews failed:', String((e && e.message) || e));
   }
+  added.forEach((src, i) => {
+    const prev = previews[i];
+    if(!prev) {
+      console.log('preview failed for', src.uri);
+      return;
+    }
+    src._preview = prev.image;
+    src._w = prev.width;
+    src._h = prev.height;
+  });
 
   const jobs = new JobRunner(WORKER_PATH);
   const app = new App({ model, pipeline, registry, jobs });
@@ -1,4 +1,5 @@
 #include "js_alloc.hpp"
+#include "js_cv.hpp"
 #include "js_size.hpp"
 #include "js_point.hpp"
 #include "js_mat.hpp"
@@ -6,6 +7,11 @@
 #include "include/js_inputoutputarray.hpp"
 #include <opencv2/video/background_segm.hpp>
 #include <opencv2/bgsegm.hpp>
+#include <opencv2/imgproc.hpp>
+#include <cinttypes>
+#include <exception>
+#include <memory>
+#include <vector>
 
 typedef cv::BackgroundSubtractor JSBackgroundSubtractorClass;
 typedef cv::Ptr<JSBackgroundSubtractorClass> JSBackgroundSubtractorData;
@@ -257,6 +263,177 @@ js_bg_subtractor_method(JSContext* ctx, JSValueConst this_val, int argc, JSValue
   return JS_UNDEFINED;
 }
 
+/**
+ * cv.applyBackgroundSubtractors(subtractors, frames, masks?, learningRate | options?)
+ *
+ * Runs subtractors[i].apply(frames[i], masks[i]) for every stream at once,
+ * one stream per task on OpenCV's thread pool. The subtractors hold
+ * independent models, so streams don't share any state; a subtractor, and
+ * a mask buffer, may only appear once in the list.
+ *
+ * options: { learningRate = -1, scale = 1 }. With scale < 1 each frame is
+ * shrunk (INTER_AREA) before it reaches the model and the mask is scaled
+ * back up (INTER_NEAREST) to the frame size. A model is sized by the
+ * first frame it sees, so keep the scale of a stream constant.
+ *
+ * `masks` entries that are Mats receive the result in place, missing
+ * entries get a new Mat; the masks are returned as an array.
+ */
+static JSValue
+js_bg_subtractor_apply_all(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  /* downscaled frames and masks, kept between calls */
+  static thread_local std::vector<cv::Mat> small_buf, small_mask_buf;
+  /* the pool threads have thread_locals of their own - hand them these */
+  std::vector<cv::Mat>& small = small_buf;
+  std::vector<cv::Mat>& small_mask = small_mask_buf;
+  std::vector<JSBackgroundSubtractorClass*> subtractors;
+  std::vector<cv::Mat> frames, masks;
+  std::vector<JSValue> mask_values;
+  std::vector<std::exception_ptr> errors;
+  double learning_rate = -1, scale = 1;
+  int64_t n;
+  JSValue ret = JS_EXCEPTION;
+
+  if(argc < 2 || !js_is_array(ctx, argv[0]) || !js_is_array(ctx, argv[1]))
+    return JS_ThrowTypeError(ctx, "cv.applyBackgroundSubtractors(subtractors[], frames[], masks[]?, learningRate | options?)");
+
+  n = js_array_length(ctx, argv[0]);
+
+  if(js_array_length(ctx, argv[1]) != n)
+    return JS_ThrowRangeError(ctx, "cv.applyBackgroundSubtractors: %" PRId64 " subtractors but %" PRId64 " frames", n, js_array_length(ctx, argv[1]));
+
+  if(argc > 3) {
+    if(JS_IsNumber(argv[3])) {
+      JS_ToFloat64(ctx, &learning_rate, argv[3]);
+    } else if(JS_IsObject(argv[3])) {
+      JSValue value = JS_GetPropertyStr(ctx, argv[3], "learningRate");
+
+      if(!JS_IsUndefined(value))
+        JS_ToFloat64(ctx, &learning_rate, value);
+
+      JS_FreeValue(ctx, value);
+      value = JS_GetPropertyStr(ctx, argv[3], "scale");
+
+      if(!JS_IsUndefined(value))
+        JS_ToFloat64(ctx, &scale, value);
+
+      JS_FreeValue(ctx, value);
+    }
+
+    if(!(scale > 0 && scale <= 1))
+      return JS_ThrowRangeError(ctx, "cv.applyBackgroundSubtractors: scale must be in (0, 1]");
+  }
+
+  subtractors.resize(n);
+  frames.resize(n);
+  masks.resize(n);
+  mask_values.assign(n, JS_UNDEFINED);
+  errors.resize(n);
+
+  for(int64_t i = 0; i < n; ++i) {
+    JSValue item = JS_GetPropertyUint32(ctx, argv[0], i);
+    JSBackgroundSubtractorData* s = static_cast<JSBackgroundSubtractorData*>(JS_GetOpaque(item, js_bg_subtractor_class_id));
+
+    JS_FreeValue(ctx, item);
+
+    if(!s || !*s) {
+      JS_ThrowTypeError(ctx, "cv.applyBackgroundSubtractors: subtractors[%" PRId64 "] is not a BackgroundSubtractor", i);
+      goto fail;
+    }
+
+    subtractors[i] = s->get();
+
+    for(int64_t j = 0; j < i; ++j)
+      if(subtractors[j] == subtractors[i]) {
+        JS_ThrowRangeError(ctx, "cv.applyBackgroundSubtractors: subtractors[%" PRId64 "] is subtractors[%" PRId64 "]", i, j);
+        goto fail;
+      }
+
+    item = JS_GetPropertyUint32(ctx, argv[1], i);
+    cv::Mat* mat = js_mat_data_nothrow(item);
+    JSUMatData* umat = mat ? nullptr : js_umat_data(item);
+
+    JS_FreeValue(ctx, item);
+
+    if(!mat && !umat) {
+      JS_ThrowTypeError(ctx, "cv.applyBackgroundSubtractors: frames[%" PRId64 "] is not a Mat or UMat", i);
+      goto fail;
+    }
+
+    /* workers run on the CPU path; a UMat is mapped here, on the calling thread */
+    frames[i] = mat ? *mat : umat->getMat(cv::ACCESS_READ);
+
+    if(argc > 2 && js_is_array(ctx, argv[2]))
+      item = JS_GetPropertyUint32(ctx, argv[2], i);
+    else
+      item = JS_UNDEFINED;
+
+    if((mat = js_mat_data_nothrow(item))) {
+      masks[i] = *mat;
+      mask_values[i] = item;
+
+      /* two workers would write the same buffer */
+      for(int64_t j = 0; j < i; ++j)
+        if(js_mat_data_nothrow(mask_values[j]) == mat || (masks[i].data && masks[j].data == masks[i].data)) {
+          JS_ThrowRangeError(ctx, "cv.applyBackgroundSubtractors: masks[%" PRId64 "] is masks[%" PRId64 "]", i, j);
+          goto fail;
+        }
+    } else {
+      JS_FreeValue(ctx, item);
+    }
+  }
+
+  small.resize(n);
+  small_mask.resize(n);
+
+  cv::parallel_for_(
+      cv::Range(0, int(n)),
+      [&](const cv::Range& range) {
+        for(int i = range.start; i < range.end; ++i) {
+          try {
+            if(scale < 1) {
+              cv::resize(frames[i], small[i], cv::Size(), scale, scale, cv::INTER_AREA);
+              subtractors[i]->apply(small[i], small_mask[i], learning_rate);
+              cv::resize(small_mask[i], masks[i], frames[i].size(), 0, 0, cv::INTER_NEAREST);
+            } else {
+              subtractors[i]->apply(frames[i], masks[i], learning_rate);
+            }
+          } catch(const std::exception&) { errors[i] = std::current_exception(); }
+        }
+      },
+      double(n));
+
+  for(int64_t i = 0; i < n; ++i)
+    if(errors[i]) {
+      try {
+        std::rethrow_exception(errors[i]);
+      } catch(const std::exception& e) { js_cv_throw(ctx, e); }
+      goto fail;
+    }
+
+  ret = JS_NewArray(ctx);
+
+  for(int64_t i = 0; i < n; ++i) {
+    cv::Mat* mat;
+
+    /* a passed Mat was reallocated by apply() if its size or type didn't fit */
+    if((mat = js_mat_data_nothrow(mask_values[i]))) {
+      *mat = masks[i];
+      JS_SetPropertyUint32(ctx, ret, i, mask_values[i]);
+    } else {
+      JS_SetPropertyUint32(ctx, ret, i, js_mat_wrap(ctx, masks[i]));
+    }
+
+    mask_values[i] = JS_UNDEFINED;
+  }
+
+fail:
+  for(JSValue& value : mask_values)
+    JS_FreeValue(ctx, value);
+
+  return ret;
+}
+
 JSClassDef js_bg_subtractor_class = {
     .class_name = "BackgroundSubtractor",
     .finalizer = js_bg_subtractor_finalizer,
@@ -276,6 +453,7 @@ const JSCFunctionListEntry js_bg_subtractor_create_funcs[] = {
     JS_CFUNC_MAGIC_DEF("createBackgroundSubtractorLSBP", 0, js_bg_subtractor_function, BGSEGM_LSBP),
     JS_CFUNC_MAGIC_DEF("createBackgroundSubtractorMOG2", 0, js_bg_subtractor_function, BGSEGM_MOG2),
     JS_CFUNC_MAGIC_DEF("createBackgroundSubtractorKNN", 0, js_bg_subtractor_function, BGSEGM_KNN),
+    JS_CFUNC_DEF("applyBackgroundSubtractors", 2, js_bg_subtractor_apply_all),
     JS_PROP_INT32_DEF("LSBP_CAMERA_MOTION_COMPENSATION_NONE", cv::bgsegm::LSBP_CAMERA_MOTION_COMPENSATION_NONE, 0),
     JS_PROP_INT32_DEF("LSBP_CAMERA_MOTION_COMPENSATION_LK", cv::bgsegm::LSBP_CAMERA_MOTION_COMPENSATION_LK, 0),
 };
@@ -0,0 +1,363 @@
+#include "js_alloc.hpp"
+#include "js_cv.hpp"
+#include "js_mat.hpp"
+#include "js_umat.hpp"
+#include "include/js_array.hpp"
+#include "include/js_typed_array.hpp"
+#include "include/jsbindings.hpp"
+#include "include/binary_matcher.hpp"
+#include <opencv2/core.hpp>
+#include <quickjs.h>
+#include <new>
+#include <vector>
+
+enum {
+  BINARY_MATCHER_ADD = 0,
+  BINARY_MATCHER_CLEAR,
+  BINARY_MATCHER_KNN_MATCH,
+  BINARY_MATCHER_MATCH,
+};
+
+enum {
+  BINARY_MATCHER_SIZE = 0,
+  BINARY_MATCHER_DESCRIPTOR_SIZE,
+};
+
+extern "C" {
+thread_local JSValue binary_matcher_proto = JS_UNDEFINED, binary_matcher_class = JS_UNDEFINED;
+thread_local JSClassID js_binary_matcher_class_id = 0;
+}
+
+static BinaryMatcher*
+js_binary_matcher_data2(JSContext* ctx, JSValueConst val) {
+  return static_cast<BinaryMatcher*>(JS_GetOpaque2(ctx, val, js_binary_matcher_class_id));
+}
+
+/* descriptor rows from a Mat or UMat */
+static bool
+js_binary_matcher_descriptors(JSValueConst value, cv::Mat& out) {
+  cv::Mat* mat;
+  JSUMatData* umat;
+
+  if((mat = js_mat_data_nothrow(value)))
+    out = *mat;
+  else if((umat = js_umat_data(value)))
+    out = umat->getMat(cv::ACCESS_READ);
+  else
+    return false;
+
+  return true;
+}
+
+/* a Mat/UMat, or an array of them; throws a TypeError or the cv::Exception */
+static bool
+js_binary_matcher_add(JSContext* ctx, BinaryMatcher* bm, JSValueConst value) {
+  std::vector<cv::Mat> sets;
+
+  if(js_is_array(ctx, value)) {
+    uint32_t length = js_array_length(ctx, value);
+
+    sets.resize(length);
+
+    for(uint32_t i = 0; i < length; ++i) {
+      JSValue item = JS_GetPropertyUint32(ctx, value, i);
+      bool ok = js_binary_matcher_descriptors(item, sets[i]);
+
+      JS_FreeValue(ctx, item);
+
+      if(!ok) {
+        JS_ThrowTypeError(ctx, "descriptors[%u] is not a Mat or UMat", i);
+        return false;
+      }
+    }
+  } else {
+    sets.resize(1);
+
+    if(!js_binary_matcher_descriptors(value, sets[0])) {
+      JS_ThrowTypeError(ctx, "descriptors must be a Mat, a UMat or an array of them");
+      return false;
+    }
+  }
+
+  try {
+    for(const cv::Mat& set : sets)
+      bm->add(set);
+  } catch(const cv::Exception& e) {
+    js_cv_throw(ctx, e);
+    return false;
+  }
+
+  return true;
+}
+
+static JSValue
+js_binary_matcher_get_option(JSContext* ctx, JSValueConst options, const char* name) {
+  return JS_IsObject(options) ? JS_GetPropertyStr(ctx, options, name) : JS_UNDEFINED;
+}
+
+static void
+js_binary_matcher_option(JSContext* ctx, JSValueConst options, const char* name, int32_t& out) {
+  JSValue value = js_binary_matcher_get_option(ctx, options, name);
+
+  if(!JS_IsUndefined(value))
+    JS_ToInt32(ctx, &out, value);
+
+  JS_FreeValue(ctx, value);
+}
+
+static void
+js_binary_matcher_option(JSContext* ctx, JSValueConst options, const char* name, bool& out) {
+  JSValue value = js_binary_matcher_get_option(ctx, options, name);
+
+  if(!JS_IsUndefined(value))
+    out = JS_ToBool(ctx, value);
+
+  JS_FreeValue(ctx, value);
+}
+
+/**
+ * new BinaryMatcher(train?, { tables = 8, keyBits = 16, probes = 1, seed })
+ *
+ * `train` is a Mat/UMat of CV_8UC1 descriptor rows, or an array of them.
+ * The options configure the LSH index used by `{ lsh: true }` searches.
+ */
+static JSValue
+js_binary_matcher_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  JSValue obj = JS_UNDEFINED, proto;
+  BinaryMatcher* bm;
+  BinaryMatcher::LshParams params;
+  JSValueConst options = argc > 1 ? argv[1] : JS_UNDEFINED;
+  int32_t seed = int32_t(params.seed);
+
+  js_binary_matcher_option(ctx, options, "tables", params.tables);
+  js_binary_matcher_option(ctx, options, "keyBits", params.keyBits);
+  js_binary_matcher_option(ctx, options, "probes", params.probes);
+  js_binary_matcher_option(ctx, options, "seed", seed);
+  params.seed = uint32_t(seed);
+
+  if(params.tables < 1 || params.keyBits < 1 || params.keyBits > 32 || params.probes < 0 || params.probes > 2)
+    return JS_ThrowRangeError(ctx, "tables must be at least 1, keyBits 1 to 32 and probes 0 to 2");
+
+  if(!(bm = js_allocate<BinaryMatcher>(ctx)))
+    return JS_EXCEPTION;
+
+  new(bm) BinaryMatcher(params);
+
+  if(argc > 0 && !JS_IsUndefined(argv[0]) && !JS_IsNull(argv[0]))
+    if(!js_binary_matcher_add(ctx, bm, argv[0]))
+      goto fail;
+
+  /* using new_target to get the prototype is necessary when the class is extended. */
+  proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    goto fail;
+
+  obj = JS_NewObjectProtoClass(ctx, proto, js_binary_matcher_class_id);
+  JS_FreeValue(ctx, proto);
+  if(JS_IsException(obj))
+    goto fail;
+
+  JS_SetOpaque(obj, bm);
+  return obj;
+
+fail:
+  bm->~BinaryMatcher();
+  js_deallocate(ctx, bm);
+  JS_FreeValue(ctx, obj);
+  return JS_EXCEPTION;
+}
+
+/**
+ * add(descriptors)                  Mat/UMat or array of them
+ * clear()
+ * knnMatch(query, k = 2, { lsh })   -> { k, trainIdx, distance }, Int32Arrays
+ *                                      of query rows x k, -1 where missing
+ * match(query, { ratio, crossCheck, maxDistance, lsh })
+ *                                   -> { queryIdx, trainIdx, distance }
+ *
+ * Train indices count rows across everything added so far.
+ */
+static JSValue
+js_binary_matcher_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  BinaryMatcher* bm;
+  cv::Mat query;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(bm = js_binary_matcher_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  if((magic == BINARY_MATCHER_KNN_MATCH || magic == BINARY_MATCHER_MATCH) && (argc < 1 || !js_binary_matcher_descriptors(argv[0], query)))
+    return JS_ThrowTypeError(ctx, "argument 1 must be a Mat or UMat of query descriptors");
+
+  try {
+    switch(magic) {
+      case BINARY_MATCHER_ADD: {
+        if(argc < 1)
+          return JS_ThrowTypeError(ctx, "expecting descriptors");
+
+        if(!js_binary_matcher_add(ctx, bm, argv[0]))
+          return JS_EXCEPTION;
+
+        break;
+      }
+
+      case BINARY_MATCHER_CLEAR: {
+        bm->clear();
+        break;
+      }
+
+      case BINARY_MATCHER_KNN_MATCH: {
+        int32_t k = 2;
+        bool lsh = false;
+        std::vector<int32_t> train_idx, distance;
+
+        if(argc > 1 && !JS_IsUndefined(argv[1]))
+          JS_ToInt32(ctx, &k, argv[1]);
+
+        if(k < 1)
+          return JS_ThrowRangeError(ctx, "k must be at least 1");
+
+        js_binary_matcher_option(ctx, argc > 2 ? argv[2] : JS_UNDEFINED, "lsh", lsh);
+        bm->knnMatch(query, k, lsh, train_idx, distance);
+
+        ret = JS_NewObject(ctx);
+        JS_SetPropertyStr(ctx, ret, "k", JS_NewInt32(ctx, k));
+        JS_SetPropertyStr(ctx, ret, "trainIdx", js_typedarray_from(ctx, train_idx.data(), train_idx.data() + train_idx.size()));
+        JS_SetPropertyStr(ctx, ret, "distance", js_typedarray_from(ctx, distance.data(), distance.data() + distance.size()));
+        break;
+      }
+
+      case BINARY_MATCHER_MATCH: {
+        JSValueConst options = argc > 1 ? argv[1] : JS_UNDEFINED;
+        JSValue value = js_binary_matcher_get_option(ctx, options, "ratio");
+        double ratio = 0;
+        int32_t max_distance = -1;
+        bool cross_check = false, lsh = false;
+        std::vector<BinaryMatcher::Match> matches;
+        std::vector<int32_t> query_idx, train_idx, distance;
+
+        if(!JS_IsUndefined(value))
+          JS_ToFloat64(ctx, &ratio, value);
+
+        JS_FreeValue(ctx, value);
+        js_binary_matcher_option(ctx, options, "crossCheck", cross_check);
+        js_binary_matcher_option(ctx, options, "maxDistance", max_distance);
+        js_binary_matcher_option(ctx, options, "lsh", lsh);
+
+        bm->match(query, float(ratio), cross_check, max_distance, lsh, matches);
+
+        query_idx.reserve(matches.size());
+        train_idx.reserve(matches.size());
+        distance.reserve(matches.size());
+
+        for(const BinaryMatcher::Match& m : matches) {
+          query_idx.push_back(m.queryIdx);
+          train_idx.push_back(m.trainIdx);
+          distance.push_back(m.distance);
+        }
+
+        ret = JS_NewObject(ctx);
+        JS_SetPropertyStr(ctx, ret, "queryIdx", js_typedarray_from(ctx, query_idx.data(), query_idx.data() + query_idx.size()));
+        JS_SetPropertyStr(ctx, ret, "trainIdx", js_typedarray_from(ctx, train_idx.data(), train_idx.data() + train_idx.size()));
+        JS_SetPropertyStr(ctx, ret, "distance", js_typedarray_from(ctx, distance.data(), distance.data() + distance.size()));
+        break;
+      }
+    }
+  } catch(const cv::Exception& e) {
+    JS_FreeValue(ctx, ret);
+    return js_cv_throw(ctx, e);
+  }
+
+  return ret;
+}
+
+static JSValue
+js_binary_matcher_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  BinaryMatcher* bm;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(bm = js_binary_matcher_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case BINARY_MATCHER_SIZE: {
+      ret = JS_NewInt32(ctx, bm->size());
+      break;
+    }
+
+    case BINARY_MATCHER_DESCRIPTOR_SIZE: {
+      ret = JS_NewInt32(ctx, bm->descriptorSize());
+      break;
+    }
+  }
+
+  return ret;
+}
+
+void
+js_binary_matcher_finalizer(JSRuntime* rt, JSValue val) {
+  BinaryMatcher* bm;
+
+  if((bm = static_cast<BinaryMatcher*>(JS_GetOpaque(val, js_binary_matcher_class_id)))) {
+    bm->~BinaryMatcher();
+    js_deallocate(rt, bm);
+  }
+}
+
+JSClassDef js_binary_matcher_class = {
+    .class_name = "BinaryMatcher",
+    .finalizer = js_binary_matcher_finalizer,
+};
+
+const JSCFunctionListEntry js_binary_matcher_proto_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("add", 1, js_binary_matcher_method, BINARY_MATCHER_ADD),
+    JS_CFUNC_MAGIC_DEF("clear", 0, js_binary_matcher_method, BINARY_MATCHER_CLEAR),
+    JS_CFUNC_MAGIC_DEF("knnMatch", 2, js_binary_matcher_method, BINARY_MATCHER_KNN_MATCH),
+    JS_CFUNC_MAGIC_DEF("match", 1, js_binary_matcher_method, BINARY_MATCHER_MATCH),
+    JS_CGETSET_MAGIC_DEF("size", js_binary_matcher_get, 0, BINARY_MATCHER_SIZE),
+    JS_CGETSET_MAGIC_DEF("descriptorSize", js_binary_matcher_get, 0, BINARY_MATCHER_DESCRIPTOR_SIZE),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "BinaryMatcher", JS_PROP_CONFIGURABLE),
+};
+
+extern "C" int
+js_binary_matcher_init(JSContext* ctx, JSModuleDef* m) {
+
+  if(js_binary_matcher_class_id == 0) {
+    /* create the BinaryMatcher class */
+    JS_NewClassID(&js_binary_matcher_class_id);
+    JS_NewClass(JS_GetRuntime(ctx), js_binary_matcher_class_id, &js_binary_matcher_class);
+
+    binary_matcher_proto = JS_NewObject(ctx);
+    JS_SetPropertyFunctionList(ctx, binary_matcher_proto, js_binary_matcher_proto_funcs, countof(js_binary_matcher_proto_funcs));
+    JS_SetClassProto(ctx, js_binary_matcher_class_id, binary_matcher_proto);
+
+    binary_matcher_class = JS_NewCFunction2(ctx, js_binary_matcher_constructor, "BinaryMatcher", 2, JS_CFUNC_constructor, 0);
+    /* set proto.constructor and ctor.prototype */
+    JS_SetConstructor(ctx, binary_matcher_class, binary_matcher_proto);
+  }
+
+  if(m)
+    JS_SetModuleExport(ctx, m, "BinaryMatcher", binary_matcher_class);
+
+  return 0;
+}
+
+extern "C" void
+js_binary_matcher_export(JSContext* ctx, JSModuleDef* m) {
+  JS_AddModuleExport(ctx, m, "BinaryMatcher");
+}
+
+#if defined(JS_BINARY_MATCHER_MODULE)
+#define JS_INIT_MODULE VISIBLE js_init_module
+#else
+#define JS_INIT_MODULE js_init_module_binary_matcher
+#endif
+
+extern "C" JSModuleDef*
+JS_INIT_MODULE(JSContext* ctx, const char* module_name) {
+  JSModuleDef* m;
+  if(!(m = JS_NewCModule(ctx, module_name, &js_binary_matcher_init)))
+    return NULL;
+  js_binary_matcher_export(ctx, m);
+  return m;
+}
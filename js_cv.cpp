@@ -9,6 +9,8 @@
 #include "include/png_write.hpp"
 #include "include/png_read.hpp"
 #include "include/gif_write.hpp"
+#include "include/thumbnail.hpp"
+#include "include/mat_accounting.hpp"
 #include <quickjs.h>
 #include "include/util.hpp"
 #include "include/js_inputoutputarray.hpp"
@@ -122,6 +124,56 @@ js_cv_imread(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[
   } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
 }
 
+static JSValue
+js_cv_thumbnails(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  std::vector<std::string> paths;
+  std::vector<Thumbnail> thumbs;
+  std::string cache_dir = thumbnail_cache_dir();
+  int32_t max_size = 256;
+  JSValue ret;
+
+  if(js_array_to(ctx, argv[0], paths) < 0)
+    return JS_ThrowTypeError(ctx, "argument 1 must be an array of filenames");
+
+  if(argc > 1 && JS_ToInt32(ctx, &max_size, argv[1]))
+    return JS_EXCEPTION;
+
+  if(max_size <= 0)
+    return JS_ThrowRangeError(ctx, "maxSize must be positive");
+
+  if(argc > 2 && JS_IsObject(argv[2])) {
+    JSValue dir = JS_GetPropertyStr(ctx, argv[2], "cacheDir");
+
+    if(JS_IsString(dir))
+      js_value_to(ctx, dir, cache_dir);
+    else if(!JS_IsUndefined(dir) && !JS_ToBool(ctx, dir))
+      cache_dir.clear();
+
+    JS_FreeValue(ctx, dir);
+  }
+
+  try {
+    thumbs = thumbnails(paths, max_size, cache_dir);
+  } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
+
+  ret = JS_NewArray(ctx);
+
+  for(size_t i = 0; i < thumbs.size(); ++i) {
+    JSValue item = JS_NULL;
+
+    if(!thumbs[i].image.empty()) {
+      item = JS_NewObject(ctx);
+      JS_SetPropertyStr(ctx, item, "image", js_mat_wrap(ctx, thumbs[i].image));
+      JS_SetPropertyStr(ctx, item, "width", JS_NewInt32(ctx, thumbs[i].width));
+      JS_SetPropertyStr(ctx, item, "height", JS_NewInt32(ctx, thumbs[i].height));
+    }
+
+    JS_SetPropertyUint32(ctx, ret, i, item);
+  }
+
+  return ret;
+}
+
 static JSValue
 js_cv_imwrite(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
 
@@ -520,6 +572,57 @@ js_cv_cpu(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[],
   return ret;
 }
 
+enum {
+  MEMORY_USAGE = 0,
+  MEMORY_SET_THRESHOLD,
+};
+
+/**
+ * memoryUsage() -> { live, peak, buffers, allocations, collections,
+ *                    threshold, Mat, UMat, Vector }
+ * setMemoryThreshold(bytes)
+ *
+ * live/peak are bytes of Mat (and host UMat) buffers allocated outside
+ * the QuickJS heap, buffers the number alive. Mat, UMat and Vector count
+ * live binding objects; a Vector's elements aren't part of live. Once
+ * live exceeds threshold, wrapping a new object runs the GC; collections
+ * counts those runs. 0 disables it.
+ */
+static JSValue
+js_cv_memory(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  JSValue ret = JS_UNDEFINED;
+
+  switch(magic) {
+    case MEMORY_USAGE: {
+      MatAccountingStats stats = matAccountingStats();
+
+      ret = JS_NewObject(ctx);
+      JS_SetPropertyStr(ctx, ret, "live", JS_NewInt64(ctx, stats.live));
+      JS_SetPropertyStr(ctx, ret, "peak", JS_NewInt64(ctx, stats.peak));
+      JS_SetPropertyStr(ctx, ret, "buffers", JS_NewInt64(ctx, stats.buffers));
+      JS_SetPropertyStr(ctx, ret, "allocations", JS_NewInt64(ctx, stats.allocations));
+      JS_SetPropertyStr(ctx, ret, "collections", JS_NewInt64(ctx, stats.collections));
+      JS_SetPropertyStr(ctx, ret, "threshold", JS_NewInt64(ctx, stats.threshold));
+      JS_SetPropertyStr(ctx, ret, "Mat", JS_NewInt64(ctx, stats.objects[MAT_ACCOUNTING_MAT]));
+      JS_SetPropertyStr(ctx, ret, "UMat", JS_NewInt64(ctx, stats.objects[MAT_ACCOUNTING_UMAT]));
+      JS_SetPropertyStr(ctx, ret, "Vector", JS_NewInt64(ctx, stats.objects[MAT_ACCOUNTING_VECTOR]));
+      break;
+    }
+
+    case MEMORY_SET_THRESHOLD: {
+      int64_t bytes;
+
+      if(argc < 1 || JS_ToInt64(ctx, &bytes, argv[0]) || bytes < 0)
+        return JS_ThrowRangeError(ctx, "argument 1 must be a byte count >= 0");
+
+      matAccountingSetThreshold(bytes);
+      break;
+    }
+  }
+
+  return ret;
+}
+
 enum {
   BITWISE_AND = 0,
   BITWISE_OR,
@@ -1724,6 +1827,7 @@ js_function_list_t js_cv_static_funcs{
     JS_CFUNC_DEF("imencode", 1, js_cv_imencode),
     JS_CFUNC_DEF("imread", 1, js_cv_imread),
     JS_CFUNC_DEF("imwrite", 2, js_cv_imwrite),
+    JS_CFUNC_DEF("thumbnails", 2, js_cv_thumbnails),
     JS_CFUNC_DEF("matFromArray", 4, js_cv_matfromarray),
     JS_CFUNC_SPECIAL_DEF("TermCriteria", 3, constructor, js_cv_termcriteria_constructor),
     JS_CFUNC_DEF("split", 2, js_cv_split),
@@ -1736,6 +1840,8 @@ js_function_list_t js_cv_static_funcs{
     JS_CFUNC_MAGIC_DEF("getCPUTickCount", 0, js_cv_getticks, 2),
     JS_CFUNC_MAGIC_DEF("getNumberOfCPUs", 0, js_cv_cpu, 0),
     JS_CFUNC_MAGIC_DEF("getCPUFeaturesLine", 0, js_cv_cpu, 1),
+    JS_CFUNC_MAGIC_DEF("memoryUsage", 0, js_cv_memory, MEMORY_USAGE),
+    JS_CFUNC_MAGIC_DEF("setMemoryThreshold", 1, js_cv_memory, MEMORY_SET_THRESHOLD),
     JS_CFUNC_MAGIC_DEF("bitwise_and", 3, js_cv_bitwise, BITWISE_AND),
     JS_CFUNC_MAGIC_DEF("bitwise_or", 3, js_cv_bitwise, BITWISE_OR),
     JS_CFUNC_MAGIC_DEF("bitwise_xor", 3, js_cv_bitwise, BITWISE_XOR),
@@ -1878,6 +1984,7 @@ js_function_list_t js_cv_constants{
     JS_CONSTANT(CV_32S),
     JS_CONSTANT(CV_32F),
     JS_CONSTANT(CV_64F),
+    JS_CONSTANT(CV_16F),
     JS_CONSTANT(CV_8UC1),
     JS_CONSTANT(CV_8UC2),
     JS_CONSTANT(CV_8UC3),
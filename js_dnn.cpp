@@ -4,11 +4,42 @@
 #include "js_rotated_rect.hpp"
 #include "include/jsbindings.hpp"
 #include "include/js_inputoutputarray.hpp"
+#include "include/js_async.hpp"
+#include "include/kv_cache.hpp"
+#include "include/blob_builder.hpp"
+#include "include/model_cache.hpp"
+#include "include/sampling.hpp"
 #include <quickjs.h>
 
 #include <opencv2/dnn.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+
+/* What forwardAsync() needs besides the Net itself: the blobs given to
+ * setInput() (Net has no getter for them) and a lock serializing inference.
+ * Copies share the lock, like they share the underlying network, and so
+ * do Models built on the Net. An input recorded while the lock was taken
+ * is `pending` until the next call holding it. */
+struct JSNetInput {
+  cv::Mat blob;
+  double scalefactor;
+  cv::Scalar mean;
+  bool pending;
+};
+
+struct JSNetData : public cv::dnn::Net {
+  std::map<cv::String, JSNetInput> inputs;
+  std::shared_ptr<std::mutex> lock = std::make_shared<std::mutex>();
+  /* model cache entry (mapping or SharedNet) kept alive by this Net */
+  std::shared_ptr<const void> cached;
+  /* other contexts feed the same network, see readNetCached() */
+  bool shared = false;
+
+  JSNetData() = default;
+  JSNetData(const cv::dnn::Net& net) : cv::dnn::Net(net) {}
+};
 
-using JSNetData = cv::dnn::Net;
 using JSImage2BlobParamsData = cv::dnn::Image2BlobParams;
 using JSLayerData = cv::Ptr<cv::dnn::Layer>;
 
@@ -158,6 +189,7 @@ enum {
   DNN_NET_ENABLEWINOGRAD,
   DNN_NET_FORWARD,
   DNN_NET_FORWARDALL,
+  DNN_NET_FORWARDASYNC,
   DNN_NET_GETUNCONNECTEDOUTLAYERS,
   DNN_NET_GETUNCONNECTEDOUTLAYERSNAMES,
   DNN_NET_SETINPUT,
@@ -184,6 +216,20 @@ enum {
 #endif
 };
 
+/* Sets an input, or only records it while a forwardAsync() holds the network */
+static void
+js_net_record_input(JSNetData& dn, const cv::Mat& blob, const cv::String& name, double scalefactor = 1.0, const cv::Scalar& mean = cv::Scalar()) {
+  std::unique_lock<std::mutex> guard(*dn.lock, std::try_to_lock);
+
+  if(guard.owns_lock()) {
+    dn.setInput(blob, name, scalefactor, mean);
+    dn.inputs[name] = JSNetInput{blob, scalefactor, mean, false};
+  } else {
+    /* the caller may refill `blob` before the lock is free */
+    dn.inputs[name] = JSNetInput{blob.clone(), scalefactor, mean, true};
+  }
+}
+
 static JSValue
 js_net_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
   JSNetData* dn;
@@ -192,7 +238,25 @@ js_net_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv
   if(!(dn = js_net_data2(ctx, this_val)))
     return JS_EXCEPTION;
 
+  /* wait for a forwardAsync() in flight before touching the network; setInput() only records then */
+  std::unique_lock<std::mutex> guard(*dn->lock, std::defer_lock);
+
+  if(magic != DNN_NET_FORWARDASYNC && magic != DNN_NET_SETINPUT)
+    guard.lock();
+
   try {
+    if(guard.owns_lock()) {
+      /* a shared network may hold another context's inputs and outputs */
+      bool all = dn->shared && (magic == DNN_NET_FORWARD || magic == DNN_NET_FORWARDALL);
+
+      for(auto& input : dn->inputs) {
+        if(all || input.second.pending)
+          dn->setInput(input.second.blob, input.first, input.second.scalefactor, input.second.mean);
+
+        input.second.pending = false;
+      }
+    }
+
     switch(magic) {
       case DNN_NET_CONNECT: {
         if(argc >= 4) {
@@ -257,30 +321,32 @@ js_net_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv
           if(argc > 0)
             js_value_to(ctx, argv[0], name);
 
-          ret = js_mat_wrap(ctx, dn->forward(name));
+          cv::Mat out = dn->forward(name);
+
+          ret = js_mat_wrap(ctx, dn->shared ? out.clone() : out);
         } else {
           std::vector<cv::Mat> vecOfBlobs;
           cv::String outputName;
 
           if(argc == 1) {
             dn->forward(vecOfBlobs);
-
-            js_array_copy(ctx, argv[0], vecOfBlobs);
           } else if(JS_IsString(argv[1])) {
             js_value_to(ctx, argv[1], outputName);
 
             dn->forward(vecOfBlobs, outputName);
-
-            js_array_copy(ctx, argv[0], vecOfBlobs);
           } else if(JS_IsObject(argv[1])) {
             std::vector<cv::String> outputNames;
 
             js_value_to(ctx, argv[1], outputNames);
 
             dn->forward(vecOfBlobs, outputNames);
-
-            js_array_copy(ctx, argv[0], vecOfBlobs);
           }
+
+          if(dn->shared)
+            for(cv::Mat& blob : vecOfBlobs)
+              blob = blob.clone();
+
+          js_array_copy(ctx, argv[0], vecOfBlobs);
         }
 
         break;
@@ -294,10 +360,52 @@ js_net_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv
 
         dn->forward(vecOfVecOfBlobs, outputNames);
 
+        if(dn->shared)
+          for(auto& blobs : vecOfVecOfBlobs)
+            for(cv::Mat& blob : blobs)
+              blob = blob.clone();
+
         js_array_copy(ctx, argv[0], vecOfVecOfBlobs);
         break;
       }
 
+      case DNN_NET_FORWARDASYNC: {
+        std::vector<cv::String> outputNames;
+        bool single = argc == 0 || !JS_IsObject(argv[0]);
+        auto inputs = std::make_shared<std::map<cv::String, JSNetInput>>(dn->inputs);
+        auto outs = std::make_shared<std::vector<cv::Mat>>();
+
+        if(!single)
+          js_value_to(ctx, argv[0], outputNames);
+        else if(argc > 0 && JS_IsString(argv[0]))
+          js_value_to(ctx, argv[0], outputNames.emplace_back());
+
+        /* the caller may refill its blobs while this forward pass is queued */
+        for(auto& input : *inputs)
+          input.second.blob = input.second.blob.clone();
+
+        ret = js_async_run(
+            ctx,
+            [net = cv::dnn::Net(*dn), lock = dn->lock, inputs, outputNames, single, outs]() mutable {
+              std::lock_guard<std::mutex> guard(*lock);
+
+              for(const auto& input : *inputs)
+                net.setInput(input.second.blob, input.first, input.second.scalefactor, input.second.mean);
+
+              if(single) {
+                outs->push_back(net.forward(outputNames.empty() ? cv::String() : outputNames[0]));
+              } else {
+                net.forward(*outs, outputNames.empty() ? net.getUnconnectedOutLayersNames() : outputNames);
+              }
+
+              /* the outputs live in the network's buffers until the next forward */
+              for(cv::Mat& out : *outs)
+                out = out.clone();
+            },
+            [outs, single](JSContext* ctx) { return single ? js_mat_wrap(ctx, outs->front()) : js_value_from(ctx, *outs); });
+        break;
+      }
+
       case DNN_NET_GETUNCONNECTEDOUTLAYERS: {
         ret = js_value_from(ctx, dn->getUnconnectedOutLayers());
         break;
@@ -325,7 +433,7 @@ js_net_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv
         if(argc > 3)
           js_scalar_read(ctx, argv[3], mean);
 
-        dn->setInput(blob, name, scalefactor, mean);
+        js_net_record_input(*dn, blob.getMat(), name, scalefactor, mean);
         break;
       }
 
@@ -588,6 +696,7 @@ const JSCFunctionListEntry js_net_proto_funcs[] = {
     JS_CFUNC_MAGIC_DEF("enableWinograd", 1, js_net_method, DNN_NET_ENABLEWINOGRAD),
     JS_CFUNC_MAGIC_DEF("forward", 0, js_net_method, DNN_NET_FORWARD),
     JS_CFUNC_MAGIC_DEF("forwardAll", 1, js_net_method, DNN_NET_FORWARDALL),
+    JS_CFUNC_MAGIC_DEF("forwardAsync", 0, js_net_method, DNN_NET_FORWARDASYNC),
     JS_CFUNC_MAGIC_DEF("getUnconnectedOutLayers", 0, js_net_method, DNN_NET_GETUNCONNECTEDOUTLAYERS),
     JS_CFUNC_MAGIC_DEF("getUnconnectedOutLayersNames", 0, js_net_method, DNN_NET_GETUNCONNECTEDOUTLAYERSNAMES),
 #ifndef HAVE_OPENCV_DNN_NEW_ENGINE
@@ -1277,6 +1386,21 @@ const JSCFunctionListEntry js_tokenizer_static_funcs[] = {
  * setOutputNames, setInputParams, predict, setPreferableBackend/Target,
  * enableWinograd) - factored out once here instead of seven times. */
 
+/* cv::dnn::Model has setters for its preprocessing parameters but no getters;
+ * keep a copy next to each model so BatchScheduler can build the same blob. */
+struct DnnModelInput {
+  cv::Size size;
+  cv::Scalar mean, scale = cv::Scalar::all(1);
+  bool swapRB = false, crop = false;
+  std::vector<cv::String> outputNames;
+  /* the Net's lock when built on a dnn.Net: both drive the same network */
+  std::shared_ptr<std::mutex> lock = std::make_shared<std::mutex>();
+};
+
+template<class T> struct DnnModelData : public T, public DnnModelInput {
+  using T::T;
+};
+
 enum {
   MODEL_SET_INPUT_SIZE,
   MODEL_SET_INPUT_MEAN,
@@ -1302,11 +1426,11 @@ js_model_base_method(JSContext* ctx, ModelT& model, int argc, JSValueConst argv[
           int32_t w, h;
           js_value_to(ctx, argv[0], w);
           js_value_to(ctx, argv[1], h);
-          model.setInputSize(cv::Size(w, h));
+          model.setInputSize(model.size = cv::Size(w, h));
         } else {
           cv::Size sz;
           js_value_to(ctx, argv[0], sz);
-          model.setInputSize(sz);
+          model.setInputSize(model.size = sz);
         }
         break;
       }
@@ -1314,35 +1438,35 @@ js_model_base_method(JSContext* ctx, ModelT& model, int argc, JSValueConst argv[
       case MODEL_SET_INPUT_MEAN: {
         cv::Scalar mean;
         js_scalar_read(ctx, argv[0], mean);
-        model.setInputMean(mean);
+        model.setInputMean(model.mean = mean);
         break;
       }
 
       case MODEL_SET_INPUT_SCALE: {
         cv::Scalar scale;
         js_scalar_read(ctx, argv[0], scale);
-        model.setInputScale(scale);
+        model.setInputScale(model.scale = scale);
         break;
       }
 
       case MODEL_SET_INPUT_CROP: {
         bool crop = false;
         js_value_to(ctx, argv[0], crop);
-        model.setInputCrop(crop);
+        model.setInputCrop(model.crop = crop);
         break;
       }
 
       case MODEL_SET_INPUT_SWAP_RB: {
         bool swapRB = false;
         js_value_to(ctx, argv[0], swapRB);
-        model.setInputSwapRB(swapRB);
+        model.setInputSwapRB(model.swapRB = swapRB);
         break;
       }
 
       case MODEL_SET_OUTPUT_NAMES: {
         std::vector<cv::String> names;
         js_value_to(ctx, argv[0], names);
-        model.setOutputNames(names);
+        model.setOutputNames(model.outputNames = names);
         break;
       }
 
@@ -1364,6 +1488,12 @@ js_model_base_method(JSContext* ctx, ModelT& model, int argc, JSValueConst argv[
           js_value_to(ctx, argv[4], crop);
 
         model.setInputParams(scale, size, mean, swapRB, crop);
+
+        model.scale = cv::Scalar::all(scale);
+        model.size = size;
+        model.mean = mean;
+        model.swapRB = swapRB;
+        model.crop = crop;
         break;
       }
 
@@ -1422,7 +1552,7 @@ js_model_base_method(JSContext* ctx, ModelT& model, int argc, JSValueConst argv[
  * all eight Model-family classes - construction shape is identical:
  * new X(net) from an existing dnn.Net, or new X(model[, config]) from files. */
 #define DEFINE_DNN_MODEL_SKELETON(tag, CppType, JsName) \
-  using JS##tag##Data = CppType; \
+  using JS##tag##Data = DnnModelData<CppType>; \
   extern "C" { \
   thread_local JSValue tag##_proto, tag##_class; \
   thread_local JSClassID js_##tag##_class_id; \
@@ -1447,6 +1577,7 @@ js_model_base_method(JSContext* ctx, ModelT& model, int argc, JSValueConst argv[
     try { \
       if(argc > 0 && (net = js_net_data(argv[0]))) { \
         new(data) JS##tag##Data(*net); \
+        data->lock = net->lock; \
       } else { \
         std::string model, config; \
         if(argc > 0) \
@@ -1497,6 +1628,8 @@ js_model_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst ar
   if(!(data = js_model_data2(ctx, this_val)))
     return JS_EXCEPTION;
 
+  std::lock_guard<std::mutex> guard(*data->lock);
+
   js_model_base_method(ctx, *data, argc, argv, magic, ret);
   return ret;
 }
@@ -1523,6 +1656,8 @@ js_classification_model_method(JSContext* ctx, JSValueConst this_val, int argc,
   if(!(data = js_classification_model_data2(ctx, this_val)))
     return JS_EXCEPTION;
 
+  std::lock_guard<std::mutex> guard(*data->lock);
+
   if(js_model_base_method(ctx, *data, argc, argv, magic, ret))
     return ret;
 
@@ -1584,6 +1719,8 @@ js_detection_model_method(JSContext* ctx, JSValueConst this_val, int argc, JSVal
   if(!(data = js_detection_model_data2(ctx, this_val)))
     return JS_EXCEPTION;
 
+  std::lock_guard<std::mutex> guard(*data->lock);
+
   if(js_model_base_method(ctx, *data, argc, argv, magic, ret))
     return ret;
 
@@ -1652,6 +1789,8 @@ js_segmentation_model_method(JSContext* ctx, JSValueConst this_val, int argc, JS
   if(!(data = js_segmentation_model_data2(ctx, this_val)))
     return JS_EXCEPTION;
 
+  std::lock_guard<std::mutex> guard(*data->lock);
+
   if(js_model_base_method(ctx, *data, argc, argv, magic, ret))
     return ret;
 
@@ -1691,6 +1830,8 @@ js_keypoints_model_method(JSContext* ctx, JSValueConst this_val, int argc, JSVal
   if(!(data = js_keypoints_model_data2(ctx, this_val)))
     return JS_EXCEPTION;
 
+  std::lock_guard<std::mutex> guard(*data->lock);
+
   if(js_model_base_method(ctx, *data, argc, argv, magic, ret))
     return ret;
 
@@ -1738,6 +1879,8 @@ js_text_recognition_model_method(JSContext* ctx, JSValueConst this_val, int argc
   if(!(data = js_text_recognition_model_data2(ctx, this_val)))
     return JS_EXCEPTION;
 
+  std::lock_guard<std::mutex> guard(*data->lock);
+
   if(js_model_base_method(ctx, *data, argc, argv, magic, ret))
     return ret;
 
@@ -1894,6 +2037,8 @@ js_text_detection_model_east_method(JSContext* ctx, JSValueConst this_val, int a
   if(!(data = js_text_detection_model_east_data2(ctx, this_val)))
     return JS_EXCEPTION;
 
+  std::lock_guard<std::mutex> guard(*data->lock);
+
   if(js_model_base_method(ctx, *data, argc, argv, magic, ret))
     return ret;
   if(js_text_detection_model_method(ctx, *data, argc, argv, magic, ret))
@@ -1962,6 +2107,8 @@ js_text_detection_model_db_method(JSContext* ctx, JSValueConst this_val, int arg
   if(!(data = js_text_detection_model_db_data2(ctx, this_val)))
     return JS_EXCEPTION;
 
+  std::lock_guard<std::mutex> guard(*data->lock);
+
   if(js_model_base_method(ctx, *data, argc, argv, magic, ret))
     return ret;
   if(js_text_detection_model_method(ctx, *data, argc, argv, magic, ret))
@@ -2036,6 +2183,843 @@ const JSCFunctionListEntry js_text_detection_model_db_proto_funcs[] = {
     JS_PROP_STRING_DEF("[Symbol.toStringTag]", "TextDetectionModel_DB", JS_PROP_CONFIGURABLE),
 };
 
+/* BatchScheduler - front-end for one Model that queues predict()/classify()
+ * requests and runs them as a single forward pass once maxBatchSize requests
+ * are queued or maxDelay milliseconds after the first one, whichever comes
+ * first. Each request gets its own Promise. */
+struct DnnBatchRequest {
+  cv::Mat frame;
+  bool classify;
+  JSValue funcs[2];
+};
+
+struct JSBatchSchedulerData {
+  JSValue model = JS_UNDEFINED;
+  cv::dnn::Model* net = nullptr;
+  DnnModelInput* input = nullptr;
+  cv::dnn::ClassificationModel* classifier = nullptr;
+  int32_t maxBatchSize = 8;
+  double maxDelay = 5;
+  uint32_t generation = 0;
+  std::vector<DnnBatchRequest> queue;
+};
+
+extern "C" {
+thread_local JSValue batch_scheduler_proto, batch_scheduler_class;
+thread_local JSClassID js_batch_scheduler_class_id;
+}
+
+template<class T>
+static cv::dnn::Model*
+js_model_cast(T* data, DnnModelInput*& input) {
+  input = data;
+  return data;
+}
+
+/* Any of the Model-family objects, as its cv::dnn::Model base */
+static cv::dnn::Model*
+js_model_any(JSValueConst val, DnnModelInput*& input, cv::dnn::ClassificationModel*& classifier) {
+  classifier = nullptr;
+
+  if(auto* p = js_classification_model_data(val)) {
+    classifier = p;
+    return js_model_cast(p, input);
+  }
+  if(auto* p = js_model_data(val))
+    return js_model_cast(p, input);
+  if(auto* p = js_detection_model_data(val))
+    return js_model_cast(p, input);
+  if(auto* p = js_segmentation_model_data(val))
+    return js_model_cast(p, input);
+  if(auto* p = js_keypoints_model_data(val))
+    return js_model_cast(p, input);
+  if(auto* p = js_text_recognition_model_data(val))
+    return js_model_cast(p, input);
+  if(auto* p = js_text_detection_model_east_data(val))
+    return js_model_cast(p, input);
+  if(auto* p = js_text_detection_model_db_data(val))
+    return js_model_cast(p, input);
+
+  return nullptr;
+}
+
+static JSBatchSchedulerData*
+js_batch_scheduler_data(JSValueConst val) {
+  return static_cast<JSBatchSchedulerData*>(JS_GetOpaque(val, js_batch_scheduler_class_id));
+}
+
+static JSBatchSchedulerData*
+js_batch_scheduler_data2(JSContext* ctx, JSValueConst val) {
+  return static_cast<JSBatchSchedulerData*>(JS_GetOpaque2(ctx, val, js_batch_scheduler_class_id));
+}
+
+/* Row i of a batched output; outputs without a batch axis go to everyone. */
+static cv::Mat
+dnn_batch_slice(const cv::Mat& out, int i, int n) {
+  if(out.dims < 1 || out.size[0] != n)
+    return out;
+
+  std::vector<cv::Range> ranges(out.dims, cv::Range::all());
+  ranges[0] = cv::Range(i, i + 1);
+
+  return out(ranges).clone();
+}
+
+static JSValue
+dnn_batch_classify(JSContext* ctx, const cv::Mat& out, bool softmax) {
+  cv::Mat scores;
+  cv::Point maxLoc;
+  double conf;
+
+  out.reshape(1, 1).convertTo(scores, CV_32F);
+
+  if(softmax) {
+    double maxVal;
+
+    cv::minMaxLoc(scores, nullptr, &maxVal);
+    cv::exp(scores - maxVal, scores);
+    scores /= cv::sum(scores)[0];
+  }
+
+  cv::minMaxLoc(scores, nullptr, &conf, nullptr, &maxLoc);
+
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "classId", js_value_from(ctx, maxLoc.x));
+  JS_SetPropertyStr(ctx, obj, "confidence", js_value_from(ctx, float(conf)));
+  return obj;
+}
+
+static void
+js_batch_scheduler_flush(JSContext* ctx, JSBatchSchedulerData* bs) {
+  std::vector<DnnBatchRequest> batch;
+  std::vector<cv::Mat> frames, outs;
+  const DnnModelInput& input = *bs->input;
+  int n;
+
+  batch.swap(bs->queue);
+  bs->generation++;
+
+  if((n = batch.size()) == 0)
+    return;
+
+  try {
+    /* shared with the Net and Models on the same network */
+    std::lock_guard<std::mutex> guard(*input.lock);
+    cv::dnn::Net& net = bs->net->getNetwork_();
+    cv::Size size = input.size.empty() ? batch[0].frame.size() : input.size;
+    cv::dnn::Image2BlobParams params(input.scale, size, input.mean, input.swapRB, CV_32F, qjs_dnn_compat::DNN_LAYOUT_NCHW, input.crop ? cv::dnn::DNN_PMODE_CROP_CENTER : cv::dnn::DNN_PMODE_NULL);
+
+    for(const DnnBatchRequest& req : batch)
+      frames.push_back(req.frame);
+
+    net.setInput(cv::dnn::blobFromImagesWithParams(frames, params));
+    net.forward(outs, input.outputNames.empty() ? net.getUnconnectedOutLayersNames() : input.outputNames);
+
+    /* forward() hands out the net's own buffers, the next pass overwrites them */
+    for(cv::Mat& out : outs)
+      out = out.clone();
+  } catch(const std::exception& e) {
+    /* whatever failed, every queued request hears about it */
+    js_cv_throw(ctx, e);
+    JSValue error = JS_GetException(ctx);
+
+    for(DnnBatchRequest& req : batch)
+      js_promise_settle(ctx, req.funcs, JS_DupValue(ctx, error), true);
+
+    JS_FreeValue(ctx, error);
+    return;
+  }
+
+  bool softmax = bs->classifier && bs->classifier->getEnableSoftmaxPostProcessing();
+
+  for(int i = 0; i < n; ++i) {
+    JSValue result;
+
+    try {
+      if(batch[i].classify) {
+        if(outs.empty())
+          CV_Error(cv::Error::StsError, "BatchScheduler: the network has no output to classify");
+
+        result = dnn_batch_classify(ctx, dnn_batch_slice(outs[0], i, n), softmax);
+      } else {
+        std::vector<cv::Mat> mine;
+
+        for(const cv::Mat& out : outs)
+          mine.push_back(dnn_batch_slice(out, i, n));
+
+        result = js_value_from(ctx, mine);
+      }
+    } catch(const std::exception& e) {
+      js_cv_throw(ctx, e);
+      js_promise_settle(ctx, batch[i].funcs, JS_GetException(ctx), true);
+      continue;
+    }
+
+    js_promise_settle(ctx, batch[i].funcs, result);
+  }
+}
+
+/* Timer callback; func_data = [scheduler, generation when armed] */
+static JSValue
+js_batch_scheduler_timeout(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic, JSValue* func_data) {
+  JSBatchSchedulerData* bs;
+  uint32_t generation;
+
+  if((bs = js_batch_scheduler_data(func_data[0]))) {
+    JS_ToUint32(ctx, &generation, func_data[1]);
+
+    /* a full batch has already gone out since this timer was armed */
+    if(generation == bs->generation)
+      js_batch_scheduler_flush(ctx, bs);
+  }
+
+  return JS_UNDEFINED;
+}
+
+static JSValue
+js_batch_scheduler_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  JSBatchSchedulerData* bs;
+  JSValue obj = JS_UNDEFINED, proto;
+  DnnModelInput* input;
+  cv::dnn::ClassificationModel* classifier;
+  cv::dnn::Model* net;
+
+  if(argc < 1 || !(net = js_model_any(argv[0], input, classifier)))
+    return JS_ThrowTypeError(ctx, "argument 1 must be a dnn.Model");
+
+  if(!(bs = js_allocate<JSBatchSchedulerData>(ctx)))
+    return JS_EXCEPTION;
+
+  new(bs) JSBatchSchedulerData();
+
+  bs->model = JS_DupValue(ctx, argv[0]);
+  bs->net = net;
+  bs->input = input;
+  bs->classifier = classifier;
+
+  if(argc > 1)
+    js_value_to(ctx, argv[1], bs->maxBatchSize);
+  if(argc > 2)
+    js_value_to(ctx, argv[2], bs->maxDelay);
+
+  if(bs->maxBatchSize < 1)
+    bs->maxBatchSize = 1;
+
+  proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    goto fail;
+
+  obj = JS_NewObjectProtoClass(ctx, proto, js_batch_scheduler_class_id);
+  JS_FreeValue(ctx, proto);
+  if(JS_IsException(obj))
+    goto fail;
+
+  JS_SetOpaque(obj, bs);
+  return obj;
+
+fail:
+  JS_FreeValue(ctx, bs->model);
+  bs->~JSBatchSchedulerData();
+  js_deallocate(ctx, bs);
+  JS_FreeValue(ctx, obj);
+  return JS_EXCEPTION;
+}
+
+enum {
+  BATCH_SCHEDULER_PREDICT,
+  BATCH_SCHEDULER_CLASSIFY,
+  BATCH_SCHEDULER_FLUSH,
+};
+
+static JSValue
+js_batch_scheduler_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  JSBatchSchedulerData* bs;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(bs = js_batch_scheduler_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case BATCH_SCHEDULER_PREDICT:
+    case BATCH_SCHEDULER_CLASSIFY: {
+      DnnBatchRequest req;
+
+      if(magic == BATCH_SCHEDULER_CLASSIFY && !bs->classifier)
+        return JS_ThrowTypeError(ctx, "classify() requires a dnn.ClassificationModel");
+
+      try {
+        JSInputArray frame = js_cv_inputarray(ctx, argv[0]);
+
+        /* the caller is free to reuse its Mat (e.g. for the next capture) before the batch runs */
+        req.frame = frame.getMat().clone();
+      } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
+
+      if(req.frame.empty())
+        return JS_ThrowTypeError(ctx, "argument 1 must be a non-empty image");
+
+      req.classify = magic == BATCH_SCHEDULER_CLASSIFY;
+      ret = js_promise_new(ctx, req.funcs);
+
+      if(JS_IsException(ret))
+        return ret;
+
+      bs->queue.push_back(req);
+
+      if(bs->queue.size() >= size_t(bs->maxBatchSize)) {
+        js_batch_scheduler_flush(ctx, bs);
+      } else if(bs->queue.size() == 1) {
+        JSValue data[2] = {this_val, JS_NewUint32(ctx, bs->generation)};
+        JSValue fn = JS_NewCFunctionData(ctx, js_batch_scheduler_timeout, 0, 0, 2, data);
+
+        js_set_timeout(ctx, fn, bs->maxDelay);
+        JS_FreeValue(ctx, fn);
+      }
+
+      break;
+    }
+
+    case BATCH_SCHEDULER_FLUSH: {
+      size_t n = bs->queue.size();
+
+      js_batch_scheduler_flush(ctx, bs);
+      ret = js_value_from(ctx, uint32_t(n));
+      break;
+    }
+  }
+
+  return ret;
+}
+
+enum {
+  BATCH_SCHEDULER_MODEL,
+  BATCH_SCHEDULER_PENDING,
+  BATCH_SCHEDULER_MAXBATCHSIZE,
+  BATCH_SCHEDULER_MAXDELAY,
+};
+
+static JSValue
+js_batch_scheduler_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  JSBatchSchedulerData* bs;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(bs = js_batch_scheduler_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case BATCH_SCHEDULER_MODEL: {
+      ret = JS_DupValue(ctx, bs->model);
+      break;
+    }
+
+    case BATCH_SCHEDULER_PENDING: {
+      ret = js_value_from(ctx, uint32_t(bs->queue.size()));
+      break;
+    }
+
+    case BATCH_SCHEDULER_MAXBATCHSIZE: {
+      ret = js_value_from(ctx, bs->maxBatchSize);
+      break;
+    }
+
+    case BATCH_SCHEDULER_MAXDELAY: {
+      ret = js_value_from(ctx, bs->maxDelay);
+      break;
+    }
+  }
+
+  return ret;
+}
+
+static JSValue
+js_batch_scheduler_set(JSContext* ctx, JSValueConst this_val, JSValueConst value, int magic) {
+  JSBatchSchedulerData* bs;
+
+  if(!(bs = js_batch_scheduler_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case BATCH_SCHEDULER_MAXBATCHSIZE: {
+      js_value_to(ctx, value, bs->maxBatchSize);
+
+      if(bs->maxBatchSize < 1)
+        bs->maxBatchSize = 1;
+      break;
+    }
+
+    case BATCH_SCHEDULER_MAXDELAY: {
+      js_value_to(ctx, value, bs->maxDelay);
+      break;
+    }
+  }
+
+  return JS_UNDEFINED;
+}
+
+static void
+js_batch_scheduler_finalizer(JSRuntime* rt, JSValue val) {
+  JSBatchSchedulerData* bs;
+
+  if((bs = js_batch_scheduler_data(val))) {
+    /* only reachable with requests pending when the runtime is torn down */
+    for(DnnBatchRequest& req : bs->queue) {
+      JS_FreeValueRT(rt, req.funcs[0]);
+      JS_FreeValueRT(rt, req.funcs[1]);
+    }
+
+    JS_FreeValueRT(rt, bs->model);
+    bs->~JSBatchSchedulerData();
+    js_deallocate(rt, bs);
+  }
+}
+
+JSClassDef js_batch_scheduler_class = {
+    .class_name = "BatchScheduler",
+    .finalizer = js_batch_scheduler_finalizer,
+};
+
+const JSCFunctionListEntry js_batch_scheduler_proto_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("predict", 1, js_batch_scheduler_method, BATCH_SCHEDULER_PREDICT),
+    JS_CFUNC_MAGIC_DEF("classify", 1, js_batch_scheduler_method, BATCH_SCHEDULER_CLASSIFY),
+    JS_CFUNC_MAGIC_DEF("flush", 0, js_batch_scheduler_method, BATCH_SCHEDULER_FLUSH),
+    JS_CGETSET_MAGIC_DEF("model", js_batch_scheduler_get, 0, BATCH_SCHEDULER_MODEL),
+    JS_CGETSET_MAGIC_DEF("pending", js_batch_scheduler_get, 0, BATCH_SCHEDULER_PENDING),
+    JS_CGETSET_MAGIC_DEF("maxBatchSize", js_batch_scheduler_get, js_batch_scheduler_set, BATCH_SCHEDULER_MAXBATCHSIZE),
+    JS_CGETSET_MAGIC_DEF("maxDelay", js_batch_scheduler_get, js_batch_scheduler_set, BATCH_SCHEDULER_MAXDELAY),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "BatchScheduler", JS_PROP_CONFIGURABLE),
+};
+
+/* Set a Net input the way Net.setInput() does, for natives feeding a Net */
+static void
+js_net_set_input(JSNetData& net, const cv::Mat& blob, const cv::String& name) {
+  js_net_record_input(net, blob, name);
+}
+
+/* KVCache - preallocated past_key_values storage for decomposed-attention
+ * LLM exports (see include/kv_cache.hpp and examples/qwen25_inference.js).
+ * It keeps the history, it doesn't spare the net copying the prefix. */
+using JSKVCacheData = KVCache;
+
+extern "C" {
+thread_local JSValue kv_cache_proto, kv_cache_class;
+thread_local JSClassID js_kv_cache_class_id;
+}
+
+static JSKVCacheData*
+js_kv_cache_data(JSValueConst val) {
+  return static_cast<JSKVCacheData*>(JS_GetOpaque(val, js_kv_cache_class_id));
+}
+
+static JSKVCacheData*
+js_kv_cache_data2(JSContext* ctx, JSValueConst val) {
+  return static_cast<JSKVCacheData*>(JS_GetOpaque2(ctx, val, js_kv_cache_class_id));
+}
+
+static JSValue
+js_kv_cache_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  JSKVCacheData* kv;
+  JSValue obj = JS_UNDEFINED, proto;
+  int32_t layers = 0, heads = 0, headDim = 0, capacity = 0;
+  bool dummy = true;
+
+  if(argc < 4)
+    return JS_ThrowTypeError(ctx, "expecting (layers, heads, headDim, capacity[, dummy])");
+
+  js_value_to(ctx, argv[0], layers);
+  js_value_to(ctx, argv[1], heads);
+  js_value_to(ctx, argv[2], headDim);
+  js_value_to(ctx, argv[3], capacity);
+
+  if(argc > 4)
+    js_value_to(ctx, argv[4], dummy);
+
+  if(layers <= 0 || heads <= 0 || headDim <= 0 || capacity <= 0)
+    return JS_ThrowRangeError(ctx, "layers, heads, headDim and capacity must be positive");
+
+  if(!(kv = js_allocate<JSKVCacheData>(ctx)))
+    return JS_EXCEPTION;
+
+  try {
+    new(kv) JSKVCacheData(layers, heads, headDim, capacity, dummy);
+  } catch(const cv::Exception& e) {
+    js_deallocate(ctx, kv);
+    return js_cv_throw(ctx, e);
+  }
+
+  proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    goto fail;
+
+  obj = JS_NewObjectProtoClass(ctx, proto, js_kv_cache_class_id);
+  JS_FreeValue(ctx, proto);
+  if(JS_IsException(obj))
+    goto fail;
+
+  JS_SetOpaque(obj, kv);
+  return obj;
+
+fail:
+  kv->~JSKVCacheData();
+  js_deallocate(ctx, kv);
+  JS_FreeValue(ctx, obj);
+  return JS_EXCEPTION;
+}
+
+enum {
+  KV_CACHE_KEY,
+  KV_CACHE_VALUE,
+  KV_CACHE_ATTENTION_MASK,
+  KV_CACHE_POSITION_IDS,
+  KV_CACHE_APPEND,
+  KV_CACHE_SET_INPUTS,
+  KV_CACHE_RESET,
+};
+
+static JSValue
+js_kv_cache_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  JSKVCacheData* kv;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(kv = js_kv_cache_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  try {
+    switch(magic) {
+      case KV_CACHE_KEY:
+      case KV_CACHE_VALUE: {
+        int32_t layer = -1;
+
+        js_value_to(ctx, argv[0], layer);
+
+        if(layer < 0 || layer >= kv->layers)
+          return JS_ThrowRangeError(ctx, "layer %d out of range [0, %d)", layer, kv->layers);
+
+        ret = js_mat_wrap(ctx, magic == KV_CACHE_KEY ? kv->key(layer) : kv->value(layer));
+        break;
+      }
+
+      case KV_CACHE_ATTENTION_MASK:
+      case KV_CACHE_POSITION_IDS: {
+        int32_t n = 1;
+
+        if(argc > 0)
+          js_value_to(ctx, argv[0], n);
+
+        ret = js_mat_wrap(ctx, magic == KV_CACHE_ATTENTION_MASK ? kv->attentionMask(n) : kv->positionIds(n));
+        break;
+      }
+
+      /* append(outs, n[, start = 0]) - outs[start..] are the present.* tensors */
+      case KV_CACHE_APPEND: {
+        JSInputArray outs = js_cv_inputarray(ctx, argv[0]);
+        std::vector<cv::Mat> mats;
+        int32_t n = 1, start = 0;
+
+        if(argc > 1)
+          js_value_to(ctx, argv[1], n);
+        if(argc > 2)
+          js_value_to(ctx, argv[2], start);
+
+        outs.getMatVector(mats);
+
+        if(start < 0 || size_t(start) + kv->layers * 2 > mats.size())
+          return JS_ThrowRangeError(ctx, "expecting %d present tensors from index %d", kv->layers * 2, start);
+
+        if(kv->length + n > kv->capacity)
+          return JS_ThrowRangeError(ctx, "KVCache capacity of %d timesteps exceeded", kv->capacity);
+
+        kv->append(std::vector<cv::Mat>(mats.begin() + start, mats.begin() + start + kv->layers * 2), n);
+        break;
+      }
+
+      /* setInputs(net, n) - past_key_values.*, attention_mask and position_ids for n new tokens;
+       * the net copies each prefix in full */
+      case KV_CACHE_SET_INPUTS: {
+        JSNetData* dn;
+        int32_t n = 1;
+        char name[64];
+
+        if(!(dn = js_net_data2(ctx, argv[0])))
+          return JS_EXCEPTION;
+
+        if(argc > 1)
+          js_value_to(ctx, argv[1], n);
+
+        for(int layer = 0; layer < kv->layers; ++layer) {
+          snprintf(name, sizeof(name), "past_key_values.%d.key", layer);
+          js_net_set_input(*dn, kv->key(layer), name);
+          snprintf(name, sizeof(name), "past_key_values.%d.value", layer);
+          js_net_set_input(*dn, kv->value(layer), name);
+        }
+
+        js_net_set_input(*dn, kv->attentionMask(n), "attention_mask");
+        js_net_set_input(*dn, kv->positionIds(n), "position_ids");
+        break;
+      }
+
+      case KV_CACHE_RESET: {
+        kv->reset();
+        break;
+      }
+    }
+  } catch(const cv::Exception& e) { ret = js_cv_throw(ctx, e); }
+
+  return ret;
+}
+
+enum {
+  KV_CACHE_LENGTH,
+  KV_CACHE_CAPACITY,
+  KV_CACHE_LAYERS,
+  KV_CACHE_OFFSET,
+};
+
+static JSValue
+js_kv_cache_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  JSKVCacheData* kv;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(kv = js_kv_cache_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case KV_CACHE_LENGTH: {
+      ret = js_value_from(ctx, kv->length);
+      break;
+    }
+
+    case KV_CACHE_CAPACITY: {
+      ret = js_value_from(ctx, kv->capacity);
+      break;
+    }
+
+    case KV_CACHE_LAYERS: {
+      ret = js_value_from(ctx, kv->layers);
+      break;
+    }
+
+    case KV_CACHE_OFFSET: {
+      ret = js_value_from(ctx, kv->offset());
+      break;
+    }
+  }
+
+  return ret;
+}
+
+static void
+js_kv_cache_finalizer(JSRuntime* rt, JSValue val) {
+  JSKVCacheData* kv;
+
+  if((kv = js_kv_cache_data(val))) {
+    kv->~JSKVCacheData();
+    js_deallocate(rt, kv);
+  }
+}
+
+JSClassDef js_kv_cache_class = {
+    .class_name = "KVCache",
+    .finalizer = js_kv_cache_finalizer,
+};
+
+const JSCFunctionListEntry js_kv_cache_proto_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("key", 1, js_kv_cache_method, KV_CACHE_KEY),
+    JS_CFUNC_MAGIC_DEF("value", 1, js_kv_cache_method, KV_CACHE_VALUE),
+    JS_CFUNC_MAGIC_DEF("attentionMask", 1, js_kv_cache_method, KV_CACHE_ATTENTION_MASK),
+    JS_CFUNC_MAGIC_DEF("positionIds", 1, js_kv_cache_method, KV_CACHE_POSITION_IDS),
+    JS_CFUNC_MAGIC_DEF("append", 2, js_kv_cache_method, KV_CACHE_APPEND),
+    JS_CFUNC_MAGIC_DEF("setInputs", 2, js_kv_cache_method, KV_CACHE_SET_INPUTS),
+    JS_CFUNC_MAGIC_DEF("reset", 0, js_kv_cache_method, KV_CACHE_RESET),
+    JS_CGETSET_MAGIC_DEF("length", js_kv_cache_get, 0, KV_CACHE_LENGTH),
+    JS_CGETSET_MAGIC_DEF("capacity", js_kv_cache_get, 0, KV_CACHE_CAPACITY),
+    JS_CGETSET_MAGIC_DEF("layers", js_kv_cache_get, 0, KV_CACHE_LAYERS),
+    JS_CGETSET_MAGIC_DEF("offset", js_kv_cache_get, 0, KV_CACHE_OFFSET),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "KVCache", JS_PROP_CONFIGURABLE),
+};
+
+/* BlobBuilder - blobFromImagesWithParams() into a blob that is reused across
+ * calls (see include/blob_builder.hpp). */
+using JSBlobBuilderData = BlobBuilder;
+
+extern "C" {
+thread_local JSValue blob_builder_proto, blob_builder_class;
+thread_local JSClassID js_blob_builder_class_id;
+}
+
+static JSBlobBuilderData*
+js_blob_builder_data(JSValueConst val) {
+  return static_cast<JSBlobBuilderData*>(JS_GetOpaque(val, js_blob_builder_class_id));
+}
+
+static JSBlobBuilderData*
+js_blob_builder_data2(JSContext* ctx, JSValueConst val) {
+  return static_cast<JSBlobBuilderData*>(JS_GetOpaque2(ctx, val, js_blob_builder_class_id));
+}
+
+static void
+js_blob_builder_params(JSBlobBuilderData& bb, const JSImage2BlobParamsData& params) {
+  bb.scale = params.scalefactor;
+  bb.size = params.size;
+  bb.mean = params.mean;
+  bb.swapRB = params.swapRB;
+  bb.ddepth = params.ddepth;
+  bb.nhwc = params.datalayout == qjs_dnn_compat::DNN_LAYOUT_NHWC;
+  bb.paddingMode = params.paddingmode;
+  bb.borderValue = params.borderValue;
+}
+
+static JSValue
+js_blob_builder_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  JSBlobBuilderData* bb;
+  JSImage2BlobParamsData* params = nullptr;
+  JSValue obj = JS_UNDEFINED, proto;
+
+  if(argc > 0 && !JS_IsUndefined(argv[0]) && !(params = js_imageblob2params_data2(ctx, argv[0])))
+    return JS_EXCEPTION;
+
+  if(!(bb = js_allocate<JSBlobBuilderData>(ctx)))
+    return JS_EXCEPTION;
+
+  new(bb) JSBlobBuilderData();
+
+  if(params)
+    js_blob_builder_params(*bb, *params);
+
+  proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    goto fail;
+
+  obj = JS_NewObjectProtoClass(ctx, proto, js_blob_builder_class_id);
+  JS_FreeValue(ctx, proto);
+  if(JS_IsException(obj))
+    goto fail;
+
+  JS_SetOpaque(obj, bb);
+  return obj;
+
+fail:
+  bb->~JSBlobBuilderData();
+  js_deallocate(ctx, bb);
+  JS_FreeValue(ctx, obj);
+  return JS_EXCEPTION;
+}
+
+enum {
+  BLOB_BUILDER_BUILD,
+};
+
+static JSValue
+js_blob_builder_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  JSBlobBuilderData* bb;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(bb = js_blob_builder_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  try {
+    switch(magic) {
+      /* build(images) - the returned Mat shares the builder's blob */
+      case BLOB_BUILDER_BUILD: {
+        JSInputArray input = js_cv_inputarray(ctx, argv[0]);
+        std::vector<cv::Mat> images;
+
+        if(input.isMatVector())
+          input.getMatVector(images);
+        else
+          images.push_back(input.getMat());
+
+        if(images.empty())
+          return JS_ThrowRangeError(ctx, "expecting at least one image");
+
+        ret = js_mat_wrap(ctx, bb->build(images));
+        break;
+      }
+    }
+  } catch(const cv::Exception& e) { ret = js_cv_throw(ctx, e); }
+
+  return ret;
+}
+
+enum {
+  BLOB_BUILDER_BLOB,
+  BLOB_BUILDER_PARAMS,
+};
+
+static JSValue
+js_blob_builder_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  JSBlobBuilderData* bb;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(bb = js_blob_builder_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case BLOB_BUILDER_BLOB: {
+      if(!bb->blob.empty())
+        ret = js_mat_wrap(ctx, bb->blob);
+      break;
+    }
+
+    case BLOB_BUILDER_PARAMS: {
+      ret = js_imageblob2params_new(ctx,
+                                    JSImage2BlobParamsData(bb->scale,
+                                                           bb->size,
+                                                           bb->mean,
+                                                           bb->swapRB,
+                                                           bb->ddepth,
+                                                           bb->nhwc ? qjs_dnn_compat::DNN_LAYOUT_NHWC : qjs_dnn_compat::DNN_LAYOUT_NCHW,
+                                                           cv::dnn::ImagePaddingMode(bb->paddingMode),
+                                                           bb->borderValue));
+      break;
+    }
+  }
+
+  return ret;
+}
+
+static JSValue
+js_blob_builder_set(JSContext* ctx, JSValueConst this_val, JSValueConst val, int magic) {
+  JSBlobBuilderData* bb;
+
+  if(!(bb = js_blob_builder_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case BLOB_BUILDER_PARAMS: {
+      JSImage2BlobParamsData* params;
+
+      if(!(params = js_imageblob2params_data2(ctx, val)))
+        return JS_EXCEPTION;
+
+      js_blob_builder_params(*bb, *params);
+      break;
+    }
+  }
+
+  return JS_UNDEFINED;
+}
+
+static void
+js_blob_builder_finalizer(JSRuntime* rt, JSValue val) {
+  JSBlobBuilderData* bb;
+
+  if((bb = js_blob_builder_data(val))) {
+    bb->~JSBlobBuilderData();
+    js_deallocate(rt, bb);
+  }
+}
+
+JSClassDef js_blob_builder_class = {
+    .class_name = "BlobBuilder",
+    .finalizer = js_blob_builder_finalizer,
+};
+
+const JSCFunctionListEntry js_blob_builder_proto_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("build", 1, js_blob_builder_method, BLOB_BUILDER_BUILD),
+    JS_CGETSET_MAGIC_DEF("blob", js_blob_builder_get, 0, BLOB_BUILDER_BLOB),
+    JS_CGETSET_MAGIC_DEF("params", js_blob_builder_get, js_blob_builder_set, BLOB_BUILDER_PARAMS),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "BlobBuilder", JS_PROP_CONFIGURABLE),
+};
+
 #define REGISTER_DNN_MODEL_CLASS(tag, JsName) \
   do { \
     JS_NewClassID(&js_##tag##_class_id); \
@@ -2048,6 +3032,50 @@ const JSCFunctionListEntry js_text_detection_model_db_proto_funcs[] = {
     JS_SetPropertyStr(ctx, dnn_object, JsName, tag##_class); \
   } while(0)
 
+/* dnn.sample() options: { temperature, topK, topP, repetitionPenalty, seed, history, candidates } */
+static void
+js_dnn_sample_options(JSContext* ctx, JSValueConst obj, SampleOptions& options) {
+  JSValue v;
+
+  if(!JS_IsUndefined(v = JS_GetPropertyStr(ctx, obj, "temperature")))
+    js_value_to(ctx, v, options.temperature);
+  JS_FreeValue(ctx, v);
+
+  if(!JS_IsUndefined(v = JS_GetPropertyStr(ctx, obj, "topK")))
+    js_value_to(ctx, v, options.topK);
+  JS_FreeValue(ctx, v);
+
+  if(!JS_IsUndefined(v = JS_GetPropertyStr(ctx, obj, "topP")))
+    js_value_to(ctx, v, options.topP);
+  JS_FreeValue(ctx, v);
+
+  if(!JS_IsUndefined(v = JS_GetPropertyStr(ctx, obj, "repetitionPenalty")))
+    js_value_to(ctx, v, options.repetitionPenalty);
+  JS_FreeValue(ctx, v);
+
+  if(!JS_IsUndefined(v = JS_GetPropertyStr(ctx, obj, "candidates")))
+    js_value_to(ctx, v, options.candidates);
+  JS_FreeValue(ctx, v);
+
+  if((options.seeded = JS_IsNumber(v = JS_GetPropertyStr(ctx, obj, "seed")))) {
+    int64_t seed = 0;
+
+    JS_ToInt64(ctx, &seed, v);
+    options.seed = seed;
+  }
+  JS_FreeValue(ctx, v);
+
+  if(js_is_array(ctx, v = JS_GetPropertyStr(ctx, obj, "history"))) {
+    js_array_to(ctx, v, options.history);
+  } else if(JS_IsObject(v)) {
+    cv::Mat history = js_cv_inputarray(ctx, v).getMat();
+
+    history.reshape(1, 1).convertTo(history, CV_32S);
+    options.history.assign(history.ptr<int32_t>(), history.ptr<int32_t>() + history.total());
+  }
+  JS_FreeValue(ctx, v);
+}
+
 enum {
   DNN_BLOBFROMIMAGE,
   DNN_BLOBFROMIMAGES,
@@ -2059,9 +3087,11 @@ enum {
   /*DNN_GETLAYERFACTORYIMPL,
     DNN_GETLAYERFACTORYMUTEX,*/
   DNN_IMAGESFROMBLOB,
+  DNN_MODELCACHEENTRIES,
   DNN_NMSBOXES,
   DNN_NMSBOXESBATCHED,
   DNN_READNET,
+  DNN_READNETCACHED,
   DNN_READNETFROMCAFFE,
   DNN_READNETFROMDARKNET,
   DNN_READNETFROMMODELOPTIMIZER,
@@ -2071,6 +3101,7 @@ enum {
   DNN_READNETFROMTORCH,
   DNN_READTENSORFROMONNX,
   DNN_READTORCHBLOB,
+  DNN_SAMPLE,
   DNN_SHRINKCAFFEMODEL,
   DNN_SOFTNMSBOXES,
   DNN_WRITETEXTGRAPH,
@@ -2306,8 +3337,8 @@ js_dnn_func(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]
           } else
             size = size2;
 
-          size_t msize, msize2;
-          uint8_t* mptr;
+          size_t msize = 0, msize2;
+          uint8_t* mptr = nullptr;
 
           if(argc > argi) {
             mptr = JS_GetArrayBuffer(ctx, &msize2, argv[argi++]);
@@ -2349,8 +3380,8 @@ js_dnn_func(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]
           } else
             size = size2;
 
-          size_t msize, msize2;
-          uint8_t* mptr;
+          size_t msize = 0, msize2;
+          uint8_t* mptr = nullptr;
 
           if(argc > argi) {
             mptr = JS_GetArrayBuffer(ctx, &msize2, argv[argi++]);
@@ -2393,8 +3424,8 @@ js_dnn_func(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]
           } else
             size = size2;
 
-          size_t msize, msize2;
-          uint8_t* mptr;
+          size_t msize = 0, msize2;
+          uint8_t* mptr = nullptr;
 
           if(argc > argi) {
             mptr = JS_GetArrayBuffer(ctx, &msize2, argv[argi++]);
@@ -2482,8 +3513,8 @@ js_dnn_func(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]
           } else
             size = size2;
 
-          size_t msize, msize2;
-          uint8_t* mptr;
+          size_t msize = 0, msize2;
+          uint8_t* mptr = nullptr;
 
           if(argc > argi) {
             mptr = JS_GetArrayBuffer(ctx, &msize2, argv[argi++]);
@@ -2592,6 +3623,42 @@ js_dnn_func(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]
       }
 #endif
 
+      case DNN_SAMPLE: {
+        JSInputArray input = js_cv_inputarray(ctx, argv[0]);
+        cv::Mat logits = input.getMat();
+        SampleOptions options;
+        std::vector<int32_t> ids;
+        std::vector<float> probs;
+        int32_t token;
+        int vocab;
+
+        if(logits.empty())
+          return JS_ThrowTypeError(ctx, "argument 1 must be a non-empty logits Mat");
+
+        if(argc > 1 && JS_IsObject(argv[1]))
+          js_dnn_sample_options(ctx, argv[1], options);
+
+        if(!logits.isContinuous())
+          logits = logits.clone();
+        if(logits.depth() != CV_32F)
+          logits.convertTo(logits, CV_32F);
+
+        /* [..., vocab]: only the last position is sampled */
+        vocab = logits.size[logits.dims - 1];
+        token = sample_logits(logits.ptr<float>() + (logits.total() * logits.channels() - vocab), vocab, options, &ids, &probs);
+
+        if(options.candidates > 0) {
+          ret = JS_NewObject(ctx);
+          JS_SetPropertyStr(ctx, ret, "token", js_value_from(ctx, token));
+          JS_SetPropertyStr(ctx, ret, "ids", js_typedarray_from(ctx, ids.data(), ids.data() + ids.size()));
+          JS_SetPropertyStr(ctx, ret, "probs", js_typedarray_from(ctx, probs.data(), probs.data() + probs.size()));
+        } else {
+          ret = js_value_from(ctx, token);
+        }
+
+        break;
+      }
+
       case DNN_SOFTNMSBOXES: {
         std::vector<cv::Rect> bboxes;
         std::vector<float> scores, updated_scores;
@@ -2672,6 +3739,74 @@ js_dnn_func(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]
         ret = js_net_new(ctx, net_proto, n);
         break;
       }
+
+      /* readNetCached(path[, { backend, target, shared }]) - see include/model_cache.hpp */
+      case DNN_READNETCACHED: {
+        std::string path;
+        int32_t backend = -1, target = -1;
+        bool shared = false;
+
+        js_value_to(ctx, argv[0], path);
+
+        if(argc > 1 && JS_IsObject(argv[1])) {
+          JSValue v;
+
+          if(!JS_IsUndefined(v = JS_GetPropertyStr(ctx, argv[1], "backend")))
+            js_value_to(ctx, v, backend);
+          JS_FreeValue(ctx, v);
+
+          if(!JS_IsUndefined(v = JS_GetPropertyStr(ctx, argv[1], "target")))
+            js_value_to(ctx, v, target);
+          JS_FreeValue(ctx, v);
+
+          shared = JS_ToBool(ctx, v = JS_GetPropertyStr(ctx, argv[1], "shared")) > 0;
+          JS_FreeValue(ctx, v);
+        }
+
+        if(shared) {
+          std::shared_ptr<SharedNet> entry = model_cache_shared(path, backend, target);
+          JSNetData n(entry->net);
+
+          n.lock = entry->lock;
+          n.cached = entry;
+          n.shared = true;
+          ret = js_net_new(ctx, net_proto, n);
+        } else {
+          std::shared_ptr<const ModelBytes> bytes;
+          JSNetData n(model_cache_read(path, backend, target, &bytes));
+
+          n.cached = bytes;
+          ret = js_net_new(ctx, net_proto, n);
+        }
+
+        break;
+      }
+
+      case DNN_MODELCACHEENTRIES: {
+        std::vector<ModelCacheEntry> entries = model_cache_entries();
+        uint32_t i = 0;
+
+        ret = JS_NewArray(ctx);
+
+        for(const ModelCacheEntry& entry : entries) {
+          JSValue obj = JS_NewObject(ctx);
+
+          JS_SetPropertyStr(ctx, obj, "path", js_value_from(ctx, entry.path));
+          JS_SetPropertyStr(ctx, obj, "mtime", JS_NewInt64(ctx, entry.mtime));
+          JS_SetPropertyStr(ctx, obj, "size", JS_NewInt64(ctx, entry.size));
+          JS_SetPropertyStr(ctx, obj, "shared", JS_NewBool(ctx, entry.shared));
+          JS_SetPropertyStr(ctx, obj, "refs", JS_NewInt64(ctx, entry.refs));
+
+          if(entry.shared) {
+            JS_SetPropertyStr(ctx, obj, "backend", js_value_from(ctx, entry.backend));
+            JS_SetPropertyStr(ctx, obj, "target", js_value_from(ctx, entry.target));
+          }
+
+          JS_SetPropertyUint32(ctx, ret, i++, obj);
+        }
+
+        break;
+      }
     }
   } catch(const cv::Exception& e) { ret = js_cv_throw(ctx, e); }
 
@@ -2737,8 +3872,10 @@ const JSCFunctionListEntry js_dnn_dnn_funcs[] = {
       JS_CFUNC_MAGIC_DEF("getLayerFactoryImpl", 0, js_dnn_func, DNN_GETLAYERFACTORYIMPL),
       JS_CFUNC_MAGIC_DEF("getLayerFactoryMutex", 0, js_dnn_func, DNN_GETLAYERFACTORYMUTEX),*/
     JS_CFUNC_MAGIC_DEF("imagesFromBlob", 2, js_dnn_func, DNN_IMAGESFROMBLOB),
+    JS_CFUNC_MAGIC_DEF("modelCacheEntries", 0, js_dnn_func, DNN_MODELCACHEENTRIES),
     JS_CFUNC_MAGIC_DEF("NMSBoxes", 5, js_dnn_func, DNN_NMSBOXES),
     JS_CFUNC_MAGIC_DEF("NMSBoxesBatched", 6, js_dnn_func, DNN_NMSBOXESBATCHED),
+    JS_CFUNC_MAGIC_DEF("readNetCached", 1, js_dnn_func, DNN_READNETCACHED),
 #ifndef HAVE_OPENCV_DNN_NEW_ENGINE
     JS_CFUNC_MAGIC_DEF("readNetFromCaffe", 1, js_dnn_func, DNN_READNETFROMCAFFE),
     JS_CFUNC_MAGIC_DEF("readNetFromDarknet", 1, js_dnn_func, DNN_READNETFROMDARKNET),
@@ -2752,6 +3889,7 @@ const JSCFunctionListEntry js_dnn_dnn_funcs[] = {
     JS_CFUNC_MAGIC_DEF("readTorchBlob", 1, js_dnn_func, DNN_READTORCHBLOB),
     JS_CFUNC_MAGIC_DEF("shrinkCaffeModel", 1, js_dnn_func, DNN_SHRINKCAFFEMODEL),
 #endif
+    JS_CFUNC_MAGIC_DEF("sample", 1, js_dnn_func, DNN_SAMPLE),
     JS_CFUNC_MAGIC_DEF("softNMSBoxes", 1, js_dnn_func, DNN_SOFTNMSBOXES),
     JS_CFUNC_MAGIC_DEF("writeTextGraph", 2, js_dnn_func, DNN_WRITETEXTGRAPH),
 };
@@ -2762,6 +3900,9 @@ const JSCFunctionListEntry js_dnn_static_funcs[] = {
 
 extern "C" int
 js_dnn_init(JSContext* ctx, JSModuleDef* m) {
+  /* forwardAsync() and BatchScheduler need the 'os' event loop */
+  js_async_init(ctx);
+
   dnn_object = JS_NewObjectProto(ctx, JS_NULL);
 
   /* create the Net class */
@@ -2830,6 +3971,42 @@ js_dnn_init(JSContext* ctx, JSModuleDef* m) {
   REGISTER_DNN_MODEL_CLASS(text_detection_model_east, "TextDetectionModel_EAST");
   REGISTER_DNN_MODEL_CLASS(text_detection_model_db, "TextDetectionModel_DB");
 
+  /* create the BatchScheduler class */
+  JS_NewClassID(&js_batch_scheduler_class_id);
+  JS_NewClass(JS_GetRuntime(ctx), js_batch_scheduler_class_id, &js_batch_scheduler_class);
+
+  batch_scheduler_proto = JS_NewObject(ctx);
+  JS_SetPropertyFunctionList(ctx, batch_scheduler_proto, js_batch_scheduler_proto_funcs, countof(js_batch_scheduler_proto_funcs));
+  JS_SetClassProto(ctx, js_batch_scheduler_class_id, batch_scheduler_proto);
+
+  batch_scheduler_class = JS_NewCFunction2(ctx, js_batch_scheduler_constructor, "BatchScheduler", 1, JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, batch_scheduler_class, batch_scheduler_proto);
+  JS_SetPropertyStr(ctx, dnn_object, "BatchScheduler", batch_scheduler_class);
+
+  /* create the KVCache class */
+  JS_NewClassID(&js_kv_cache_class_id);
+  JS_NewClass(JS_GetRuntime(ctx), js_kv_cache_class_id, &js_kv_cache_class);
+
+  kv_cache_proto = JS_NewObject(ctx);
+  JS_SetPropertyFunctionList(ctx, kv_cache_proto, js_kv_cache_proto_funcs, countof(js_kv_cache_proto_funcs));
+  JS_SetClassProto(ctx, js_kv_cache_class_id, kv_cache_proto);
+
+  kv_cache_class = JS_NewCFunction2(ctx, js_kv_cache_constructor, "KVCache", 4, JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, kv_cache_class, kv_cache_proto);
+  JS_SetPropertyStr(ctx, dnn_object, "KVCache", kv_cache_class);
+
+  /* create the BlobBuilder class */
+  JS_NewClassID(&js_blob_builder_class_id);
+  JS_NewClass(JS_GetRuntime(ctx), js_blob_builder_class_id, &js_blob_builder_class);
+
+  blob_builder_proto = JS_NewObject(ctx);
+  JS_SetPropertyFunctionList(ctx, blob_builder_proto, js_blob_builder_proto_funcs, countof(js_blob_builder_proto_funcs));
+  JS_SetClassProto(ctx, js_blob_builder_class_id, blob_builder_proto);
+
+  blob_builder_class = JS_NewCFunction2(ctx, js_blob_builder_constructor, "BlobBuilder", 0, JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, blob_builder_class, blob_builder_proto);
+  JS_SetPropertyStr(ctx, dnn_object, "BlobBuilder", blob_builder_class);
+
   JS_SetPropertyFunctionList(ctx, dnn_object, js_dnn_dnn_funcs, countof(js_dnn_dnn_funcs));
 
   if(m) {
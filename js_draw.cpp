@@ -11,6 +11,8 @@
 #include "js_keypoint.hpp"
 #include "include/jsbindings.hpp"
 #include "include/js_inputoutputarray.hpp"
+#include "include/draw_list.hpp"
+#include "include/js_alloc.hpp"
 #include <opencv2/features2d.hpp>
 #include <opencv2/imgproc.hpp>
 #include <quickjs.h>
@@ -754,6 +756,383 @@ js_fill_convex_poly(JSContext* ctx, JSValueConst this_val, int argc, JSValueCons
   return JS_UNDEFINED;
 }
 
+thread_local JSValue draw_list_proto = JS_UNDEFINED, draw_list_class = JS_UNDEFINED;
+thread_local JSClassID js_draw_list_class_id = 0;
+
+enum {
+  DRAW_LIST_LINE = 0,
+  DRAW_LIST_RECTANGLE,
+  DRAW_LIST_CIRCLE,
+  DRAW_LIST_ELLIPSE,
+  DRAW_LIST_POLYLINES,
+  DRAW_LIST_FILL_POLY,
+  DRAW_LIST_PUT_TEXT,
+  DRAW_LIST_CLEAR,
+  DRAW_LIST_DRAW,
+};
+
+enum {
+  DRAW_LIST_LENGTH = 0,
+  DRAW_LIST_BOUNDS,
+};
+
+static DrawList*
+js_draw_list_data2(JSContext* ctx, JSValueConst val) {
+  return static_cast<DrawList*>(JS_GetOpaque2(ctx, val, js_draw_list_class_id));
+}
+
+/* Polyline vertices from an array of Points, or a Mat, PointVector,
+ * PointArray or TypedArray of x,y pairs, rounded to integers */
+static bool
+js_draw_list_points(JSContext* ctx, JSValueConst value, std::vector<cv::Point>& pts) {
+  pts.clear();
+
+  if(js_is_array(ctx, value)) {
+    std::vector<cv::Point2d> points;
+
+    js_array_to(ctx, value, points);
+
+    for(const cv::Point2d& pt : points)
+      pts.emplace_back(cvRound(pt.x), cvRound(pt.y));
+
+    return true;
+  }
+
+  JSInputArray arr = js_cv_inputarray(ctx, value);
+
+  if(js_is_noarray(arr))
+    return false;
+
+  cv::Mat mat = arr.getMat();
+
+  if(mat.empty())
+    return true;
+
+  if(!mat.isContinuous())
+    mat = mat.clone();
+
+  if(mat.channels() == 1 && mat.total() % 2 == 0)
+    mat = mat.reshape(2, int(mat.total() / 2));
+
+  int n = mat.checkVector(2);
+
+  if(n < 0)
+    return false;
+
+  pts.resize(n);
+  mat.reshape(2, n).convertTo(cv::Mat(n, 1, CV_32SC2, pts.data()), CV_32S);
+  return true;
+}
+
+/* Trailing color, thickness and lineType (or antialias flag) arguments */
+static void
+js_draw_list_style(JSContext* ctx, int argc, JSValueConst argv[], int i, cv::Scalar& color, int& thickness, int& line_type) {
+  if(argc > i)
+    js_color_read(ctx, argv[i++], &color);
+
+  if(argc > i)
+    js_value_to(ctx, argv[i++], thickness);
+
+  if(argc > i) {
+    if(JS_IsBool(argv[i]))
+      line_type = JS_ToBool(ctx, argv[i]) ? cv::LINE_AA : cv::LINE_8;
+    else if(JS_IsNumber(argv[i]))
+      JS_ToInt32(ctx, &line_type, argv[i]);
+  }
+}
+
+static JSValue
+js_draw_list_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  JSValue obj = JS_UNDEFINED, proto;
+  DrawList* list;
+
+  if(!(list = js_allocate<DrawList>(ctx)))
+    return JS_EXCEPTION;
+
+  new(list) DrawList();
+
+  /* using new_target to get the prototype is necessary when the class is extended. */
+  proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+
+  if(JS_IsException(proto))
+    goto fail;
+
+  obj = JS_NewObjectProtoClass(ctx, proto, js_draw_list_class_id);
+  JS_FreeValue(ctx, proto);
+
+  if(JS_IsException(obj))
+    goto fail;
+
+  JS_SetOpaque(obj, list);
+
+  return obj;
+
+fail:
+  list->~DrawList();
+  js_deallocate(ctx, list);
+  JS_FreeValue(ctx, obj);
+  return JS_EXCEPTION;
+}
+
+/**
+ * DrawList methods take the arguments of the free drawing functions of the
+ * same name, minus the destination Mat, and record instead of drawing.
+ * draw(mat, { offset, clip, bands }) replays the list onto `mat`.
+ */
+static JSValue
+js_draw_list_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  DrawList* list;
+  cv::Scalar color;
+  int i = 0, thickness = 1, line_type = cv::LINE_AA;
+
+  if(!(list = js_draw_list_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case DRAW_LIST_LINE: {
+      JSLineData<double> line(0, 0, 0, 0);
+
+      if(!js_line_arg(ctx, argc, argv, i, line))
+        return JS_ThrowTypeError(ctx, "argument 1 must be a line");
+
+      js_draw_list_style(ctx, argc, argv, i, color, thickness, line_type);
+
+      if(thickness < 1)
+        return JS_ThrowRangeError(ctx, "thickness must be positive");
+
+      list->line(line.a, line.b, color, thickness, line_type);
+      break;
+    }
+
+    case DRAW_LIST_RECTANGLE: {
+      JSRectData<double> rect;
+      JSPointData<double> pt1, pt2;
+
+      if(argc > i && js_rect_read(ctx, argv[i], &rect)) {
+        pt1 = rect.tl();
+        pt2 = rect.br();
+        i++;
+      } else if(argc > i + 1 && js_point_read(ctx, argv[i], &pt1) && js_point_read(ctx, argv[i + 1], &pt2)) {
+        i += 2;
+      } else {
+        return JS_ThrowTypeError(ctx, "argument 1 must be a Rect or two Points");
+      }
+
+      js_draw_list_style(ctx, argc, argv, i, color, thickness, line_type);
+      list->rectangle(pt1, pt2, color, thickness, line_type);
+      break;
+    }
+
+    case DRAW_LIST_CIRCLE: {
+      JSPointData<double> center;
+      int32_t radius = 0;
+
+      if(argc <= i || !js_point_read(ctx, argv[i++], &center))
+        return JS_ThrowTypeError(ctx, "argument 1 must be a Point");
+
+      if(argc > i)
+        JS_ToInt32(ctx, &radius, argv[i++]);
+
+      thickness = -1;
+      js_draw_list_style(ctx, argc, argv, i, color, thickness, line_type);
+      list->circle(center, radius, color, thickness, line_type);
+      break;
+    }
+
+    case DRAW_LIST_ELLIPSE: {
+      JSPointData<double> center;
+      JSSizeData<double> axes;
+      double angle = 0, start_angle = 0, end_angle = 360;
+
+      if(argc > i && js_rect_read(ctx, argv[i], &center, &axes)) {
+        center.x += axes.width / 2;
+        center.y += axes.height / 2;
+        i++;
+      } else if(argc > i + 1 && js_point_read(ctx, argv[i], &center) && js_size_read(ctx, argv[i + 1], &axes)) {
+        i += 2;
+      } else {
+        return JS_ThrowTypeError(ctx, "argument 1 must be a Rect, or a Point and a Size");
+      }
+
+      if(argc > i)
+        js_value_to(ctx, argv[i++], angle);
+      if(argc > i)
+        js_value_to(ctx, argv[i++], start_angle);
+      if(argc > i)
+        js_value_to(ctx, argv[i++], end_angle);
+
+      thickness = -1;
+      js_draw_list_style(ctx, argc, argv, i, color, thickness, line_type);
+      list->ellipse(center, cv::Size(cvRound(axes.width), cvRound(axes.height)), angle, start_angle, end_angle, color, thickness, line_type);
+      break;
+    }
+
+    case DRAW_LIST_POLYLINES:
+    case DRAW_LIST_FILL_POLY: {
+      std::vector<cv::Point> pts;
+      bool closed = false;
+
+      if(argc <= i || !js_draw_list_points(ctx, argv[i++], pts))
+        return JS_ThrowTypeError(ctx, "argument 1 must be an array of Points, Mat, PointVector, PointArray or TypedArray");
+
+      if(magic == DRAW_LIST_FILL_POLY) {
+        if(argc > i)
+          js_color_read(ctx, argv[i++], &color);
+        if(argc > i)
+          JS_ToInt32(ctx, &line_type, argv[i++]);
+
+        list->fillPoly(pts.data(), pts.size(), color, line_type);
+        break;
+      }
+
+      if(argc > i)
+        closed = JS_ToBool(ctx, argv[i++]);
+
+      js_draw_list_style(ctx, argc, argv, i, color, thickness, line_type);
+
+      if(thickness < 1)
+        return JS_ThrowRangeError(ctx, "thickness must be positive");
+
+      list->polylines(pts.data(), pts.size(), closed, color, thickness, line_type);
+      break;
+    }
+
+    case DRAW_LIST_PUT_TEXT: {
+      std::string text;
+      JSPointData<double> org;
+      int32_t font_face = cv::FONT_HERSHEY_SIMPLEX;
+      double font_scale = 1;
+      bool bottom_left_origin = false;
+
+      if(argc > i)
+        js_value_to(ctx, argv[i++], text);
+
+      if(argc <= i || !js_point_read(ctx, argv[i++], &org))
+        return JS_ThrowTypeError(ctx, "argument 2 must be a Point");
+
+      if(argc > i && !JS_IsNumber(argv[i]))
+        return JS_ThrowTypeError(ctx, "DrawList only records Hershey fonts, argument 3 must be a number");
+
+      if(argc > i)
+        JS_ToInt32(ctx, &font_face, argv[i++]);
+      if(argc > i)
+        JS_ToFloat64(ctx, &font_scale, argv[i++]);
+
+      js_draw_list_style(ctx, argc, argv, i, color, thickness, line_type);
+
+      if(argc > i + 3)
+        bottom_left_origin = JS_ToBool(ctx, argv[i + 3]);
+
+      try {
+        list->text(text, org, font_face, font_scale, color, std::max(thickness, 1), line_type, bottom_left_origin);
+      } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
+
+      break;
+    }
+
+    case DRAW_LIST_CLEAR: {
+      list->clear();
+      break;
+    }
+
+    case DRAW_LIST_DRAW: {
+      JSMatData* dst;
+      JSPointData<double> offset(0, 0);
+      JSRectData<double> clip(0, 0, 0, 0);
+      int32_t bands = 1;
+
+      if(argc < 1 || !(dst = js_mat_data_nothrow(argv[0])))
+        return JS_ThrowTypeError(ctx, "argument 1 must be a Mat");
+
+      if(argc > 1 && JS_IsObject(argv[1])) {
+        JSValue value;
+
+        value = JS_GetPropertyStr(ctx, argv[1], "offset");
+        if(!JS_IsUndefined(value) && !js_point_read(ctx, value, &offset)) {
+          JS_FreeValue(ctx, value);
+          return JS_ThrowTypeError(ctx, "options.offset must be a Point");
+        }
+        JS_FreeValue(ctx, value);
+
+        value = JS_GetPropertyStr(ctx, argv[1], "clip");
+        if(!JS_IsUndefined(value) && !js_rect_read(ctx, value, &clip)) {
+          JS_FreeValue(ctx, value);
+          return JS_ThrowTypeError(ctx, "options.clip must be a Rect");
+        }
+        JS_FreeValue(ctx, value);
+
+        value = JS_GetPropertyStr(ctx, argv[1], "bands");
+        if(!JS_IsUndefined(value))
+          JS_ToInt32(ctx, &bands, value);
+        JS_FreeValue(ctx, value);
+      }
+
+      try {
+        list->replay(*dst, offset, clip, bands);
+      } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
+
+      break;
+    }
+  }
+
+  return JS_UNDEFINED;
+}
+
+static JSValue
+js_draw_list_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  DrawList* list;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(list = js_draw_list_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case DRAW_LIST_LENGTH: {
+      ret = JS_NewInt64(ctx, list->size());
+      break;
+    }
+
+    case DRAW_LIST_BOUNDS: {
+      cv::Rect r = list->bounds();
+
+      ret = js_rect_new(ctx, double(r.x), double(r.y), double(r.width), double(r.height));
+      break;
+    }
+  }
+
+  return ret;
+}
+
+void
+js_draw_list_finalizer(JSRuntime* rt, JSValue val) {
+  DrawList* list;
+
+  if((list = static_cast<DrawList*>(JS_GetOpaque(val, js_draw_list_class_id)))) {
+    list->~DrawList();
+    js_deallocate(rt, list);
+  }
+}
+
+JSClassDef js_draw_list_class = {
+    .class_name = "DrawList",
+    .finalizer = js_draw_list_finalizer,
+};
+
+const JSCFunctionListEntry js_draw_list_proto_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("line", 1, js_draw_list_method, DRAW_LIST_LINE),
+    JS_CFUNC_MAGIC_DEF("rectangle", 1, js_draw_list_method, DRAW_LIST_RECTANGLE),
+    JS_CFUNC_MAGIC_DEF("circle", 2, js_draw_list_method, DRAW_LIST_CIRCLE),
+    JS_CFUNC_MAGIC_DEF("ellipse", 2, js_draw_list_method, DRAW_LIST_ELLIPSE),
+    JS_CFUNC_MAGIC_DEF("polylines", 1, js_draw_list_method, DRAW_LIST_POLYLINES),
+    JS_CFUNC_MAGIC_DEF("fillPoly", 1, js_draw_list_method, DRAW_LIST_FILL_POLY),
+    JS_CFUNC_MAGIC_DEF("putText", 2, js_draw_list_method, DRAW_LIST_PUT_TEXT),
+    JS_CFUNC_MAGIC_DEF("clear", 0, js_draw_list_method, DRAW_LIST_CLEAR),
+    JS_CFUNC_MAGIC_DEF("draw", 1, js_draw_list_method, DRAW_LIST_DRAW),
+    JS_CGETSET_MAGIC_DEF("length", js_draw_list_get, 0, DRAW_LIST_LENGTH),
+    JS_CGETSET_MAGIC_DEF("bounds", js_draw_list_get, 0, DRAW_LIST_BOUNDS),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "DrawList", JS_PROP_CONFIGURABLE),
+};
+
 JSValue draw_proto = JS_UNDEFINED, draw_class = JS_UNDEFINED;
 thread_local JSClassID js_draw_class_id = 0;
 
@@ -834,6 +1213,19 @@ js_draw_init(JSContext* ctx, JSModuleDef* m) {
 
   JS_SetModuleExport(ctx, m, "Draw", draw_class);
 
+  /* create the DrawList class */
+  JS_NewClassID(&js_draw_list_class_id);
+  JS_NewClass(JS_GetRuntime(ctx), js_draw_list_class_id, &js_draw_list_class);
+
+  draw_list_proto = JS_NewObject(ctx);
+  JS_SetPropertyFunctionList(ctx, draw_list_proto, js_draw_list_proto_funcs, countof(js_draw_list_proto_funcs));
+  JS_SetClassProto(ctx, js_draw_list_class_id, draw_list_proto);
+
+  draw_list_class = JS_NewCFunction2(ctx, js_draw_list_constructor, "DrawList", 0, JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, draw_list_class, draw_list_proto);
+
+  JS_SetModuleExport(ctx, m, "DrawList", draw_list_class);
+
   JS_SetModuleExportList(ctx, m, js_draw_global_funcs, countof(js_draw_global_funcs));
 
   return 0;
@@ -842,6 +1234,7 @@ js_draw_init(JSContext* ctx, JSModuleDef* m) {
 extern "C" void
 js_draw_export(JSContext* ctx, JSModuleDef* m) {
   JS_AddModuleExport(ctx, m, "Draw");
+  JS_AddModuleExport(ctx, m, "DrawList");
   JS_AddModuleExportList(ctx, m, js_draw_global_funcs, countof(js_draw_global_funcs));
 }
 
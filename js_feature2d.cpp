@@ -3,14 +3,20 @@
 #include "js_alloc.hpp"
 #include "include/js_array.hpp"
 #include "js_keypoint.hpp"
+#include "js_mat.hpp"
 #include "js_umat.hpp"
 #include "js_filenode.hpp"
 #include "js_filestorage.hpp"
 #include "include/jsbindings.hpp"
 #include "include/js_inputoutputarray.hpp"
+#include "include/flann_index_matcher.hpp"
 #include <quickjs.h>
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
 #include <cstring>
 #include <cstdint>
+#include <exception>
 #include <new>
 #include <string>
 #include <vector>
@@ -79,6 +85,65 @@ enum {
   DESCRIPTOR_MATCHER_FLANN_BASED,
 };
 
+/**
+ * FlannBasedMatcher options: { algorithm: 'auto' | 'kdtree' | 'kmeans' |
+ * 'lsh', trees, branching, iterations, tableNumber, keySize,
+ * multiProbeLevel, checks, rebuildRatio }
+ */
+static bool
+js_descriptor_matcher_options(JSContext* ctx, JSValueConst options, FlannIndexMatcher::Config& config, int32_t& checks, double& rebuildRatio) {
+  static const char* const algorithms[] = {"auto", "kdtree", "kmeans", "lsh"};
+  const std::pair<const char*, int32_t*> ints[] = {
+      {"trees", &config.trees},
+      {"branching", &config.branching},
+      {"iterations", &config.iterations},
+      {"tableNumber", &config.tableNumber},
+      {"keySize", &config.keySize},
+      {"multiProbeLevel", &config.multiProbeLevel},
+      {"checks", &checks},
+  };
+  JSValue value = JS_GetPropertyStr(ctx, options, "algorithm");
+
+  if(JS_IsString(value)) {
+    const char* name = JS_ToCString(ctx, value);
+    size_t i = 0;
+
+    while(i < countof(algorithms) && strcmp(name, algorithms[i]))
+      ++i;
+
+    if(i == countof(algorithms))
+      JS_ThrowRangeError(ctx, "FlannBasedMatcher: unknown algorithm '%s'", name);
+    else
+      config.algorithm = i;
+
+    JS_FreeCString(ctx, name);
+    JS_FreeValue(ctx, value);
+
+    if(i == countof(algorithms))
+      return false;
+  } else if(!JS_IsUndefined(value)) {
+    JS_ToInt32(ctx, &config.algorithm, value);
+    JS_FreeValue(ctx, value);
+  }
+
+  for(const auto& [name, ptr] : ints) {
+    value = JS_GetPropertyStr(ctx, options, name);
+
+    if(!JS_IsUndefined(value))
+      JS_ToInt32(ctx, ptr, value);
+
+    JS_FreeValue(ctx, value);
+  }
+
+  value = JS_GetPropertyStr(ctx, options, "rebuildRatio");
+
+  if(!JS_IsUndefined(value))
+    JS_ToFloat64(ctx, &rebuildRatio, value);
+
+  JS_FreeValue(ctx, value);
+  return true;
+}
+
 static JSValue
 js_descriptor_matcher_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[], int magic) {
   JSDescriptorMatcherData* dm;
@@ -102,7 +167,14 @@ js_descriptor_matcher_constructor(JSContext* ctx, JSValueConst new_target, int a
     }
 
     case DESCRIPTOR_MATCHER_FLANN_BASED: {
-      new(dm) JSDescriptorMatcherData(new cv::FlannBasedMatcher());
+      FlannIndexMatcher::Config config;
+      int32_t checks = 32;
+      double rebuildRatio = 0.1;
+
+      if(argc > 0 && JS_IsObject(argv[0]) && !js_descriptor_matcher_options(ctx, argv[0], config, checks, rebuildRatio))
+        goto fail;
+
+      new(dm) JSDescriptorMatcherData(new FlannIndexMatcher(config, checks, rebuildRatio));
       break;
     }
   }
@@ -130,6 +202,8 @@ fail:
 
 enum {
   DESCRIPTOR_MATCHER_EMPTY = 0,
+  DESCRIPTOR_MATCHER_INDEXED,
+  DESCRIPTOR_MATCHER_PENDING,
 };
 
 static JSValue
@@ -145,6 +219,14 @@ js_descriptor_matcher_get(JSContext* ctx, JSValueConst this_val, int magic) {
       ret = JS_NewBool(ctx, dm->get()->empty());
       break;
     }
+
+    case DESCRIPTOR_MATCHER_INDEXED:
+    case DESCRIPTOR_MATCHER_PENDING: {
+      if(FlannIndexMatcher* fim = dynamic_cast<FlannIndexMatcher*>(dm->get()))
+        ret = JS_NewInt32(ctx, magic == DESCRIPTOR_MATCHER_INDEXED ? fim->indexedCount() : fim->pendingCount());
+
+      break;
+    }
   }
 
   return ret;
@@ -154,6 +236,8 @@ enum {
   DESCRIPTOR_MATCHER_CLEAR,
   DESCRIPTOR_MATCHER_MATCH,
   DESCRIPTOR_MATCHER_TRAIN,
+  DESCRIPTOR_MATCHER_SAVE_INDEX,
+  DESCRIPTOR_MATCHER_LOAD_INDEX,
 };
 
 static JSValue
@@ -164,53 +248,95 @@ js_descriptor_matcher_method(JSContext* ctx, JSValueConst this_val, int argc, JS
   if(!(dm = js_descriptor_matcher_data2(ctx, this_val)))
     return JS_EXCEPTION;
 
-  cv::BFMatcher* bfm = dynamic_cast<cv::BFMatcher*>(dm->get());
-  cv::FlannBasedMatcher* flm = dynamic_cast<cv::FlannBasedMatcher*>(dm->get());
+  FlannIndexMatcher* fim = dynamic_cast<FlannIndexMatcher*>(dm->get());
 
-  switch(magic) {
-    case DESCRIPTOR_MATCHER_ADD: {
-      JSInputArray descriptors = js_cv_inputarray(ctx, argv[0]);
+  try {
+    switch(magic) {
+      case DESCRIPTOR_MATCHER_ADD: {
+        /* one Mat, or an array of them: one train image each */
+        if(js_is_array(ctx, argv[0])) {
+          std::vector<cv::Mat> sets;
+          int64_t n = js_array_length(ctx, argv[0]);
 
-      dm->get()->add(descriptors);
-      break;
-    }
+          for(int64_t i = 0; i < n; ++i) {
+            JSValue item = JS_GetPropertyUint32(ctx, argv[0], i);
+            cv::Mat* mat = js_mat_data_nothrow(item);
 
-    case DESCRIPTOR_MATCHER_CLEAR: {
-      dm->get()->clear();
-      break;
-    }
+            JS_FreeValue(ctx, item);
+
+            if(!mat)
+              return JS_ThrowTypeError(ctx, "argument 1 must be a Mat or an array of Mats");
 
-    case DESCRIPTOR_MATCHER_MATCH: {
-      JSInputArray queryDescriptors = js_cv_inputarray(ctx, argv[0]), trainDescriptors;
-      std::vector<cv::DMatch> matches;
-      JSInputArray masks = cv::noArray();
+            sets.push_back(*mat);
+          }
+
+          dm->get()->add(sets);
+        } else {
+          JSInputArray descriptors = js_cv_inputarray(ctx, argv[0]);
+
+          dm->get()->add(descriptors);
+        }
+
+        break;
+      }
+
+      case DESCRIPTOR_MATCHER_CLEAR: {
+        dm->get()->clear();
+        break;
+      }
+
+      case DESCRIPTOR_MATCHER_MATCH: {
+        JSInputArray queryDescriptors = js_cv_inputarray(ctx, argv[0]), trainDescriptors;
+        std::vector<cv::DMatch> matches;
+        JSInputArray masks = cv::noArray();
+
+        if(argc > 3) {
+          trainDescriptors = js_cv_inputarray(ctx, argv[1]);
+          masks = js_cv_inputarray(ctx, argv[3]);
 
-      if(argc > 3) {
-        trainDescriptors = js_cv_inputarray(ctx, argv[1]);
-        masks = js_cv_inputarray(ctx, argv[3]);
+          dm->get()->match(queryDescriptors, trainDescriptors, matches, masks);
 
-        dm->get()->match(queryDescriptors, trainDescriptors, matches, masks);
+          js_array_clear(ctx, argv[2]);
+          js_array_copy(ctx, argv[2], matches);
+        } else {
+          if(argc > 2)
+            masks = js_cv_inputarray(ctx, argv[2]);
 
-        js_array_clear(ctx, argv[2]);
-        js_array_copy(ctx, argv[2], matches);
-      } else {
-        if(argc > 2)
-          masks = js_cv_inputarray(ctx, argv[2]);
+          dm->get()->match(queryDescriptors, matches, masks);
 
-        dm->get()->match(queryDescriptors, matches, masks);
+          js_array_clear(ctx, argv[1]);
+          js_array_copy(ctx, argv[1], matches);
+        }
 
-        js_array_clear(ctx, argv[1]);
-        js_array_copy(ctx, argv[1], matches);
+        break;
       }
 
-      break;
-    }
+      case DESCRIPTOR_MATCHER_TRAIN: {
+        dm->get()->train();
+        break;
+      }
 
-    case DESCRIPTOR_MATCHER_TRAIN: {
-      dm->get()->train();
-      break;
+      case DESCRIPTOR_MATCHER_SAVE_INDEX:
+      case DESCRIPTOR_MATCHER_LOAD_INDEX: {
+        std::string path;
+
+        if(!fim)
+          return JS_ThrowTypeError(ctx, "%s() needs a FlannBasedMatcher", magic == DESCRIPTOR_MATCHER_SAVE_INDEX ? "saveIndex" : "loadIndex");
+
+        if(argc < 1 || !JS_IsString(argv[0]))
+          return JS_ThrowTypeError(ctx, "argument 1 must be a path");
+
+        js_value_to(ctx, argv[0], path);
+
+        if(magic == DESCRIPTOR_MATCHER_SAVE_INDEX)
+          fim->saveIndex(path);
+        else
+          fim->loadIndex(path);
+
+        break;
+      }
     }
-  }
+  } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
 
   return ret;
 }
@@ -237,7 +363,11 @@ const JSCFunctionListEntry js_descriptor_matcher_proto_funcs[] = {
     JS_CFUNC_MAGIC_DEF("clear", 0, js_descriptor_matcher_method, DESCRIPTOR_MATCHER_CLEAR),
     JS_CFUNC_MAGIC_DEF("match", 2, js_descriptor_matcher_method, DESCRIPTOR_MATCHER_MATCH),
     JS_CFUNC_MAGIC_DEF("train", 0, js_descriptor_matcher_method, DESCRIPTOR_MATCHER_TRAIN),
+    JS_CFUNC_MAGIC_DEF("saveIndex", 1, js_descriptor_matcher_method, DESCRIPTOR_MATCHER_SAVE_INDEX),
+    JS_CFUNC_MAGIC_DEF("loadIndex", 1, js_descriptor_matcher_method, DESCRIPTOR_MATCHER_LOAD_INDEX),
     JS_CGETSET_MAGIC_DEF("empty", js_descriptor_matcher_get, 0, DESCRIPTOR_MATCHER_EMPTY),
+    JS_CGETSET_MAGIC_DEF("indexedCount", js_descriptor_matcher_get, 0, DESCRIPTOR_MATCHER_INDEXED),
+    JS_CGETSET_MAGIC_DEF("pendingCount", js_descriptor_matcher_get, 0, DESCRIPTOR_MATCHER_PENDING),
     JS_PROP_STRING_DEF("[Symbol.toStringTag]", "DescriptorMatcher", JS_PROP_CONFIGURABLE),
 };
 
@@ -993,11 +1123,181 @@ f2d->getDefaultName().c_str()), JS_PROP_ENUMERABLE);
   return obj;
 }*/
 
+/**
+ * @brief A detector for one more worker thread. Most implementations keep
+ * only their parameters between calls and can be shared; MSER (scratch
+ * buffers), DAISY (the current image and its smoothed layers) and FREAK
+ * (lazily built pattern tables) keep per-call state, so those are
+ * recreated from their parameters.
+ */
+static cv::Ptr<cv::Feature2D>
+js_feature2d_clone(const cv::Ptr<cv::Feature2D>& f2d) {
+  cv::Feature2D* ptr = f2d.get();
+
+  if(MSER* mser = dynamic_cast<MSER*>(ptr)) {
+    cv::Ptr<MSER> ret = MSER::create(mser->getDelta(),
+                                     mser->getMinArea(),
+                                     mser->getMaxArea(),
+                                     mser->getMaxVariation(),
+                                     mser->getMinDiversity(),
+                                     mser->getMaxEvolution(),
+                                     mser->getAreaThreshold(),
+                                     mser->getMinMargin(),
+                                     mser->getEdgeBlurSize());
+
+    ret->setPass2Only(mser->getPass2Only());
+    return ret;
+  }
+
+  if(DAISY* daisy = dynamic_cast<DAISY*>(ptr))
+    return DAISY::create(daisy->getRadius(),
+                         daisy->getQRadius(),
+                         daisy->getQTheta(),
+                         daisy->getQHist(),
+                         daisy->getNorm(),
+                         daisy->getH(),
+                         daisy->getInterpolation(),
+                         daisy->getUseOrientation());
+
+  if(FREAK* freak = dynamic_cast<FREAK*>(ptr))
+    return FREAK::create(freak->getOrientationNormalized(), freak->getScaleNormalized(), freak->getPatternScale(), freak->getNOctaves());
+
+  return f2d;
+}
+
+/**
+ * detectAndComputeBatch(images, masks?, { threads })
+ *
+ * detectAndCompute() over a set of images on OpenCV's thread pool, each
+ * worker pulling the next image. Returns
+ *
+ *   { keypoints: Float32Array, descriptors: Mat, offsets: Uint32Array }
+ *
+ * where image i owns rows offsets[i] .. offsets[i + 1] of `descriptors`
+ * and of `keypoints`, a table of x, y, size, angle, response, octave,
+ * class_id per keypoint.
+ */
+static JSValue
+js_feature2d_detect_and_compute_batch(JSContext* ctx, JSFeature2DData* s, int argc, JSValueConst argv[]) {
+  std::vector<cv::Mat> images, masks;
+  std::vector<std::vector<cv::KeyPoint>> keypoints;
+  std::vector<cv::Mat> descriptors;
+  std::vector<cv::Ptr<cv::Feature2D>> detectors;
+  std::vector<std::exception_ptr> errors;
+  std::atomic<int> next(0);
+  int32_t threads = cv::getNumThreads();
+  int64_t n;
+
+  if(argc < 1 || !js_is_array(ctx, argv[0]))
+    return JS_ThrowTypeError(ctx, "argument 1 must be an array of images");
+
+  n = js_array_length(ctx, argv[0]);
+  images.resize(n);
+  masks.resize(n);
+
+  for(int64_t i = 0; i < n; ++i) {
+    JSValue item = JS_GetPropertyUint32(ctx, argv[0], i);
+    cv::Mat* mat = js_mat_data_nothrow(item);
+    JSUMatData* umat = mat ? nullptr : js_umat_data(item);
+
+    JS_FreeValue(ctx, item);
+
+    if(!mat && !umat)
+      return JS_ThrowTypeError(ctx, "images[%" PRId64 "] is not a Mat or UMat", i);
+
+    images[i] = mat ? *mat : umat->getMat(cv::ACCESS_READ);
+
+    if(argc > 1 && js_is_array(ctx, argv[1])) {
+      item = JS_GetPropertyUint32(ctx, argv[1], i);
+
+      if((mat = js_mat_data_nothrow(item)))
+        masks[i] = *mat;
+
+      JS_FreeValue(ctx, item);
+    }
+  }
+
+  if(argc > 2 && JS_IsObject(argv[2])) {
+    JSValue value = JS_GetPropertyStr(ctx, argv[2], "threads");
+
+    if(!JS_IsUndefined(value))
+      JS_ToInt32(ctx, &threads, value);
+
+    JS_FreeValue(ctx, value);
+  }
+
+  threads = std::max(1, std::min<int32_t>(threads, std::max<int64_t>(n, 1)));
+  keypoints.resize(n);
+  descriptors.resize(n);
+  errors.resize(threads);
+  detectors.push_back(*s);
+
+  for(int32_t w = 1; w < threads; ++w)
+    detectors.push_back(js_feature2d_clone(*s));
+
+  cv::parallel_for_(
+      cv::Range(0, threads),
+      [&](const cv::Range& range) {
+        for(int w = range.start; w < range.end; ++w) {
+          try {
+            int i;
+
+            while((i = next++) < n)
+              detectors[w]->detectAndCompute(images[i], masks[i], keypoints[i], descriptors[i]);
+          } catch(const std::exception&) { errors[w] = std::current_exception(); }
+        }
+      },
+      threads);
+
+  for(const std::exception_ptr& error : errors)
+    if(error) {
+      try {
+        std::rethrow_exception(error);
+      } catch(const std::exception& e) { return js_cv_throw(ctx, e); }
+    }
+
+  std::vector<uint32_t> offsets(n + 1, 0);
+  std::vector<float> table;
+  cv::Mat all;
+  int cols = 0, type = -1;
+
+  for(int64_t i = 0; i < n; ++i) {
+    offsets[i + 1] = offsets[i] + keypoints[i].size();
+
+    if(!descriptors[i].empty()) {
+      cols = descriptors[i].cols;
+      type = descriptors[i].type();
+    }
+  }
+
+  table.reserve(offsets[n] * 7);
+
+  for(const auto& kps : keypoints)
+    for(const cv::KeyPoint& kp : kps)
+      table.insert(table.end(), {kp.pt.x, kp.pt.y, kp.size, kp.angle, kp.response, float(kp.octave), float(kp.class_id)});
+
+  if(type >= 0) {
+    all.create(offsets[n], cols, type);
+
+    for(int64_t i = 0; i < n; ++i)
+      if(!descriptors[i].empty())
+        descriptors[i].copyTo(all.rowRange(offsets[i], offsets[i] + descriptors[i].rows));
+  }
+
+  JSValue ret = JS_NewObject(ctx);
+
+  JS_SetPropertyStr(ctx, ret, "keypoints", js_typedarray_from(ctx, table.data(), table.data() + table.size()));
+  JS_SetPropertyStr(ctx, ret, "descriptors", js_mat_wrap(ctx, all));
+  JS_SetPropertyStr(ctx, ret, "offsets", js_typedarray_from(ctx, offsets.data(), offsets.data() + offsets.size()));
+  return ret;
+}
+
 enum {
   METHOD_CLEAR = 0,
   METHOD_COMPUTE,
   METHOD_DETECT,
   METHOD_DETECTANDCOMPUTE,
+  METHOD_DETECTANDCOMPUTE_BATCH,
   METHOD_WRITE,
   METHOD_READ,
   METHOD_GET_DEFAULT_NAME,
@@ -1069,6 +1369,11 @@ js_feature2d_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueCons
         break;
       }
 
+      case METHOD_DETECTANDCOMPUTE_BATCH: {
+        ret = js_feature2d_detect_and_compute_batch(ctx, s, argc, argv);
+        break;
+      }
+
       case METHOD_WRITE: {
         JSFileStorageData* fs;
 
@@ -1267,6 +1572,7 @@ const JSCFunctionListEntry js_feature2d_proto_funcs[] = {
     JS_CFUNC_MAGIC_DEF("compute", 2, js_feature2d_method, METHOD_COMPUTE),
     JS_CFUNC_MAGIC_DEF("detect", 2, js_feature2d_method, METHOD_DETECT),
     JS_CFUNC_MAGIC_DEF("detectAndCompute", 4, js_feature2d_method, METHOD_DETECTANDCOMPUTE),
+    JS_CFUNC_MAGIC_DEF("detectAndComputeBatch", 1, js_feature2d_method, METHOD_DETECTANDCOMPUTE_BATCH),
     JS_CFUNC_MAGIC_DEF("write", 1, js_feature2d_method, METHOD_WRITE),
     JS_CFUNC_MAGIC_DEF("read", 1, js_feature2d_method, METHOD_READ),
     JS_CFUNC_MAGIC_DEF("getDefaultName", 0, js_feature2d_method, METHOD_GET_DEFAULT_NAME),
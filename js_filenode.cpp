@@ -1,13 +1,22 @@
 #include "js_filenode.hpp"
+#include "js_cv.hpp"
 #include "js_mat.hpp"
 #include "include/js_alloc.hpp"
 #include "include/js_array.hpp"
+#include "include/js_typed_array.hpp"
 #include "include/jsbindings.hpp"
 #include "include/util.hpp"
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <unordered_map>
 
 extern "C" {
 thread_local JSValue filenode_proto, filenode_class, filenode_iterator_proto, filenode_iterator_class;
 thread_local JSClassID js_filenode_class_id, js_filenode_iterator_class_id;
+thread_local JSValue filenode_proxy_object_proto, filenode_proxy_array_proto;
+thread_local JSClassID js_filenode_proxy_class_id;
 }
 
 static JSValue
@@ -375,6 +384,7 @@ enum {
   METHOD_TYPE,
   METHOD_TOSTRING,
   METHOD_VALUEOF,
+  METHOD_TOJS,
 };
 
 static void
@@ -404,6 +414,401 @@ js_filenode_global(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst
   return ret;
 }
 
+struct JSFileNodeToJSOptions {
+  int32_t depth = INT32_MAX;  // collection levels converted, deeper ones stay FileNodes
+  bool mats_as_typed = false; // Mats as TypedArrays with rows/cols/channels properties
+  bool lazy = false;          // maps and non-numeric sequences as lazy proxies
+};
+
+/* State of a lazy proxy: converted children are kept, keyed by property */
+struct JSFileNodeProxyData {
+  cv::FileNode node;
+  JSFileNodeToJSOptions options;
+  int32_t level;
+  size_t size;
+  /*
+   * FileNode::operator[] is a linear scan for names and indices alike:
+   * the children are walked once, on first access, and looked up here.
+   */
+  bool indexed;
+  std::vector<cv::FileNode> children;
+  std::unordered_map<std::string, size_t> names;
+  std::map<JSAtom, JSValue> cache;
+
+  JSFileNodeProxyData(const cv::FileNode& fn, const JSFileNodeToJSOptions& opts, int32_t lvl)
+      : node(fn), options(opts), level(lvl), size(fn.size()), indexed(false) {}
+};
+
+static JSValue js_filenode_to_js(JSContext* ctx, const cv::FileNode& fn, const JSFileNodeToJSOptions& options, int32_t level);
+
+/* maps written by cv::write(FileStorage&, const Mat&) */
+static bool
+js_filenode_is_mat(const cv::FileNode& fn) {
+  return fn["dt"].isString() && fn["data"].isSeq() && ((fn["rows"].isInt() && fn["cols"].isInt()) || fn["sizes"].isSeq());
+}
+
+static JSValue
+js_filenode_mat_typed(JSContext* ctx, const cv::FileNode& fn) {
+  cv::Mat mat = fn.mat();
+  JSValue buffer, ret;
+
+  if(mat.depth() == CV_16F)
+    mat.convertTo(mat, CV_32F);
+
+  buffer = JS_NewArrayBufferCopy(ctx, mat.data, mat.total() * mat.elemSize());
+  ret = js_typedarray_new(ctx, buffer, 0, mat.total() * mat.channels(), TypedArrayType(mat));
+  JS_FreeValue(ctx, buffer);
+
+  if(!JS_IsException(ret)) {
+    JS_SetPropertyStr(ctx, ret, "rows", JS_NewInt32(ctx, mat.rows));
+    JS_SetPropertyStr(ctx, ret, "cols", JS_NewInt32(ctx, mat.cols));
+    JS_SetPropertyStr(ctx, ret, "channels", JS_NewInt32(ctx, mat.channels()));
+  }
+
+  return ret;
+}
+
+/* Int32Array or Float64Array when every element is a number, otherwise undefined */
+static JSValue
+js_filenode_numeric_seq(JSContext* ctx, const cv::FileNode& fn) {
+  size_t i = 0, n = fn.size();
+  bool ints = true;
+
+  if(n == 0)
+    return JS_UNDEFINED;
+
+  for(cv::FileNodeIterator it = fn.begin(); i < n; ++it, ++i) {
+    int type = (*it).type();
+
+    if(type == cv::FileNode::REAL)
+      ints = false;
+    else if(type != cv::FileNode::INT)
+      return JS_UNDEFINED;
+  }
+
+  i = 0;
+
+  if(ints) {
+    std::vector<int32_t> values(n);
+
+    for(cv::FileNodeIterator it = fn.begin(); i < n; ++it, ++i)
+      values[i] = int(*it);
+
+    return js_typedarray_from(ctx, values.data(), values.data() + n);
+  }
+
+  std::vector<double> values(n);
+
+  for(cv::FileNodeIterator it = fn.begin(); i < n; ++it, ++i)
+    values[i] = double(*it);
+
+  return js_typedarray_from(ctx, values.data(), values.data() + n);
+}
+
+static JSValue
+js_filenode_proxy_new(JSContext* ctx, const cv::FileNode& fn, const JSFileNodeToJSOptions& options, int32_t level) {
+  JSFileNodeProxyData* px;
+  JSValue obj;
+
+  obj = JS_NewObjectProtoClass(ctx, fn.isSeq() ? filenode_proxy_array_proto : filenode_proxy_object_proto, js_filenode_proxy_class_id);
+
+  if(JS_IsException(obj))
+    return obj;
+
+  if(!(px = js_allocate<JSFileNodeProxyData>(ctx))) {
+    JS_FreeValue(ctx, obj);
+    return JS_EXCEPTION;
+  }
+
+  new(px) JSFileNodeProxyData(fn, options, level);
+  JS_SetOpaque(obj, px);
+  return obj;
+}
+
+static JSValue
+js_filenode_to_js(JSContext* ctx, const cv::FileNode& fn, const JSFileNodeToJSOptions& options, int32_t level) {
+  JSValue ret;
+
+  switch(fn.type()) {
+    case cv::FileNode::INT: return JS_NewInt32(ctx, int(fn));
+    case cv::FileNode::REAL: return JS_NewFloat64(ctx, double(fn));
+
+    case cv::FileNode::STRING: {
+      std::string str = fn.string();
+
+      return JS_NewStringLen(ctx, str.data(), str.size());
+    }
+
+    case cv::FileNode::SEQ:
+    case cv::FileNode::MAP: break;
+    default: return JS_NULL;
+  }
+
+  /* Mats and numeric sequences are leaves: converted whatever the depth */
+  if(fn.isMap() && js_filenode_is_mat(fn))
+    return options.mats_as_typed ? js_filenode_mat_typed(ctx, fn) : js_mat_wrap(ctx, fn.mat());
+
+  if(fn.isSeq() && !JS_IsUndefined(ret = js_filenode_numeric_seq(ctx, fn)))
+    return ret;
+
+  if(level >= options.depth)
+    return js_filenode_new(ctx, fn);
+
+  if(options.lazy)
+    return js_filenode_proxy_new(ctx, fn, options, level);
+
+  ret = fn.isSeq() ? JS_NewArray(ctx) : JS_NewObject(ctx);
+
+  uint32_t i = 0, n = fn.size();
+
+  /* iterated, not indexed: operator[] on a FileNode is a linear search */
+  for(cv::FileNodeIterator it = fn.begin(); i < n; ++it, ++i) {
+    cv::FileNode child = *it;
+    JSValue value = js_filenode_to_js(ctx, child, options, level + 1);
+
+    if(JS_IsException(value)) {
+      JS_FreeValue(ctx, ret);
+      return value;
+    }
+
+    if(fn.isSeq())
+      JS_SetPropertyUint32(ctx, ret, i, value);
+    else
+      JS_SetPropertyStr(ctx, ret, child.name().c_str(), value);
+  }
+
+  return ret;
+}
+
+/* canonical array index: "0", "12", not "012" or "1e3" */
+static bool
+js_filenode_proxy_index(const char* name, size_t& index) {
+  char* end;
+
+  if(!(*name >= '0' && *name <= '9') || (name[0] == '0' && name[1]))
+    return false;
+
+  index = strtoull(name, &end, 10);
+  return *end == '\0';
+}
+
+static void
+js_filenode_proxy_build(JSFileNodeProxyData* px) {
+  size_t i = 0;
+
+  px->children.reserve(px->size);
+
+  for(cv::FileNodeIterator it = px->node.begin(); i < px->size; ++it, ++i) {
+    px->children.push_back(*it);
+
+    if(px->node.isMap())
+      px->names.emplace(px->children.back().name(), i);
+  }
+
+  px->indexed = true;
+}
+
+enum {
+  PROXY_ABSENT = 0,
+  PROXY_CHILD,
+  PROXY_LENGTH,
+};
+
+/* resolves a property to a child node without converting it */
+static int
+js_filenode_proxy_lookup(JSContext* ctx, JSFileNodeProxyData* px, JSAtom prop, cv::FileNode& child) {
+  JSValue key = JS_AtomToValue(ctx, prop);
+  const char* name;
+  size_t index;
+  int ret = PROXY_ABSENT;
+
+  /* symbols are never keys, whatever their description */
+  if(JS_IsSymbol(key)) {
+    JS_FreeValue(ctx, key);
+    return PROXY_ABSENT;
+  }
+
+  JS_FreeValue(ctx, key);
+
+  if(!(name = JS_AtomToCString(ctx, prop)))
+    return -1;
+
+  if(!px->indexed)
+    js_filenode_proxy_build(px);
+
+  if(px->node.isSeq()) {
+    if(!strcmp(name, "length")) {
+      ret = PROXY_LENGTH;
+    } else if(js_filenode_proxy_index(name, index) && index < px->size) {
+      child = px->children[index];
+      ret = PROXY_CHILD;
+    }
+  } else {
+    auto it = px->names.find(name);
+
+    if(it != px->names.end()) {
+      child = px->children[it->second];
+      ret = PROXY_CHILD;
+    }
+  }
+
+  JS_FreeCString(ctx, name);
+  return ret;
+}
+
+/* the converted child, converted on first use and cached */
+static JSValue
+js_filenode_proxy_value(JSContext* ctx, JSFileNodeProxyData* px, JSAtom prop) {
+  auto cached = px->cache.find(prop);
+  cv::FileNode child;
+  JSValue value;
+  int found;
+
+  if(cached != px->cache.end())
+    return JS_DupValue(ctx, cached->second);
+
+  if((found = js_filenode_proxy_lookup(ctx, px, prop, child)) < 0)
+    return JS_EXCEPTION;
+
+  if(found != PROXY_CHILD)
+    return JS_UNDEFINED;
+
+  try {
+    value = js_filenode_to_js(ctx, child, px->options, px->level + 1);
+  } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
+
+  if(!JS_IsException(value))
+    px->cache.emplace(JS_DupAtom(ctx, prop), JS_DupValue(ctx, value));
+
+  return value;
+}
+
+/* getter of a child not converted yet; data[0] is the property key */
+static JSValue
+js_filenode_proxy_getter(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic, JSValue* data) {
+  JSFileNodeProxyData* px;
+  JSAtom prop;
+  JSValue ret;
+
+  if(!(px = static_cast<JSFileNodeProxyData*>(JS_GetOpaque2(ctx, this_val, js_filenode_proxy_class_id))))
+    return JS_EXCEPTION;
+
+  if((prop = JS_ValueToAtom(ctx, data[0])) == JS_ATOM_NULL)
+    return JS_EXCEPTION;
+
+  ret = js_filenode_proxy_value(ctx, px, prop);
+  JS_FreeAtom(ctx, prop);
+  return ret;
+}
+
+/**
+ * Converted children are data properties. The others are reported as
+ * accessors converting on first read: QuickJS asks for a descriptor of
+ * every key when enumerating, and that must not convert the whole level.
+ */
+static int
+js_filenode_proxy_get_own_property(JSContext* ctx, JSPropertyDescriptor* desc, JSValueConst obj, JSAtom prop) {
+  JSFileNodeProxyData* px = static_cast<JSFileNodeProxyData*>(JS_GetOpaque(obj, js_filenode_proxy_class_id));
+  auto cached = px->cache.find(prop);
+  cv::FileNode child;
+  int found;
+
+  if(cached != px->cache.end()) {
+    if(desc) {
+      desc->flags = JS_PROP_ENUMERABLE;
+      desc->value = JS_DupValue(ctx, cached->second);
+      desc->getter = JS_UNDEFINED;
+      desc->setter = JS_UNDEFINED;
+    }
+
+    return 1;
+  }
+
+  if((found = js_filenode_proxy_lookup(ctx, px, prop, child)) <= 0)
+    return found;
+
+  if(!desc)
+    return 1;
+
+  desc->setter = JS_UNDEFINED;
+
+  if(found == PROXY_LENGTH) {
+    desc->flags = 0;
+    desc->value = JS_NewInt64(ctx, px->size);
+    desc->getter = JS_UNDEFINED;
+  } else {
+    JSValue key = JS_AtomToValue(ctx, prop);
+
+    desc->flags = JS_PROP_ENUMERABLE | JS_PROP_GETSET;
+    desc->value = JS_UNDEFINED;
+    desc->getter = JS_NewCFunctionData(ctx, js_filenode_proxy_getter, 0, 0, 1, &key);
+    JS_FreeValue(ctx, key);
+
+    if(JS_IsException(desc->getter))
+      return -1;
+  }
+
+  return 1;
+}
+
+static int
+js_filenode_proxy_get_own_property_names(JSContext* ctx, JSPropertyEnum** ptab, uint32_t* plen, JSValueConst obj) {
+  JSFileNodeProxyData* px = static_cast<JSFileNodeProxyData*>(JS_GetOpaque(obj, js_filenode_proxy_class_id));
+  JSPropertyEnum* tab;
+  uint32_t n = px->node.isSeq() ? px->size + 1 : px->size;
+
+  if(!px->indexed)
+    js_filenode_proxy_build(px);
+
+  if(!(tab = static_cast<JSPropertyEnum*>(js_mallocz(ctx, sizeof(JSPropertyEnum) * std::max<uint32_t>(n, 1)))))
+    return -1;
+
+  for(uint32_t i = 0; i < px->size; ++i) {
+    if(px->node.isSeq()) {
+      tab[i].atom = JS_NewAtomUInt32(ctx, i);
+    } else {
+      std::string name = px->children[i].name();
+
+      tab[i].atom = JS_NewAtomLen(ctx, name.data(), name.size());
+    }
+
+    tab[i].is_enumerable = TRUE;
+  }
+
+  if(px->node.isSeq()) {
+    tab[px->size].atom = JS_NewAtom(ctx, "length");
+    tab[px->size].is_enumerable = FALSE;
+  }
+
+  *ptab = tab;
+  *plen = n;
+  return 0;
+}
+
+static void
+js_filenode_proxy_finalizer(JSRuntime* rt, JSValue val) {
+  JSFileNodeProxyData* px;
+
+  if((px = static_cast<JSFileNodeProxyData*>(JS_GetOpaque(val, js_filenode_proxy_class_id)))) {
+    for(auto& entry : px->cache) {
+      JS_FreeAtomRT(rt, entry.first);
+      JS_FreeValueRT(rt, entry.second);
+    }
+
+    px->~JSFileNodeProxyData();
+    js_deallocate(rt, px);
+  }
+}
+
+static void
+js_filenode_proxy_mark(JSRuntime* rt, JSValueConst val, JS_MarkFunc* mark_func) {
+  JSFileNodeProxyData* px;
+
+  if((px = static_cast<JSFileNodeProxyData*>(JS_GetOpaque(val, js_filenode_proxy_class_id))))
+    for(auto& entry : px->cache)
+      JS_MarkValue(rt, entry.second, mark_func);
+}
+
 static JSValue
 js_filenode_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
   JSFileNodeData* fn;
@@ -639,6 +1044,55 @@ js_filenode_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst
 
       break;
     }
+
+    /**
+     * toJS({ depth = Infinity, matsAsTyped = false, lazy = false })
+     *
+     * Converts the subtree in one pass. Sequences of numbers become an
+     * Int32Array (all INT) or Float64Array, Mats written by cv.write()
+     * become Mats, or TypedArrays with rows/cols/channels with
+     * matsAsTyped. Both count as leaves and are converted at any level;
+     * other collections below `depth` levels stay FileNodes.
+     *
+     * With `lazy`, maps and other sequences become proxies converting a
+     * child when it is first read. Until then the child is an accessor,
+     * so `in`, Object.keys() and for-in convert nothing; reading values,
+     * as JSON.stringify() does, converts them. As with FileNodes, the
+     * FileStorage must stay open while proxies are in use.
+     */
+    case METHOD_TOJS: {
+      JSFileNodeToJSOptions options;
+
+      if(argc > 0 && JS_IsObject(argv[0])) {
+        JSValue value;
+        double depth;
+
+        value = JS_GetPropertyStr(ctx, argv[0], "depth");
+        if(!JS_IsUndefined(value)) {
+          if(JS_ToFloat64(ctx, &depth, value) || std::isnan(depth) || depth < 0) {
+            JS_FreeValue(ctx, value);
+            return JS_ThrowRangeError(ctx, "depth must be a number >= 0");
+          }
+
+          options.depth = depth >= INT32_MAX ? INT32_MAX : int32_t(depth);
+        }
+        JS_FreeValue(ctx, value);
+
+        value = JS_GetPropertyStr(ctx, argv[0], "matsAsTyped");
+        options.mats_as_typed = JS_ToBool(ctx, value);
+        JS_FreeValue(ctx, value);
+
+        value = JS_GetPropertyStr(ctx, argv[0], "lazy");
+        options.lazy = JS_ToBool(ctx, value);
+        JS_FreeValue(ctx, value);
+      }
+
+      try {
+        ret = js_filenode_to_js(ctx, *fn, options, 0);
+      } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
+
+      break;
+    }
   }
 
   return ret;
@@ -688,9 +1142,22 @@ const JSCFunctionListEntry js_filenode_proto_funcs[] = {
 
     JS_CFUNC_MAGIC_DEF("toString", 0, js_filenode_method, METHOD_TOSTRING),
     JS_CFUNC_MAGIC_DEF("valueOf", 0, js_filenode_method, METHOD_VALUEOF),
+    JS_CFUNC_MAGIC_DEF("toJS", 0, js_filenode_method, METHOD_TOJS),
 
     JS_PROP_STRING_DEF("[Symbol.toStringTag]", "FileNode", JS_PROP_CONFIGURABLE),
 };
+static JSClassExoticMethods js_filenode_proxy_exotic = {
+    .get_own_property = js_filenode_proxy_get_own_property,
+    .get_own_property_names = js_filenode_proxy_get_own_property_names,
+};
+
+JSClassDef js_filenode_proxy_class = {
+    .class_name = "FileNodeProxy",
+    .finalizer = js_filenode_proxy_finalizer,
+    .gc_mark = js_filenode_proxy_mark,
+    .exotic = &js_filenode_proxy_exotic,
+};
+
 const JSCFunctionListEntry js_filenode_static_funcs[] = {
     JS_CFUNC_MAGIC_DEF("isCollection", 1, js_filenode_funcs, FUNCTION_ISCOLLECTION),
     JS_CFUNC_MAGIC_DEF("isEmptyCollection", 1, js_filenode_funcs, FUNCTION_ISEMPTYCOLLECTION),
@@ -748,6 +1215,24 @@ js_filenode_init(JSContext* ctx, JSModuleDef* m) {
   JS_SetConstructor(ctx, filenode_iterator_class, filenode_iterator_proto);
   JS_SetPropertyFunctionList(ctx, filenode_iterator_class, js_filenode_iterator_static_funcs, countof(js_filenode_iterator_static_funcs));
 
+  /* lazy toJS() results: exotic objects with Object or Array prototypes, not exported */
+  JS_NewClassID(&js_filenode_proxy_class_id);
+  JS_NewClass(JS_GetRuntime(ctx), js_filenode_proxy_class_id, &js_filenode_proxy_class);
+
+  {
+    JSValue global = JS_GetGlobalObject(ctx), ctor;
+
+    ctor = JS_GetPropertyStr(ctx, global, "Object");
+    filenode_proxy_object_proto = JS_GetPropertyStr(ctx, ctor, "prototype");
+    JS_FreeValue(ctx, ctor);
+
+    ctor = JS_GetPropertyStr(ctx, global, "Array");
+    filenode_proxy_array_proto = JS_GetPropertyStr(ctx, ctor, "prototype");
+    JS_FreeValue(ctx, ctor);
+
+    JS_FreeValue(ctx, global);
+  }
+
   if(m) {
     JS_SetModuleExport(ctx, m, "FileNode", filenode_class);
     JS_SetModuleExport(ctx, m, "FileNodeIterator", filenode_iterator_class);
@@ -1,11 +1,14 @@
 #include "js_filestorage.hpp"
 #include "js_filenode.hpp"
+#include "js_cv.hpp"
 #include "js_mat.hpp"
+#include "js_umat.hpp"
 #include "js_rect.hpp"
 #include "js_point.hpp"
 #include "include/js_array.hpp"
 #include "include/js_alloc.hpp"
 #include "include/util.hpp"
+#include "include/mat_container.hpp"
 
 extern "C" {
 thread_local JSValue filestorage_proto, filestorage_class;
@@ -219,6 +222,138 @@ js_filestorage_global(JSContext* ctx, JSValueConst this_val, int argc, JSValueCo
   return ret;
 }
 
+enum { MAT_CONTAINER_SAVE, MAT_CONTAINER_LOAD };
+
+static bool
+js_filestorage_container_mat(JSValueConst value, cv::Mat& out) {
+  JSMatData* mat;
+  JSUMatData* umat;
+
+  if((mat = js_mat_data_nothrow(value)))
+    out = *mat;
+  else if((umat = js_umat_data(value)))
+    out = umat->getMat(cv::ACCESS_READ);
+  else
+    return false;
+
+  return true;
+}
+
+/**
+ * saveMat(filename, mat | { name: mat, ... }, { compress: false | true | level })
+ * loadMat(filename, { copy = false })
+ *
+ * loadMat() returns a Mat for a file saved from a single Mat, an object of
+ * named Mats otherwise. Uncompressed Mats alias the mapped file unless
+ * `copy` is set.
+ */
+static JSValue
+js_filestorage_mat_container(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  std::string filename;
+  JSValue ret = JS_UNDEFINED;
+  int argi = magic == MAT_CONTAINER_SAVE ? 2 : 1;
+  JSValueConst options = argc > argi ? argv[argi] : JS_UNDEFINED;
+
+  if(argc < 1 || !JS_IsString(argv[0]))
+    return JS_ThrowTypeError(ctx, "argument 1 must be a filename");
+
+  js_value_to(ctx, argv[0], filename);
+
+  try {
+    switch(magic) {
+      case MAT_CONTAINER_SAVE: {
+        std::vector<MatEntry> entries;
+        int32_t level = 0;
+
+        if(argc < 2)
+          return JS_ThrowTypeError(ctx, "argument 2 must be a Mat or an object of Mats");
+
+        if(JS_IsObject(options)) {
+          JSValue value = JS_GetPropertyStr(ctx, options, "compress");
+
+          if(JS_IsBool(value))
+            level = JS_ToBool(ctx, value) ? 3 : 0;
+          else if(!JS_IsUndefined(value))
+            JS_ToInt32(ctx, &level, value);
+
+          JS_FreeValue(ctx, value);
+        }
+
+        entries.emplace_back();
+
+        if(!js_filestorage_container_mat(argv[1], entries[0].mat)) {
+          JSPropertyEnum* props;
+          uint32_t len;
+          bool ok = true;
+
+          entries.clear();
+
+          if(!JS_IsObject(argv[1]) || JS_GetOwnPropertyNames(ctx, &props, &len, argv[1], JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY))
+            return JS_ThrowTypeError(ctx, "argument 2 must be a Mat or an object of Mats");
+
+          for(uint32_t i = 0; i < len; i++) {
+            if(ok) {
+              const char* key = JS_AtomToCString(ctx, props[i].atom);
+              JSValue value = JS_GetProperty(ctx, argv[1], props[i].atom);
+              MatEntry entry;
+
+              entry.name = key;
+
+              if((ok = js_filestorage_container_mat(value, entry.mat)))
+                entries.push_back(entry);
+              else
+                JS_ThrowTypeError(ctx, "property '%s' is not a Mat or UMat", key);
+
+              JS_FreeValue(ctx, value);
+              JS_FreeCString(ctx, key);
+            }
+
+            JS_FreeAtom(ctx, props[i].atom);
+          }
+
+          js_free(ctx, props);
+
+          if(!ok)
+            return JS_EXCEPTION;
+        }
+
+        saveMats(filename, entries, level);
+        break;
+      }
+
+      case MAT_CONTAINER_LOAD: {
+        bool copy = false;
+        std::vector<MatEntry> entries;
+
+        if(JS_IsObject(options)) {
+          JSValue value = JS_GetPropertyStr(ctx, options, "copy");
+
+          copy = JS_ToBool(ctx, value);
+          JS_FreeValue(ctx, value);
+        }
+
+        entries = loadMats(filename, !copy);
+
+        if(entries.size() == 1 && entries[0].name.empty()) {
+          ret = js_mat_wrap(ctx, entries[0].mat);
+        } else {
+          ret = JS_NewObject(ctx);
+
+          for(const MatEntry& entry : entries)
+            JS_SetPropertyStr(ctx, ret, entry.name.c_str(), js_mat_wrap(ctx, entry.mat));
+        }
+
+        break;
+      }
+    }
+  } catch(const cv::Exception& e) {
+    JS_FreeValue(ctx, ret);
+    return js_cv_throw(ctx, e);
+  }
+
+  return ret;
+}
+
 enum {
   METHOD_OPEN,
   METHOD_RELEASE,
@@ -478,6 +613,8 @@ const JSCFunctionListEntry js_filestorage_static_funcs[] = {
 const JSCFunctionListEntry js_filestorage_global_funcs[] = {
     JS_CFUNC_MAGIC_DEF("write", 3, js_filestorage_global, GLOBAL_WRITE),
     JS_CFUNC_MAGIC_DEF("writeScalar", 2, js_filestorage_global, GLOBAL_WRITESCALAR),
+    JS_CFUNC_MAGIC_DEF("saveMat", 2, js_filestorage_mat_container, MAT_CONTAINER_SAVE),
+    JS_CFUNC_MAGIC_DEF("loadMat", 1, js_filestorage_mat_container, MAT_CONTAINER_LOAD),
 };
 
 extern "C" int
@@ -0,0 +1,284 @@
+#include "js_alloc.hpp"
+#include "js_cv.hpp"
+#include "js_mat.hpp"
+#include "js_umat.hpp"
+#include "include/jsbindings.hpp"
+#include "include/homography_tracker.hpp"
+#include <opencv2/core.hpp>
+#include <quickjs.h>
+#include <new>
+
+enum {
+  HOMOGRAPHY_TRACKER_SET_REFERENCE = 0,
+  HOMOGRAPHY_TRACKER_UPDATE,
+  HOMOGRAPHY_TRACKER_RESET,
+};
+
+enum {
+  HOMOGRAPHY_TRACKER_REFERENCE_SIZE = 0,
+  HOMOGRAPHY_TRACKER_TRACKED_COUNT,
+};
+
+extern "C" {
+thread_local JSValue homography_tracker_proto = JS_UNDEFINED, homography_tracker_class = JS_UNDEFINED;
+thread_local JSClassID js_homography_tracker_class_id = 0;
+}
+
+static HomographyTracker*
+js_homography_tracker_data2(JSContext* ctx, JSValueConst val) {
+  return static_cast<HomographyTracker*>(JS_GetOpaque2(ctx, val, js_homography_tracker_class_id));
+}
+
+/* a Mat or UMat; UMats are mapped for reading on this thread */
+static bool
+js_homography_tracker_image(JSValueConst value, cv::Mat& out) {
+  cv::Mat* mat;
+  JSUMatData* umat;
+
+  if((mat = js_mat_data_nothrow(value)))
+    out = *mat;
+  else if((umat = js_umat_data(value)))
+    out = umat->getMat(cv::ACCESS_READ);
+  else
+    return false;
+
+  return true;
+}
+
+static void
+js_homography_tracker_option(JSContext* ctx, JSValueConst options, const char* name, int32_t& out) {
+  JSValue value = JS_GetPropertyStr(ctx, options, name);
+
+  if(!JS_IsUndefined(value))
+    JS_ToInt32(ctx, &out, value);
+
+  JS_FreeValue(ctx, value);
+}
+
+static void
+js_homography_tracker_option(JSContext* ctx, JSValueConst options, const char* name, double& out) {
+  JSValue value = JS_GetPropertyStr(ctx, options, name);
+
+  if(!JS_IsUndefined(value))
+    JS_ToFloat64(ctx, &out, value);
+
+  JS_FreeValue(ctx, value);
+}
+
+/**
+ * new HomographyTracker(reference?, { features = 1000, minTracked = 40,
+ * minInlierRatio = 0.5, redetectInterval = 0, ratio = 0.8,
+ * ransacThreshold = 3, winSize = 21, maxLevel = 3 })
+ */
+static JSValue
+js_homography_tracker_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  JSValue obj = JS_UNDEFINED, proto;
+  HomographyTracker* ht;
+  HomographyTracker::Params params;
+  JSValueConst options = argc > 1 ? argv[1] : JS_UNDEFINED;
+  cv::Mat reference;
+
+  if(JS_IsObject(options)) {
+    double ratio = params.ratio;
+
+    js_homography_tracker_option(ctx, options, "features", params.features);
+    js_homography_tracker_option(ctx, options, "minTracked", params.minTracked);
+    js_homography_tracker_option(ctx, options, "minInlierRatio", params.minInlierRatio);
+    js_homography_tracker_option(ctx, options, "redetectInterval", params.redetectInterval);
+    js_homography_tracker_option(ctx, options, "ratio", ratio);
+    js_homography_tracker_option(ctx, options, "ransacThreshold", params.ransacThreshold);
+    js_homography_tracker_option(ctx, options, "winSize", params.winSize);
+    js_homography_tracker_option(ctx, options, "maxLevel", params.maxLevel);
+    params.ratio = float(ratio);
+  }
+
+  if(params.features < 4 || params.winSize < 3 || params.maxLevel < 0 || params.ransacThreshold <= 0)
+    return JS_ThrowRangeError(ctx, "features must be at least 4, winSize at least 3, maxLevel >= 0 and ransacThreshold > 0");
+
+  if(argc > 0 && !JS_IsUndefined(argv[0]) && !js_homography_tracker_image(argv[0], reference))
+    return JS_ThrowTypeError(ctx, "argument 1 must be a Mat or UMat");
+
+  if(!(ht = js_allocate<HomographyTracker>(ctx)))
+    return JS_EXCEPTION;
+
+  try {
+    new(ht) HomographyTracker(params);
+  } catch(const cv::Exception& e) {
+    js_deallocate(ctx, ht);
+    return js_cv_throw(ctx, e);
+  }
+
+  if(!reference.empty()) {
+    try {
+      ht->setReference(reference);
+    } catch(const cv::Exception& e) {
+      js_cv_throw(ctx, e);
+      goto fail;
+    }
+  }
+
+  /* using new_target to get the prototype is necessary when the class is extended. */
+  proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    goto fail;
+
+  obj = JS_NewObjectProtoClass(ctx, proto, js_homography_tracker_class_id);
+  JS_FreeValue(ctx, proto);
+  if(JS_IsException(obj))
+    goto fail;
+
+  JS_SetOpaque(obj, ht);
+  return obj;
+
+fail:
+  ht->~HomographyTracker();
+  js_deallocate(ctx, ht);
+  JS_FreeValue(ctx, obj);
+  return JS_EXCEPTION;
+}
+
+/**
+ * setReference(image, mask?)   -> number of reference keypoints
+ * update(frame)                -> { H, found, redetected, tracked, inliers }
+ * reset()                      next update() redetects
+ *
+ * H is the 3x3 CV_64F reference -> frame homography, null when none was
+ * found. `tracked` counts the point pairs RANSAC ran on: points followed
+ * by optical flow, or descriptor matches when `redetected`.
+ */
+static JSValue
+js_homography_tracker_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  HomographyTracker* ht;
+  cv::Mat image, mask;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(ht = js_homography_tracker_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  if(magic != HOMOGRAPHY_TRACKER_RESET && (argc < 1 || !js_homography_tracker_image(argv[0], image)))
+    return JS_ThrowTypeError(ctx, "argument 1 must be a Mat or UMat");
+
+  try {
+    switch(magic) {
+      case HOMOGRAPHY_TRACKER_SET_REFERENCE: {
+        if(argc > 1 && !JS_IsUndefined(argv[1]) && !JS_IsNull(argv[1]) && !js_homography_tracker_image(argv[1], mask))
+          return JS_ThrowTypeError(ctx, "argument 2 must be a Mat or UMat");
+
+        ret = JS_NewInt32(ctx, ht->setReference(image, mask));
+        break;
+      }
+
+      case HOMOGRAPHY_TRACKER_UPDATE: {
+        HomographyTracker::Result result = ht->update(image);
+
+        ret = JS_NewObject(ctx);
+        JS_SetPropertyStr(ctx, ret, "H", result.found ? js_mat_wrap(ctx, cv::Mat(result.H, true)) : JS_NULL);
+        JS_SetPropertyStr(ctx, ret, "found", JS_NewBool(ctx, result.found));
+        JS_SetPropertyStr(ctx, ret, "redetected", JS_NewBool(ctx, result.redetected));
+        JS_SetPropertyStr(ctx, ret, "tracked", JS_NewInt32(ctx, result.tracked));
+        JS_SetPropertyStr(ctx, ret, "inliers", JS_NewInt32(ctx, result.inliers));
+        break;
+      }
+
+      case HOMOGRAPHY_TRACKER_RESET: {
+        ht->reset();
+        break;
+      }
+    }
+  } catch(const cv::Exception& e) {
+    JS_FreeValue(ctx, ret);
+    return js_cv_throw(ctx, e);
+  }
+
+  return ret;
+}
+
+static JSValue
+js_homography_tracker_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  HomographyTracker* ht;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(ht = js_homography_tracker_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case HOMOGRAPHY_TRACKER_REFERENCE_SIZE: {
+      ret = JS_NewInt32(ctx, ht->referenceSize());
+      break;
+    }
+
+    case HOMOGRAPHY_TRACKER_TRACKED_COUNT: {
+      ret = JS_NewInt32(ctx, ht->trackedCount());
+      break;
+    }
+  }
+
+  return ret;
+}
+
+void
+js_homography_tracker_finalizer(JSRuntime* rt, JSValue val) {
+  HomographyTracker* ht;
+
+  if((ht = static_cast<HomographyTracker*>(JS_GetOpaque(val, js_homography_tracker_class_id)))) {
+    ht->~HomographyTracker();
+    js_deallocate(rt, ht);
+  }
+}
+
+JSClassDef js_homography_tracker_class = {
+    .class_name = "HomographyTracker",
+    .finalizer = js_homography_tracker_finalizer,
+};
+
+const JSCFunctionListEntry js_homography_tracker_proto_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("setReference", 1, js_homography_tracker_method, HOMOGRAPHY_TRACKER_SET_REFERENCE),
+    JS_CFUNC_MAGIC_DEF("update", 1, js_homography_tracker_method, HOMOGRAPHY_TRACKER_UPDATE),
+    JS_CFUNC_MAGIC_DEF("reset", 0, js_homography_tracker_method, HOMOGRAPHY_TRACKER_RESET),
+    JS_CGETSET_MAGIC_DEF("referenceSize", js_homography_tracker_get, 0, HOMOGRAPHY_TRACKER_REFERENCE_SIZE),
+    JS_CGETSET_MAGIC_DEF("trackedCount", js_homography_tracker_get, 0, HOMOGRAPHY_TRACKER_TRACKED_COUNT),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "HomographyTracker", JS_PROP_CONFIGURABLE),
+};
+
+extern "C" int
+js_homography_tracker_init(JSContext* ctx, JSModuleDef* m) {
+
+  if(js_homography_tracker_class_id == 0) {
+    /* create the HomographyTracker class */
+    JS_NewClassID(&js_homography_tracker_class_id);
+    JS_NewClass(JS_GetRuntime(ctx), js_homography_tracker_class_id, &js_homography_tracker_class);
+
+    homography_tracker_proto = JS_NewObject(ctx);
+    JS_SetPropertyFunctionList(ctx, homography_tracker_proto, js_homography_tracker_proto_funcs, countof(js_homography_tracker_proto_funcs));
+    JS_SetClassProto(ctx, js_homography_tracker_class_id, homography_tracker_proto);
+
+    homography_tracker_class = JS_NewCFunction2(ctx, js_homography_tracker_constructor, "HomographyTracker", 2, JS_CFUNC_constructor, 0);
+    /* set proto.constructor and ctor.prototype */
+    JS_SetConstructor(ctx, homography_tracker_class, homography_tracker_proto);
+  }
+
+  if(m)
+    JS_SetModuleExport(ctx, m, "HomographyTracker", homography_tracker_class);
+
+  return 0;
+}
+
+extern "C" void
+js_homography_tracker_export(JSContext* ctx, JSModuleDef* m) {
+  JS_AddModuleExport(ctx, m, "HomographyTracker");
+}
+
+#if defined(JS_HOMOGRAPHY_TRACKER_MODULE)
+#define JS_INIT_MODULE VISIBLE js_init_module
+#else
+#define JS_INIT_MODULE js_init_module_homography_tracker
+#endif
+
+extern "C" JSModuleDef*
+JS_INIT_MODULE(JSContext* ctx, const char* module_name) {
+  JSModuleDef* m;
+  if(!(m = JS_NewCModule(ctx, module_name, &js_homography_tracker_init)))
+    return NULL;
+  js_homography_tracker_export(ctx, m);
+  return m;
+}
@@ -18,9 +18,11 @@
 #include "include/util.hpp"
 #include <cassert>
 #include <stddef.h>
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
 #include <opencv2/imgproc.hpp>
@@ -942,7 +944,11 @@ js_cv_lsd(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[])
 
   // lines = js_cv_inputoutputarray(ctx, argv[1]);
 
-  cv::Ptr<cv::LSD> ls = cv::createLSDPtr(::LSD_REFINE_ADV);
+  /* one detector per thread, so its scratch buffers carry over from frame to frame */
+  static thread_local cv::Ptr<cv::LSD> ls;
+
+  if(!ls)
+    ls = cv::createLSDPtr(::LSD_REFINE_ADV);
 
   ls->detect(src, lines, width, prec, nfa);
 
@@ -1085,6 +1091,213 @@ js_cv_point_polygon_test(JSContext* ctx, JSValueConst this_val, int argc, JSValu
   } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
 }
 
+enum {
+  STATS_AREA = 0,
+  STATS_PERIMETER,
+  STATS_BOUNDING_RECT,
+  STATS_MIN_AREA_RECT,
+  STATS_MIN_ENCLOSING_CIRCLE,
+  STATS_FIT_ELLIPSE,
+  STATS_CONVEX_HULL_AREA,
+  STATS_MOMENTS,
+  STATS_HU_MOMENTS,
+  STATS_CENTROID,
+  STATS_COUNT,
+};
+
+/* Column name and values per row for every cv.contourStats() field */
+static const struct {
+  const char* name;
+  int width;
+} js_contour_stats_fields[STATS_COUNT] = {
+    {"area", 1},
+    {"perimeter", 1},
+    {"boundingRect", 4},
+    {"minAreaRect", 5},
+    {"minEnclosingCircle", 3},
+    {"fitEllipse", 5},
+    {"convexHullArea", 1},
+    {"moments", 24},
+    {"huMoments", 7},
+    {"centroid", 2},
+};
+
+static void
+js_contour_stats_row(const cv::Mat& contour, const bool want[STATS_COUNT], std::vector<double> columns[STATS_COUNT], size_t i) {
+  static thread_local cv::Mat hull;
+  double nan = std::numeric_limits<double>::quiet_NaN();
+  auto row = [&](int field) { return columns[field].data() + i * js_contour_stats_fields[field].width; };
+  cv::Moments m;
+
+  /* an empty contour keeps its zero row, except for the fits that need points */
+  if(contour.empty()) {
+    if(want[STATS_FIT_ELLIPSE])
+      std::fill_n(row(STATS_FIT_ELLIPSE), 5, nan);
+    if(want[STATS_CENTROID])
+      std::fill_n(row(STATS_CENTROID), 2, nan);
+    return;
+  }
+
+  if(want[STATS_MOMENTS] || want[STATS_HU_MOMENTS] || want[STATS_CENTROID])
+    m = cv::moments(contour);
+
+  if(want[STATS_AREA])
+    *row(STATS_AREA) = cv::contourArea(contour);
+
+  if(want[STATS_PERIMETER])
+    *row(STATS_PERIMETER) = cv::arcLength(contour, true);
+
+  if(want[STATS_BOUNDING_RECT]) {
+    cv::Rect r = cv::boundingRect(contour);
+    double* p = row(STATS_BOUNDING_RECT);
+
+    p[0] = r.x, p[1] = r.y, p[2] = r.width, p[3] = r.height;
+  }
+
+  if(want[STATS_MIN_AREA_RECT]) {
+    cv::RotatedRect rr = cv::minAreaRect(contour);
+    double* p = row(STATS_MIN_AREA_RECT);
+
+    p[0] = rr.center.x, p[1] = rr.center.y, p[2] = rr.size.width, p[3] = rr.size.height, p[4] = rr.angle;
+  }
+
+  if(want[STATS_MIN_ENCLOSING_CIRCLE]) {
+    cv::Point2f center;
+    float radius;
+    double* p = row(STATS_MIN_ENCLOSING_CIRCLE);
+
+    cv::minEnclosingCircle(contour, center, radius);
+    p[0] = center.x, p[1] = center.y, p[2] = radius;
+  }
+
+  if(want[STATS_FIT_ELLIPSE]) {
+    double* p = row(STATS_FIT_ELLIPSE);
+
+    /* cv::fitEllipse() needs at least 5 points */
+    if(contour.checkVector(2) >= 5) {
+      cv::RotatedRect rr = cv::fitEllipse(contour);
+
+      p[0] = rr.center.x, p[1] = rr.center.y, p[2] = rr.size.width, p[3] = rr.size.height, p[4] = rr.angle;
+    } else {
+      std::fill_n(p, 5, nan);
+    }
+  }
+
+  if(want[STATS_CONVEX_HULL_AREA]) {
+    cv::convexHull(contour, hull);
+    *row(STATS_CONVEX_HULL_AREA) = hull.empty() ? 0 : cv::contourArea(hull);
+  }
+
+  if(want[STATS_MOMENTS]) {
+    const double values[24] = {
+        m.m00,  m.m10,  m.m01,  m.m20,  m.m11,  m.m02,  m.m30,  m.m21,  m.m12,  m.m03,  m.mu20, m.mu11,
+        m.mu02, m.mu30, m.mu21, m.mu12, m.mu03, m.nu20, m.nu11, m.nu02, m.nu30, m.nu21, m.nu12, m.nu03,
+    };
+
+    std::copy(values, values + 24, row(STATS_MOMENTS));
+  }
+
+  if(want[STATS_HU_MOMENTS])
+    cv::HuMoments(m, row(STATS_HU_MOMENTS));
+
+  if(want[STATS_CENTROID]) {
+    double* p = row(STATS_CENTROID);
+
+    p[0] = m.m00 != 0 ? m.m10 / m.m00 : nan;
+    p[1] = m.m00 != 0 ? m.m01 / m.m00 : nan;
+  }
+}
+
+/**
+ * cv.contourStats(contours, fields = ['area', 'perimeter', 'boundingRect'])
+ *
+ * Computes the requested shape measures for a whole contour set, one
+ * contour per task on OpenCV's thread pool, and returns them as a table:
+ * { count, <field>: Float64Array } with `width` values per contour row:
+ *
+ *   area (1), perimeter (1, closed), boundingRect (4: x, y, width, height),
+ *   minAreaRect (5: cx, cy, width, height, angle), minEnclosingCircle (3: cx,
+ *   cy, radius), fitEllipse (5, NaN below 5 points), convexHullArea (1),
+ *   moments (24, in cv::Moments order m00..m03, mu20..mu03, nu20..nu03),
+ *   huMoments (7), centroid (2, NaN for zero area)
+ *
+ * `contours` is an array (of Mat, PointVector, Point2fVector, PointArray,
+ * Contour or point arrays), a MatVector, PointVectorVector,
+ * Point2fVectorVector, or a packed { points, offsets } as returned by
+ * cv.psimpl.*Batch().
+ */
+static JSValue
+js_cv_contour_stats(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  static thread_local std::vector<cv::Mat> contour_buf;
+  static thread_local std::vector<double> column_buf[STATS_COUNT];
+  /* the pool threads have thread_locals of their own - hand them these */
+  std::vector<cv::Mat>& contours = contour_buf;
+  std::vector<double>* columns = column_buf;
+  bool want[STATS_COUNT] = {false};
+  JSValue points = JS_UNDEFINED, ret = JS_EXCEPTION;
+
+  if(argc < 1)
+    return JS_ThrowTypeError(ctx, "Expected at least 1 argument");
+
+  if(argc < 2 || JS_IsUndefined(argv[1])) {
+    want[STATS_AREA] = want[STATS_PERIMETER] = want[STATS_BOUNDING_RECT] = true;
+  } else {
+    std::vector<std::string> names;
+
+    if(JS_IsString(argv[1])) {
+      const char* name = JS_ToCString(ctx, argv[1]);
+
+      names.push_back(name);
+      JS_FreeCString(ctx, name);
+    } else if(js_array_to(ctx, argv[1], names) < 0) {
+      return JS_ThrowTypeError(ctx, "argument 2 must be a field name or an array of field names");
+    }
+
+    for(const std::string& name : names) {
+      int field = 0;
+
+      while(field < STATS_COUNT && name != js_contour_stats_fields[field].name)
+        ++field;
+
+      if(field == STATS_COUNT)
+        return JS_ThrowRangeError(ctx, "cv.contourStats: unknown field '%s'", name.c_str());
+
+      want[field] = true;
+    }
+  }
+
+  contours.clear();
+
+  try {
+    if(!js_contours_read(ctx, argv[0], contours, points))
+      goto fail;
+
+    for(int field = 0; field < STATS_COUNT; ++field)
+      if(want[field])
+        columns[field].assign(contours.size() * js_contour_stats_fields[field].width, 0);
+
+    cv::parallel_for_(cv::Range(0, int(contours.size())), [&](const cv::Range& range) {
+      for(int i = range.start; i < range.end; ++i)
+        js_contour_stats_row(contours[i], want, columns, i);
+    });
+  } catch(const cv::Exception& e) {
+    ret = js_cv_throw(ctx, e);
+    goto fail;
+  }
+
+  ret = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, ret, "count", JS_NewUint32(ctx, contours.size()));
+
+  for(int field = 0; field < STATS_COUNT; ++field)
+    if(want[field])
+      JS_SetPropertyStr(ctx, ret, js_contour_stats_fields[field].name, js_typedarray_from(ctx, columns[field].data(), columns[field].data() + columns[field].size()));
+
+fail:
+  contours.clear();
+  JS_FreeValue(ctx, points);
+  return ret;
+}
+
 enum {
   MOTION_ACCUMULATE = 0,
   MOTION_ACCUMULATE_PRODUCT,
@@ -2535,6 +2748,7 @@ const JSCFunctionListEntry js_imgproc_static_funcs[] = {
     JS_CFUNC_MAGIC_DEF("connectedComponents", 1, js_imgproc_shape, SHAPE_CONNECTED_COMPONENTS),
     JS_CFUNC_MAGIC_DEF("connectedComponentsWithStats", 1, js_imgproc_shape, SHAPE_CONNECTED_COMPONENTS_WITH_STATS),
     JS_CFUNC_MAGIC_DEF("contourArea", 1, js_imgproc_shape, SHAPE_CONTOUR_AREA),
+    JS_CFUNC_DEF("contourStats", 1, js_cv_contour_stats),
     JS_CFUNC_MAGIC_DEF("convexHull", 1, js_imgproc_shape, SHAPE_CONVEX_HULL),
     JS_CFUNC_MAGIC_DEF("convexityDefects", 1, js_imgproc_shape, SHAPE_CONVEXITY_DEFECTS),
     JS_CFUNC_MAGIC_DEF("createGeneralizedHoughBallard", 0, js_imgproc_shape, SHAPE_CREATE_GENERALIZED_HOUGH_BALLARD),
@@ -7,6 +7,12 @@
 #include "include/jsbindings.hpp"
 #include "include/line.hpp"
 #include "include/geometry.hpp"
+#include "include/line_index.hpp"
+#include "include/line_merge.hpp"
+#include "include/js_inputoutputarray.hpp"
+#include "js_cv.hpp"
+#include "js_mat.hpp"
+#include "js_rect.hpp"
 #include <quickjs.h>
 #include <algorithm>
 #include <cctype>
@@ -719,6 +725,405 @@ const JSCFunctionListEntry js_line_static_funcs[] = {
     JS_CFUNC_DEF("sum", 1, js_line_sum),
 };
 
+extern "C" {
+thread_local JSValue line_index_proto = JS_UNDEFINED, line_index_class = JS_UNDEFINED;
+thread_local JSClassID js_line_index_class_id = 0;
+}
+
+enum {
+  LINE_INDEX_INSERT = 0,
+  LINE_INDEX_REMOVE,
+  LINE_INDEX_GET,
+  LINE_INDEX_NEAREST,
+  LINE_INDEX_RADIUS,
+  LINE_INDEX_BOX,
+  LINE_INDEX_ENDPOINTS,
+};
+
+enum {
+  LINE_INDEX_SIZE = 0,
+  LINE_INDEX_CELLSIZE,
+};
+
+static LineIndex*
+js_line_index_data2(JSContext* ctx, JSValueConst val) {
+  return static_cast<LineIndex*>(JS_GetOpaque2(ctx, val, js_line_index_class_id));
+}
+
+/* Segments from a typed array or Mat of x1,y1,x2,y2 (e.g. LSD output), or an array of Line objects */
+static bool
+js_line_index_lines(JSContext* ctx, JSValueConst value, std::vector<Line<double>>& lines) {
+  lines.clear();
+
+  if(js_is_typedarray(ctx, value) || js_mat_data_nothrow(value)) {
+    cv::Mat mat = js_cv_inputarray(ctx, value).getMat(), xyxy;
+    size_t n = mat.total() * mat.channels();
+
+    if(n % 4)
+      return false;
+
+    if(n) {
+      if(!mat.isContinuous())
+        mat = mat.clone();
+
+      mat.reshape(4, n / 4).convertTo(xyxy, CV_64F);
+    }
+
+    lines.reserve(n / 4);
+
+    for(size_t i = 0; i < n / 4; ++i) {
+      const cv::Vec4d& v = xyxy.at<cv::Vec4d>(i);
+
+      lines.emplace_back(v[0], v[1], v[2], v[3]);
+    }
+
+    return true;
+  }
+
+  if(!js_is_array(ctx, value))
+    return false;
+
+  int64_t n = js_array_length(ctx, value);
+
+  lines.reserve(n);
+
+  for(int64_t i = 0; i < n; ++i) {
+    JSValue item = JS_GetPropertyUint32(ctx, value, i);
+    JSLineData<double> line;
+    bool ok = js_line_read(ctx, item, &line);
+
+    JS_FreeValue(ctx, item);
+
+    if(!ok)
+      return false;
+
+    lines.emplace_back(line.x1, line.y1, line.x2, line.y2);
+  }
+
+  return true;
+}
+
+/* A query is a segment id (which is then excluded), a Line or a point */
+static bool
+js_line_index_query(JSContext* ctx, LineIndex& index, JSValueConst value, Line<double>& query, int& exclude) {
+  JSLineData<double> line;
+  JSPointData<double> point;
+
+  exclude = -1;
+
+  if(JS_IsNumber(value)) {
+    int32_t id = -1;
+
+    JS_ToInt32(ctx, &id, value);
+
+    if(!index.contains(id))
+      return false;
+
+    query = index.at(id);
+    exclude = id;
+  } else if(js_line_read(ctx, value, &line)) {
+    query = Line<double>(line.x1, line.y1, line.x2, line.y2);
+  } else if(js_point_read(ctx, value, &point)) {
+    query = Line<double>(point, point);
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+static JSValue
+js_line_index_ids(JSContext* ctx, std::vector<int>& ids) {
+  return js_typedarray_from(ctx, ids.data(), ids.data() + ids.size());
+}
+
+static JSValue
+js_line_index_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  JSValue obj = JS_UNDEFINED, proto;
+  LineIndex* index;
+  std::vector<Line<double>> lines;
+  double cellSize = 0;
+  int argi = 0;
+
+  if(argc > argi && !JS_IsNumber(argv[argi]) && !JS_IsUndefined(argv[argi]))
+    if(!js_line_index_lines(ctx, argv[argi++], lines))
+      return JS_ThrowTypeError(ctx, "argument 1 must be a TypedArray, Mat or array of lines");
+
+  if(argc > argi && !JS_IsUndefined(argv[argi]))
+    if(JS_ToFloat64(ctx, &cellSize, argv[argi]) || cellSize < 0)
+      return JS_ThrowRangeError(ctx, "cellSize must be a positive number");
+
+  if(!(index = js_allocate<LineIndex>(ctx)))
+    return JS_EXCEPTION;
+
+  new(index) LineIndex(cellSize);
+  index->build(lines);
+
+  /* using new_target to get the prototype is necessary when the class is extended. */
+  proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+
+  if(JS_IsException(proto))
+    goto fail;
+
+  obj = JS_NewObjectProtoClass(ctx, proto, js_line_index_class_id);
+  JS_FreeValue(ctx, proto);
+
+  if(JS_IsException(obj))
+    goto fail;
+
+  JS_SetOpaque(obj, index);
+
+  return obj;
+
+fail:
+  index->~LineIndex();
+  js_deallocate(ctx, index);
+  JS_FreeValue(ctx, obj);
+  return JS_EXCEPTION;
+}
+
+static JSValue
+js_line_index_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  LineIndex* index;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(index = js_line_index_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case LINE_INDEX_INSERT: {
+      JSLineData<double> line;
+      std::vector<Line<double>> lines;
+      bool bulk = js_is_typedarray(ctx, argv[0]) || js_mat_data_nothrow(argv[0]);
+
+      /* [x1, y1, x2, y2] is one line, [line, ...] many */
+      if(!bulk && js_is_array(ctx, argv[0])) {
+        JSValue first = JS_GetPropertyUint32(ctx, argv[0], 0);
+
+        bulk = !JS_IsNumber(first);
+        JS_FreeValue(ctx, first);
+      }
+
+      if(!bulk && js_line_read(ctx, argv[0], &line))
+        return JS_NewInt32(ctx, index->insert(Line<double>(line.x1, line.y1, line.x2, line.y2)));
+
+      if(!js_line_index_lines(ctx, argv[0], lines))
+        return JS_ThrowTypeError(ctx, "argument 1 must be a Line, TypedArray, Mat or array of lines");
+
+      std::vector<int> ids;
+
+      ids.reserve(lines.size());
+
+      for(const Line<double>& l : lines)
+        ids.push_back(index->insert(l));
+
+      ret = js_line_index_ids(ctx, ids);
+      break;
+    }
+
+    case LINE_INDEX_REMOVE: {
+      int32_t id = -1;
+
+      if(JS_ToInt32(ctx, &id, argv[0]))
+        return JS_EXCEPTION;
+
+      ret = JS_NewBool(ctx, index->remove(id));
+      break;
+    }
+
+    case LINE_INDEX_GET: {
+      int32_t id = -1;
+
+      if(JS_ToInt32(ctx, &id, argv[0]))
+        return JS_EXCEPTION;
+
+      if(index->contains(id)) {
+        const Line<double>& l = index->at(id);
+
+        ret = js_line_new(ctx, l.a.x, l.a.y, l.b.x, l.b.y);
+      }
+
+      break;
+    }
+
+    case LINE_INDEX_NEAREST:
+    case LINE_INDEX_RADIUS: {
+      Line<double> query(0, 0, 0, 0);
+      int exclude;
+      double arg = magic == LINE_INDEX_NEAREST ? 1 : 0;
+
+      if(!js_line_index_query(ctx, *index, argv[0], query, exclude))
+        return JS_ThrowTypeError(ctx, "argument 1 must be a segment id, Line or Point");
+
+      if(argc > 1 && !JS_IsUndefined(argv[1]))
+        JS_ToFloat64(ctx, &arg, argv[1]);
+
+      std::vector<int> ids = magic == LINE_INDEX_NEAREST ? index->nearest(query, int(arg), exclude) : index->radius(query, arg, exclude);
+
+      ret = js_line_index_ids(ctx, ids);
+      break;
+    }
+
+    case LINE_INDEX_BOX: {
+      JSRectData<double> rect;
+
+      if(!js_rect_read(ctx, argv[0], &rect))
+        return JS_ThrowTypeError(ctx, "argument 1 must be a Rect");
+
+      std::vector<int> ids = index->box(rect);
+
+      ret = js_line_index_ids(ctx, ids);
+      break;
+    }
+
+    case LINE_INDEX_ENDPOINTS: {
+      JSPointData<double> point;
+      double radius = 0;
+      std::vector<int> ends;
+
+      if(!js_point_read(ctx, argv[0], &point))
+        return JS_ThrowTypeError(ctx, "argument 1 must be a Point");
+
+      if(argc > 1)
+        JS_ToFloat64(ctx, &radius, argv[1]);
+
+      std::vector<int> ids = index->endpoints(point, radius, &ends);
+
+      ret = JS_NewObject(ctx);
+      JS_SetPropertyStr(ctx, ret, "ids", js_line_index_ids(ctx, ids));
+      JS_SetPropertyStr(ctx, ret, "ends", js_line_index_ids(ctx, ends));
+      break;
+    }
+  }
+
+  return ret;
+}
+
+static JSValue
+js_line_index_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  LineIndex* index;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(index = js_line_index_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case LINE_INDEX_SIZE: {
+      ret = JS_NewInt64(ctx, index->size());
+      break;
+    }
+
+    case LINE_INDEX_CELLSIZE: {
+      ret = JS_NewFloat64(ctx, index->cellSize());
+      break;
+    }
+  }
+
+  return ret;
+}
+
+void
+js_line_index_finalizer(JSRuntime* rt, JSValue val) {
+  LineIndex* index;
+
+  if((index = static_cast<LineIndex*>(JS_GetOpaque(val, js_line_index_class_id)))) {
+    index->~LineIndex();
+    js_deallocate(rt, index);
+  }
+}
+
+JSClassDef js_line_index_class = {
+    .class_name = "LineIndex",
+    .finalizer = js_line_index_finalizer,
+};
+
+const JSCFunctionListEntry js_line_index_proto_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("insert", 1, js_line_index_method, LINE_INDEX_INSERT),
+    JS_CFUNC_MAGIC_DEF("remove", 1, js_line_index_method, LINE_INDEX_REMOVE),
+    JS_CFUNC_MAGIC_DEF("get", 1, js_line_index_method, LINE_INDEX_GET),
+    JS_CFUNC_MAGIC_DEF("nearest", 1, js_line_index_method, LINE_INDEX_NEAREST),
+    JS_CFUNC_MAGIC_DEF("radius", 2, js_line_index_method, LINE_INDEX_RADIUS),
+    JS_CFUNC_MAGIC_DEF("box", 1, js_line_index_method, LINE_INDEX_BOX),
+    JS_CFUNC_MAGIC_DEF("endpoints", 2, js_line_index_method, LINE_INDEX_ENDPOINTS),
+    JS_CGETSET_MAGIC_DEF("size", js_line_index_get, 0, LINE_INDEX_SIZE),
+    JS_CGETSET_MAGIC_DEF("cellSize", js_line_index_get, 0, LINE_INDEX_CELLSIZE),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "LineIndex", JS_PROP_CONFIGURABLE),
+};
+
+enum {
+  LINE_MERGE_SEGMENTS = 0,
+  LINE_JOIN_SEGMENTS,
+};
+
+static JSValue
+js_line_segments(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  std::vector<Line<double>> lines;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!js_line_index_lines(ctx, argv[0], lines))
+    return JS_ThrowTypeError(ctx, "argument 1 must be a TypedArray, Mat or array of lines");
+
+  try {
+    switch(magic) {
+      case LINE_MERGE_SEGMENTS: {
+        SegmentMergeParams params;
+
+        if(argc > 1 && JS_IsObject(argv[1])) {
+          std::pair<const char*, double*> options[] = {
+              {"angleTol", &params.angleTol},
+              {"gapTol", &params.gapTol},
+              {"offsetTol", &params.offsetTol},
+          };
+
+          for(auto& [name, ptr] : options) {
+            JSValue v = JS_GetPropertyStr(ctx, argv[1], name);
+
+            if(JS_IsNumber(v))
+              JS_ToFloat64(ctx, ptr, v);
+
+            JS_FreeValue(ctx, v);
+          }
+        }
+
+        std::vector<cv::Vec4f> merged = merge_segments(lines, params);
+
+        /* same container kind as the input */
+        if(js_mat_data_nothrow(argv[0]))
+          ret = js_mat_wrap(ctx, cv::Mat(merged, true));
+        else
+          ret = js_typedarray_from(ctx, merged.empty() ? nullptr : &merged[0][0], merged.empty() ? nullptr : &merged[0][0] + merged.size() * 4);
+
+        break;
+      }
+
+      case LINE_JOIN_SEGMENTS: {
+        double tol = 1;
+        std::vector<cv::Point2f> points;
+        std::vector<uint32_t> offsets;
+
+        if(argc > 1 && !JS_IsUndefined(argv[1]))
+          JS_ToFloat64(ctx, &tol, argv[1]);
+
+        join_segments(lines, tol, points, offsets);
+
+        float* coords = points.empty() ? nullptr : &points[0].x;
+
+        ret = JS_NewObject(ctx);
+        JS_SetPropertyStr(ctx, ret, "points", js_typedarray_from(ctx, coords, coords + points.size() * 2));
+        JS_SetPropertyStr(ctx, ret, "offsets", js_typedarray_from(ctx, offsets.data(), offsets.data() + offsets.size()));
+        break;
+      }
+    }
+  } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
+
+  return ret;
+}
+
+const JSCFunctionListEntry js_line_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("mergeSegments", 1, js_line_segments, LINE_MERGE_SEGMENTS),
+    JS_CFUNC_MAGIC_DEF("joinSegments", 1, js_line_segments, LINE_JOIN_SEGMENTS),
+};
+
 int
 js_line_init(JSContext* ctx, JSModuleDef* m) {
 
@@ -737,10 +1142,23 @@ js_line_init(JSContext* ctx, JSModuleDef* m) {
     JS_SetPropertyFunctionList(ctx, line_class, js_line_static_funcs, countof(js_line_static_funcs));
 
     // js_object_inspect(ctx, line_proto, js_line_inspect);
+
+    JS_NewClassID(&js_line_index_class_id);
+    JS_NewClass(JS_GetRuntime(ctx), js_line_index_class_id, &js_line_index_class);
+
+    line_index_proto = JS_NewObject(ctx);
+    JS_SetPropertyFunctionList(ctx, line_index_proto, js_line_index_proto_funcs, countof(js_line_index_proto_funcs));
+    JS_SetClassProto(ctx, js_line_index_class_id, line_index_proto);
+
+    line_index_class = JS_NewCFunction2(ctx, js_line_index_constructor, "LineIndex", 2, JS_CFUNC_constructor, 0);
+    JS_SetConstructor(ctx, line_index_class, line_index_proto);
   }
 
-  if(m)
+  if(m) {
     JS_SetModuleExport(ctx, m, "Line", line_class);
+    JS_SetModuleExport(ctx, m, "LineIndex", line_index_class);
+    JS_SetModuleExportList(ctx, m, js_line_funcs, countof(js_line_funcs));
+  }
 
   return 0;
 }
@@ -748,6 +1166,8 @@ js_line_init(JSContext* ctx, JSModuleDef* m) {
 extern "C" void
 js_line_export(JSContext* ctx, JSModuleDef* m) {
   JS_AddModuleExport(ctx, m, "Line");
+  JS_AddModuleExport(ctx, m, "LineIndex");
+  JS_AddModuleExportList(ctx, m, js_line_funcs, countof(js_line_funcs));
 }
 
 #ifdef JS_LINE_MODULE
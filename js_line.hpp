@@ -56,6 +56,8 @@ extern "C" {
 
 extern thread_local JSValue line_proto, line_class;
 extern thread_local JSClassID js_line_class_id;
+extern thread_local JSValue line_index_proto, line_index_class;
+extern thread_local JSClassID js_line_index_class_id;
 
 JSModuleDef* js_init_module_line(JSContext*, const char*);
 
@@ -11,6 +11,7 @@
 #include "js_umat.hpp"
 #include "include/jsbindings.hpp"
 #include "include/js_inputoutputarray.hpp"
+#include "include/mat_accounting.hpp"
 #include <quickjs.h>
 #include <opencv2/core/cvdef.h>
 #include <opencv2/core/hal/interface.h>
@@ -164,6 +165,7 @@ js_mat_track(JSContext* ctx, JSMatData* s) {
   }
 
   mat_list.push_back(s);
+  matAccountingObject(MAT_ACCOUNTING_MAT, 1);
 
   for(const auto& ptr : deallocate)
     js_deallocate(ctx, ptr);
@@ -176,6 +178,7 @@ js_mat_new(JSContext* ctx, uint32_t rows, uint32_t cols, int type) {
   JSMatData* s;
   if(JS_IsUndefined(mat_proto))
     js_mat_init(ctx, NULL);
+  js_external_memory_check(ctx);
   ret = JS_NewObjectProtoClass(ctx, mat_proto, js_mat_class_id);
   s = js_mat_track(ctx, js_allocate<cv::Mat>(ctx));
   if(cols || rows || type) {
@@ -196,6 +199,7 @@ JSValue
 js_mat_wrap(JSContext* ctx, const cv::Mat& mat) {
   JSValue ret;
   JSMatData* s;
+  js_external_memory_check(ctx);
   ret = JS_NewObjectProtoClass(ctx, mat_proto, js_mat_class_id);
 
   s = js_mat_track(ctx, js_allocate<cv::Mat>(ctx));
@@ -479,6 +483,8 @@ js_mat_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueCon
   JSValue proto, obj = JS_UNDEFINED;
   JSMatData* m;
 
+  js_external_memory_check(ctx);
+
   if(!(m = js_mat_track(ctx, js_allocate<cv::Mat>(ctx))))
     return JS_EXCEPTION;
 
@@ -500,6 +506,7 @@ js_mat_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueCon
   return obj;
 
 fail:
+  matAccountingObject(MAT_ACCOUNTING_MAT, -1);
   js_deallocate(ctx, m);
 fail2:
   JS_FreeValue(ctx, obj);
@@ -1905,6 +1912,7 @@ js_mat_finalizer(JSRuntime* rt, JSValue val) {
 
   if((s = static_cast<JSMatData*>(JS_GetOpaque(val, js_mat_class_id)))) {
     s->~JSMatData();
+    matAccountingObject(MAT_ACCOUNTING_MAT, -1);
 
     js_deallocate(rt, s);
   }
@@ -2183,6 +2191,9 @@ const JSCFunctionListEntry js_mat_static_funcs[] = {
 int
 js_mat_init(JSContext* ctx, JSModuleDef* m) {
   if(js_mat_class_id == 0) {
+    /* count pixel buffers from here on, see js_external_memory_check() */
+    matAccountingInstall();
+
     /* create the Mat class */
     JS_NewClassID(&js_mat_class_id);
     JS_NewClassID(&js_mat_iterator_class_id);
@@ -0,0 +1,605 @@
+#include "js_alloc.hpp"
+#include "js_affine3.hpp"
+#include "js_cv.hpp"
+#include "js_mat.hpp"
+#include "js_point.hpp"
+#include "js_point_array.hpp"
+#include "js_rect.hpp"
+#include "include/js_array.hpp"
+#include "include/js_inputoutputarray.hpp"
+#include "include/js_typed_array.hpp"
+#include "include/jsbindings.hpp"
+#include <opencv2/core.hpp>
+#include <quickjs.h>
+#include <algorithm>
+#include <new>
+#include <vector>
+
+enum {
+  METHOD_AT = 0,
+  METHOD_SET,
+  METHOD_PUSH,
+  METHOD_TRANSLATE,
+  METHOD_SCALE,
+  METHOD_TRANSFORM,
+  METHOD_BOUNDING_RECT,
+  METHOD_DISTANCE_TO,
+  METHOD_NEAREST,
+  METHOD_FILTER,
+  METHOD_TO_MAT,
+  METHOD_TO_ARRAY,
+  METHOD_TO_TYPED_ARRAY,
+};
+
+enum {
+  PROP_LENGTH = 0,
+  PROP_DEPTH,
+};
+
+extern "C" {
+thread_local JSValue point_array_proto = JS_UNDEFINED, point_array_class = JS_UNDEFINED;
+thread_local JSClassID js_point_array_class_id = 0;
+}
+
+JSPointArrayData*
+js_point_array_data(JSValueConst val) {
+  return static_cast<JSPointArrayData*>(JS_GetOpaque(val, js_point_array_class_id));
+}
+
+JSPointArrayData*
+js_point_array_data2(JSContext* ctx, JSValueConst val) {
+  return static_cast<JSPointArrayData*>(JS_GetOpaque2(ctx, val, js_point_array_class_id));
+}
+
+/* Bring `mat` back to N x 1 with 2 float/double channels, e.g. after an
+ * OpenCV function used the array as output and wrote 1 x N or CV_32SC2. */
+static void
+js_point_array_normalize(JSPointArrayData& pa) {
+  cv::Mat& m = pa.mat;
+
+  if(m.empty()) {
+    m.create(0, 1, CV_MAKETYPE(pa.depth, 2));
+    return;
+  }
+
+  if(!m.isContinuous())
+    m = m.clone();
+
+  size_t n = m.total() * m.channels();
+
+  CV_Assert(n % 2 == 0);
+
+  if(m.channels() != 2 || m.cols != 1 || m.dims > 2) {
+    int sizes[] = {int(n / 2), 1};
+
+    m = m.reshape(2, 2, sizes);
+  }
+
+  if(m.depth() != CV_32F && m.depth() != CV_64F)
+    m.convertTo(m, CV_32F);
+
+  pa.depth = m.depth();
+}
+
+static JSValue
+js_point_array_new(JSContext* ctx, JSValueConst proto, const cv::Mat& mat, int depth) {
+  JSPointArrayData* pa;
+  JSValue obj = JS_NewObjectProtoClass(ctx, proto, js_point_array_class_id);
+
+  if(JS_IsException(obj))
+    return obj;
+
+  if(!(pa = js_allocate<JSPointArrayData>(ctx))) {
+    JS_FreeValue(ctx, obj);
+    return JS_EXCEPTION;
+  }
+
+  new(pa) JSPointArrayData();
+  pa->mat = mat;
+  pa->depth = depth;
+  js_point_array_normalize(*pa);
+
+  JS_SetOpaque(obj, pa);
+  return obj;
+}
+
+JSValue
+js_point_array_wrap(JSContext* ctx, const cv::Mat& mat) {
+  return js_point_array_new(ctx, point_array_proto, mat, mat.depth() == CV_64F ? CV_64F : CV_32F);
+}
+
+/* Points from a PointArray, Mat, TypedArray, Point vector or array of Points */
+static bool
+js_point_array_read(JSContext* ctx, JSValueConst value, int depth, cv::Mat& out) {
+  JSPointArrayData* other;
+
+  if((other = js_point_array_data(value))) {
+    other->mat.convertTo(out, depth);
+    return true;
+  }
+
+  if(js_is_array(ctx, value)) {
+    int64_t n = js_array_length(ctx, value);
+    cv::Mat points(int(n), 1, CV_64FC2);
+
+    for(int64_t i = 0; i < n; ++i) {
+      JSValue item = JS_GetPropertyUint32(ctx, value, i);
+      JSPointData<double> pt;
+      bool ok = js_point_read(ctx, item, &pt);
+
+      JS_FreeValue(ctx, item);
+
+      if(!ok)
+        return false;
+
+      points.at<cv::Point2d>(int(i)) = pt;
+    }
+
+    points.convertTo(out, depth);
+    return true;
+  }
+
+  JSInputArray input = js_cv_inputarray(ctx, value);
+
+  if(input.empty() && input.kind() == cv::_InputArray::NONE)
+    return false;
+
+  cv::Mat mat = input.getMat();
+
+  if(!mat.isContinuous())
+    mat = mat.clone();
+
+  if((mat.total() * mat.channels()) % 2)
+    return false;
+
+  mat.reshape(1, 1).reshape(2, int(mat.total() * mat.channels() / 2)).convertTo(out, depth);
+  return true;
+}
+
+static JSValue
+js_point_array_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  JSValue proto, ret;
+  int32_t depth = -1;
+  cv::Mat mat;
+
+  if(argc > 1 && !JS_IsUndefined(argv[1]))
+    if(JS_ToInt32(ctx, &depth, argv[1]) || (depth != CV_32F && depth != CV_64F))
+      return JS_ThrowRangeError(ctx, "depth must be CV_32F or CV_64F");
+
+  try {
+    if(argc > 0 && JS_IsNumber(argv[0])) {
+      uint32_t n = 0;
+
+      JS_ToUint32(ctx, &n, argv[0]);
+      mat = cv::Mat::zeros(n, 1, CV_MAKETYPE(depth == -1 ? CV_32F : depth, 2));
+    } else if(argc > 0 && !JS_IsUndefined(argv[0])) {
+      cv::Mat* src = js_mat_data_nothrow(argv[0]);
+
+      if(depth == -1) {
+        bool f64 = src ? src->depth() == CV_64F : js_is_typedarray(ctx, argv[0]) && js_typedarray_type(ctx, argv[0]).byte_size == 8;
+
+        depth = f64 ? CV_64F : CV_32F;
+      }
+
+      /* a matching continuous Mat is shared, not copied */
+      if(src && src->channels() == 2 && src->depth() == depth && src->isContinuous())
+        mat = src->reshape(2, int(src->total()));
+      else if(!js_point_array_read(ctx, argv[0], depth, mat))
+        return JS_ThrowTypeError(ctx, "argument 1 must be a length, PointArray, Mat, TypedArray or array of points");
+    }
+  } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
+
+  /* using new_target to get the prototype is necessary when the class is extended. */
+  proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+
+  if(JS_IsException(proto))
+    return JS_EXCEPTION;
+
+  ret = js_point_array_new(ctx, proto, mat, depth == -1 ? CV_32F : depth);
+  JS_FreeValue(ctx, proto);
+  return ret;
+}
+
+template<class T>
+static void
+js_point_array_compact(const cv::Mat& src, const std::vector<uchar>& keep, cv::Mat& dst) {
+  const cv::Point_<T>* in = src.ptr<cv::Point_<T>>();
+  size_t n = std::count_if(keep.begin(), keep.end(), [](uchar k) { return k != 0; });
+
+  dst.create(int(n), 1, src.type());
+
+  cv::Point_<T>* out = dst.ptr<cv::Point_<T>>();
+
+  for(size_t i = 0; i < keep.size(); ++i)
+    if(keep[i])
+      *out++ = in[i];
+}
+
+static bool
+js_point_array_matrix(JSContext* ctx, JSValueConst value, cv::Mat& m) {
+  cv::Affine3<double>* affine;
+
+  /* a 3D affine acts on the z = 0 plane */
+  if((affine = js_affine3_data(value))) {
+    const cv::Matx44d& a = affine->matrix;
+
+    m = (cv::Mat_<double>(2, 3) << a(0, 0), a(0, 1), a(0, 3), a(1, 0), a(1, 1), a(1, 3));
+    return true;
+  }
+
+  m = js_cv_inputarray(ctx, value).getMat();
+
+  switch(m.total() * m.channels()) {
+    case 4:
+    case 6: m = m.reshape(1, 1).reshape(1, 2); break;
+    case 9: m = m.reshape(1, 1).reshape(1, 3); break;
+    default: return false;
+  }
+
+  m.convertTo(m, CV_64F);
+  return true;
+}
+
+static JSValue
+js_point_array_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  JSPointArrayData* pa;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(pa = js_point_array_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  try {
+    js_point_array_normalize(*pa);
+
+    cv::Mat& mat = pa->mat;
+    int n = mat.rows;
+
+    switch(magic) {
+      case METHOD_AT:
+      case METHOD_SET: {
+        int32_t i = -1;
+        JSPointData<double> pt;
+
+        JS_ToInt32(ctx, &i, argv[0]);
+
+        if(i < 0 || i >= n)
+          return JS_ThrowRangeError(ctx, "index %d out of range [0, %d)", i, n);
+
+        if(magic == METHOD_AT) {
+          pt = pa->depth == CV_64F ? mat.at<cv::Point2d>(i) : cv::Point2d(mat.at<cv::Point2f>(i));
+          ret = js_point_new(ctx, pt.x, pt.y);
+          break;
+        }
+
+        if(!js_point_read(ctx, argv[1], &pt))
+          return JS_ThrowTypeError(ctx, "argument 2 must be a Point");
+
+        if(pa->depth == CV_64F)
+          mat.at<cv::Point2d>(i) = pt;
+        else
+          mat.at<cv::Point2f>(i) = pt;
+
+        ret = JS_DupValue(ctx, this_val);
+        break;
+      }
+
+      case METHOD_PUSH: {
+        /* grow geometrically like Mat::push_back() */
+        if(size_t(n + argc) > size_t(mat.datalimit - mat.datastart) / mat.elemSize())
+          mat.reserve(std::max(n + argc, (n * 3 + 1) / 2));
+
+        mat.resize(n + argc);
+
+        for(int i = 0; i < argc; ++i) {
+          JSPointData<double> pt;
+
+          if(!js_point_read(ctx, argv[i], &pt)) {
+            mat.resize(n);
+            return JS_ThrowTypeError(ctx, "argument %d must be a Point", i + 1);
+          }
+
+          if(pa->depth == CV_64F)
+            mat.at<cv::Point2d>(n + i) = pt;
+          else
+            mat.at<cv::Point2f>(n + i) = pt;
+        }
+
+        ret = JS_NewUint32(ctx, mat.rows);
+        break;
+      }
+
+      case METHOD_TRANSLATE: {
+        JSPointData<double> d;
+
+        if(JS_IsNumber(argv[0])) {
+          JS_ToFloat64(ctx, &d.x, argv[0]);
+          d.y = d.x;
+
+          if(argc > 1)
+            JS_ToFloat64(ctx, &d.y, argv[1]);
+        } else if(!js_point_read(ctx, argv[0], &d)) {
+          return JS_ThrowTypeError(ctx, "argument 1 must be a Point or number");
+        }
+
+        cv::add(mat, cv::Scalar(d.x, d.y), mat);
+        ret = JS_DupValue(ctx, this_val);
+        break;
+      }
+
+      case METHOD_SCALE: {
+        JSPointData<double> s, origin;
+        int argi = 1;
+
+        if(JS_IsNumber(argv[0])) {
+          JS_ToFloat64(ctx, &s.x, argv[0]);
+          s.y = s.x;
+
+          if(argc > 1 && JS_IsNumber(argv[1]))
+            JS_ToFloat64(ctx, &s.y, argv[argi++]);
+        } else if(!js_point_read(ctx, argv[0], &s)) {
+          return JS_ThrowTypeError(ctx, "argument 1 must be a Point or number");
+        }
+
+        cv::multiply(mat, cv::Scalar(s.x, s.y), mat);
+
+        /* (p - origin) * s + origin */
+        if(argc > argi && js_point_read(ctx, argv[argi], &origin))
+          cv::add(mat, cv::Scalar(origin.x * (1 - s.x), origin.y * (1 - s.y)), mat);
+
+        ret = JS_DupValue(ctx, this_val);
+        break;
+      }
+
+      case METHOD_TRANSFORM: {
+        cv::Mat m;
+
+        if(!js_point_array_matrix(ctx, argv[0], m))
+          return JS_ThrowTypeError(ctx, "argument 1 must be an Affine3 or a 2x2, 2x3 or 3x3 matrix");
+
+        if(n > 0) {
+          if(m.rows == 3)
+            cv::perspectiveTransform(mat, mat, m);
+          else
+            cv::transform(mat, mat, m);
+        }
+
+        ret = JS_DupValue(ctx, this_val);
+        break;
+      }
+
+      case METHOD_BOUNDING_RECT: {
+        cv::Mat lo, hi;
+
+        if(n == 0) {
+          ret = js_rect_new(ctx, 0.0, 0.0, 0.0, 0.0);
+          break;
+        }
+
+        cv::reduce(mat.reshape(1, n), lo, 0, cv::REDUCE_MIN, CV_64F);
+        cv::reduce(mat.reshape(1, n), hi, 0, cv::REDUCE_MAX, CV_64F);
+
+        ret = js_rect_new(ctx, lo.at<double>(0), lo.at<double>(1), hi.at<double>(0) - lo.at<double>(0), hi.at<double>(1) - lo.at<double>(1));
+        break;
+      }
+
+      case METHOD_DISTANCE_TO:
+      case METHOD_NEAREST: {
+        JSPointArrayData* other = js_point_array_data(argv[0]);
+        JSPointData<double> pt;
+        cv::Mat diff, dist;
+
+        if(other && magic == METHOD_DISTANCE_TO) {
+          /* pairwise against another PointArray of the same length */
+          js_point_array_normalize(*other);
+
+          if(other->mat.rows != n)
+            return JS_ThrowRangeError(ctx, "PointArray lengths differ (%d vs %d)", n, other->mat.rows);
+
+          other->mat.convertTo(diff, mat.depth());
+          cv::subtract(mat, diff, diff);
+        } else if(js_point_read(ctx, argv[0], &pt)) {
+          cv::subtract(mat, cv::Scalar(pt.x, pt.y), diff);
+        } else {
+          return JS_ThrowTypeError(ctx, "argument 1 must be a Point");
+        }
+
+        if(n > 0) {
+          diff = diff.reshape(1, n);
+          cv::magnitude(diff.col(0), diff.col(1), dist);
+        }
+
+        if(magic == METHOD_NEAREST) {
+          int idx[2] = {-1, -1};
+
+          if(n > 0)
+            cv::minMaxIdx(dist, nullptr, nullptr, idx);
+
+          ret = JS_NewInt32(ctx, idx[0]);
+        } else if(pa->depth == CV_64F) {
+          double* p = n > 0 ? dist.ptr<double>() : nullptr;
+
+          ret = js_typedarray_from(ctx, p, p + n);
+        } else {
+          float* p = n > 0 ? dist.ptr<float>() : nullptr;
+
+          ret = js_typedarray_from(ctx, p, p + n);
+        }
+
+        break;
+      }
+
+      case METHOD_FILTER: {
+        std::vector<uchar> keep(n);
+        cv::Mat result;
+
+        if(js_is_function(ctx, argv[0])) {
+          for(int i = 0; i < n; ++i) {
+            cv::Point2d pt = pa->depth == CV_64F ? mat.at<cv::Point2d>(i) : cv::Point2d(mat.at<cv::Point2f>(i));
+            JSValue args[] = {JS_NewFloat64(ctx, pt.x), JS_NewFloat64(ctx, pt.y), JS_NewInt32(ctx, i)};
+            JSValue r = JS_Call(ctx, argv[0], JS_UNDEFINED, countof(args), args);
+
+            if(JS_IsException(r))
+              return r;
+
+            keep[i] = JS_ToBool(ctx, r) > 0;
+            JS_FreeValue(ctx, r);
+          }
+        } else {
+          cv::Mat mask = js_cv_inputarray(ctx, argv[0]).getMat();
+
+          if(int(mask.total() * mask.channels()) != n)
+            return JS_ThrowRangeError(ctx, "mask must have one element per point (%d)", n);
+
+          if(n > 0)
+            cv::Mat(mask.reshape(1, 1) != 0).copyTo(cv::Mat(1, n, CV_8U, keep.data()));
+        }
+
+        if(pa->depth == CV_64F)
+          js_point_array_compact<double>(mat, keep, result);
+        else
+          js_point_array_compact<float>(mat, keep, result);
+
+        ret = js_point_array_wrap(ctx, result);
+        break;
+      }
+
+      case METHOD_TO_MAT: {
+        /* shares the storage until the PointArray grows */
+        ret = js_mat_wrap(ctx, mat);
+        break;
+      }
+
+      case METHOD_TO_ARRAY: {
+        ret = JS_NewArray(ctx);
+
+        for(int i = 0; i < n; ++i) {
+          cv::Point2d pt = pa->depth == CV_64F ? mat.at<cv::Point2d>(i) : cv::Point2d(mat.at<cv::Point2f>(i));
+
+          JS_SetPropertyUint32(ctx, ret, i, js_point_new(ctx, pt.x, pt.y));
+        }
+
+        break;
+      }
+
+      case METHOD_TO_TYPED_ARRAY: {
+        if(pa->depth == CV_64F) {
+          double* p = n > 0 ? mat.ptr<double>() : nullptr;
+
+          ret = js_typedarray_from(ctx, p, p + n * 2);
+        } else {
+          float* p = n > 0 ? mat.ptr<float>() : nullptr;
+
+          ret = js_typedarray_from(ctx, p, p + n * 2);
+        }
+
+        break;
+      }
+    }
+  } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
+
+  return ret;
+}
+
+static JSValue
+js_point_array_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  JSPointArrayData* pa;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(pa = js_point_array_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  try {
+    js_point_array_normalize(*pa);
+  } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
+
+  switch(magic) {
+    case PROP_LENGTH: {
+      ret = JS_NewUint32(ctx, pa->mat.rows);
+      break;
+    }
+
+    case PROP_DEPTH: {
+      ret = JS_NewInt32(ctx, pa->depth);
+      break;
+    }
+  }
+
+  return ret;
+}
+
+void
+js_point_array_finalizer(JSRuntime* rt, JSValue val) {
+  JSPointArrayData* pa;
+
+  if((pa = static_cast<JSPointArrayData*>(JS_GetOpaque(val, js_point_array_class_id)))) {
+    pa->~JSPointArrayData();
+    js_deallocate(rt, pa);
+  }
+}
+
+JSClassDef js_point_array_class = {
+    .class_name = "PointArray",
+    .finalizer = js_point_array_finalizer,
+};
+
+const JSCFunctionListEntry js_point_array_proto_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("at", 1, js_point_array_method, METHOD_AT),
+    JS_CFUNC_MAGIC_DEF("set", 2, js_point_array_method, METHOD_SET),
+    JS_CFUNC_MAGIC_DEF("push", 1, js_point_array_method, METHOD_PUSH),
+    JS_CFUNC_MAGIC_DEF("translate", 1, js_point_array_method, METHOD_TRANSLATE),
+    JS_CFUNC_MAGIC_DEF("scale", 1, js_point_array_method, METHOD_SCALE),
+    JS_CFUNC_MAGIC_DEF("transform", 1, js_point_array_method, METHOD_TRANSFORM),
+    JS_CFUNC_MAGIC_DEF("boundingRect", 0, js_point_array_method, METHOD_BOUNDING_RECT),
+    JS_CFUNC_MAGIC_DEF("distanceTo", 1, js_point_array_method, METHOD_DISTANCE_TO),
+    JS_CFUNC_MAGIC_DEF("nearest", 1, js_point_array_method, METHOD_NEAREST),
+    JS_CFUNC_MAGIC_DEF("filter", 1, js_point_array_method, METHOD_FILTER),
+    JS_CFUNC_MAGIC_DEF("toMat", 0, js_point_array_method, METHOD_TO_MAT),
+    JS_CFUNC_MAGIC_DEF("toArray", 0, js_point_array_method, METHOD_TO_ARRAY),
+    JS_CFUNC_MAGIC_DEF("toTypedArray", 0, js_point_array_method, METHOD_TO_TYPED_ARRAY),
+    JS_CGETSET_MAGIC_DEF("length", js_point_array_get, 0, PROP_LENGTH),
+    JS_CGETSET_MAGIC_DEF("depth", js_point_array_get, 0, PROP_DEPTH),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "PointArray", JS_PROP_CONFIGURABLE),
+};
+
+extern "C" int
+js_point_array_init(JSContext* ctx, JSModuleDef* m) {
+
+  if(js_point_array_class_id == 0) {
+    /* create the PointArray class */
+    JS_NewClassID(&js_point_array_class_id);
+    JS_NewClass(JS_GetRuntime(ctx), js_point_array_class_id, &js_point_array_class);
+
+    point_array_proto = JS_NewObject(ctx);
+    JS_SetPropertyFunctionList(ctx, point_array_proto, js_point_array_proto_funcs, countof(js_point_array_proto_funcs));
+    JS_SetClassProto(ctx, js_point_array_class_id, point_array_proto);
+
+    point_array_class = JS_NewCFunction2(ctx, js_point_array_constructor, "PointArray", 2, JS_CFUNC_constructor, 0);
+    /* set proto.constructor and ctor.prototype */
+    JS_SetConstructor(ctx, point_array_class, point_array_proto);
+  }
+
+  if(m)
+    JS_SetModuleExport(ctx, m, "PointArray", point_array_class);
+
+  return 0;
+}
+
+extern "C" void
+js_point_array_export(JSContext* ctx, JSModuleDef* m) {
+  JS_AddModuleExport(ctx, m, "PointArray");
+}
+
+#if defined(JS_POINT_ARRAY_MODULE)
+#define JS_INIT_MODULE VISIBLE js_init_module
+#else
+#define JS_INIT_MODULE js_init_module_point_array
+#endif
+
+extern "C" JSModuleDef*
+JS_INIT_MODULE(JSContext* ctx, const char* module_name) {
+  JSModuleDef* m;
+  if(!(m = JS_NewCModule(ctx, module_name, &js_point_array_init)))
+    return NULL;
+  js_point_array_export(ctx, m);
+  return m;
+}
@@ -0,0 +1,29 @@
+#ifndef JS_POINT_ARRAY_HPP
+#define JS_POINT_ARRAY_HPP
+
+#include "include/jsbindings.hpp"
+#include <opencv2/core/mat.hpp>
+#include <quickjs.h>
+
+/**
+ * @brief A point set stored interleaved in one N x 1 CV_32FC2 or CV_64FC2
+ * Mat instead of N Point objects. Passing it to OpenCV aliases `mat`.
+ */
+struct JSPointArrayData {
+  cv::Mat mat;
+  int depth = CV_32F;
+};
+
+extern "C" {
+extern thread_local JSValue point_array_proto, point_array_class;
+extern thread_local JSClassID js_point_array_class_id;
+
+int js_point_array_init(JSContext*, JSModuleDef*);
+void js_point_array_export(JSContext*, JSModuleDef*);
+}
+
+JSPointArrayData* js_point_array_data(JSValueConst val);
+JSPointArrayData* js_point_array_data2(JSContext*, JSValueConst val);
+JSValue js_point_array_wrap(JSContext*, const cv::Mat& mat);
+
+#endif /* defined(JS_POINT_ARRAY_HPP) */
@@ -1,3 +1,4 @@
+#include "js_cv.hpp"
 #include "js_mat.hpp"
 #include "js_vector.hpp"
 #include "include/js_array.hpp"
@@ -5,6 +6,7 @@
 #include "include/psimpl.hpp"
 #include <quickjs.h>
 #include <opencv2/core.hpp>
+#include <algorithm>
 #include <vector>
 
 using cv::Point;
@@ -174,6 +176,257 @@ js_psimpl_simplify(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst
   return JS_ThrowTypeError(ctx, "Expected Mat, PointVector, Point2fVector, or array");
 }
 
+/* Contour sets for the *Batch() variants below are flattened into one
+ * interleaved coordinate buffer plus point offsets (n + 1 entries). The
+ * buffers are thread_local and only ever grow, so a steady stream of
+ * frames stops allocating after the first. */
+template<typename T> struct PsimplBatch {
+  std::vector<T> coords, result;
+  std::vector<uint32_t> offsets, lengths;
+
+  static PsimplBatch&
+  get() {
+    static thread_local PsimplBatch batch;
+
+    return batch;
+  }
+};
+
+template<typename T>
+static void
+js_psimpl_append(const cv::Mat& mat, std::vector<T>& coords) {
+  cv::Mat src = mat.isContinuous() ? mat : mat.clone();
+  size_t n = src.total() * src.channels(), old = coords.size();
+
+  coords.resize(old + n);
+
+  if(n) {
+    cv::Mat dst(1, int(n), cv::DataType<T>::type, coords.data() + old);
+    src.reshape(1, 1).convertTo(dst, dst.type());
+  }
+}
+
+template<typename T, typename P>
+static void
+js_psimpl_append(const std::vector<P>& points, std::vector<T>& coords) {
+  coords.reserve(coords.size() + points.size() * 2);
+
+  for(const P& pt : points)
+    coords.insert(coords.end(), {T(pt.x), T(pt.y)});
+}
+
+/* Append one contour; false if `value` is not a polyline */
+template<typename T>
+static bool
+js_psimpl_append(JSContext* ctx, JSValueConst value, std::vector<T>& coords) {
+  JSMatData* mat;
+  JSVector<Point>* pointVec;
+  JSVector<Point2f>* point2fVec;
+
+  if((mat = js_mat_data_nothrow(value)))
+    js_psimpl_append(*mat, coords);
+  else if((pointVec = JSVector<Point>::fromJS(value)))
+    js_psimpl_append(*pointVec->vec, coords);
+  else if((point2fVec = JSVector<Point2f>::fromJS(value)))
+    js_psimpl_append(*point2fVec->vec, coords);
+  else if(js_is_array(ctx, value)) {
+    std::vector<cv::Point2d> points;
+    js_array_to(ctx, value, points);
+    js_psimpl_append(points, coords);
+  } else
+    return false;
+
+  return true;
+}
+
+/* Simplify every contour on the thread pool, then compact the results in
+ * place - a contour's output never outgrows its own input slot. */
+template<typename T>
+static JSValue
+js_psimpl_batch_run(JSContext* ctx, const T* coords, const uint32_t* offsets, size_t count, double arg1, double arg2, int magic) {
+  PsimplBatch<T>& batch = PsimplBatch<T>::get();
+  size_t pos = 0;
+
+  batch.result.resize(size_t(offsets[count]) * 2);
+  batch.lengths.resize(count + 1);
+
+  cv::parallel_for_(cv::Range(0, int(count)), [&](const cv::Range& range) {
+    for(int i = range.start; i < range.end; ++i) {
+      size_t begin = size_t(offsets[i]) * 2, n = size_t(offsets[i + 1] - offsets[i]) * 2;
+
+      batch.lengths[i + 1] = js_psimpl_run<T>(coords + begin, n, batch.result.data() + begin, arg1, arg2, magic) / 2;
+    }
+  });
+
+  batch.lengths[0] = 0;
+
+  for(size_t i = 0; i < count; ++i) {
+    T* src = batch.result.data() + size_t(offsets[i]) * 2;
+    size_t n = batch.lengths[i + 1];
+
+    std::copy(src, src + n * 2, batch.result.data() + pos * 2);
+    pos += n;
+    batch.lengths[i + 1] = pos;
+  }
+
+  JSValue ret = JS_NewObject(ctx);
+
+  JS_SetPropertyStr(ctx, ret, "points", js_typedarray_from(ctx, batch.result.data(), batch.result.data() + pos * 2));
+  JS_SetPropertyStr(ctx, ret, "offsets", js_typedarray_from(ctx, batch.lengths.data(), batch.lengths.data() + count + 1));
+  return ret;
+}
+
+template<typename T>
+static JSValue
+js_psimpl_batch_gather(JSContext* ctx, JSValueConst contours, double arg1, double arg2, int magic) {
+  PsimplBatch<T>& batch = PsimplBatch<T>::get();
+  JSVector<cv::Mat>* matVec;
+  JSVector<std::vector<Point>>* pointVecVec;
+  JSVector<std::vector<Point2f>>* point2fVecVec;
+
+  batch.coords.clear();
+  batch.offsets.assign(1, 0);
+
+  auto next = [&]() { batch.offsets.push_back(batch.coords.size() / 2); };
+
+  if((matVec = JSVector<cv::Mat>::fromJS(contours))) {
+    for(const cv::Mat& mat : *matVec->vec) {
+      js_psimpl_append(mat, batch.coords);
+      next();
+    }
+  } else if((pointVecVec = JSVector<std::vector<Point>>::fromJS(contours))) {
+    for(const auto& points : *pointVecVec->vec) {
+      js_psimpl_append(points, batch.coords);
+      next();
+    }
+  } else if((point2fVecVec = JSVector<std::vector<Point2f>>::fromJS(contours))) {
+    for(const auto& points : *point2fVecVec->vec) {
+      js_psimpl_append(points, batch.coords);
+      next();
+    }
+  } else if(js_is_array(ctx, contours)) {
+    uint32_t length = js_array_length(ctx, contours);
+
+    for(uint32_t i = 0; i < length; ++i) {
+      JSValue item = JS_GetPropertyUint32(ctx, contours, i);
+      bool ok = js_psimpl_append(ctx, item, batch.coords);
+
+      JS_FreeValue(ctx, item);
+
+      if(!ok)
+        return JS_ThrowTypeError(ctx, "contour %u: expected Mat, PointVector, Point2fVector, or array", i);
+
+      next();
+    }
+  } else {
+    return JS_ThrowTypeError(ctx, "Expected an array, MatVector, PointVectorVector, Point2fVectorVector or { points, offsets }");
+  }
+
+  return js_psimpl_batch_run<T>(ctx, batch.coords.data(), batch.offsets.data(), batch.offsets.size() - 1, arg1, arg2, magic);
+}
+
+/* Coordinate type of a contour set: that of its first contour, integer
+ * for plain arrays like the single-contour functions */
+static int
+js_psimpl_batch_depth(JSContext* ctx, JSValueConst contours) {
+  auto mat_depth = [](const cv::Mat& mat) { return mat.depth() == CV_32S || mat.depth() == CV_32F ? mat.depth() : CV_64F; };
+  JSVector<cv::Mat>* matVec;
+  JSMatData* mat;
+  int depth = CV_32S;
+
+  if(JSVector<std::vector<Point2f>>::fromJS(contours))
+    return CV_32F;
+
+  if((matVec = JSVector<cv::Mat>::fromJS(contours)))
+    return matVec->vec->empty() ? CV_32S : mat_depth(matVec->vec->front());
+
+  if(js_is_array(ctx, contours) && js_array_length(ctx, contours) > 0) {
+    JSValue first = JS_GetPropertyUint32(ctx, contours, 0);
+
+    if((mat = js_mat_data_nothrow(first)))
+      depth = mat_depth(*mat);
+    else if(JSVector<Point2f>::fromJS(first))
+      depth = CV_32F;
+
+    JS_FreeValue(ctx, first);
+  }
+
+  return depth;
+}
+
+/**
+ * cv.psimpl.*Batch(contours, arg1, arg2) - the same algorithms over a whole
+ * contour set, one contour per task on OpenCV's thread pool.
+ *
+ * `contours` is an array (of Mat, PointVector, Point2fVector or point
+ * arrays), a MatVector, PointVectorVector, Point2fVectorVector, or a packed
+ * { points: Int32Array|Float32Array|Float64Array, offsets } with offsets in
+ * points (n + 1 entries). The result is packed the same way, coordinates in
+ * the type of the input: { points, offsets: Uint32Array }.
+ */
+static JSValue
+js_psimpl_batch(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  if(argc < 1)
+    return JS_ThrowTypeError(ctx, "Expected at least 1 argument");
+
+  double arg1 = 0, arg2 = 0;
+  if(argc > 1) {
+    JS_ToFloat64(ctx, &arg1, argv[1]);
+    if(argc > 2)
+      JS_ToFloat64(ctx, &arg2, argv[2]);
+  }
+
+  JSValue points, offsets;
+
+  try {
+    if(JS_IsObject(argv[0]) && !js_is_array(ctx, argv[0]) && !JS_IsUndefined(offsets = JS_GetPropertyStr(ctx, argv[0], "offsets"))) {
+      static thread_local std::vector<uint32_t> off;
+      JSValue ret = JS_EXCEPTION;
+
+      points = JS_GetPropertyStr(ctx, argv[0], "points");
+
+      if(!js_is_typedarray(ctx, points) || !js_is_typedarray(ctx, offsets)) {
+        JS_ThrowTypeError(ctx, "Expected { points: TypedArray, offsets: TypedArray }");
+      } else {
+        TypedArrayType type = js_typedarray_type(ctx, points), otype = js_typedarray_type(ctx, offsets);
+        TypedArrayProps props = js_typedarray_props(ctx, points), oprops = js_typedarray_props(ctx, offsets);
+        size_t coord_count = props.size();
+
+        off.clear();
+
+        if(otype.byte_size == 4 && !otype.is_floating_point)
+          off.assign(oprops.ptr<uint32_t>(), oprops.ptr<uint32_t>() + oprops.size());
+
+        bool valid = !off.empty() && off[0] == 0 && size_t(off.back()) * 2 <= coord_count;
+
+        for(size_t i = 1; valid && i < off.size(); ++i)
+          valid = off[i] >= off[i - 1];
+
+        if(!valid)
+          JS_ThrowRangeError(ctx, "offsets must be a non-decreasing Int32Array/Uint32Array from 0 to at most points.length / 2");
+        else if(type.is_floating_point && type.byte_size == 8)
+          ret = js_psimpl_batch_run<double>(ctx, props.ptr<double>(), off.data(), off.size() - 1, arg1, arg2, magic);
+        else if(type.is_floating_point && type.byte_size == 4)
+          ret = js_psimpl_batch_run<float>(ctx, props.ptr<float>(), off.data(), off.size() - 1, arg1, arg2, magic);
+        else if(type.byte_size == 4 && type.is_signed)
+          ret = js_psimpl_batch_run<int32_t>(ctx, props.ptr<int32_t>(), off.data(), off.size() - 1, arg1, arg2, magic);
+        else
+          JS_ThrowTypeError(ctx, "points must be an Int32Array, Float32Array or Float64Array");
+      }
+
+      JS_FreeValue(ctx, points);
+      JS_FreeValue(ctx, offsets);
+      return ret;
+    }
+
+    switch(js_psimpl_batch_depth(ctx, argv[0])) {
+      case CV_32F: return js_psimpl_batch_gather<float>(ctx, argv[0], arg1, arg2, magic);
+      case CV_64F: return js_psimpl_batch_gather<double>(ctx, argv[0], arg1, arg2, magic);
+      default: return js_psimpl_batch_gather<int32_t>(ctx, argv[0], arg1, arg2, magic);
+    }
+  } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
+}
+
 static const JSCFunctionListEntry js_psimpl_funcs[] = {
     JS_CFUNC_MAGIC_DEF("reumannWitkam", 1, js_psimpl_simplify, SIMPLIFY_REUMANN_WITKAM),
     JS_CFUNC_MAGIC_DEF("opheim", 1, js_psimpl_simplify, SIMPLIFY_OPHEIM),
@@ -182,6 +435,13 @@ static const JSCFunctionListEntry js_psimpl_funcs[] = {
     JS_CFUNC_MAGIC_DEF("nthPoint", 1, js_psimpl_simplify, SIMPLIFY_NTH_POINT),
     JS_CFUNC_MAGIC_DEF("radialDistance", 1, js_psimpl_simplify, SIMPLIFY_RADIAL_DISTANCE),
     JS_CFUNC_MAGIC_DEF("perpendicularDistance", 1, js_psimpl_simplify, SIMPLIFY_PERPENDICULAR_DISTANCE),
+    JS_CFUNC_MAGIC_DEF("reumannWitkamBatch", 1, js_psimpl_batch, SIMPLIFY_REUMANN_WITKAM),
+    JS_CFUNC_MAGIC_DEF("opheimBatch", 1, js_psimpl_batch, SIMPLIFY_OPHEIM),
+    JS_CFUNC_MAGIC_DEF("langBatch", 1, js_psimpl_batch, SIMPLIFY_LANG),
+    JS_CFUNC_MAGIC_DEF("douglasPeuckerBatch", 1, js_psimpl_batch, SIMPLIFY_DOUGLAS_PEUCKER),
+    JS_CFUNC_MAGIC_DEF("nthPointBatch", 1, js_psimpl_batch, SIMPLIFY_NTH_POINT),
+    JS_CFUNC_MAGIC_DEF("radialDistanceBatch", 1, js_psimpl_batch, SIMPLIFY_RADIAL_DISTANCE),
+    JS_CFUNC_MAGIC_DEF("perpendicularDistanceBatch", 1, js_psimpl_batch, SIMPLIFY_PERPENDICULAR_DISTANCE),
 };
 
 static const JSCFunctionListEntry js_psimpl_static_funcs[] = {
@@ -4,6 +4,9 @@
 #include "js_rect.hpp"
 #include "js_vector.hpp"
 #include "include/jsbindings.hpp"
+#include "include/js_inputoutputarray.hpp"
+#include "js_cv.hpp"
+#include "js_mat.hpp"
 #include <opencv2/core/matx.hpp>
 #include <quickjs.h>
 #include <stddef.h>
@@ -63,6 +66,47 @@ js_subdiv2d_finalizer(JSRuntime* rt, JSValue val) {
   js_deallocate(rt, s);
 }
 
+/* x,y pairs from a typed array or Mat of any depth */
+static bool
+js_subdiv2d_points(JSContext* ctx, JSValueConst value, std::vector<cv::Point2f>& points) {
+  cv::Mat mat = js_cv_inputarray(ctx, value).getMat(), xy;
+  size_t n = mat.total() * mat.channels();
+
+  if(n % 2)
+    return false;
+
+  if(n) {
+    if(!mat.isContinuous())
+      mat = mat.clone();
+
+    mat.reshape(2, n / 2).convertTo(xy, CV_32F);
+  }
+
+  points.assign(xy.ptr<cv::Point2f>(), xy.ptr<cv::Point2f>() + n / 2);
+  return true;
+}
+
+/* Vertex ids of every triangle, 3 per triangle, in getTriangleList() order */
+static void
+js_subdiv2d_triangle_indices(cv::Subdiv2D& s, std::vector<int32_t>& indices) {
+  std::vector<int> leading;
+
+  s.getLeadingEdgeList(leading);
+  indices.clear();
+  indices.reserve(leading.size() * 3);
+
+  for(int edge : leading) {
+    int ea = edge, eb = s.getEdge(ea, cv::Subdiv2D::NEXT_AROUND_LEFT), ec = s.getEdge(eb, cv::Subdiv2D::NEXT_AROUND_LEFT);
+    int a = s.edgeOrg(ea), b = s.edgeOrg(eb), c = s.edgeOrg(ec);
+
+    /* vertex 0 is unused, 1-3 are the outer triangle initDelaunay() starts from */
+    if(a < 4 || b < 4 || c < 4)
+      continue;
+
+    indices.insert(indices.end(), {a, b, c});
+  }
+}
+
 enum {
   SUBDIV2D_EDGE_DST = 077,
   SUBDIV2D_EDGE_ORG,
@@ -136,11 +180,19 @@ js_subdiv2d_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst
       break;
     }
 
+    /* getEdgeList() without an array: Float32Array of x1,y1,x2,y2 */
     case SUBDIV2D_GET_EDGE_LIST: {
       std::vector<cv::Vec4f> edgeList;
 
       s->getEdgeList(edgeList);
 
+      if(!js_is_array(ctx, argv[0])) {
+        float* ptr = reinterpret_cast<float*>(edgeList.data());
+
+        ret = js_typedarray_from(ctx, ptr, ptr + edgeList.size() * 4);
+        break;
+      }
+
       js_array_clear(ctx, argv[0]);
       js_array_copy(ctx, argv[0], edgeList);
       break;
@@ -156,9 +208,35 @@ js_subdiv2d_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst
       break;
     }
 
+    /* getTriangleList() without an array: Float32Array of x1,y1,x2,y2,x3,y3,
+     * getTriangleList({ indices: true }): Int32Array of vertex ids */
     case SUBDIV2D_GET_TRIANGLE_LIST: {
       std::vector<cv::Vec6f> triangleList;
 
+      if(!js_is_array(ctx, argv[0])) {
+        BOOL indices = FALSE;
+
+        if(JS_IsObject(argv[0])) {
+          JSValue v = JS_GetPropertyStr(ctx, argv[0], "indices");
+          indices = JS_ToBool(ctx, v) > 0;
+          JS_FreeValue(ctx, v);
+        }
+
+        if(indices) {
+          std::vector<int32_t> vertices;
+
+          js_subdiv2d_triangle_indices(*s, vertices);
+          ret = js_typedarray_from(ctx, vertices.data(), vertices.data() + vertices.size());
+        } else {
+          s->getTriangleList(triangleList);
+
+          float* ptr = reinterpret_cast<float*>(triangleList.data());
+          ret = js_typedarray_from(ctx, ptr, ptr + triangleList.size() * 6);
+        }
+
+        break;
+      }
+
       s->getTriangleList(triangleList);
 
       js_array_clear(ctx, argv[0]);
@@ -182,6 +260,38 @@ js_subdiv2d_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst
     }
 
     case SUBDIV2D_GET_VORONOI_FACET_LIST: {
+      /* getVoronoiFacetList([idx]): { points: Float32Array, offsets: Uint32Array, centers: Float32Array },
+       * facet i is points[2 * offsets[i] .. 2 * offsets[i + 1]) */
+      if(argc < 2 || !JSVector<std::vector<cv::Point2f>>::fromJS(argv[1])) {
+        std::vector<int> indices;
+        std::vector<std::vector<cv::Point2f>> facets;
+        std::vector<cv::Point2f> centers;
+        std::vector<float> points;
+        std::vector<uint32_t> offsets{0};
+
+        if(js_is_typedarray(ctx, argv[0]))
+          js_cv_inputarray(ctx, argv[0]).getMat().reshape(1, 1).convertTo(indices, CV_32S);
+        else if(js_is_array(ctx, argv[0]))
+          js_array_to(ctx, argv[0], indices);
+
+        s->getVoronoiFacetList(indices, facets, centers);
+
+        for(const auto& facet : facets) {
+          for(const cv::Point2f& pt : facet)
+            points.insert(points.end(), {pt.x, pt.y});
+
+          offsets.push_back(points.size() / 2);
+        }
+
+        float* c = reinterpret_cast<float*>(centers.data());
+
+        ret = JS_NewObject(ctx);
+        JS_SetPropertyStr(ctx, ret, "points", js_typedarray_from(ctx, points.data(), points.data() + points.size()));
+        JS_SetPropertyStr(ctx, ret, "offsets", js_typedarray_from(ctx, offsets.data(), offsets.data() + offsets.size()));
+        JS_SetPropertyStr(ctx, ret, "centers", js_typedarray_from(ctx, c, c + centers.size() * 2));
+        break;
+      }
+
       JSVector<int>* idx;
       JSVector<std::vector<cv::Point2f>>* facetList;
       JSVector<cv::Point2f>* facetCenters = JSVector<cv::Point2f>::fromJS(argv[2]);
@@ -206,10 +316,29 @@ js_subdiv2d_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst
       break;
     }
 
+    /* insert(Float32Array|Mat) inserts all points in one call and returns
+     * their vertex ids as an Int32Array, -1 where a point was rejected */
     case SUBDIV2D_INSERT: {
       JSPointData<float> pt;
 
-      if(!js_point_read(ctx, argv[0], &pt)) {
+      if(js_is_typedarray(ctx, argv[0]) || js_mat_data_nothrow(argv[0])) {
+        std::vector<cv::Point2f> points;
+
+        try {
+          if(!js_subdiv2d_points(ctx, argv[0], points))
+            return JS_ThrowRangeError(ctx, "expecting x,y pairs");
+        } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
+
+        std::vector<int32_t> vertices(points.size());
+
+        for(size_t i = 0; i < points.size(); ++i) {
+          try {
+            vertices[i] = s->insert(points[i]);
+          } catch(const cv::Exception&) { vertices[i] = -1; }
+        }
+
+        ret = js_typedarray_from(ctx, vertices.data(), vertices.data() + vertices.size());
+      } else if(!js_point_read(ctx, argv[0], &pt)) {
         std::vector<JSPointData<float>> ptvec;
         js_array_to(ctx, argv[0], ptvec);
         s->insert(ptvec);
@@ -0,0 +1,624 @@
+#include "js_alloc.hpp"
+#include "js_affine3.hpp"
+#include "js_cv.hpp"
+#include "js_line.hpp"
+#include "js_mat.hpp"
+#include "js_rotated_rect.hpp"
+#include "include/js_array.hpp"
+#include "include/js_inputoutputarray.hpp"
+#include "include/js_typed_array.hpp"
+#include "include/jsbindings.hpp"
+#include "include/svg_writer.hpp"
+#include <opencv2/core.hpp>
+#include <quickjs.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+/* Where a writer's output goes: a file, a JS callback receiving ArrayBuffer
+ * chunks, or memory handed back by finish() */
+struct JSSvgWriterData {
+  JSContext* ctx;
+  JSValue callback = JS_UNDEFINED;
+  FILE* file = nullptr;
+  std::string memory;
+  bool failed = false, finished = false;
+  SvgWriter writer;
+
+  JSSvgWriterData(JSContext* c, int precision, bool relative, size_t chunkSize)
+      : ctx(c), writer([this](const char* data, size_t size) { write(data, size); }, precision, relative, chunkSize) {}
+
+  void
+  write(const char* data, size_t size) {
+    if(failed)
+      return;
+
+    if(file) {
+      failed = fwrite(data, 1, size, file) != size;
+
+      if(failed)
+        JS_ThrowInternalError(ctx, "SvgWriter: write failed: %s", strerror(errno));
+    } else if(JS_IsFunction(ctx, callback)) {
+      JSValue chunk = JS_NewArrayBufferCopy(ctx, reinterpret_cast<const uint8_t*>(data), size);
+      JSValue result = JS_Call(ctx, callback, JS_UNDEFINED, 1, &chunk);
+
+      failed = JS_IsException(result);
+      JS_FreeValue(ctx, chunk);
+      JS_FreeValue(ctx, result);
+    } else {
+      memory.append(data, size);
+    }
+  }
+
+  void
+  close() {
+    if(file) {
+      fclose(file);
+      file = nullptr;
+    }
+  }
+};
+
+enum {
+  SVG_WRITER_CONTOURS = 0,
+  SVG_WRITER_POLYLINES,
+  SVG_WRITER_LINES,
+  SVG_WRITER_ELLIPSES,
+  SVG_WRITER_BEGIN_GROUP,
+  SVG_WRITER_END_GROUP,
+  SVG_WRITER_SET_TRANSFORM,
+  SVG_WRITER_RAW,
+  SVG_WRITER_FINISH,
+};
+
+enum {
+  SVG_WRITER_BYTES_WRITTEN = 0,
+  SVG_WRITER_DEPTH,
+};
+
+extern "C" {
+thread_local JSValue svg_writer_proto = JS_UNDEFINED, svg_writer_class = JS_UNDEFINED;
+thread_local JSClassID js_svg_writer_class_id = 0;
+}
+
+static JSSvgWriterData*
+js_svg_writer_data2(JSContext* ctx, JSValueConst val) {
+  return static_cast<JSSvgWriterData*>(JS_GetOpaque2(ctx, val, js_svg_writer_class_id));
+}
+
+/* Style objects use camelCase keys for SVG's kebab-case presentation
+ * attributes (strokeWidth -> stroke-width). Attributes that are camelCase
+ * in SVG itself keep their name. */
+static std::string
+js_svg_writer_attribute_name(const char* key) {
+  static const char* const camel[] = {
+      "viewBox",
+      "preserveAspectRatio",
+      "gradientUnits",
+      "gradientTransform",
+      "patternUnits",
+      "patternTransform",
+      "clipPathUnits",
+      "maskUnits",
+      "textLength",
+      "lengthAdjust",
+  };
+  std::string name;
+
+  for(const char* c : camel)
+    if(!strcmp(key, c))
+      return key;
+
+  for(const char* p = key; *p; ++p) {
+    if(*p >= 'A' && *p <= 'Z') {
+      name += '-';
+      name += char(*p - 'A' + 'a');
+    } else {
+      name += *p;
+    }
+  }
+
+  return name;
+}
+
+static bool
+js_svg_writer_attributes(JSContext* ctx, JSValueConst obj, SvgWriter::attributes_type& attrs) {
+  JSPropertyEnum* props;
+  uint32_t len;
+
+  if(!JS_IsObject(obj))
+    return JS_IsUndefined(obj) || JS_IsNull(obj);
+
+  if(JS_GetOwnPropertyNames(ctx, &props, &len, obj, JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY))
+    return false;
+
+  for(uint32_t i = 0; i < len; i++) {
+    const char* key = JS_AtomToCString(ctx, props[i].atom);
+    JSValue value = JS_GetProperty(ctx, obj, props[i].atom);
+
+    if(!JS_IsUndefined(value) && !JS_IsNull(value)) {
+      const char* str = JS_ToCString(ctx, value);
+
+      attrs.emplace_back(js_svg_writer_attribute_name(key), str ? str : "");
+      JS_FreeCString(ctx, str);
+    }
+
+    JS_FreeValue(ctx, value);
+    JS_FreeCString(ctx, key);
+    JS_FreeAtom(ctx, props[i].atom);
+  }
+
+  js_free(ctx, props);
+  return true;
+}
+
+static bool
+js_svg_writer_has(const SvgWriter::attributes_type& attrs, const char* name) {
+  for(const auto& attr : attrs)
+    if(attr.first == name)
+      return true;
+
+  return false;
+}
+
+/* 2x3 affine or 3x3 perspective placement, as a Mat, array, TypedArray or Affine3 (z = 0 plane) */
+static bool
+js_svg_writer_matrix(JSContext* ctx, JSValueConst value, cv::Matx33d& matrix) {
+  cv::Affine3<double>* affine;
+  cv::Mat m;
+
+  if((affine = js_affine3_data(value))) {
+    const cv::Matx44d& a = affine->matrix;
+
+    matrix = cv::Matx33d(a(0, 0), a(0, 1), a(0, 3), a(1, 0), a(1, 1), a(1, 3), 0, 0, 1);
+    return true;
+  }
+
+  m = js_cv_inputarray(ctx, value).getMat();
+
+  if(m.total() * m.channels() != 6 && m.total() * m.channels() != 9)
+    return false;
+
+  (m.isContinuous() ? m : m.clone()).reshape(1, 1).convertTo(m, CV_64F);
+
+  const double* v = m.ptr<double>();
+
+  matrix = cv::Matx33d(v[0], v[1], v[2], v[3], v[4], v[5], 0, 0, 1);
+
+  if(m.total() == 9)
+    matrix(2, 0) = v[6], matrix(2, 1) = v[7], matrix(2, 2) = v[8];
+
+  return true;
+}
+
+/* x1, y1, x2, y2 rows from an array of Lines, or a Mat/TypedArray */
+static bool
+js_svg_writer_lines(JSContext* ctx, JSValueConst value, cv::Mat& out) {
+  if(js_is_array(ctx, value)) {
+    uint32_t length = js_array_length(ctx, value);
+    std::vector<cv::Vec4d> lines;
+
+    for(uint32_t i = 0; i < length; ++i) {
+      JSValue item = JS_GetPropertyUint32(ctx, value, i);
+      JSLineData<double> line(0, 0, 0, 0);
+      bool ok = js_line_read(ctx, item, &line);
+
+      JS_FreeValue(ctx, item);
+
+      if(!ok)
+        return false;
+
+      lines.emplace_back(line.x1, line.y1, line.x2, line.y2);
+    }
+
+    cv::Mat(lines, true).copyTo(out);
+    return true;
+  }
+
+  JSInputArray arr = js_cv_inputarray(ctx, value);
+
+  if(js_is_noarray(arr))
+    return false;
+
+  out = arr.getMat();
+  return out.total() * out.channels() % 4 == 0;
+}
+
+/* cx, cy, width, height, angle rows from an array of RotatedRects, or a Mat/TypedArray */
+static bool
+js_svg_writer_ellipses(JSContext* ctx, JSValueConst value, cv::Mat& out) {
+  if(js_is_array(ctx, value)) {
+    uint32_t length = js_array_length(ctx, value);
+    std::vector<cv::Vec<double, 5>> ellipses;
+
+    for(uint32_t i = 0; i < length; ++i) {
+      JSValue item = JS_GetPropertyUint32(ctx, value, i);
+      JSRotatedRectData* rr = js_rotated_rect_data(item);
+
+      JS_FreeValue(ctx, item);
+
+      if(!rr)
+        return false;
+
+      ellipses.push_back(cv::Vec<double, 5>(rr->center.x, rr->center.y, rr->size.width, rr->size.height, rr->angle));
+    }
+
+    cv::Mat(ellipses, true).copyTo(out);
+    return true;
+  }
+
+  JSInputArray arr = js_cv_inputarray(ctx, value);
+
+  if(js_is_noarray(arr))
+    return false;
+
+  out = arr.getMat();
+  return out.total() * out.channels() % 5 == 0;
+}
+
+/**
+ * new SvgWriter(target?, { width, height, precision = 3, relative = true,
+ * chunkSize = 65536, attributes })
+ *
+ * `target` is a filename, a function called with each ArrayBuffer chunk,
+ * or omitted to collect the document for finish().
+ */
+static JSValue
+js_svg_writer_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  JSValue obj = JS_UNDEFINED, proto;
+  JSSvgWriterData* sw;
+  double width = 0, height = 0;
+  int32_t precision = 3;
+  bool relative = true;
+  int64_t chunk_size = 1 << 16;
+  SvgWriter::attributes_type attrs;
+  JSValueConst options = argc > 1 ? argv[1] : JS_UNDEFINED;
+
+  if(JS_IsObject(options)) {
+    JSValue value;
+
+    value = JS_GetPropertyStr(ctx, options, "width");
+    JS_ToFloat64(ctx, &width, value);
+    JS_FreeValue(ctx, value);
+
+    value = JS_GetPropertyStr(ctx, options, "height");
+    JS_ToFloat64(ctx, &height, value);
+    JS_FreeValue(ctx, value);
+
+    value = JS_GetPropertyStr(ctx, options, "precision");
+    if(!JS_IsUndefined(value))
+      JS_ToInt32(ctx, &precision, value);
+    JS_FreeValue(ctx, value);
+
+    value = JS_GetPropertyStr(ctx, options, "relative");
+    if(!JS_IsUndefined(value))
+      relative = JS_ToBool(ctx, value);
+    JS_FreeValue(ctx, value);
+
+    value = JS_GetPropertyStr(ctx, options, "chunkSize");
+    if(!JS_IsUndefined(value))
+      JS_ToInt64(ctx, &chunk_size, value);
+    JS_FreeValue(ctx, value);
+
+    value = JS_GetPropertyStr(ctx, options, "attributes");
+    bool ok = js_svg_writer_attributes(ctx, value, attrs);
+    JS_FreeValue(ctx, value);
+
+    if(!ok)
+      return JS_ThrowTypeError(ctx, "options.attributes must be an object");
+  }
+
+  if(chunk_size <= 0)
+    return JS_ThrowRangeError(ctx, "chunkSize must be positive");
+
+  if(!(sw = js_allocate<JSSvgWriterData>(ctx)))
+    return JS_EXCEPTION;
+
+  new(sw) JSSvgWriterData(ctx, precision, relative, chunk_size);
+
+  if(argc > 0 && JS_IsString(argv[0])) {
+    const char* filename = JS_ToCString(ctx, argv[0]);
+
+    sw->file = fopen(filename, "wb");
+
+    if(!sw->file) {
+      JS_ThrowInternalError(ctx, "SvgWriter: cannot open '%s': %s", filename, strerror(errno));
+      JS_FreeCString(ctx, filename);
+      goto fail;
+    }
+
+    JS_FreeCString(ctx, filename);
+  } else if(argc > 0 && JS_IsFunction(ctx, argv[0])) {
+    sw->callback = JS_DupValue(ctx, argv[0]);
+  } else if(argc > 0 && !JS_IsUndefined(argv[0]) && !JS_IsNull(argv[0])) {
+    JS_ThrowTypeError(ctx, "argument 1 must be a filename or a function");
+    goto fail;
+  }
+
+  /* using new_target to get the prototype is necessary when the class is extended. */
+  proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+
+  if(JS_IsException(proto))
+    goto fail;
+
+  obj = JS_NewObjectProtoClass(ctx, proto, js_svg_writer_class_id);
+  JS_FreeValue(ctx, proto);
+
+  if(JS_IsException(obj))
+    goto fail;
+
+  JS_SetOpaque(obj, sw);
+
+  sw->writer.begin(width, height, attrs);
+
+  if(sw->failed) {
+    JS_FreeValue(ctx, obj);
+    return JS_EXCEPTION;
+  }
+
+  return obj;
+
+fail:
+  sw->close();
+  JS_FreeValue(ctx, sw->callback);
+  sw->~JSSvgWriterData();
+  js_deallocate(ctx, sw);
+  JS_FreeValue(ctx, obj);
+  return JS_EXCEPTION;
+}
+
+/**
+ * contours(contours, style?)        closed subpaths, one <path>
+ * polylines(polylines, style?)      open subpaths, one <path>
+ * lines(lines, style?)              one <path> of segments
+ * ellipses(ellipses, style?)        an <ellipse> each, in a <g> when styled
+ * beginGroup(attributes?) / endGroup()
+ * setTransform(matrix | null)       affine or perspective placement
+ * raw(text)
+ * finish()                          closes the document
+ *
+ * Contour sets are read by js_contours_read(). Paths without a `fill`
+ * style get fill="none" unless they are contours.
+ */
+static JSValue
+js_svg_writer_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  JSSvgWriterData* sw;
+  SvgWriter::attributes_type attrs;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(sw = js_svg_writer_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  if(sw->finished)
+    return JS_ThrowInternalError(ctx, "SvgWriter: already finished");
+
+  if(sw->failed)
+    return JS_ThrowInternalError(ctx, "SvgWriter: output failed earlier");
+
+  try {
+    switch(magic) {
+      case SVG_WRITER_CONTOURS:
+      case SVG_WRITER_POLYLINES:
+      case SVG_WRITER_LINES:
+      case SVG_WRITER_ELLIPSES:
+      case SVG_WRITER_BEGIN_GROUP: {
+        int argi = magic == SVG_WRITER_BEGIN_GROUP ? 0 : 1;
+
+        if(argc > argi && !js_svg_writer_attributes(ctx, argv[argi], attrs))
+          return JS_ThrowTypeError(ctx, "argument %d must be an attribute object", argi + 1);
+
+        if((magic == SVG_WRITER_POLYLINES || magic == SVG_WRITER_LINES) && !js_svg_writer_has(attrs, "fill"))
+          attrs.emplace(attrs.begin(), "fill", "none");
+
+        break;
+      }
+    }
+
+    switch(magic) {
+      case SVG_WRITER_CONTOURS:
+      case SVG_WRITER_POLYLINES: {
+        std::vector<cv::Mat> contours;
+        JSValue keep = JS_UNDEFINED;
+
+        if(argc < 1 || !js_contours_read(ctx, argv[0], contours, keep, true)) {
+          JS_FreeValue(ctx, keep);
+          return JS_EXCEPTION;
+        }
+
+        sw->writer.path(contours, magic == SVG_WRITER_CONTOURS, attrs);
+        JS_FreeValue(ctx, keep);
+        break;
+      }
+
+      case SVG_WRITER_LINES: {
+        cv::Mat lines;
+
+        if(argc < 1 || !js_svg_writer_lines(ctx, argv[0], lines))
+          return JS_ThrowTypeError(ctx, "argument 1 must be an array of Lines, or a Mat/TypedArray of x1, y1, x2, y2");
+
+        sw->writer.lines(lines, attrs);
+        break;
+      }
+
+      case SVG_WRITER_ELLIPSES: {
+        cv::Mat ellipses;
+
+        if(argc < 1 || !js_svg_writer_ellipses(ctx, argv[0], ellipses))
+          return JS_ThrowTypeError(ctx, "argument 1 must be an array of RotatedRects, or a Mat/TypedArray of cx, cy, width, height, angle");
+
+        sw->writer.ellipses(ellipses, attrs);
+        break;
+      }
+
+      case SVG_WRITER_BEGIN_GROUP: {
+        sw->writer.beginGroup(attrs);
+        break;
+      }
+
+      case SVG_WRITER_END_GROUP: {
+        if(sw->writer.depth() == 0)
+          return JS_ThrowInternalError(ctx, "SvgWriter: no open group");
+
+        sw->writer.endGroup();
+        break;
+      }
+
+      case SVG_WRITER_SET_TRANSFORM: {
+        cv::Matx33d matrix;
+
+        if(argc < 1 || JS_IsNull(argv[0]) || JS_IsUndefined(argv[0]))
+          sw->writer.resetTransform();
+        else if(js_svg_writer_matrix(ctx, argv[0], matrix))
+          sw->writer.setTransform(matrix);
+        else
+          return JS_ThrowTypeError(ctx, "argument 1 must be a 2x3 or 3x3 matrix, an Affine3 or null");
+
+        break;
+      }
+
+      case SVG_WRITER_RAW: {
+        std::string text;
+
+        if(argc > 0)
+          js_value_to(ctx, argv[0], text);
+
+        sw->writer.raw(text);
+        break;
+      }
+
+      case SVG_WRITER_FINISH: {
+        sw->writer.finish();
+        sw->finished = true;
+        sw->close();
+
+        if(!sw->failed && !sw->file && !JS_IsFunction(ctx, sw->callback)) {
+          ret = JS_NewArrayBufferCopy(ctx, reinterpret_cast<const uint8_t*>(sw->memory.data()), sw->memory.size());
+          std::string().swap(sw->memory);
+        }
+
+        break;
+      }
+    }
+  } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
+
+  if(sw->failed) {
+    JS_FreeValue(ctx, ret);
+    return JS_EXCEPTION;
+  }
+
+  return ret;
+}
+
+static JSValue
+js_svg_writer_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  JSSvgWriterData* sw;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(sw = js_svg_writer_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case SVG_WRITER_BYTES_WRITTEN: {
+      ret = JS_NewInt64(ctx, sw->writer.bytesWritten());
+      break;
+    }
+
+    case SVG_WRITER_DEPTH: {
+      ret = JS_NewInt32(ctx, sw->writer.depth());
+      break;
+    }
+  }
+
+  return ret;
+}
+
+void
+js_svg_writer_finalizer(JSRuntime* rt, JSValue val) {
+  JSSvgWriterData* sw;
+
+  if((sw = static_cast<JSSvgWriterData*>(JS_GetOpaque(val, js_svg_writer_class_id)))) {
+    /* a file still open gets a complete document, a callback can't be called from here */
+    if(sw->file && !sw->finished && !sw->failed)
+      sw->writer.finish();
+
+    sw->close();
+    JS_FreeValueRT(rt, sw->callback);
+    sw->~JSSvgWriterData();
+    js_deallocate(rt, sw);
+  }
+}
+
+static void
+js_svg_writer_mark(JSRuntime* rt, JSValueConst val, JS_MarkFunc* mark_func) {
+  JSSvgWriterData* sw;
+
+  if((sw = static_cast<JSSvgWriterData*>(JS_GetOpaque(val, js_svg_writer_class_id))))
+    JS_MarkValue(rt, sw->callback, mark_func);
+}
+
+JSClassDef js_svg_writer_class = {
+    .class_name = "SvgWriter",
+    .finalizer = js_svg_writer_finalizer,
+    .gc_mark = js_svg_writer_mark,
+};
+
+const JSCFunctionListEntry js_svg_writer_proto_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("contours", 1, js_svg_writer_method, SVG_WRITER_CONTOURS),
+    JS_CFUNC_MAGIC_DEF("polylines", 1, js_svg_writer_method, SVG_WRITER_POLYLINES),
+    JS_CFUNC_MAGIC_DEF("lines", 1, js_svg_writer_method, SVG_WRITER_LINES),
+    JS_CFUNC_MAGIC_DEF("ellipses", 1, js_svg_writer_method, SVG_WRITER_ELLIPSES),
+    JS_CFUNC_MAGIC_DEF("beginGroup", 0, js_svg_writer_method, SVG_WRITER_BEGIN_GROUP),
+    JS_CFUNC_MAGIC_DEF("endGroup", 0, js_svg_writer_method, SVG_WRITER_END_GROUP),
+    JS_CFUNC_MAGIC_DEF("setTransform", 1, js_svg_writer_method, SVG_WRITER_SET_TRANSFORM),
+    JS_CFUNC_MAGIC_DEF("raw", 1, js_svg_writer_method, SVG_WRITER_RAW),
+    JS_CFUNC_MAGIC_DEF("finish", 0, js_svg_writer_method, SVG_WRITER_FINISH),
+    JS_CGETSET_MAGIC_DEF("bytesWritten", js_svg_writer_get, 0, SVG_WRITER_BYTES_WRITTEN),
+    JS_CGETSET_MAGIC_DEF("depth", js_svg_writer_get, 0, SVG_WRITER_DEPTH),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "SvgWriter", JS_PROP_CONFIGURABLE),
+};
+
+extern "C" int
+js_svg_writer_init(JSContext* ctx, JSModuleDef* m) {
+
+  if(js_svg_writer_class_id == 0) {
+    /* create the SvgWriter class */
+    JS_NewClassID(&js_svg_writer_class_id);
+    JS_NewClass(JS_GetRuntime(ctx), js_svg_writer_class_id, &js_svg_writer_class);
+
+    svg_writer_proto = JS_NewObject(ctx);
+    JS_SetPropertyFunctionList(ctx, svg_writer_proto, js_svg_writer_proto_funcs, countof(js_svg_writer_proto_funcs));
+    JS_SetClassProto(ctx, js_svg_writer_class_id, svg_writer_proto);
+
+    svg_writer_class = JS_NewCFunction2(ctx, js_svg_writer_constructor, "SvgWriter", 2, JS_CFUNC_constructor, 0);
+    /* set proto.constructor and ctor.prototype */
+    JS_SetConstructor(ctx, svg_writer_class, svg_writer_proto);
+  }
+
+  if(m)
+    JS_SetModuleExport(ctx, m, "SvgWriter", svg_writer_class);
+
+  return 0;
+}
+
+extern "C" void
+js_svg_writer_export(JSContext* ctx, JSModuleDef* m) {
+  JS_AddModuleExport(ctx, m, "SvgWriter");
+}
+
+#if defined(JS_SVG_WRITER_MODULE)
+#define JS_INIT_MODULE VISIBLE js_init_module
+#else
+#define JS_INIT_MODULE js_init_module_svg_writer
+#endif
+
+extern "C" JSModuleDef*
+JS_INIT_MODULE(JSContext* ctx, const char* module_name) {
+  JSModuleDef* m;
+  if(!(m = JS_NewCModule(ctx, module_name, &js_svg_writer_init)))
+    return NULL;
+  js_svg_writer_export(ctx, m);
+  return m;
+}
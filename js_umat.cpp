@@ -6,6 +6,7 @@
 #include "js_rect.hpp"
 #include "js_size.hpp"
 #include "include/jsbindings.hpp"
+#include "include/mat_accounting.hpp"
 #include <opencv2/core/mat.hpp>
 #include <opencv2/core/mat.inl.hpp>
 #include <opencv2/core/types.hpp>
@@ -188,9 +189,11 @@ js_umat_new(JSContext* ctx, uint32_t rows, uint32_t cols, int type) {
   if(JS_IsUndefined(umat_proto))
     js_umat_init(ctx, NULL);
 
+  js_external_memory_check(ctx);
   ret = JS_NewObjectProtoClass(ctx, umat_proto, js_umat_class_id);
 
   um = js_allocate<cv::UMat>(ctx);
+  matAccountingObject(MAT_ACCOUNTING_UMAT, 1);
 
   if(cols || rows || type) {
     new(um) cv::UMat(rows, cols, type);
@@ -248,6 +251,7 @@ js_umat_finalizer(JSRuntime* rt, JSValue val) {
 
   if((um = static_cast<JSUMatData*>(JS_GetOpaque(val, js_umat_class_id)))) {
     um->release();
+    matAccountingObject(MAT_ACCOUNTING_UMAT, -1);
     js_deallocate(rt, um);
   }
   // JS_FreeValueRT(rt, val);
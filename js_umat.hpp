@@ -7,6 +7,7 @@
 #include "js_mat.hpp"
 #include "js_typed_array.hpp"
 #include "include/jsbindings.hpp"
+#include "include/mat_accounting.hpp"
 #include <opencv2/core/mat.hpp>
 #include <opencv2/core/mat.inl.hpp>
 #include <opencv2/core/matx.hpp>
@@ -67,10 +68,13 @@ typed_input_array(TypedArrayProps& prop) {
 
 static inline JSValue
 js_umat_wrap(JSContext* ctx, const cv::UMat& umat) {
+  js_external_memory_check(ctx);
+
   JSValue ret = JS_NewObjectProtoClass(ctx, umat_proto, js_umat_class_id);
   JSUMatData* s = js_allocate<cv::UMat>(ctx);
 
   new(s) cv::UMat(umat);
+  matAccountingObject(MAT_ACCOUNTING_UMAT, 1);
 
   JS_SetOpaque(ret, s);
   return ret;
@@ -7,7 +7,9 @@
 #include <string>
 
 #include "include/jsbindings.hpp"
+#include "include/js_alloc.hpp"
 #include "include/js_converter.hpp"
+#include "include/mat_accounting.hpp"
 
 extern "C" {
 
@@ -46,8 +48,11 @@ public:
 
   VectorType* vec;
 
-  JSVector() : vec(new VectorType()) {}
-  ~JSVector() { delete vec; }
+  JSVector() : vec(new VectorType()) { matAccountingObject(MAT_ACCOUNTING_VECTOR, 1); }
+  ~JSVector() {
+    delete vec;
+    matAccountingObject(MAT_ACCOUNTING_VECTOR, -1);
+  }
 
   /**
    * @brief Get the class ID for this vector type
@@ -88,6 +93,8 @@ public:
    * @brief Create a new JS object wrapping this vector
    */
   JSValue toJS(JSContext* ctx) {
+    js_external_memory_check(ctx);
+
     JSValue obj = JS_NewObjectClass(ctx, get_class_id());
 
     if(JS_IsException(obj)) {
@@ -104,6 +111,9 @@ public:
    */
   static JSValue constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst* argv) {
     JSClassID class_id = get_class_id();
+
+    js_external_memory_check(ctx);
+
     JSValue obj = JS_NewObjectClass(ctx, class_id);
     if(JS_IsException(obj))
       return JS_EXCEPTION;
@@ -1,6 +1,9 @@
 #include "js_alloc.hpp"
+#include "js_cv.hpp"
 #include "js_array.hpp"
 #include "js_mat.hpp"
+#include "js_typed_array.hpp"
+#include "js_video_capture.hpp"
 #include "include/jsbindings.hpp"
 #include <opencv2/core.hpp>
 #include <opencv2/core/cvstd.hpp>
@@ -52,12 +55,30 @@ js_video_capture_open(JSContext* ctx, JSVideoCaptureData* s, int argc, JSValueCo
 
   std::cerr << "VideoCapture.open filename='" << filename << "', camID=" << camID << ", apiPreference=" << apiPreference << std::endl;
 
+  s->filename = filename;
+  s->seek_index.reset();
+  s->seek_index_failed = false;
+
   if(filename.empty())
     return s->open(camID, apiPreference, params);
 
   return s->open(filename, apiPreference, params);
 }
 
+/* Load the sidecar index of the opened file, or build (and save) it */
+static VideoSeekIndex*
+js_video_capture_seek_index(JSVideoCaptureData* s, const std::string& sidecar = std::string(), bool rebuild = false) {
+  if(s->filename.empty())
+    return nullptr;
+
+  if(rebuild || (!s->seek_index && !s->seek_index_failed)) {
+    s->seek_index = VideoSeekIndex::get(s->filename, sidecar, rebuild);
+    s->seek_index_failed = !s->seek_index;
+  }
+
+  return s->seek_index.get();
+}
+
 static JSValue
 js_video_capture_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
   JSVideoCaptureData* s;
@@ -72,7 +93,8 @@ js_video_capture_constructor(JSContext* ctx, JSValueConst new_target, int argc,
 
   if(argc > 0) {
     if(!js_video_capture_open(ctx, s, argc, argv)) {
-      delete s;
+      s->~JSVideoCaptureData();
+      js_deallocate(ctx, s);
       return JS_ThrowInternalError(ctx, "VideoCapture.open error");
     }
   }
@@ -117,7 +139,10 @@ enum {
   VIDEO_CAPTURE_METHOD_IS_OPENED,
   VIDEO_CAPTURE_METHOD_OPEN,
   VIDEO_CAPTURE_METHOD_READ,
-  VIDEO_CAPTURE_METHOD_RETRIEVE
+  VIDEO_CAPTURE_METHOD_RETRIEVE,
+  VIDEO_CAPTURE_METHOD_SEEK,
+  VIDEO_CAPTURE_METHOD_BUILD_SEEK_INDEX,
+  VIDEO_CAPTURE_METHOD_KEYFRAMES,
 };
 
 static JSValue
@@ -193,13 +218,66 @@ js_video_capture_method(JSContext* ctx, JSValueConst video_capture, int argc, JS
       ret = JS_NewBool(ctx, s->retrieve(*m));
       break;
     }
+
+    case VIDEO_CAPTURE_METHOD_SEEK: {
+      int32_t frame;
+      VideoSeekIndex* index;
+
+      if(JS_ToInt32(ctx, &frame, argv[0]))
+        return JS_EXCEPTION;
+
+      try {
+        if((index = js_video_capture_seek_index(s)) && size_t(frame) < index->size())
+          ret = JS_NewBool(ctx, video_seek(*s, *index, frame));
+        else
+          ret = JS_NewBool(ctx, s->set(cv::CAP_PROP_POS_FRAMES, frame));
+      } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
+
+      break;
+    }
+
+    case VIDEO_CAPTURE_METHOD_BUILD_SEEK_INDEX: {
+      std::string sidecar;
+      bool rebuild = false;
+      VideoSeekIndex* index;
+
+      if(argc > 0 && !JS_IsUndefined(argv[0]))
+        js_value_to(ctx, argv[0], sidecar);
+
+      if(argc > 1)
+        rebuild = JS_ToBool(ctx, argv[1]);
+
+      try {
+        index = js_video_capture_seek_index(s, sidecar, rebuild);
+      } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
+
+      ret = JS_NewInt64(ctx, index ? index->size() : 0);
+      break;
+    }
+
+    case VIDEO_CAPTURE_METHOD_KEYFRAMES: {
+      VideoSeekIndex* index;
+
+      try {
+        index = js_video_capture_seek_index(s);
+      } catch(const cv::Exception& e) { return js_cv_throw(ctx, e); }
+
+      if(index) {
+        std::vector<int32_t> keyframes = index->keyframes();
+        ret = js_typedarray_from(ctx, keyframes.data(), keyframes.data() + keyframes.size());
+      } else {
+        ret = JS_NULL;
+      }
+
+      break;
+    }
   }
 
   return ret;
 }
 
 JSValue
-js_video_capture_wrap(JSContext* ctx, cv::VideoCapture* cap) {
+js_video_capture_wrap(JSContext* ctx, JSVideoCaptureData* cap) {
   JSValue ret;
 
   ret = JS_NewObjectProtoClass(ctx, video_capture_proto, js_video_capture_class_id);
@@ -225,6 +303,9 @@ const JSCFunctionListEntry js_video_capture_proto_funcs[] = {
     JS_CFUNC_MAGIC_DEF("open", 1, js_video_capture_method, VIDEO_CAPTURE_METHOD_OPEN),
     JS_CFUNC_MAGIC_DEF("read", 1, js_video_capture_method, VIDEO_CAPTURE_METHOD_READ),
     JS_CFUNC_MAGIC_DEF("retrieve", 1, js_video_capture_method, VIDEO_CAPTURE_METHOD_RETRIEVE),
+    JS_CFUNC_MAGIC_DEF("seek", 1, js_video_capture_method, VIDEO_CAPTURE_METHOD_SEEK),
+    JS_CFUNC_MAGIC_DEF("buildSeekIndex", 0, js_video_capture_method, VIDEO_CAPTURE_METHOD_BUILD_SEEK_INDEX),
+    JS_CFUNC_MAGIC_DEF("keyframes", 0, js_video_capture_method, VIDEO_CAPTURE_METHOD_KEYFRAMES),
 
     JS_PROP_STRING_DEF("[Symbol.toStringTag]", "VideoCapture", JS_PROP_CONFIGURABLE),
 
@@ -0,0 +1,31 @@
+#ifndef JS_VIDEO_CAPTURE_HPP
+#define JS_VIDEO_CAPTURE_HPP
+
+#include "include/jsbindings.hpp"
+#include "include/video_index.hpp"
+#include <opencv2/videoio.hpp>
+#include <quickjs.h>
+#include <memory>
+#include <string>
+
+/**
+ * @brief cv::VideoCapture plus the file it was opened from, so seek() can
+ * lazily attach the file's VideoSeekIndex (include/video_index.hpp).
+ */
+struct JSVideoCaptureData : public cv::VideoCapture {
+  std::string filename;
+  std::shared_ptr<VideoSeekIndex> seek_index;
+  /* no index can be built for this file, don't try on every seek() */
+  bool seek_index_failed = false;
+};
+
+extern "C" int js_video_capture_init(JSContext*, JSModuleDef*);
+
+extern "C" {
+extern thread_local JSValue video_capture_proto, video_capture_class;
+extern thread_local JSClassID js_video_capture_class_id;
+
+JSVideoCaptureData* js_video_capture_data2(JSContext*, JSValueConst val);
+}
+
+#endif /* defined(JS_VIDEO_CAPTURE_HPP) */
@@ -49,7 +49,10 @@
 #include <cfloat>
 
 #include <iostream>
+#include <mutex>
 
+#include <opencv2/core/hal/hal.hpp>
+#include <opencv2/core/utility.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp> // Only for imshow
 
@@ -325,13 +328,19 @@ public:
   bool intersection(cv::InputArray line1, cv::InputArray line2, cv::Point& P);
 
 private:
-  cv::Mat image;
-  Mat_<double> scaled_image;
-  double* scaled_image_data;
-  Mat_<double> angles; // in rads
-  double* angles_data;
-  Mat_<double> modgrad;
-  double* modgrad_data;
+  // Working images are single precision and kept across detect() calls, so
+  // frames of an unchanged size allocate nothing. Norms are rounded to float
+  // and angles come from fastAtan32f, so a pixel close to the threshold, a
+  // bin edge or the angle tolerance may land on the other side than in the
+  // double reference. checkReference() in tests/accuracy_test.cpp measures
+  // how far segments move against lsd 1.6.
+  cv::Mat image, gaussian_img;
+  Mat_<float> scaled_image;
+  float* scaled_image_data;
+  Mat_<float> angles; // in rads
+  float* angles_data;
+  Mat_<float> modgrad;
+  float* modgrad_data;
   Mat_<uchar> used;
 
   int img_width;
@@ -374,6 +383,10 @@ private:
     double p;              // probability of a point with angle within 'prec'
   };
 
+  std::vector<coorlist> list;
+  std::vector<coorlist*> range_s, range_e;
+  std::vector<RegionPoint> reg;
+
   LSDImpl& operator=(const LSDImpl&); // to quiet MSVC
 
   // Used in the angle_filtering routine.
@@ -397,13 +410,14 @@ private:
 
   /**
    * Finds the angles and the gradients of the image. Generates a list of pseudo ordered points.
+   * Rows are processed in parallel.
    *
    * @param threshold The minimum value of the angle that is considered defined, otherwise NOTDEF
    * @param n_bins    The number of bins with which gradients are ordered by, using bucket sort.
-   * @param list      Return: Vector of coordinate points that are pseudo ordered by magnitude.
+   * @param points    Return: Vector of coordinate points that are pseudo ordered by magnitude.
    *                  Pixels would be ordered by norm value, up to a precision given by max_grad/n_bins.
    */
-  void ll_angle(const double& threshold, const unsigned int& n_bins, std::vector<coorlist>& list);
+  void ll_angle(const double& threshold, const unsigned int& n_bins, std::vector<coorlist>& points);
 
   /**
    * Grow a region starting from point s with a defined precision,
@@ -541,11 +555,11 @@ LSDImpl::LSDImpl(int _refine,
 void
 cv::LSDImpl::detect(
     const cv::InputArray _image, cv::OutputArray _lines, cv::OutputArray _width, cv::OutputArray _prec, cv::OutputArray _nfa) {
-  Mat_<double> img = _image.getMat();
+  cv::Mat img = _image.getMat();
   CV_Assert(!img.empty() && img.channels() == 1);
 
-  // Convert image to double
-  img.convertTo(image, CV_64FC1);
+  // Convert image to float
+  img.convertTo(image, CV_32FC1);
 
   std::vector<cv::Vec4i> lines;
   std::vector<double> w, p, n;
@@ -577,9 +591,7 @@ cv::LSDImpl::flsd(std::vector<cv::Vec4i>& lines,
   const double p = ANG_TH / 180;
   const double rho = QUANT / sin(prec); // gradient magnitude threshold
 
-  std::vector<coorlist> list;
   if(SCALE != 1) {
-    cv::Mat gaussian_img;
     const double sigma = (SCALE < 1) ? (SIGMA_SCALE / SCALE) : (SIGMA_SCALE);
     const double sprec = 3;
     const unsigned int h = (unsigned int)(ceil(sigma * sqrt(2 * sprec * log(10.0))));
@@ -598,8 +610,9 @@ cv::LSDImpl::flsd(std::vector<cv::Vec4i>& lines,
 
   // // Initialize region only when needed
   // cv::Mat region = cv::Mat::zeros(scaled_image.size(), CV_8UC1);
-  used = Mat_<uchar>::zeros(scaled_image.size()); // zeros = NOTUSED
-  std::vector<RegionPoint> reg(img_width * img_height);
+  used.create(scaled_image.size());
+  used.setTo(NOTUSED);
+  reg.resize(img_width * img_height);
 
   // Search for line segments
   unsigned int ls_count = 0;
@@ -672,14 +685,14 @@ cv::LSDImpl::flsd(std::vector<cv::Vec4i>& lines,
 }
 
 void
-cv::LSDImpl::ll_angle(const double& threshold, const unsigned int& n_bins, std::vector<coorlist>& list) {
+cv::LSDImpl::ll_angle(const double& threshold, const unsigned int& n_bins, std::vector<coorlist>& points) {
   // Initialize data
-  angles = Mat_<double>(scaled_image.size());
-  modgrad = Mat_<double>(scaled_image.size());
+  angles.create(scaled_image.size());
+  modgrad.create(scaled_image.size());
 
-  angles_data = angles.ptr<double>(0);
-  modgrad_data = modgrad.ptr<double>(0);
-  scaled_image_data = scaled_image.ptr<double>(0);
+  angles_data = angles.ptr<float>(0);
+  modgrad_data = modgrad.ptr<float>(0);
+  scaled_image_data = scaled_image.ptr<float>(0);
 
   img_width = scaled_image.cols;
   img_height = scaled_image.rows;
@@ -691,47 +704,70 @@ cv::LSDImpl::ll_angle(const double& threshold, const unsigned int& n_bins, std::
   // Computing gradient for remaining pixels
   CV_Assert(scaled_image.isContinuous() && modgrad.isContinuous() && angles.isContinuous()); // Accessing image data linearly
 
-  double max_grad = -1;
-  for(int y = 0; y < img_height - 1; ++y) {
-    for(int addr = y * img_width, addr_end = addr + img_width - 1; addr < addr_end; ++addr) {
-      double DA = scaled_image_data[addr + img_width + 1] - scaled_image_data[addr];
-      double BC = scaled_image_data[addr + 1] - scaled_image_data[addr + img_width];
-      double gx = DA + BC;                              // gradient x component
-      double gy = DA - BC;                              // gradient y component
-      double norm = std::sqrt((gx * gx + gy * gy) / 4); // gradient norm
+  float max_grad = -1;
+  std::mutex max_lock;
 
-      modgrad_data[addr] = norm; // store gradient
+  cv::parallel_for_(cv::Range(0, img_height - 1), [&](const cv::Range& range) {
+    static thread_local std::vector<float> buffer;
+    const int n = img_width - 1;
+    float local_max = -1;
 
-      if(norm <= threshold) // norm too small, gradient no defined
-      {
-        angles_data[addr] = NOTDEF;
-      } else {
-        angles_data[addr] = cv::fastAtan2(float(gx), float(-gy)) * DEG_TO_RADS; // gradient angle computation
-        if(norm > max_grad) {
-          max_grad = norm;
-        }
+    buffer.resize(n * 2);
+
+    float *gx = buffer.data(), *ngy = gx + n;
+
+    for(int y = range.start; y < range.end; ++y) {
+      const float* row = scaled_image_data + y * img_width;
+      const float* next = row + img_width;
+      float* norm = modgrad_data + y * img_width;
+      float* angle = angles_data + y * img_width;
+
+      for(int x = 0; x < n; ++x) {
+        float DA = next[x + 1] - row[x];
+        float BC = row[x + 1] - next[x];
+
+        gx[x] = DA + BC;  // gradient x component
+        ngy[x] = BC - DA; // negated gradient y component
+      }
+
+      // gradient norm sqrt((gx^2 + gy^2) / 4) and angle atan2(gx, -gy), both vectorized
+      cv::hal::magnitude32f(gx, ngy, norm, n);
+      cv::hal::fastAtan32f(gx, ngy, angle, n, false);
+
+      for(int x = 0; x < n; ++x) {
+        norm[x] *= 0.5f;
+
+        if(norm[x] <= threshold) // norm too small, gradient no defined
+          angle[x] = NOTDEF;
+        else if(norm[x] > local_max)
+          local_max = norm[x];
       }
     }
-  }
+
+    std::lock_guard<std::mutex> guard(max_lock);
+
+    if(local_max > max_grad)
+      max_grad = local_max;
+  });
 
   // Compute histogram of gradient values
-  list = std::vector<coorlist>(img_width * img_height);
-  std::vector<coorlist*> range_s(n_bins);
-  std::vector<coorlist*> range_e(n_bins);
+  points.resize(img_width * img_height);
+  range_s.assign(n_bins, nullptr);
+  range_e.assign(n_bins, nullptr);
   unsigned int count = 0;
   double bin_coef = (max_grad > 0) ? double(n_bins - 1) / max_grad : 0; // If all image is smooth, max_grad <= 0
 
   for(int y = 0; y < img_height - 1; ++y) {
-    const double* norm = modgrad_data + y * img_width;
+    const float* norm = modgrad_data + y * img_width;
     for(int x = 0; x < img_width - 1; ++x, ++norm) {
       // Store the point in the right bin according to its norm
       int i = int((*norm) * bin_coef);
       if(!range_e[i]) {
-        range_e[i] = range_s[i] = &list[count];
+        range_e[i] = range_s[i] = &points[count];
         ++count;
       } else {
-        range_e[i]->next = &list[count];
-        range_e[i] = &list[count];
+        range_e[i]->next = &points[count];
+        range_e[i] = &points[count];
         ++count;
       }
       range_e[i]->p = cv::Point(x, y);
@@ -739,6 +775,9 @@ cv::LSDImpl::ll_angle(const double& threshold, const unsigned int& n_bins, std::
     }
   }
 
+  // Entries past the binned pixels are left at (0,0), as from a fresh vector
+  std::fill(points.begin() + count, points.end(), coorlist());
+
   // Sort
   int idx = n_bins - 1;
   for(; idx > 0 && !range_s[idx]; --idx)
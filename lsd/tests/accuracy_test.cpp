@@ -1,9 +1,12 @@
+#include <algorithm>
+#include <cfloat>
 #include <iostream>
 
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 #include <lsd_opencv.hpp>
+#include <lsd_wrap.hpp>
 
 using namespace std;
 
@@ -94,13 +97,71 @@ checkLines() {
   std::cout << "Lines Check   - Number of lines: " << lines.size() << " - " << numLines * 2 << " Wanted." << std::endl;
 }
 
+// Distance of the closest endpoint pair, either orientation
+static double
+endpointDistance(const cv::Vec4i& a, const lsdwrap::seg& b) {
+  double fwd = std::max(cv::norm(cv::Point2d(a[0] - b.x1, a[1] - b.y1)), cv::norm(cv::Point2d(a[2] - b.x2, a[3] - b.y2)));
+  double rev = std::max(cv::norm(cv::Point2d(a[0] - b.x2, a[1] - b.y2)), cv::norm(cv::Point2d(a[2] - b.x1, a[3] - b.y1)));
+  return std::min(fwd, rev);
+}
+
+// cv::LSD works in float with fastAtan32f; lsd 1.6 works in double. The port
+// has always sub-sampled differently, so segments are matched with a tolerance.
+bool
+checkReference() {
+  const double maxDistance = 3, minLength = 20, minMatched = 0.9;
+  cv::RNG rng(0x15d);
+  int matched = 0, total = 0;
+  double worst = 0;
+
+  for(int scene = 0; scene < 8; ++scene) {
+    cv::Mat image(sz, CV_8UC1, cv::Scalar::all(rng.uniform(0, 64)));
+
+    for(int i = 0; i < 12; ++i) {
+      cv::Point p1(rng.uniform(0, sz.width), rng.uniform(0, sz.height));
+      cv::Point p2(rng.uniform(0, sz.width), rng.uniform(0, sz.height));
+      cv::line(image, p1, p2, cv::Scalar::all(rng.uniform(128, 256)), rng.uniform(2, 6), cv::LINE_AA);
+    }
+
+    cv::GaussianBlur(image, image, cv::Size(3, 3), 0);
+
+    vector<cv::Vec4i> lines;
+    vector<lsdwrap::seg> reference;
+    lsdwrap::LsdWrap lsd_old;
+    cv::Ptr<cv::LSD> ls = cv::createLSDPtr(::LSD_REFINE_STD);
+
+    ls->detect(image, lines);
+    lsd_old.lsdw(image, reference);
+
+    for(const lsdwrap::seg& s : reference) {
+      if(cv::norm(cv::Point2d(s.x2 - s.x1, s.y2 - s.y1)) < minLength)
+        continue;
+
+      double best = DBL_MAX;
+      for(const cv::Vec4i& l : lines) best = std::min(best, endpointDistance(l, s));
+
+      ++total;
+      if(best <= maxDistance) {
+        ++matched;
+        worst = std::max(worst, best);
+      }
+    }
+  }
+
+  bool ok = total > 0 && matched >= minMatched * total;
+  std::cout << "Reference      - " << matched << " of " << total << " lsd 1.6 segments matched, worst endpoint " << worst
+            << " px - " << minMatched * 100 << "% within " << maxDistance << " px Wanted." << (ok ? "" : " FAILED") << std::endl;
+  return ok;
+}
+
 int
 main() {
+  bool ok = checkReference();
   checkWhiteNoise();
   checkConstantColor();
   checkRotatedRectangle();
   for(int i = 0; i < 10; ++i) { checkLines(); }
   checkLines();
   cv::waitKey();
-  return 0;
+  return ok ? 0 : 1;
 }
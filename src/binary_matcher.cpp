@@ -0,0 +1,379 @@
+#include "binary_matcher.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <utility>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/* a POPCNT build of the distance kernels next to the baseline one, chosen
+ * by the loader; HAVE_TARGET_CLONES is set by CMake where ifuncs link */
+#if defined(HAVE_TARGET_CLONES)
+#define BINARY_MATCHER_TARGETS __attribute__((target_clones("popcnt", "default")))
+#endif
+
+#ifndef BINARY_MATCHER_TARGETS
+#define BINARY_MATCHER_TARGETS
+#endif
+
+namespace {
+
+/* queries compared against one train block before moving on; the train
+ * block (2048 rows of 32 bytes = 64 KiB) stays in L2 meanwhile */
+const int query_block = 64, train_block = 2048;
+
+inline int
+popcount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcountll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  return int(__popcnt64(x));
+#else
+  x = x - ((x >> 1) & 0x5555555555555555ull);
+  x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+  x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+  return int((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+/* W words known at compile time (unrolled), 0: `words` at run time */
+template<int W>
+inline int
+hamming(const uint64_t* a, const uint64_t* b, int words) {
+  int d = 0;
+
+  for(int i = 0; i < (W ? W : words); ++i)
+    d += popcount64(a[i] ^ b[i]);
+
+  return d;
+}
+
+/* insert into one query's top-k, sorted by distance; ties keep the earlier row */
+inline void
+keep(int32_t* idx, int32_t* dist, int k, int32_t id, int32_t d) {
+  int i = k - 1;
+
+  while(i > 0 && dist[i - 1] > d) {
+    dist[i] = dist[i - 1];
+    idx[i] = idx[i - 1];
+    --i;
+  }
+
+  dist[i] = d;
+  idx[i] = id;
+}
+
+template<int W>
+inline void
+scan(const uint64_t* query, int nq, const uint64_t* train, int t0, int t1, int words, int k, int32_t* idx, int32_t* dist) {
+  for(int q = 0; q < nq; ++q) {
+    const uint64_t* a = query + size_t(q) * words;
+    int32_t *qi = idx + size_t(q) * k, *qd = dist + size_t(q) * k;
+
+    for(int t = t0; t < t1; ++t) {
+      int d = hamming<W>(a, train + size_t(t) * words, words);
+
+      if(d < qd[k - 1])
+        keep(qi, qd, k, t, d);
+    }
+  }
+}
+
+BINARY_MATCHER_TARGETS void
+knn_tile(const uint64_t* query, int nq, const uint64_t* train, int t0, int t1, int words, int k, int32_t* idx, int32_t* dist) {
+  switch(words) {
+    case 2: scan<2>(query, nq, train, t0, t1, words, k, idx, dist); break;   // 16 bytes: BRIEF-16
+    case 4: scan<4>(query, nq, train, t0, t1, words, k, idx, dist); break;   // 32 bytes: ORB, BRIEF-32, LATCH
+    case 8: scan<8>(query, nq, train, t0, t1, words, k, idx, dist); break;   // 61/64 bytes: AKAZE, BRISK, FREAK
+    default: scan<0>(query, nq, train, t0, t1, words, k, idx, dist); break;
+  }
+}
+
+BINARY_MATCHER_TARGETS void
+knn_candidates(const uint64_t* query, const uint64_t* train, const int32_t* ids, size_t n, int words, int k, int32_t* idx, int32_t* dist) {
+  for(size_t i = 0; i < n; ++i) {
+    int d = hamming<0>(query, train + size_t(ids[i]) * words, words);
+
+    if(d < dist[k - 1])
+      keep(idx, dist, k, ids[i], d);
+  }
+}
+
+void
+brute_knn(const uint64_t* query, int nq, const uint64_t* train, int nt, int words, int k, int32_t* idx, int32_t* dist) {
+  int blocks = (nq + query_block - 1) / query_block;
+
+  std::fill(idx, idx + size_t(nq) * k, -1);
+  std::fill(dist, dist + size_t(nq) * k, INT_MAX);
+
+  cv::parallel_for_(cv::Range(0, blocks), [&](const cv::Range& range) {
+    for(int b = range.start; b < range.end; ++b) {
+      int q0 = b * query_block, n = std::min(query_block, nq - q0);
+
+      for(int t0 = 0; t0 < nt; t0 += train_block)
+        knn_tile(query + size_t(q0) * words, n, train, t0, std::min(t0 + train_block, nt), words, k, idx + size_t(q0) * k, dist + size_t(q0) * k);
+    }
+  });
+}
+
+/* rows zero-padded to whole words: padding XORs to 0 and doesn't count */
+void
+pack(const cv::Mat& src, int words, std::vector<uint64_t>& dst) {
+  size_t base = dst.size();
+
+  dst.resize(base + size_t(src.rows) * words, 0);
+
+  for(int r = 0; r < src.rows; ++r)
+    std::memcpy(&dst[base + size_t(r) * words], src.ptr(r), src.cols);
+}
+
+} // namespace
+
+BinaryMatcher::BinaryMatcher(const LshParams& p) : params(p) {
+  params.tables = std::max(params.tables, 1);
+  params.keyBits = std::min(std::max(params.keyBits, 1), 32);
+  params.probes = std::min(std::max(params.probes, 0), 2);
+}
+
+void
+BinaryMatcher::add(const cv::Mat& descriptors) {
+  if(descriptors.empty())
+    return;
+
+  if(descriptors.type() != CV_8UC1)
+    CV_Error(cv::Error::StsUnsupportedFormat, "BinaryMatcher: descriptors must be CV_8UC1");
+
+  if(bytes && descriptors.cols != bytes)
+    CV_Error(cv::Error::StsBadArg, "BinaryMatcher: descriptors differ in width from the ones already added");
+
+  if(!bytes) {
+    bytes = descriptors.cols;
+    words = (bytes + 7) / 8;
+  }
+
+  pack(descriptors, words, train);
+  rows += descriptors.rows;
+  lsh_built = false;
+}
+
+void
+BinaryMatcher::clear() {
+  train.clear();
+  tables.clear();
+  bytes = words = rows = 0;
+  lsh_built = false;
+}
+
+uint32_t
+BinaryMatcher::hash(const Table& table, const uint64_t* row) const {
+  uint32_t key = 0;
+
+  for(size_t i = 0; i < table.bits.size(); ++i) {
+    int b = table.bits[i];
+
+    key |= uint32_t((row[b >> 6] >> (b & 63)) & 1) << i;
+  }
+
+  return key;
+}
+
+void
+BinaryMatcher::build_lsh() {
+  std::mt19937 rng(params.seed);
+  std::vector<uint16_t> positions(bytes * 8);
+  int bits = std::min(params.keyBits, bytes * 8);
+
+  std::iota(positions.begin(), positions.end(), 0);
+  tables.assign(params.tables, Table());
+
+  /* drawn up front, so the sampled bits don't depend on scheduling */
+  for(Table& table : tables) {
+    std::shuffle(positions.begin(), positions.end(), rng);
+    table.bits.assign(positions.begin(), positions.begin() + bits);
+  }
+
+  cv::parallel_for_(cv::Range(0, int(tables.size())), [&](const cv::Range& range) {
+    std::vector<std::pair<uint32_t, int32_t>> entries(rows);
+
+    for(int i = range.start; i < range.end; ++i) {
+      Table& table = tables[i];
+
+      for(int r = 0; r < rows; ++r)
+        entries[r] = std::make_pair(hash(table, &train[size_t(r) * words]), r);
+
+      std::sort(entries.begin(), entries.end());
+      table.keys.resize(rows);
+      table.ids.resize(rows);
+
+      for(int r = 0; r < rows; ++r) {
+        table.keys[r] = entries[r].first;
+        table.ids[r] = entries[r].second;
+      }
+    }
+  });
+
+  lsh_built = true;
+}
+
+void
+BinaryMatcher::lsh_knn(const uint64_t* query, int nq, int k, int32_t* idx, int32_t* dist) const {
+  std::fill(idx, idx + size_t(nq) * k, -1);
+  std::fill(dist, dist + size_t(nq) * k, INT_MAX);
+
+  cv::parallel_for_(cv::Range(0, nq), [&](const cv::Range& range) {
+    /* per worker thread: which rows this query has already seen */
+    static thread_local std::vector<uint32_t> stamp;
+    static thread_local std::vector<int32_t> candidates;
+    static thread_local uint32_t epoch = 0;
+
+    if(stamp.size() < size_t(rows))
+      stamp.resize(rows, 0);
+
+    for(int q = range.start; q < range.end; ++q) {
+      const uint64_t* a = query + size_t(q) * words;
+
+      if(++epoch == 0) {
+        std::fill(stamp.begin(), stamp.end(), 0);
+        epoch = 1;
+      }
+
+      candidates.clear();
+
+      for(const Table& table : tables) {
+        uint32_t key = hash(table, a);
+        int bits = int(table.bits.size());
+        auto visit = [&](uint32_t probe) {
+          auto bucket = std::equal_range(table.keys.begin(), table.keys.end(), probe);
+
+          for(auto it = bucket.first; it != bucket.second; ++it) {
+            int32_t id = table.ids[it - table.keys.begin()];
+
+            if(stamp[id] != epoch) {
+              stamp[id] = epoch;
+              candidates.push_back(id);
+            }
+          }
+        };
+
+        visit(key);
+
+        for(int i = 0; i < bits && params.probes >= 1; ++i) {
+          visit(key ^ (1u << i));
+
+          for(int j = i + 1; j < bits && params.probes >= 2; ++j)
+            visit(key ^ (1u << i) ^ (1u << j));
+        }
+      }
+
+      knn_candidates(a, train.data(), candidates.data(), candidates.size(), words, k, idx + size_t(q) * k, dist + size_t(q) * k);
+    }
+  });
+}
+
+void
+BinaryMatcher::pack_query(const cv::Mat& query, std::vector<uint64_t>& packed) const {
+  if(query.type() != CV_8UC1 || (rows > 0 && query.cols != bytes))
+    CV_Error(cv::Error::StsBadArg, "BinaryMatcher: query descriptors must be CV_8UC1 rows as wide as the train set");
+
+  packed.clear();
+
+  /* nothing to compare with (and no width to pack to): search() returns no matches */
+  if(rows == 0)
+    return;
+
+  pack(query, words, packed);
+}
+
+void
+BinaryMatcher::search(const uint64_t* query, int nq, int k, bool lsh, int32_t* idx, int32_t* dist) {
+  if(rows == 0) {
+    std::fill(idx, idx + size_t(nq) * k, -1);
+    std::fill(dist, dist + size_t(nq) * k, INT_MAX);
+    return;
+  }
+
+  if(lsh) {
+    if(!lsh_built)
+      build_lsh();
+
+    lsh_knn(query, nq, k, idx, dist);
+  } else {
+    brute_knn(query, nq, train.data(), rows, words, k, idx, dist);
+  }
+}
+
+void
+BinaryMatcher::knnMatch(const cv::Mat& query, int k, bool lsh, std::vector<int32_t>& trainIdx, std::vector<int32_t>& distance) {
+  std::vector<uint64_t> packed;
+
+  if(k < 1)
+    CV_Error(cv::Error::StsOutOfRange, "BinaryMatcher: k must be at least 1");
+
+  pack_query(query, packed);
+  trainIdx.resize(size_t(query.rows) * k);
+  distance.resize(size_t(query.rows) * k);
+  search(packed.data(), query.rows, k, lsh, trainIdx.data(), distance.data());
+
+  for(int32_t& d : distance)
+    if(d == INT_MAX)
+      d = -1;
+}
+
+void
+BinaryMatcher::match(const cv::Mat& query, float ratio, bool crossCheck, int maxDistance, bool lsh, std::vector<Match>& matches) {
+  std::vector<uint64_t> packed;
+  std::vector<int32_t> idx, dist;
+  bool ratio_test = ratio > 0 && ratio < 1;
+  int k = ratio_test ? 2 : 1;
+
+  matches.clear();
+  pack_query(query, packed);
+  idx.resize(size_t(query.rows) * k);
+  dist.resize(size_t(query.rows) * k);
+  search(packed.data(), query.rows, k, lsh, idx.data(), dist.data());
+
+  for(int q = 0; q < query.rows; ++q) {
+    const int32_t *qi = &idx[size_t(q) * k], *qd = &dist[size_t(q) * k];
+
+    if(qi[0] < 0 || (maxDistance >= 0 && qd[0] > maxDistance))
+      continue;
+
+    if(ratio_test && qi[1] >= 0 && !(qd[0] < ratio * qd[1]))
+      continue;
+
+    matches.push_back(Match{q, qi[0], qd[0]});
+  }
+
+  if(crossCheck && !matches.empty()) {
+    /* the nearest query of every matched train row, exhaustively */
+    std::vector<int32_t> rows_used, best, best_dist;
+    std::vector<uint64_t> reverse;
+
+    for(const Match& m : matches)
+      rows_used.push_back(m.trainIdx);
+
+    std::sort(rows_used.begin(), rows_used.end());
+    rows_used.erase(std::unique(rows_used.begin(), rows_used.end()), rows_used.end());
+    reverse.resize(rows_used.size() * words);
+
+    for(size_t i = 0; i < rows_used.size(); ++i)
+      std::memcpy(&reverse[i * words], &train[size_t(rows_used[i]) * words], words * sizeof(uint64_t));
+
+    best.resize(rows_used.size());
+    best_dist.resize(rows_used.size());
+    brute_knn(reverse.data(), int(rows_used.size()), packed.data(), query.rows, words, 1, best.data(), best_dist.data());
+
+    matches.erase(std::remove_if(matches.begin(),
+                                 matches.end(),
+                                 [&](const Match& m) {
+                                   size_t i = std::lower_bound(rows_used.begin(), rows_used.end(), m.trainIdx) - rows_used.begin();
+
+                                   return best[i] != m.queryIdx;
+                                 }),
+                  matches.end());
+  }
+}
@@ -0,0 +1,115 @@
+#include "blob_builder.hpp"
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/dnn.hpp>
+#include <opencv2/imgproc.hpp>
+#include <cmath>
+
+cv::Mat
+BlobBuilder::resize(const cv::Mat& image, Slot& slot, cv::Size target) const {
+  if(image.size() == target)
+    return image;
+
+  switch(paddingMode) {
+    case cv::dnn::DNN_PMODE_CROP_CENTER: {
+      double f = std::max(double(target.width) / image.cols, double(target.height) / image.rows);
+      cv::Size scaled(std::lround(image.cols * f), std::lround(image.rows * f));
+
+      cv::resize(image, slot.resized, scaled, 0, 0, cv::INTER_LINEAR);
+
+      return slot.resized(cv::Rect((scaled.width - target.width) / 2, (scaled.height - target.height) / 2, target.width, target.height));
+    }
+
+    case cv::dnn::DNN_PMODE_LETTERBOX: {
+      double f = std::min(double(target.width) / image.cols, double(target.height) / image.rows);
+      cv::Size scaled(std::lround(image.cols * f), std::lround(image.rows * f));
+
+      slot.canvas.create(target, image.type());
+      slot.canvas.setTo(borderValue);
+
+      /* resize() into a ROI header writes through to the canvas */
+      cv::Mat inner = slot.canvas(cv::Rect((target.width - scaled.width) / 2, (target.height - scaled.height) / 2, scaled.width, scaled.height));
+      cv::resize(image, inner, scaled, 0, 0, cv::INTER_LINEAR);
+      return slot.canvas;
+    }
+
+    default: {
+      cv::resize(image, slot.resized, target, 0, 0, cv::INTER_LINEAR);
+      return slot.resized;
+    }
+  }
+}
+
+void
+BlobBuilder::convert(const cv::Mat& src, Slot& slot, int index) const {
+  int channels = src.channels();
+  bool swap = swapRB && channels >= 3;
+
+  if(nhwc) {
+    cv::Mat out(src.size(), CV_MAKETYPE(ddepth, channels), blob.ptr(index));
+    cv::Mat& work = ddepth == CV_32F ? out : slot.work;
+    const cv::Mat* in = &src;
+
+    /* swap while still 8-bit, cvtColor() would copy for in-place use */
+    if(swap) {
+      static const int pairs[] = {0, 2, 1, 1, 2, 0, 3, 3};
+
+      slot.swapped.create(src.size(), src.type());
+      cv::mixChannels(&src, 1, &slot.swapped, 1, pairs, channels);
+      in = &slot.swapped;
+    }
+
+    in->convertTo(work, CV_32F);
+    cv::subtract(work, mean, work);
+    cv::multiply(work, scale, work);
+
+    if(&work != &out)
+      work.convertTo(out, ddepth);
+
+    return;
+  }
+
+  if(channels == 1)
+    slot.channels.assign(1, src);
+  else
+    cv::split(src, slot.channels);
+
+  for(int c = 0; c < channels; ++c) {
+    int from = swap && c != 1 && c < 3 ? 2 - c : c;
+    double alpha = scale[std::min(c, 3)];
+    cv::Mat plane(src.size(), ddepth, blob.ptr(index, c));
+
+    slot.channels[from].convertTo(plane, ddepth, alpha, -mean[std::min(c, 3)] * alpha);
+  }
+}
+
+const cv::Mat&
+BlobBuilder::build(const std::vector<cv::Mat>& images) {
+  int n = images.size();
+
+  CV_Assert(n > 0 && !images[0].empty());
+
+  cv::Size target = size.empty() ? images[0].size() : size;
+  int channels = images[0].channels();
+
+  for(const cv::Mat& image : images)
+    CV_Assert(!image.empty() && image.channels() == channels);
+
+  if(nhwc) {
+    int sizes[] = {n, target.height, target.width, channels};
+    blob.create(4, sizes, ddepth);
+  } else {
+    int sizes[] = {n, channels, target.height, target.width};
+    blob.create(4, sizes, ddepth);
+  }
+
+  if(slots.size() < size_t(n))
+    slots.resize(n);
+
+  cv::parallel_for_(cv::Range(0, n), [&](const cv::Range& range) {
+    for(int i = range.start; i < range.end; ++i)
+      convert(resize(images[i], slots[i], target), slots[i], i);
+  });
+
+  return blob;
+}
@@ -0,0 +1,214 @@
+#include "draw_list.hpp"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+
+namespace {
+
+cv::Rect
+point_bounds(const cv::Point* pts, size_t n) {
+  if(n == 0)
+    return cv::Rect();
+
+  cv::Point lo = pts[0], hi = pts[0];
+
+  for(size_t i = 1; i < n; ++i) {
+    lo.x = std::min(lo.x, pts[i].x);
+    lo.y = std::min(lo.y, pts[i].y);
+    hi.x = std::max(hi.x, pts[i].x);
+    hi.y = std::max(hi.y, pts[i].y);
+  }
+
+  return cv::Rect(lo.x, lo.y, hi.x - lo.x + 1, hi.y - lo.y + 1);
+}
+
+cv::Rect
+radius_bounds(cv::Point center, int rx, int ry) {
+  return cv::Rect(center.x - rx, center.y - ry, rx * 2 + 1, ry * 2 + 1);
+}
+
+} // namespace
+
+DrawList::Command&
+DrawList::push(Op op, const cv::Scalar& color, int thickness, int lineType, cv::Rect bounds) {
+  /* half the pen, plus a pixel of antialiasing on either side */
+  int margin = std::max(thickness, 1) / 2 + 2;
+  Command cmd;
+
+  cmd.op = op;
+  cmd.line_type = uint8_t(lineType);
+  cmd.flag = false;
+  cmd.thickness = thickness;
+  cmd.point = points.size();
+  cmd.count = 0;
+  cmd.param = params.size();
+  cmd.color = color;
+  cmd.bounds = cv::Rect(bounds.x - margin, bounds.y - margin, bounds.width + margin * 2, bounds.height + margin * 2);
+
+  commands.push_back(cmd);
+  return commands.back();
+}
+
+void
+DrawList::line(cv::Point a, cv::Point b, const cv::Scalar& color, int thickness, int lineType) {
+  cv::Point pts[2] = {a, b};
+
+  push(LINE, color, thickness, lineType, point_bounds(pts, 2)).count = 2;
+  points.insert(points.end(), pts, pts + 2);
+}
+
+void
+DrawList::rectangle(cv::Point a, cv::Point b, const cv::Scalar& color, int thickness, int lineType) {
+  cv::Point pts[2] = {a, b};
+
+  push(RECTANGLE, color, thickness, lineType, point_bounds(pts, 2)).count = 2;
+  points.insert(points.end(), pts, pts + 2);
+}
+
+void
+DrawList::circle(cv::Point center, int radius, const cv::Scalar& color, int thickness, int lineType) {
+  push(CIRCLE, color, thickness, lineType, radius_bounds(center, radius, radius)).count = 1;
+  points.push_back(center);
+  params.push_back(radius);
+}
+
+void
+DrawList::ellipse(cv::Point center, cv::Size axes, double angle, double startAngle, double endAngle, const cv::Scalar& color, int thickness, int lineType) {
+  int r = std::max(axes.width, axes.height);
+
+  push(ELLIPSE, color, thickness, lineType, radius_bounds(center, r, r)).count = 1;
+  points.push_back(center);
+  params.insert(params.end(), {double(axes.width), double(axes.height), angle, startAngle, endAngle});
+}
+
+void
+DrawList::polylines(const cv::Point* pts, size_t n, bool closed, const cv::Scalar& color, int thickness, int lineType) {
+  Command& cmd = push(POLYLINES, color, thickness, lineType, point_bounds(pts, n));
+
+  cmd.count = n;
+  cmd.flag = closed;
+  points.insert(points.end(), pts, pts + n);
+}
+
+void
+DrawList::fillPoly(const cv::Point* pts, size_t n, const cv::Scalar& color, int lineType) {
+  push(FILL_POLY, color, -1, lineType, point_bounds(pts, n)).count = n;
+  points.insert(points.end(), pts, pts + n);
+}
+
+void
+DrawList::text(const std::string& str, cv::Point org, int fontFace, double fontScale, const cv::Scalar& color, int thickness, int lineType, bool bottomLeftOrigin) {
+  int baseline = 0;
+  cv::Size size = cv::getTextSize(str, fontFace, fontScale, std::max(thickness, 1), &baseline);
+  /* covers both the upright and the flipped (bottomLeftOrigin) layout */
+  int extent = size.height + baseline;
+  Command& cmd = push(TEXT, color, thickness, lineType, cv::Rect(org.x, org.y - extent, size.width + 1, extent * 2 + 1));
+
+  cmd.count = 1;
+  cmd.flag = bottomLeftOrigin;
+  points.push_back(org);
+  params.insert(params.end(), {double(fontFace), fontScale, double(texts.size())});
+  texts.push_back(str);
+}
+
+void
+DrawList::clear() {
+  commands.clear();
+  points.clear();
+  params.clear();
+  texts.clear();
+}
+
+cv::Rect
+DrawList::bounds() const {
+  cv::Rect ret;
+
+  for(const Command& cmd : commands)
+    ret = ret.empty() ? cmd.bounds : (ret | cmd.bounds);
+
+  return ret;
+}
+
+void
+DrawList::draw(const Command& cmd, cv::Mat& dst, cv::Point shift) const {
+  const cv::Point* pts = points.data() + cmd.point;
+  const double* p = params.data() + cmd.param;
+
+  switch(cmd.op) {
+    case LINE: {
+      cv::line(dst, pts[0] + shift, pts[1] + shift, cmd.color, cmd.thickness, cmd.line_type);
+      break;
+    }
+
+    case RECTANGLE: {
+      cv::rectangle(dst, pts[0] + shift, pts[1] + shift, cmd.color, cmd.thickness, cmd.line_type);
+      break;
+    }
+
+    case CIRCLE: {
+      cv::circle(dst, pts[0] + shift, int(p[0]), cmd.color, cmd.thickness, cmd.line_type);
+      break;
+    }
+
+    case ELLIPSE: {
+      cv::ellipse(dst, pts[0] + shift, cv::Size(int(p[0]), int(p[1])), p[2], p[3], p[4], cmd.color, cmd.thickness, cmd.line_type);
+      break;
+    }
+
+    case POLYLINES:
+    case FILL_POLY: {
+      static thread_local std::vector<cv::Point> moved;
+      int n = cmd.count;
+
+      if(n == 0)
+        break;
+
+      moved.resize(n);
+
+      for(int i = 0; i < n; ++i)
+        moved[i] = pts[i] + shift;
+
+      const cv::Point* ptr = moved.data();
+
+      if(cmd.op == POLYLINES)
+        cv::polylines(dst, &ptr, &n, 1, cmd.flag, cmd.color, cmd.thickness, cmd.line_type);
+      else
+        cv::fillPoly(dst, &ptr, &n, 1, cmd.color, cmd.line_type);
+      break;
+    }
+
+    case TEXT: {
+      cv::putText(dst, texts[size_t(p[2])], pts[0] + shift, int(p[0]), p[1], cmd.color, cmd.thickness, cmd.line_type, cmd.flag);
+      break;
+    }
+  }
+}
+
+void
+DrawList::replay(cv::Mat& dst, cv::Point offset, cv::Rect clip, int bands) const {
+  cv::Rect area(0, 0, dst.cols, dst.rows);
+
+  clip = clip.empty() ? area : (clip & area);
+
+  if(clip.empty() || commands.empty())
+    return;
+
+  if(bands <= 0)
+    bands = cv::getNumThreads();
+
+  bands = std::max(1, std::min(bands, clip.height));
+
+  cv::parallel_for_(
+      cv::Range(0, bands),
+      [&](const cv::Range& range) {
+        for(int b = range.start; b < range.end; ++b) {
+          int y0 = clip.y + clip.height * b / bands, y1 = clip.y + clip.height * (b + 1) / bands;
+          cv::Rect band(clip.x, y0, clip.width, y1 - y0);
+          cv::Mat roi = dst(band);
+
+          for(const Command& cmd : commands)
+            if(!((cmd.bounds + offset) & band).empty())
+              draw(cmd, roi, offset - band.tl());
+        }
+      },
+      bands);
+}
@@ -0,0 +1,383 @@
+#include "flann_index_matcher.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const char flann_index_magic[8] = {'Q', 'J', 'S', 'F', 'L', 'N', 'N', '1'};
+
+/* data pages start on this boundary, so the mapping can hand them out as is */
+const uint64_t flann_index_align = 4096;
+
+struct FlannIndexFooter {
+  char magic[8];
+  int32_t rows, cols, type;
+  uint32_t starts_count;
+  uint64_t data_offset, starts_offset;
+  FlannIndexMatcher::Config config;
+};
+
+} // namespace
+
+FlannIndexMatcher::FlannIndexMatcher(const Config& c, int ch, double ratio) : config(c), checks(ch), rebuild_ratio(std::max(ratio, 0.0)) {}
+
+bool
+FlannIndexMatcher::binary() const {
+  return (indexed.empty() ? pending : indexed).depth() == CV_8U;
+}
+
+cv::DMatch
+FlannIndexMatcher::to_match(int row, float distance) const {
+  int img = int(std::upper_bound(starts.begin(), starts.end(), row) - starts.begin()) - 1;
+
+  return cv::DMatch(-1, row - starts[img], img, distance);
+}
+
+void
+FlannIndexMatcher::append(const cv::Mat& descriptors) {
+  const cv::Mat& ref = indexed.empty() ? pending : indexed;
+
+  if(!descriptors.empty()) {
+    if(descriptors.type() != CV_32F && descriptors.type() != CV_8U)
+      CV_Error(cv::Error::StsUnsupportedFormat, "FlannIndexMatcher: descriptors must be CV_32F or CV_8U");
+
+    if(!ref.empty() && (descriptors.cols != ref.cols || descriptors.type() != ref.type()))
+      CV_Error(cv::Error::StsBadArg, "FlannIndexMatcher: descriptors differ in size or type from the ones already added");
+  }
+
+  /* an empty set still takes an image index */
+  starts.push_back(indexed.rows + pending.rows);
+
+  if(!descriptors.empty())
+    pending.push_back(descriptors);
+}
+
+void
+FlannIndexMatcher::add(cv::InputArrayOfArrays descriptors) {
+  if(descriptors.isMatVector() || descriptors.isUMatVector()) {
+    std::vector<cv::Mat> sets;
+
+    descriptors.getMatVector(sets);
+
+    for(const cv::Mat& set : sets)
+      append(set);
+  } else {
+    append(descriptors.getMat());
+  }
+
+  collect();
+}
+
+/* getTrainDescriptors() gets every added set as a header on the rows stored
+ * now; rebuilt whenever indexed/pending are replaced, because a mapped
+ * `indexed` doesn't keep its pages alive */
+void
+FlannIndexMatcher::collect() {
+  int total = indexed.rows + pending.rows;
+
+  trainDescCollection.clear();
+
+  for(size_t i = 0; i < starts.size(); ++i) {
+    int start = starts[i], end = i + 1 < starts.size() ? starts[i + 1] : total;
+
+    if(start == end)
+      trainDescCollection.push_back(cv::Mat());
+    else if(start >= indexed.rows)
+      trainDescCollection.push_back(pending.rowRange(start - indexed.rows, end - indexed.rows));
+    else
+      trainDescCollection.push_back(indexed.rowRange(start, end));
+  }
+}
+
+void
+FlannIndexMatcher::clear() {
+  DescriptorMatcher::clear();
+  index.release();
+  indexed.release();
+  pending.release();
+  starts.clear();
+  mapping.reset();
+}
+
+bool
+FlannIndexMatcher::empty() const {
+  return indexed.empty() && pending.empty();
+}
+
+void
+FlannIndexMatcher::build() {
+  cv::Mat all;
+  cv::Ptr<cv::flann::IndexParams> params;
+  int32_t algorithm = config.algorithm;
+  bool bin = binary();
+
+  if(pending.empty())
+    all = indexed;
+  else if(indexed.empty())
+    all = pending;
+  else
+    cv::vconcat(indexed, pending, all);
+
+  if(all.empty()) {
+    index.release();
+    return;
+  }
+
+  if(algorithm == AUTO)
+    algorithm = bin ? LSH : KDTREE;
+
+  if(bin != (algorithm == LSH))
+    CV_Error(cv::Error::StsBadArg, bin ? "FlannIndexMatcher: binary descriptors need an LSH index" : "FlannIndexMatcher: LSH needs binary (CV_8U) descriptors");
+
+  switch(algorithm) {
+    case KDTREE: params = cv::makePtr<cv::flann::KDTreeIndexParams>(config.trees); break;
+    case KMEANS: params = cv::makePtr<cv::flann::KMeansIndexParams>(config.branching, config.iterations); break;
+    default: params = cv::makePtr<cv::flann::LshIndexParams>(config.tableNumber, config.keySize, config.multiProbeLevel); break;
+  }
+
+  index = cv::makePtr<cv::flann::Index>(all, *params, bin ? cvflann::FLANN_DIST_HAMMING : cvflann::FLANN_DIST_L2);
+
+  /* once pending rows were merged, the index no longer reads the mapped copy */
+  if(!pending.empty())
+    mapping.reset();
+
+  indexed = all;
+  pending = cv::Mat();
+  collect();
+}
+
+void
+FlannIndexMatcher::train() {
+  if(pending.empty())
+    return;
+
+  if(!index || pending.rows > rebuild_ratio * indexed.rows)
+    build();
+}
+
+cv::Ptr<cv::DescriptorMatcher>
+FlannIndexMatcher::clone(bool emptyTrainData) const {
+  cv::Ptr<FlannIndexMatcher> ret = cv::makePtr<FlannIndexMatcher>(config, checks, rebuild_ratio);
+
+  if(!emptyTrainData) {
+    /* the index and the indexed rows are never modified, only replaced */
+    ret->index = index;
+    ret->indexed = indexed;
+    ret->pending = pending.clone();
+    ret->starts = starts;
+    ret->mapping = mapping;
+    ret->collect();
+  }
+
+  return ret;
+}
+
+void
+FlannIndexMatcher::knnMatchImpl(cv::InputArray queryDescriptors, std::vector<std::vector<cv::DMatch>>& matches, int k, cv::InputArrayOfArrays, bool compactResult) {
+  cv::Mat query = queryDescriptors.getMat(), idx, dist, pidx, pdist;
+  std::vector<cv::DMatch> row;
+  bool bin = binary();
+
+  matches.clear();
+
+  if(query.empty() || empty())
+    return;
+
+  if(query.type() != (indexed.empty() ? pending : indexed).type())
+    CV_Error(cv::Error::StsBadArg, "FlannIndexMatcher: query descriptors differ in type from the training set");
+
+  if(index && !indexed.empty())
+    index->knnSearch(query, idx, dist, std::min(k, indexed.rows), cv::flann::SearchParams(checks));
+
+  if(!pending.empty())
+    cv::batchDistance(query, pending, pdist, bin ? CV_32S : CV_32F, pidx, bin ? cv::NORM_HAMMING : cv::NORM_L2, std::min(k, pending.rows));
+
+  matches.reserve(query.rows);
+
+  for(int q = 0; q < query.rows; ++q) {
+    row.clear();
+
+    for(int j = 0; j < idx.cols; ++j) {
+      int r = idx.at<int>(q, j);
+
+      /* FLANN reports squared L2 distances */
+      if(r >= 0)
+        row.push_back(to_match(r, dist.depth() == CV_32S ? float(dist.at<int>(q, j)) : std::sqrt(dist.at<float>(q, j))));
+    }
+
+    for(int j = 0; j < pidx.cols; ++j) {
+      int r = pidx.at<int>(q, j);
+
+      if(r >= 0)
+        row.push_back(to_match(indexed.rows + r, pdist.depth() == CV_32S ? float(pdist.at<int>(q, j)) : pdist.at<float>(q, j)));
+    }
+
+    std::stable_sort(row.begin(), row.end());
+
+    if(int(row.size()) > k)
+      row.resize(k);
+
+    if(row.empty() && compactResult)
+      continue;
+
+    for(cv::DMatch& m : row)
+      m.queryIdx = q;
+
+    matches.push_back(row);
+  }
+}
+
+void
+FlannIndexMatcher::radiusMatchImpl(cv::InputArray queryDescriptors, std::vector<std::vector<cv::DMatch>>& matches, float maxDistance, cv::InputArrayOfArrays, bool compactResult) {
+  cv::Mat query = queryDescriptors.getMat(), idx, dist, pdist;
+  std::vector<cv::DMatch> row;
+  bool bin = binary();
+  /* result rows are allocated at maxResults: start small, grow only when a query fills them */
+  int limit = std::min(indexed.rows, 64);
+
+  matches.clear();
+
+  if(query.empty() || empty())
+    return;
+
+  if(query.type() != (indexed.empty() ? pending : indexed).type())
+    CV_Error(cv::Error::StsBadArg, "FlannIndexMatcher: query descriptors differ in type from the training set");
+
+  if(!pending.empty())
+    cv::batchDistance(query, pending, pdist, bin ? CV_32S : CV_32F, cv::noArray(), bin ? cv::NORM_HAMMING : cv::NORM_L2);
+
+  matches.reserve(query.rows);
+
+  for(int q = 0; q < query.rows; ++q) {
+    row.clear();
+
+    if(index && !indexed.empty()) {
+      double radius = bin ? double(maxDistance) : double(maxDistance) * maxDistance;
+      int found;
+
+      while((found = index->radiusSearch(query.row(q), idx, dist, radius, limit, cv::flann::SearchParams(checks))) >= limit && limit < indexed.rows)
+        limit = std::min(indexed.rows, std::max(found + 1, limit * 4));
+
+      for(int j = 0; j < std::min(found, idx.cols); ++j) {
+        int r = idx.at<int>(0, j);
+
+        if(r >= 0)
+          row.push_back(to_match(r, dist.depth() == CV_32S ? float(dist.at<int>(0, j)) : std::sqrt(dist.at<float>(0, j))));
+      }
+    }
+
+    for(int j = 0; j < pdist.cols; ++j) {
+      float d = pdist.depth() == CV_32S ? float(pdist.at<int>(q, j)) : pdist.at<float>(q, j);
+
+      if(d <= maxDistance)
+        row.push_back(to_match(indexed.rows + j, d));
+    }
+
+    std::stable_sort(row.begin(), row.end());
+
+    if(row.empty() && compactResult)
+      continue;
+
+    for(cv::DMatch& m : row)
+      m.queryIdx = q;
+
+    matches.push_back(row);
+  }
+}
+
+void
+FlannIndexMatcher::saveIndex(const std::string& path) {
+  std::string tmp = path + ".tmp";
+  FlannIndexFooter footer;
+  FILE* out;
+  long end;
+  bool ok;
+
+  if(!pending.empty() || !index)
+    build();
+
+  if(!index)
+    CV_Error(cv::Error::StsBadArg, "FlannIndexMatcher: nothing to save");
+
+  /* FLANN's own index file comes first, so cv::flann::Index::load() can read it from `path` */
+  index->save(tmp);
+
+  if(!(out = std::fopen(tmp.c_str(), "ab")) || std::fseek(out, 0, SEEK_END) || (end = std::ftell(out)) < 0) {
+    if(out)
+      std::fclose(out);
+
+    std::remove(tmp.c_str());
+    CV_Error(cv::Error::StsError, "FlannIndexMatcher: cannot write " + tmp);
+  }
+
+  std::memset(&footer, 0, sizeof(footer));
+  std::memcpy(footer.magic, flann_index_magic, sizeof(footer.magic));
+  footer.rows = indexed.rows;
+  footer.cols = indexed.cols;
+  footer.type = indexed.type();
+  footer.starts_count = starts.size();
+  footer.data_offset = (uint64_t(end) + flann_index_align - 1) / flann_index_align * flann_index_align;
+  footer.starts_offset = footer.data_offset + uint64_t(indexed.rows) * indexed.cols * indexed.elemSize();
+  footer.config = config;
+
+  ok = true;
+
+  for(uint64_t pad = footer.data_offset - end; pad > 0 && ok; --pad)
+    ok = std::fputc(0, out) != EOF;
+
+  for(int r = 0; r < indexed.rows && ok; ++r)
+    ok = std::fwrite(indexed.ptr(r), indexed.cols * indexed.elemSize(), 1, out) == 1;
+
+  ok = ok && (starts.empty() || std::fwrite(starts.data(), sizeof(int32_t), starts.size(), out) == starts.size());
+  ok = ok && std::fwrite(&footer, sizeof(footer), 1, out) == 1;
+  ok = std::fclose(out) == 0 && ok;
+
+  /* rename() is atomic, so a process loading the index never sees half a file */
+  if(!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    CV_Error(cv::Error::StsError, "FlannIndexMatcher: cannot write " + path);
+  }
+}
+
+void
+FlannIndexMatcher::loadIndex(const std::string& path) {
+  std::shared_ptr<const MappedFile> file = std::make_shared<const MappedFile>(path);
+  FlannIndexFooter footer;
+  cv::Ptr<cv::flann::Index> loaded;
+  cv::Mat data;
+  uint64_t data_size, footer_offset;
+
+  if(file->size < sizeof(footer))
+    CV_Error(cv::Error::StsParseError, "FlannIndexMatcher: not an index file: " + path);
+
+  footer_offset = file->size - sizeof(footer);
+  std::memcpy(&footer, file->data + footer_offset, sizeof(footer));
+
+  if(std::memcmp(footer.magic, flann_index_magic, sizeof(footer.magic)) || footer.rows <= 0 || footer.cols <= 0 || (footer.type != CV_32F && footer.type != CV_8U))
+    CV_Error(cv::Error::StsParseError, "FlannIndexMatcher: not an index file: " + path);
+
+  data_size = uint64_t(footer.rows) * footer.cols * CV_ELEM_SIZE(footer.type);
+
+  if(footer.data_offset % flann_index_align || footer.data_offset + data_size != footer.starts_offset || footer.starts_offset + uint64_t(footer.starts_count) * sizeof(int32_t) != footer_offset)
+    CV_Error(cv::Error::StsParseError, "FlannIndexMatcher: corrupt index file: " + path);
+
+  /* read-only pages: nothing writes to the indexed rows, build() copies them */
+  data = cv::Mat(footer.rows, footer.cols, footer.type, const_cast<char*>(file->data + footer.data_offset));
+  loaded = cv::makePtr<cv::flann::Index>();
+
+  if(!loaded->load(data, path))
+    CV_Error(cv::Error::StsParseError, "FlannIndexMatcher: cannot load the FLANN index in " + path);
+
+  DescriptorMatcher::clear();
+  config = footer.config;
+  index = loaded;
+  indexed = data;
+  pending = cv::Mat();
+  /* not necessarily 4-byte aligned after odd-sized binary rows */
+  starts.resize(footer.starts_count);
+  std::memcpy(starts.data(), file->data + footer.starts_offset, footer.starts_count * sizeof(int32_t));
+  mapping = file;
+  collect();
+}
@@ -0,0 +1,174 @@
+#include "homography_tracker.hpp"
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+
+namespace {
+
+cv::Mat
+to_gray(const cv::Mat& frame) {
+  cv::Mat gray;
+
+  if(frame.depth() != CV_8U)
+    CV_Error(cv::Error::StsUnsupportedFormat, "HomographyTracker: images must be 8-bit");
+
+  switch(frame.channels()) {
+    case 1: gray = frame; break;
+    case 3: cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY); break;
+    case 4: cv::cvtColor(frame, gray, cv::COLOR_BGRA2GRAY); break;
+    default: CV_Error(cv::Error::StsUnsupportedFormat, "HomographyTracker: images must have 1, 3 or 4 channels");
+  }
+
+  return gray;
+}
+
+} // namespace
+
+HomographyTracker::HomographyTracker(const Params& p) : params(p), orb(cv::ORB::create(p.features)) {}
+
+int
+HomographyTracker::setReference(const cv::Mat& image, const cv::Mat& mask) {
+  cv::Mat descriptors;
+
+  ref_keypoints.clear();
+  orb->detectAndCompute(to_gray(image), mask, ref_keypoints, descriptors);
+  matcher.clear();
+  matcher.add(descriptors);
+  reset();
+
+  return int(ref_keypoints.size());
+}
+
+void
+HomographyTracker::reset() {
+  ref_points.clear();
+  cur_points.clear();
+  prev_pyramid.clear();
+  since_detection = 0;
+}
+
+HomographyTracker::Result
+HomographyTracker::update(const cv::Mat& frame) {
+  Result result;
+  std::vector<cv::Mat> pyramid;
+  cv::Mat gray;
+  bool due = params.redetectInterval > 0 && since_detection >= params.redetectInterval;
+
+  if(ref_keypoints.empty())
+    CV_Error(cv::Error::StsError, "HomographyTracker: no reference keypoints");
+
+  gray = to_gray(frame);
+  /* built once per frame: tracked from now, and tracked from next frame */
+  cv::buildOpticalFlowPyramid(gray, pyramid, cv::Size(params.winSize, params.winSize), params.maxLevel);
+
+  if(cur_points.empty() || due || !track(gray, pyramid, result)) {
+    since_detection = 0;
+    redetect(gray, result);
+  }
+
+  ++since_detection;
+  prev_pyramid.swap(pyramid);
+
+  return result;
+}
+
+bool
+HomographyTracker::redetect(const cv::Mat& gray, Result& result) {
+  std::vector<cv::KeyPoint> keypoints;
+  std::vector<BinaryMatcher::Match> matches;
+  std::vector<cv::Point2f> ref, cur;
+  cv::Mat descriptors;
+
+  result = Result();
+  result.redetected = true;
+  ref_points.clear();
+  cur_points.clear();
+
+  orb->detectAndCompute(gray, cv::noArray(), keypoints, descriptors);
+
+  if(!descriptors.empty())
+    matcher.match(descriptors, params.ratio, true, -1, false, matches);
+
+  for(const BinaryMatcher::Match& m : matches) {
+    ref.push_back(ref_keypoints[m.trainIdx].pt);
+    cur.push_back(keypoints[m.queryIdx].pt);
+  }
+
+  result.tracked = int(matches.size());
+
+  if(!fit(ref, cur, result))
+    return false;
+
+  ref_points.swap(ref);
+  cur_points.swap(cur);
+  return true;
+}
+
+bool
+HomographyTracker::track(const cv::Mat& gray, const std::vector<cv::Mat>& pyramid, Result& result) {
+  std::vector<cv::Point2f> next;
+  std::vector<uchar> status;
+  std::vector<float> error;
+  size_t n = 0;
+
+  if(prev_pyramid.empty())
+    return false;
+
+  cv::calcOpticalFlowPyrLK(prev_pyramid, pyramid, cur_points, next, status, error, cv::Size(params.winSize, params.winSize), params.maxLevel);
+
+  for(size_t i = 0; i < status.size(); ++i) {
+    const cv::Point2f& p = next[i];
+
+    if(status[i] && p.x >= 0 && p.y >= 0 && p.x < gray.cols && p.y < gray.rows) {
+      ref_points[n] = ref_points[i];
+      next[n] = p;
+      ++n;
+    }
+  }
+
+  ref_points.resize(n);
+  next.resize(n);
+  result.tracked = int(n);
+
+  if(result.tracked < params.minTracked || !fit(ref_points, next, result))
+    return false;
+
+  if(result.inliers < params.minTracked || result.inliers < params.minInlierRatio * result.tracked)
+    return false;
+
+  cur_points.swap(next);
+  return true;
+}
+
+/* RANSAC over the pairs; on success only the inlier pairs are kept */
+bool
+HomographyTracker::fit(std::vector<cv::Point2f>& ref, std::vector<cv::Point2f>& cur, Result& result) const {
+  cv::Mat H, mask;
+  size_t n = 0;
+
+  result.found = false;
+  result.inliers = 0;
+
+  if(ref.size() < 4)
+    return false;
+
+  H = cv::findHomography(ref, cur, cv::RANSAC, params.ransacThreshold, mask);
+
+  if(H.empty())
+    return false;
+
+  for(size_t i = 0; i < ref.size(); ++i)
+    if(mask.at<uchar>(int(i))) {
+      ref[n] = ref[i];
+      cur[n] = cur[i];
+      ++n;
+    }
+
+  ref.resize(n);
+  cur.resize(n);
+
+  result.H = H;
+  result.inliers = int(n);
+  result.found = true;
+  return true;
+}
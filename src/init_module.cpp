@@ -5,10 +5,14 @@
 extern "C" int js_clahe_init(JSContext*, JSModuleDef*);
 extern "C" int js_cv_init(JSContext*, JSModuleDef*);
 extern "C" int js_draw_init(JSContext*, JSModuleDef*);
+extern "C" int js_svg_writer_init(JSContext*, JSModuleDef*);
+extern "C" int js_binary_matcher_init(JSContext*, JSModuleDef*);
+extern "C" int js_homography_tracker_init(JSContext*, JSModuleDef*);
 extern "C" int js_line_init(JSContext*, JSModuleDef*);
 extern "C" int js_mat_init(JSContext*, JSModuleDef*);
 extern "C" int js_affine3_init(JSContext*, JSModuleDef*);
 extern "C" int js_point_init(JSContext*, JSModuleDef*);
+extern "C" int js_point_array_init(JSContext*, JSModuleDef*);
 extern "C" int js_rect_init(JSContext*, JSModuleDef*);
 extern "C" int js_rotated_rect_init(JSContext*, JSModuleDef*);
 extern "C" int js_size_init(JSContext*, JSModuleDef*);
@@ -48,10 +52,14 @@ extern "C" int js_psimpl_init(JSContext*, JSModuleDef*);
 extern "C" void js_clahe_export(JSContext*, JSModuleDef*);
 extern "C" void js_cv_export(JSContext*, JSModuleDef*);
 extern "C" void js_draw_export(JSContext*, JSModuleDef*);
+extern "C" void js_svg_writer_export(JSContext*, JSModuleDef*);
+extern "C" void js_binary_matcher_export(JSContext*, JSModuleDef*);
+extern "C" void js_homography_tracker_export(JSContext*, JSModuleDef*);
 extern "C" void js_line_export(JSContext*, JSModuleDef*);
 extern "C" void js_mat_export(JSContext*, JSModuleDef*);
 extern "C" void js_affine3_export(JSContext*, JSModuleDef*);
 extern "C" void js_point_export(JSContext*, JSModuleDef*);
+extern "C" void js_point_array_export(JSContext*, JSModuleDef*);
 extern "C" void js_rect_export(JSContext*, JSModuleDef*);
 extern "C" void js_rotated_rect_export(JSContext*, JSModuleDef*);
 extern "C" void js_size_export(JSContext*, JSModuleDef*);
@@ -95,10 +103,14 @@ js_opencv_init(JSContext* ctx, JSModuleDef* m) {
   js_imgproc_init(ctx, m);
   js_clahe_init(ctx, m);
   js_draw_init(ctx, m);
+  js_svg_writer_init(ctx, m);
+  js_binary_matcher_init(ctx, m);
+  js_homography_tracker_init(ctx, m);
   js_line_init(ctx, m);
   js_mat_init(ctx, m);
   js_affine3_init(ctx, m);
   js_point_init(ctx, m);
+  js_point_array_init(ctx, m);
   js_rect_init(ctx, m);
   js_rotated_rect_init(ctx, m);
   js_size_init(ctx, m);
@@ -164,10 +176,14 @@ JS_INIT_MODULE(JSContext* ctx, const char* module_name) {
   js_imgproc_export(ctx, m);
   js_clahe_export(ctx, m);
   js_draw_export(ctx, m);
+  js_svg_writer_export(ctx, m);
+  js_binary_matcher_export(ctx, m);
+  js_homography_tracker_export(ctx, m);
   js_line_export(ctx, m);
   js_mat_export(ctx, m);
   js_affine3_export(ctx, m);
   js_point_export(ctx, m);
+  js_point_array_export(ctx, m);
   js_rect_export(ctx, m);
   js_rotated_rect_export(ctx, m);
   js_size_export(ctx, m);
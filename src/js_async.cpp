@@ -0,0 +1,208 @@
+#include "js_async.hpp"
+#include <exception>
+#include <string>
+#include <thread>
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* setTimeout and setReadHandler of the 'os' module, handed over by js_async_init() */
+static thread_local JSValue js_os_set_timeout = JS_UNDEFINED, js_os_set_read_handler = JS_UNDEFINED;
+
+/* A C module can't import another module's namespace directly. A tiny ES
+ * module imports the functions and passes them to this callback, which it
+ * finds on import.meta. */
+static const char js_os_import[] = "import { setTimeout, setReadHandler } from 'os';\n"
+                                   "import.meta.register(setTimeout, setReadHandler);\n";
+
+static JSValue
+js_os_register(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JSValue* fns[] = {&js_os_set_timeout, &js_os_set_read_handler};
+
+  for(int i = 0; i < argc && i < 2; ++i)
+    if(JS_IsFunction(ctx, argv[i])) {
+      JS_FreeValue(ctx, *fns[i]);
+      *fns[i] = JS_DupValue(ctx, argv[i]);
+    }
+
+  return JS_UNDEFINED;
+}
+
+void
+js_async_init(JSContext* ctx) {
+  JSValue func, meta, ret;
+
+  if(!JS_IsUndefined(js_os_set_read_handler))
+    return;
+
+  func = JS_Eval(ctx, js_os_import, sizeof(js_os_import) - 1, "<opencv:os>", JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
+
+  if(JS_IsException(func)) {
+    /* no 'os' module: js_async_run() and js_set_timeout() work without it */
+    JS_FreeValue(ctx, JS_GetException(ctx));
+    return;
+  }
+
+  meta = JS_GetImportMeta(ctx, static_cast<JSModuleDef*>(JS_VALUE_GET_PTR(func)));
+  JS_DefinePropertyValueStr(ctx, meta, "register", JS_NewCFunction(ctx, js_os_register, "register", 2), JS_PROP_CONFIGURABLE);
+  JS_FreeValue(ctx, meta);
+
+  if(JS_IsException(ret = JS_EvalFunction(ctx, func)))
+    JS_FreeValue(ctx, JS_GetException(ctx));
+
+  JS_FreeValue(ctx, ret);
+}
+
+static JSValue
+js_call_job(JSContext* ctx, int argc, JSValueConst argv[]) {
+  return JS_Call(ctx, argv[0], JS_UNDEFINED, 0, 0);
+}
+
+void
+js_set_timeout(JSContext* ctx, JSValueConst fn, double ms) {
+  if(JS_IsUndefined(js_os_set_timeout)) {
+    JS_EnqueueJob(ctx, js_call_job, 1, &fn);
+    return;
+  }
+
+  JSValue args[2] = {JS_DupValue(ctx, fn), JS_NewFloat64(ctx, ms)};
+  JSValue timer = JS_Call(ctx, js_os_set_timeout, JS_UNDEFINED, 2, args);
+
+  JS_FreeValue(ctx, args[0]);
+  JS_FreeValue(ctx, timer);
+}
+
+JSValue
+js_promise_new(JSContext* ctx, JSValue funcs[2]) {
+  return JS_NewPromiseCapability(ctx, funcs);
+}
+
+void
+js_promise_settle(JSContext* ctx, JSValue funcs[2], JSValue value, bool reject) {
+  JSValue ret = JS_Call(ctx, funcs[reject ? 1 : 0], JS_UNDEFINED, 1, &value);
+
+  JS_FreeValue(ctx, ret);
+  JS_FreeValue(ctx, value);
+  JS_FreeValue(ctx, funcs[0]);
+  JS_FreeValue(ctx, funcs[1]);
+  funcs[0] = funcs[1] = JS_UNDEFINED;
+}
+
+struct JSAsyncTask {
+  std::function<void()> work;
+  std::function<JSValue(JSContext*)> done;
+  JSValue funcs[2];
+  std::string error;
+  bool failed = false;
+
+  void run() {
+    try {
+      work();
+    } catch(const std::exception& e) {
+      error = e.what();
+      failed = true;
+    }
+  }
+};
+
+static void
+js_async_settle(JSContext* ctx, JSAsyncTask* task) {
+  if(task->failed) {
+    JSValue error = JS_NewError(ctx);
+
+    JS_DefinePropertyValueStr(ctx, error, "message", JS_NewString(ctx, task->error.c_str()), JS_PROP_CONFIGURABLE);
+    js_promise_settle(ctx, task->funcs, error, true);
+  } else {
+    JSValue result = task->done(ctx);
+
+    if(JS_IsException(result))
+      js_promise_settle(ctx, task->funcs, JS_GetException(ctx), true);
+    else
+      js_promise_settle(ctx, task->funcs, result);
+  }
+
+  delete task;
+}
+
+#ifndef _WIN32
+/* Finished tasks are handed back to the JS thread as pointers written to a
+ * pipe - writes up to PIPE_BUF bytes are atomic, so no further locking. */
+static thread_local int js_async_pipe[2] = {-1, -1};
+static thread_local size_t js_async_pending;
+
+static void js_async_read_handler(JSContext* ctx, bool install);
+
+static JSValue
+js_async_drain(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JSAsyncTask* tasks[64];
+  ssize_t r;
+
+  if((r = read(js_async_pipe[0], tasks, sizeof(tasks))) <= 0)
+    return JS_UNDEFINED;
+
+  for(size_t i = 0; i < r / sizeof(JSAsyncTask*); ++i) {
+    js_async_settle(ctx, tasks[i]);
+
+    if(--js_async_pending == 0)
+      js_async_read_handler(ctx, false);
+  }
+
+  return JS_UNDEFINED;
+}
+
+static void
+js_async_read_handler(JSContext* ctx, bool install) {
+  JSValue args[2] = {
+      JS_NewInt32(ctx, js_async_pipe[0]),
+      install ? JS_NewCFunction(ctx, js_async_drain, "drain", 0) : JS_NULL,
+  };
+
+  JS_FreeValue(ctx, JS_Call(ctx, js_os_set_read_handler, JS_UNDEFINED, 2, args));
+  JS_FreeValue(ctx, args[1]);
+}
+#endif
+
+JSValue
+js_async_run(JSContext* ctx, std::function<void()> work, std::function<JSValue(JSContext*)> done) {
+  JSAsyncTask* task = new JSAsyncTask{std::move(work), std::move(done)};
+  JSValue promise = js_promise_new(ctx, task->funcs);
+
+  if(JS_IsException(promise)) {
+    delete task;
+    return promise;
+  }
+
+#ifndef _WIN32
+  bool threaded = !JS_IsUndefined(js_os_set_read_handler);
+
+  if(threaded && js_async_pipe[0] == -1) {
+    if(pipe(js_async_pipe) == -1) {
+      threaded = false;
+    } else {
+      fcntl(js_async_pipe[0], F_SETFD, FD_CLOEXEC);
+      fcntl(js_async_pipe[1], F_SETFD, FD_CLOEXEC);
+    }
+  }
+
+  if(threaded) {
+    int fd = js_async_pipe[1];
+
+    if(js_async_pending++ == 0)
+      js_async_read_handler(ctx, true);
+
+    std::thread([task, fd]() {
+      task->run();
+
+      while(write(fd, &task, sizeof(task)) == -1 && errno == EINTR) {}
+    }).detach();
+
+    return promise;
+  }
+#endif
+
+  task->run();
+  js_async_settle(ctx, task);
+  return promise;
+}
@@ -2,6 +2,7 @@
 #include "include/js_inputoutputarray.hpp"
 #include "js_array.hpp"
 #include "js_umat.hpp"
+#include "mat_accounting.hpp"
 #include <quickjs.h>
 #include <algorithm>
 #include <cstdint>
@@ -121,6 +122,14 @@ js_ref(JSContext* ctx, const char* name, JSValueConst arg, JSValue value) {
   return 1;
 }
 
+void
+js_external_memory_check(JSContext* ctx) {
+  if(matAccountingPressure()) {
+    JS_RunGC(JS_GetRuntime(ctx));
+    matAccountingCollected();
+  }
+}
+
 int
 js_range_read(JSContext* ctx, JSValueConst value, cv::Range* range) {
   int ret = 0;
@@ -161,3 +170,146 @@ js_range_valid(JSContext* ctx, JSValueConst value) {
 
   return js_range_read(ctx, value, &r);
 }
+
+/**
+ * @brief Keep `mat` as an N x 1 2-channel point Mat: CV_32S and CV_32F as
+ * they are, CV_64F too if `keep_double`, anything else converted to
+ * CV_32F. False if `mat` is not a point list.
+ */
+static bool
+js_contour_push(cv::Mat mat, std::vector<cv::Mat>& contours, bool keep_double) {
+  int n;
+
+  if(mat.empty()) {
+    contours.emplace_back();
+    return true;
+  }
+
+  if((n = mat.checkVector(2)) < 0)
+    return false;
+
+  if(!mat.isContinuous())
+    mat = mat.clone();
+
+  mat = mat.reshape(2, n);
+
+  if(mat.depth() == CV_32S || mat.depth() == CV_32F || (keep_double && mat.depth() == CV_64F)) {
+    contours.push_back(mat);
+  } else {
+    cv::Mat converted;
+
+    mat.convertTo(converted, CV_32F);
+    contours.push_back(converted);
+  }
+
+  return true;
+}
+
+static bool
+js_contour_append(JSContext* ctx, JSValueConst value, std::vector<cv::Mat>& contours, bool keep_double) {
+  if(js_is_array(ctx, value)) {
+    std::vector<cv::Point2d> points;
+    cv::Mat mat;
+
+    js_array_to(ctx, value, points);
+
+    if(!points.empty())
+      cv::Mat(points).copyTo(mat);
+
+    return js_contour_push(mat, contours, keep_double);
+  }
+
+  JSInputOutputArray arr = js_cv_inputoutputarray(ctx, value);
+
+  return !js_is_noarray(arr) && js_contour_push(arr.getMat(), contours, keep_double);
+}
+
+bool
+js_contours_read(JSContext* ctx, JSValueConst value, std::vector<cv::Mat>& contours, JSValue& keep, bool keep_double) {
+  JSValue offsets;
+
+  if(js_is_array(ctx, value)) {
+    uint32_t length = js_array_length(ctx, value);
+
+    for(uint32_t i = 0; i < length; ++i) {
+      JSValue item = JS_GetPropertyUint32(ctx, value, i);
+      bool ok = js_contour_append(ctx, item, contours, keep_double);
+
+      JS_FreeValue(ctx, item);
+
+      if(!ok) {
+        JS_ThrowTypeError(ctx, "contour %u: expected Mat, PointVector, Point2fVector, PointArray, Contour or array", i);
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  if(JS_IsObject(value) && !JS_IsUndefined(offsets = JS_GetPropertyStr(ctx, value, "offsets"))) {
+    JSValue points = keep = JS_GetPropertyStr(ctx, value, "points");
+    bool valid = js_is_typedarray(ctx, points) && js_is_typedarray(ctx, offsets);
+
+    if(!valid) {
+      JS_FreeValue(ctx, offsets);
+      JS_ThrowTypeError(ctx, "Expected { points: TypedArray, offsets: TypedArray }");
+      return false;
+    }
+
+    TypedArrayType type = js_typedarray_type(ctx, points), otype = js_typedarray_type(ctx, offsets);
+    TypedArrayProps props = js_typedarray_props(ctx, points), oprops = js_typedarray_props(ctx, offsets);
+    const uint32_t* off = oprops.ptr<uint32_t>();
+    size_t count = oprops.size();
+    int mtype = -1;
+
+    JS_FreeValue(ctx, offsets);
+
+    if(type.is_floating_point && type.byte_size == 8)
+      mtype = CV_64FC2;
+    else if(type.is_floating_point && type.byte_size == 4)
+      mtype = CV_32FC2;
+    else if(type.byte_size == 4 && type.is_signed)
+      mtype = CV_32SC2;
+
+    if(mtype == -1) {
+      JS_ThrowTypeError(ctx, "points must be an Int32Array, Float32Array or Float64Array");
+      return false;
+    }
+
+    valid = otype.byte_size == 4 && !otype.is_floating_point && count > 0 && off[0] == 0 && size_t(off[count - 1]) * 2 <= props.size();
+
+    for(size_t i = 1; valid && i < count; ++i)
+      valid = off[i] >= off[i - 1];
+
+    if(!valid) {
+      JS_ThrowRangeError(ctx, "offsets must be a non-decreasing Int32Array/Uint32Array from 0 to at most points.length / 2");
+      return false;
+    }
+
+    uint8_t* base = props.ptr<uint8_t>();
+    size_t point_size = type.byte_size * 2;
+
+    for(size_t i = 0; i + 1 < count; ++i)
+      js_contour_push(cv::Mat(int(off[i + 1] - off[i]), 1, mtype, base + off[i] * point_size), contours, keep_double);
+
+    return true;
+  }
+
+  JSInputOutputArray arr = js_cv_inputoutputarray(ctx, value);
+  std::vector<cv::Mat> mats;
+
+  if(arr.kind() != cv::_InputArray::STD_VECTOR_VECTOR && arr.kind() != cv::_InputArray::STD_VECTOR_MAT) {
+    JS_ThrowTypeError(ctx, "Expected an array, MatVector, PointVectorVector, Point2fVectorVector or { points, offsets }");
+    return false;
+  }
+
+  arr.getMatVector(mats);
+
+  for(const cv::Mat& mat : mats)
+    if(!js_contour_push(mat, contours, keep_double)) {
+      JS_ThrowTypeError(ctx, "contour %zu: not a point list", contours.size());
+      return false;
+    }
+
+  return true;
+}
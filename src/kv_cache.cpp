@@ -0,0 +1,86 @@
+#include "kv_cache.hpp"
+#include <opencv2/core.hpp>
+
+/* CV_64S is new in OpenCV 5; before it, the ids are int32 */
+#if CV_VERSION_MAJOR >= 5
+typedef int64_t kv_index_t;
+#define KV_INDEX_TYPE CV_64S
+#else
+typedef int32_t kv_index_t;
+#define KV_INDEX_TYPE CV_32S
+#endif
+
+KVCache::KVCache(int layers, int heads, int headDim, int capacity, bool dummy)
+    : layers(layers), heads(heads), headDim(headDim), capacity(capacity), dummy(dummy) {
+  int sizes[] = {1, heads, capacity + offset(), headDim};
+
+  for(int i = 0; i < layers; ++i) {
+    keys.emplace_back(4, sizes, CV_32F, cv::Scalar::all(0));
+    values.emplace_back(4, sizes, CV_32F, cv::Scalar::all(0));
+  }
+}
+
+static cv::Mat
+kv_timesteps(const cv::Mat& m, int start, int end) {
+  cv::Range ranges[] = {cv::Range::all(), cv::Range::all(), cv::Range(start, end), cv::Range::all()};
+
+  return m(ranges);
+}
+
+cv::Mat
+KVCache::key(int layer) const {
+  return kv_timesteps(keys[layer], 0, offset() + length);
+}
+
+cv::Mat
+KVCache::value(int layer) const {
+  return kv_timesteps(values[layer], 0, offset() + length);
+}
+
+cv::Mat
+KVCache::attentionMask(int n) const {
+  cv::Mat mask(1, offset() + length + n, KV_INDEX_TYPE);
+
+  mask.setTo(cv::Scalar::all(1));
+
+  if(dummy)
+    mask.at<kv_index_t>(0, 0) = 0;
+
+  return mask;
+}
+
+cv::Mat
+KVCache::positionIds(int n) const {
+  cv::Mat ids(1, n, KV_INDEX_TYPE);
+
+  for(int i = 0; i < n; ++i)
+    ids.at<kv_index_t>(0, i) = length + i;
+
+  return ids;
+}
+
+void
+KVCache::append(const std::vector<cv::Mat>& present, int n) {
+  int start = offset() + length;
+
+  CV_Assert(present.size() == size_t(layers * 2));
+
+  if(length + n > capacity)
+    CV_Error(cv::Error::StsOutOfRange, "KVCache capacity exceeded");
+
+  for(int i = 0; i < layers * 2; ++i) {
+    const cv::Mat& src = present[i];
+    cv::Mat& store = (i & 1) ? values[i >> 1] : keys[i >> 1];
+
+    CV_Assert(src.dims == 4 && src.size[1] == heads && src.size[3] == headDim);
+    CV_Assert(src.size[2] == start + n);
+    CV_Assert(src.type() == CV_32F);
+
+    /* a header on the slots being filled - copyTo() writes through it */
+    cv::Mat dst = kv_timesteps(store, start, start + n);
+
+    kv_timesteps(src, start, start + n).copyTo(dst);
+  }
+
+  length += n;
+}
@@ -0,0 +1,382 @@
+#include "line_index.hpp"
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include <utility>
+
+namespace {
+
+typedef LineIndex::line_type line_type;
+typedef LineIndex::point_type point_type;
+
+double
+point_segment_distance2(const point_type& p, const point_type& a, const point_type& b) {
+  point_type d = b - a;
+  double l2 = d.dot(d), t = l2 > 0 ? std::clamp((p - a).dot(d) / l2, 0.0, 1.0) : 0.0;
+  point_type e = p - (a + d * t);
+
+  return e.dot(e);
+}
+
+double
+cross(const point_type& o, const point_type& a, const point_type& b) {
+  return (a - o).cross(b - o);
+}
+
+bool
+on_segment(const point_type& p, const point_type& a, const point_type& b) {
+  return std::min(a.x, b.x) <= p.x && p.x <= std::max(a.x, b.x) && std::min(a.y, b.y) <= p.y && p.y <= std::max(a.y, b.y);
+}
+
+bool
+segments_intersect(const line_type& s, const line_type& t) {
+  double d1 = cross(t.a, t.b, s.a), d2 = cross(t.a, t.b, s.b);
+  double d3 = cross(s.a, s.b, t.a), d4 = cross(s.a, s.b, t.b);
+
+  if(((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0)))
+    return true;
+
+  return (d1 == 0 && on_segment(s.a, t.a, t.b)) || (d2 == 0 && on_segment(s.b, t.a, t.b)) || (d3 == 0 && on_segment(t.a, s.a, s.b)) ||
+         (d4 == 0 && on_segment(t.b, s.a, s.b));
+}
+
+/* Liang–Barsky: does the segment enter the rectangle at all? */
+bool
+segment_in_rect(const line_type& l, const cv::Rect2d& r) {
+  double t0 = 0, t1 = 1;
+  double dx = l.b.x - l.a.x, dy = l.b.y - l.a.y;
+  double p[] = {-dx, dx, -dy, dy};
+  double q[] = {l.a.x - r.x, r.x + r.width - l.a.x, l.a.y - r.y, r.y + r.height - l.a.y};
+
+  for(int i = 0; i < 4; ++i) {
+    if(p[i] == 0) {
+      if(q[i] < 0)
+        return false;
+    } else {
+      double t = q[i] / p[i];
+
+      if(p[i] < 0)
+        t0 = std::max(t0, t);
+      else
+        t1 = std::min(t1, t);
+
+      if(t0 > t1)
+        return false;
+    }
+  }
+
+  return true;
+}
+
+} // namespace
+
+double
+LineIndex::distance(const line_type& s, const line_type& t) {
+  if(segments_intersect(s, t))
+    return 0;
+
+  double d = std::min(std::min(point_segment_distance2(s.a, t.a, t.b), point_segment_distance2(s.b, t.a, t.b)),
+                      std::min(point_segment_distance2(t.a, s.a, s.b), point_segment_distance2(t.b, s.a, s.b)));
+
+  return std::sqrt(d);
+}
+
+/* Calls f(cx, cy) for every cell the segment passes through, column by
+ * column, using the segment's y extent within each column. */
+template<class F>
+void
+LineIndex::traverse(const line_type& line, F&& f) const {
+  point_type a = line.a, b = line.b;
+
+  if(a.x > b.x)
+    std::swap(a, b);
+
+  double dx = b.x - a.x, eps = cell_size * 1e-9;
+  int cx0 = cell(a.x), cx1 = cell(b.x);
+
+  for(int cx = cx0; cx <= cx1; ++cx) {
+    double y0 = a.y, y1 = b.y;
+
+    if(dx > 0) {
+      double x0 = std::max(a.x, cx * cell_size), x1 = std::min(b.x, (cx + 1) * cell_size);
+
+      y0 = a.y + (b.y - a.y) * (x0 - a.x) / dx;
+      y1 = a.y + (b.y - a.y) * (x1 - a.x) / dx;
+    }
+
+    int cy0 = cell(std::min(y0, y1) - eps), cy1 = cell(std::max(y0, y1) + eps);
+
+    for(int cy = cy0; cy <= cy1; ++cy)
+      f(cx, cy);
+  }
+}
+
+/* Calls f(id) once per live segment registered in the cells [x0,x1]x[y0,y1],
+ * clipped to the occupied range. */
+template<class F>
+void
+LineIndex::visit(int x0, int y0, int x1, int y1, F&& f) const {
+  x0 = std::max(x0, min_cx);
+  y0 = std::max(y0, min_cy);
+  x1 = std::min(x1, max_cx);
+  y1 = std::min(y1, max_cy);
+
+  for(int cy = y0; cy <= y1; ++cy)
+    for(int cx = x0; cx <= x1; ++cx) {
+      auto it = cells.find(key(cx, cy));
+
+      if(it == cells.end())
+        continue;
+
+      for(int id : it->second)
+        if(seen[id] != epoch) {
+          seen[id] = epoch;
+
+          if(alive[id])
+            f(id);
+        }
+    }
+}
+
+void
+LineIndex::next_epoch() const {
+  if(seen.size() < lines.size())
+    seen.resize(lines.size(), epoch);
+
+  if(++epoch == 0) {
+    std::fill(seen.begin(), seen.end(), 0);
+    epoch = 1;
+  }
+}
+
+void
+LineIndex::clear() {
+  count = 0;
+  lines.clear();
+  alive.clear();
+  cells.clear();
+  seen.clear();
+  min_cx = min_cy = 0;
+  max_cx = max_cy = -1;
+}
+
+void
+LineIndex::build(const std::vector<line_type>& input) {
+  clear();
+
+  if(cell_size <= 0) {
+    double sum = 0;
+
+    for(const line_type& l : input)
+      sum += std::hypot(l.b.x - l.a.x, l.b.y - l.a.y);
+
+    cell_size = input.empty() ? 32 : std::max(1.0, sum / input.size());
+  }
+
+  lines.reserve(input.size());
+  alive.reserve(input.size());
+
+  for(const line_type& l : input)
+    insert(l);
+}
+
+int
+LineIndex::insert(const line_type& line) {
+  if(cell_size <= 0)
+    cell_size = std::max(1.0, std::hypot(line.b.x - line.a.x, line.b.y - line.a.y));
+
+  int id = lines.size();
+  bool empty = max_cx < min_cx;
+
+  lines.push_back(line);
+  alive.push_back(true);
+  ++count;
+
+  traverse(line, [&](int cx, int cy) {
+    cells[key(cx, cy)].push_back(id);
+
+    if(empty) {
+      min_cx = max_cx = cx;
+      min_cy = max_cy = cy;
+      empty = false;
+    } else {
+      min_cx = std::min(min_cx, cx);
+      min_cy = std::min(min_cy, cy);
+      max_cx = std::max(max_cx, cx);
+      max_cy = std::max(max_cy, cy);
+    }
+  });
+
+  return id;
+}
+
+bool
+LineIndex::remove(int id) {
+  if(!contains(id))
+    return false;
+
+  traverse(lines[id], [&](int cx, int cy) {
+    auto it = cells.find(key(cx, cy));
+
+    if(it == cells.end())
+      return;
+
+    std::vector<int>& ids = it->second;
+    ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+
+    if(ids.empty())
+      cells.erase(it);
+  });
+
+  alive[id] = false;
+  --count;
+  return true;
+}
+
+std::vector<int>
+LineIndex::nearest(const line_type& query, int k, int exclude, std::vector<double>* distances) const {
+  typedef std::pair<double, int> entry;
+  std::priority_queue<entry> best;
+  std::vector<int> ret;
+
+  if(k <= 0 || count == 0)
+    return ret;
+
+  next_epoch();
+
+  if(exclude >= 0 && size_t(exclude) < lines.size())
+    seen[exclude] = epoch;
+
+  int qx0 = cell(std::min(query.a.x, query.b.x)), qx1 = cell(std::max(query.a.x, query.b.x));
+  int qy0 = cell(std::min(query.a.y, query.b.y)), qy1 = cell(std::max(query.a.y, query.b.y));
+
+  auto consider = [&](int id) {
+    double d = distance(query, lines[id]);
+
+    if(int(best.size()) < k)
+      best.emplace(d, id);
+    else if(d < best.top().first) {
+      best.pop();
+      best.emplace(d, id);
+    }
+  };
+
+  /* rings that do not reach the occupied range hold nothing */
+  int start = std::max({0, min_cx - qx1, qx0 - max_cx, min_cy - qy1, qy0 - max_cy});
+
+  for(int ring = start;; ++ring) {
+    int x0 = qx0 - ring, y0 = qy0 - ring, x1 = qx1 + ring, y1 = qy1 + ring;
+
+    if(ring == start) {
+      visit(x0, y0, x1, y1, consider);
+    } else {
+      visit(x0, y0, x1, y0, consider);
+      visit(x0, y1, x1, y1, consider);
+      visit(x0, y0 + 1, x0, y1 - 1, consider);
+      visit(x1, y0 + 1, x1, y1 - 1, consider);
+    }
+
+    /* anything outside the rings seen so far is at least ring * cell_size away */
+    if(int(best.size()) == k && best.top().first <= ring * cell_size)
+      break;
+
+    if(x0 <= min_cx && y0 <= min_cy && x1 >= max_cx && y1 >= max_cy)
+      break;
+  }
+
+  ret.resize(best.size());
+
+  if(distances)
+    distances->resize(best.size());
+
+  for(size_t i = best.size(); i-- > 0; best.pop()) {
+    ret[i] = best.top().second;
+
+    if(distances)
+      (*distances)[i] = best.top().first;
+  }
+
+  return ret;
+}
+
+std::vector<int>
+LineIndex::radius(const line_type& query, double r, int exclude) const {
+  std::vector<int> ret;
+
+  if(count == 0 || r < 0)
+    return ret;
+
+  next_epoch();
+
+  if(exclude >= 0 && size_t(exclude) < lines.size())
+    seen[exclude] = epoch;
+
+  visit(cell(std::min(query.a.x, query.b.x) - r),
+        cell(std::min(query.a.y, query.b.y) - r),
+        cell(std::max(query.a.x, query.b.x) + r),
+        cell(std::max(query.a.y, query.b.y) + r),
+        [&](int id) {
+          if(distance(query, lines[id]) <= r)
+            ret.push_back(id);
+        });
+
+  std::sort(ret.begin(), ret.end());
+  return ret;
+}
+
+std::vector<int>
+LineIndex::box(const cv::Rect2d& rect) const {
+  std::vector<int> ret;
+
+  if(count == 0 || rect.width < 0 || rect.height < 0)
+    return ret;
+
+  next_epoch();
+
+  visit(cell(rect.x), cell(rect.y), cell(rect.x + rect.width), cell(rect.y + rect.height), [&](int id) {
+    if(segment_in_rect(lines[id], rect))
+      ret.push_back(id);
+  });
+
+  std::sort(ret.begin(), ret.end());
+  return ret;
+}
+
+std::vector<int>
+LineIndex::endpoints(const point_type& pt, double r, std::vector<int>* ends) const {
+  std::vector<std::pair<double, int>> found;
+  std::vector<int> ret;
+
+  if(count == 0 || r < 0)
+    return ret;
+
+  next_epoch();
+
+  double r2 = r * r;
+
+  visit(cell(pt.x - r), cell(pt.y - r), cell(pt.x + r), cell(pt.y + r), [&](int id) {
+    const line_type& l = lines[id];
+    point_type da = l.a - pt, db = l.b - pt;
+
+    if(da.dot(da) <= r2)
+      found.emplace_back(da.dot(da), id * 2);
+    if(db.dot(db) <= r2)
+      found.emplace_back(db.dot(db), id * 2 + 1);
+  });
+
+  std::sort(found.begin(), found.end());
+
+  ret.reserve(found.size());
+
+  if(ends)
+    ends->resize(found.size());
+
+  for(size_t i = 0; i < found.size(); ++i) {
+    ret.push_back(found[i].second >> 1);
+
+    if(ends)
+      (*ends)[i] = found[i].second & 1;
+  }
+
+  return ret;
+}
@@ -0,0 +1,252 @@
+#include "line_merge.hpp"
+#include "line_index.hpp"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <tuple>
+
+namespace {
+
+typedef Line<double> line_type;
+typedef cv::Point2d point_type;
+
+double
+direction(const line_type& l) {
+  double a = std::atan2(l.b.y - l.a.y, l.b.x - l.a.x);
+
+  return a < 0 ? a + CV_PI : (a >= CV_PI ? a - CV_PI : a);
+}
+
+double
+angle_diff(double a, double b) {
+  double d = std::fabs(a - b);
+
+  return std::min(d, CV_PI - d);
+}
+
+bool
+mergeable(const line_type& s, const line_type& t, double ls, double lt, const SegmentMergeParams& params) {
+  if(angle_diff(direction(s), direction(t)) > params.angleTol)
+    return false;
+
+  const line_type& longer = ls >= lt ? s : t;
+  const line_type& shorter = ls >= lt ? t : s;
+  double len = std::max(ls, lt);
+  point_type d = (longer.b - longer.a) * (1.0 / len);
+  point_type n(-d.y, d.x);
+
+  if(std::fabs((shorter.a - longer.a).dot(n)) > params.offsetTol || std::fabs((shorter.b - longer.a).dot(n)) > params.offsetTol)
+    return false;
+
+  double t0 = (shorter.a - longer.a).dot(d), t1 = (shorter.b - longer.a).dot(d);
+  double gap = std::max({0.0, std::min(t0, t1) - len, -std::max(t0, t1)});
+
+  return gap <= params.gapTol;
+}
+
+/* length-weighted line through a group; doubled angles average undirected directions */
+struct GroupFit {
+  double c2 = 0, s2 = 0, w = 0;
+  point_type sum = point_type(0, 0);
+
+  void
+  add(const line_type& l, double len) {
+    double a = 2 * std::atan2(l.b.y - l.a.y, l.b.x - l.a.x);
+
+    c2 += std::cos(a) * len;
+    s2 += std::sin(a) * len;
+    sum += (l.a + l.b) * (0.5 * len);
+    w += len;
+  }
+
+  /* in [0, pi) like direction() */
+  double
+  angle() const {
+    double a = std::atan2(s2, c2) / 2;
+
+    return a < 0 ? a + CV_PI : a;
+  }
+
+  point_type center() const { return sum * (1.0 / w); }
+};
+
+/* `l` lies along the group's current line, not just next to one of its members */
+bool
+fits(const GroupFit& group, const line_type& l, const SegmentMergeParams& params) {
+  double angle = group.angle();
+
+  if(angle_diff(direction(l), angle) > params.angleTol)
+    return false;
+
+  point_type c = group.center(), n(-std::sin(angle), std::cos(angle));
+
+  return std::fabs((l.a - c).dot(n)) <= params.offsetTol && std::fabs((l.b - c).dot(n)) <= params.offsetTol;
+}
+
+cv::Vec4f
+fit(const std::vector<line_type>& lines, const std::vector<double>& lengths, const std::vector<int>& group) {
+  const line_type& first = lines[group.front()];
+
+  if(group.size() == 1)
+    return cv::Vec4f(first.a.x, first.a.y, first.b.x, first.b.y);
+
+  GroupFit f;
+
+  for(int i : group)
+    f.add(lines[i], lengths[i]);
+
+  double angle = f.angle();
+  point_type d(std::cos(angle), std::sin(angle)), center = f.center();
+
+  if(d.dot(first.b - first.a) < 0)
+    d = -d;
+
+  double lo = std::numeric_limits<double>::max(), hi = std::numeric_limits<double>::lowest();
+
+  for(int i : group)
+    for(const point_type& p : {lines[i].a, lines[i].b}) {
+      double t = (p - center).dot(d);
+
+      lo = std::min(lo, t);
+      hi = std::max(hi, t);
+    }
+
+  point_type a = center + d * lo, b = center + d * hi;
+
+  return cv::Vec4f(a.x, a.y, b.x, b.y);
+}
+
+} // namespace
+
+std::vector<cv::Vec4f>
+merge_segments(const std::vector<line_type>& lines, const SegmentMergeParams& params) {
+  size_t n = lines.size();
+  std::vector<double> lengths(n);
+  std::vector<int> order(n), group_of(n, -1);
+  std::vector<std::vector<int>> groups;
+  std::vector<cv::Vec4f> ret;
+  LineIndex index;
+
+  for(size_t i = 0; i < n; ++i)
+    lengths[i] = std::hypot(lines[i].b.x - lines[i].a.x, lines[i].b.y - lines[i].a.y);
+
+  index.build(lines);
+
+  /* the longest free segment seeds the next group */
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return lengths[a] > lengths[b]; });
+
+  for(int seed : order) {
+    if(group_of[seed] != -1)
+      continue;
+
+    int g = groups.size();
+    GroupFit f;
+
+    groups.push_back({seed});
+    group_of[seed] = g;
+    f.add(lines[seed], lengths[seed]);
+
+    if(lengths[seed] == 0)
+      continue;
+
+    /* grow through the members' neighbourhoods: a candidate has to link to a
+     * member and lie on the group's line as fitted so far, so a slowly curving
+     * chain splits instead of drifting away from its first segments */
+    for(size_t m = 0; m < groups[g].size(); ++m) {
+      int i = groups[g][m];
+
+      /* segment distance never exceeds gap + offset for a mergeable pair */
+      for(int j : index.radius(lines[i], params.gapTol + params.offsetTol, i))
+        if(group_of[j] == -1 && lengths[j] > 0 && mergeable(lines[i], lines[j], lengths[i], lengths[j], params) && fits(f, lines[j], params)) {
+          group_of[j] = g;
+          groups[g].push_back(j);
+          f.add(lines[j], lengths[j]);
+        }
+    }
+  }
+
+  /* members and groups in input order, so a group is oriented like its first segment */
+  for(std::vector<int>& group : groups)
+    std::sort(group.begin(), group.end());
+
+  std::sort(groups.begin(), groups.end(), [](const std::vector<int>& a, const std::vector<int>& b) { return a.front() < b.front(); });
+
+  for(const std::vector<int>& group : groups)
+    ret.push_back(fit(lines, lengths, group));
+
+  return ret;
+}
+
+void
+join_segments(const std::vector<line_type>& lines, double tol, std::vector<cv::Point2f>& points, std::vector<uint32_t>& offsets) {
+  int n = lines.size();
+  LineIndex index;
+  std::vector<std::tuple<double, int, int>> pairs;
+  std::vector<int> link(n * 2, -1), ends;
+  std::vector<bool> visited(n, false);
+
+  points.clear();
+  offsets.assign(1, 0);
+
+  index.build(lines);
+
+  /* endpoint k is end (k & 1) of segment (k >> 1) */
+  auto endpoint = [&](int k) -> const point_type& { return k & 1 ? lines[k >> 1].b : lines[k >> 1].a; };
+  auto midpoint = [&](int k, int l) { return cv::Point2f((endpoint(k) + endpoint(l)) * 0.5); };
+
+  for(int k = 0; k < n * 2; ++k) {
+    std::vector<int> ids = index.endpoints(endpoint(k), tol, &ends);
+
+    for(size_t i = 0; i < ids.size(); ++i) {
+      int l = ids[i] * 2 + ends[i];
+
+      if(ids[i] != k >> 1 && k < l)
+        pairs.emplace_back(cv::norm(endpoint(k) - endpoint(l)), k, l);
+    }
+  }
+
+  std::sort(pairs.begin(), pairs.end());
+
+  for(const auto& [dist, k, l] : pairs)
+    if(link[k] == -1 && link[l] == -1) {
+      link[k] = l;
+      link[l] = k;
+    }
+
+  auto walk = [&](int start, int in) {
+    bool cycle = link[start * 2 + in] != -1;
+    int cur = start;
+
+    points.push_back(cycle ? midpoint(start * 2 + in, link[start * 2 + in]) : cv::Point2f(endpoint(start * 2 + in)));
+
+    for(;;) {
+      int k = cur * 2 + (1 - in), l = link[k];
+
+      visited[cur] = true;
+
+      if(l == -1 || visited[l >> 1]) {
+        cv::Point2f last = cycle ? points[offsets.back()] : cv::Point2f(endpoint(k));
+
+        points.push_back(last);
+        break;
+      }
+
+      points.push_back(midpoint(k, l));
+      cur = l >> 1;
+      in = l & 1;
+    }
+
+    offsets.push_back(points.size());
+  };
+
+  /* open chains start at a free end */
+  for(int i = 0; i < n; ++i)
+    if(!visited[i] && (link[i * 2] == -1 || link[i * 2 + 1] == -1))
+      walk(i, link[i * 2] == -1 ? 0 : 1);
+
+  /* whatever is left is closed */
+  for(int i = 0; i < n; ++i)
+    if(!visited[i])
+      walk(i, 0);
+}
@@ -0,0 +1,50 @@
+#include "mapped_file.hpp"
+#include <opencv2/core.hpp>
+#include <sys/stat.h>
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& p, bool copyOnWrite) : path(p) {
+#ifndef _WIN32
+  int fd;
+  struct stat st;
+
+  if((fd = ::open(path.c_str(), O_RDONLY)) != -1) {
+    if(::fstat(fd, &st) == 0 && st.st_size > 0) {
+      void* addr = copyOnWrite ? ::mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+      if(addr != MAP_FAILED) {
+        data = static_cast<const char*>(addr);
+        size = st.st_size;
+        mapped = true;
+      }
+    }
+
+    ::close(fd);
+  }
+#endif
+
+  if(!mapped) {
+    std::ifstream file(path, std::ios::binary);
+
+    if(!file)
+      CV_Error(cv::Error::StsObjectNotFound, "Cannot open file: " + path);
+
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data = buffer.data();
+    size = buffer.size();
+  }
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+  if(mapped)
+    ::munmap(const_cast<char*>(data), size);
+#endif
+}
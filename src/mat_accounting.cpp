@@ -0,0 +1,129 @@
+#include "mat_accounting.hpp"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+namespace {
+
+std::atomic<size_t> live_bytes(0), peak_bytes(0), live_buffers(0), allocations(0), collections(0);
+std::atomic<size_t> threshold(size_t(256) << 20), base_threshold(size_t(256) << 20);
+std::atomic<ptrdiff_t> objects[MAT_ACCOUNTING_KINDS];
+
+void
+add(size_t bytes) {
+  size_t live = live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  size_t peak = peak_bytes.load(std::memory_order_relaxed);
+
+  while(live > peak && !peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+
+  live_buffers.fetch_add(1, std::memory_order_relaxed);
+  allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+sub(size_t bytes) {
+  live_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+  live_buffers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/**
+ * Forwards to OpenCV's standard allocator. Buffers it hands out name this
+ * allocator as their currAllocator, so their release comes back here and
+ * is subtracted exactly once. It may happen on any thread.
+ */
+class AccountingMatAllocator : public cv::MatAllocator {
+public:
+  explicit AccountingMatAllocator(cv::MatAllocator* base) : base(base) {}
+
+  cv::UMatData*
+  allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usage) const override {
+    cv::UMatData* u = base->allocate(dims, sizes, type, data, step, flags, usage);
+
+    if(u) {
+      u->currAllocator = this;
+
+      /* user data isn't ours to count */
+      if(!data)
+        add(u->size);
+    }
+
+    return u;
+  }
+
+  bool
+  allocate(cv::UMatData* u, cv::AccessFlag flags, cv::UMatUsageFlags usage) const override {
+    return base->allocate(u, flags, usage);
+  }
+
+  void
+  deallocate(cv::UMatData* u) const override {
+    if(u) {
+      if(!(u->flags & cv::UMatData::USER_ALLOCATED))
+        sub(u->size);
+
+      u->currAllocator = base;
+      base->deallocate(u);
+    }
+  }
+
+private:
+  cv::MatAllocator* base;
+};
+
+} // namespace
+
+void
+matAccountingInstall() {
+  static std::once_flag once;
+
+  std::call_once(once, [] {
+    static AccountingMatAllocator allocator(cv::Mat::getStdAllocator());
+
+    cv::Mat::setDefaultAllocator(&allocator);
+  });
+}
+
+void
+matAccountingObject(MatAccountingKind kind, int delta) {
+  objects[kind].fetch_add(delta, std::memory_order_relaxed);
+}
+
+bool
+matAccountingPressure() {
+  size_t limit = threshold.load(std::memory_order_relaxed);
+
+  return limit > 0 && live_bytes.load(std::memory_order_relaxed) > limit;
+}
+
+void
+matAccountingCollected() {
+  size_t base = base_threshold.load(std::memory_order_relaxed);
+  size_t live = live_bytes.load(std::memory_order_relaxed);
+
+  /* what survives a collection is in use: don't collect again until it grows by half */
+  threshold.store(base ? std::max(base, live + live / 2) : 0, std::memory_order_relaxed);
+  collections.fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+matAccountingSetThreshold(size_t bytes) {
+  base_threshold.store(bytes, std::memory_order_relaxed);
+  threshold.store(bytes, std::memory_order_relaxed);
+}
+
+MatAccountingStats
+matAccountingStats() {
+  MatAccountingStats stats;
+
+  stats.live = live_bytes.load(std::memory_order_relaxed);
+  stats.peak = peak_bytes.load(std::memory_order_relaxed);
+  stats.buffers = live_buffers.load(std::memory_order_relaxed);
+  stats.allocations = allocations.load(std::memory_order_relaxed);
+  stats.collections = collections.load(std::memory_order_relaxed);
+  stats.threshold = threshold.load(std::memory_order_relaxed);
+
+  for(int i = 0; i < MAT_ACCOUNTING_KINDS; ++i)
+    stats.objects[i] = objects[i].load(std::memory_order_relaxed);
+
+  return stats;
+}
@@ -0,0 +1,331 @@
+#include "mat_container.hpp"
+#include "mapped_file.hpp"
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+const char mat_container_magic[8] = {'Q', 'J', 'S', 'M', 'A', 'T', 'S', '1'};
+const uint32_t mat_container_byte_order = 0x01020304;
+
+/* payload alignment: a cache line, and enough for any SIMD load */
+const uint64_t mat_container_align = 64;
+
+enum : uint32_t {
+  CODEC_NONE = 0,
+  CODEC_ZSTD,
+};
+
+struct MatContainerHeader {
+  char magic[8];
+  uint32_t byte_order, count;
+  uint64_t directory_size;
+};
+
+/* followed by the name, `dims` int32 sizes and `dims` uint64 steps */
+struct MatContainerEntry {
+  uint64_t offset, stored_size, raw_size;
+  int32_t type, dims;
+  uint32_t codec, name_size;
+};
+
+uint64_t
+align_up(uint64_t offset) {
+  return (offset + mat_container_align - 1) / mat_container_align * mat_container_align;
+}
+
+/**
+ * Keeps the mapping alive for as long as a Mat aliases it: the UMatData
+ * holds a reference, dropped by deallocate() with the last Mat.
+ */
+class MappedMatAllocator : public cv::MatAllocator {
+public:
+  cv::UMatData*
+  allocate(int, const int*, int, void*, size_t*, cv::AccessFlag, cv::UMatUsageFlags) const override {
+    return nullptr;
+  }
+
+  bool
+  allocate(cv::UMatData*, cv::AccessFlag, cv::UMatUsageFlags) const override {
+    return false;
+  }
+
+  void
+  deallocate(cv::UMatData* u) const override {
+    if(u) {
+      delete static_cast<std::shared_ptr<MappedFile>*>(u->userdata);
+      delete u;
+    }
+  }
+};
+
+cv::Mat
+alias(const std::shared_ptr<MappedFile>& file, uint64_t offset, int dims, const int* sizes, int type, const size_t* steps) {
+  static MappedMatAllocator allocator;
+  uchar* data = reinterpret_cast<uchar*>(const_cast<char*>(file->data + offset));
+  cv::Mat mat(dims, sizes, type, data, steps);
+  cv::UMatData* u = new cv::UMatData(&allocator);
+
+  u->data = u->origdata = data;
+  u->size = size_t(sizes[0]) * steps[0];
+  u->userdata = new std::shared_ptr<MappedFile>(file);
+  mat.u = u;
+  mat.addref();
+
+  return mat;
+}
+
+[[noreturn]] void
+corrupt(const std::string& path) {
+  CV_Error(cv::Error::StsParseError, "loadMats: not a Mat container or corrupt: " + path);
+}
+
+} // namespace
+
+bool
+matContainerHasZstd() {
+#ifdef HAVE_ZSTD
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+saveMats(const std::string& path, const std::vector<MatEntry>& entries, int zstdLevel) {
+  std::string tmp = path + ".tmp", directory;
+  std::vector<MatContainerEntry> records(entries.size());
+  std::vector<std::vector<char>> compressed(entries.size());
+  MatContainerHeader header;
+  uint64_t offset, written;
+  FILE* out;
+  bool ok = true;
+
+#ifndef HAVE_ZSTD
+  if(zstdLevel > 0)
+    CV_Error(cv::Error::StsNotImplemented, "saveMats: built without zstd");
+#endif
+
+  for(size_t i = 0; i < entries.size(); ++i) {
+    const cv::Mat& mat = entries[i].mat;
+    MatContainerEntry& record = records[i];
+
+    std::memset(&record, 0, sizeof(record));
+    record.type = mat.type();
+    record.dims = mat.empty() ? 0 : mat.dims;
+    record.raw_size = mat.empty() ? 0 : mat.total() * mat.elemSize();
+    record.stored_size = record.raw_size;
+    record.name_size = entries[i].name.size();
+
+#ifdef HAVE_ZSTD
+    if(zstdLevel > 0 && record.raw_size > 0) {
+      cv::Mat continuous = mat.isContinuous() ? mat : mat.clone();
+      std::vector<char>& buf = compressed[i];
+      size_t n;
+
+      buf.resize(ZSTD_compressBound(record.raw_size));
+      n = ZSTD_compress(buf.data(), buf.size(), continuous.data, record.raw_size, zstdLevel);
+
+      if(ZSTD_isError(n))
+        CV_Error(cv::Error::StsError, std::string("saveMats: zstd: ") + ZSTD_getErrorName(n));
+
+      buf.resize(n);
+      record.codec = CODEC_ZSTD;
+      record.stored_size = n;
+    }
+#endif
+  }
+
+  /* the directory's size doesn't depend on the offsets in it */
+  offset = sizeof(header);
+
+  for(size_t i = 0; i < entries.size(); ++i)
+    offset += sizeof(MatContainerEntry) + records[i].name_size + records[i].dims * (sizeof(int32_t) + sizeof(uint64_t));
+
+  for(MatContainerEntry& record : records) {
+    offset = align_up(offset);
+    record.offset = offset;
+    offset += record.stored_size;
+  }
+
+  for(size_t i = 0; i < entries.size(); ++i) {
+    const cv::Mat& mat = entries[i].mat;
+    const MatContainerEntry& record = records[i];
+    std::vector<int32_t> sizes(record.dims);
+    std::vector<uint64_t> steps(record.dims);
+
+    /* payloads are written densely, whatever the source's steps */
+    for(int d = record.dims - 1; d >= 0; --d) {
+      sizes[d] = mat.size[d];
+      steps[d] = d == record.dims - 1 ? mat.elemSize() : steps[d + 1] * sizes[d + 1];
+    }
+
+    directory.append(reinterpret_cast<const char*>(&record), sizeof(record));
+    directory.append(entries[i].name);
+    directory.append(reinterpret_cast<const char*>(sizes.data()), sizes.size() * sizeof(int32_t));
+    directory.append(reinterpret_cast<const char*>(steps.data()), steps.size() * sizeof(uint64_t));
+  }
+
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, mat_container_magic, sizeof(header.magic));
+  header.byte_order = mat_container_byte_order;
+  header.count = entries.size();
+  header.directory_size = directory.size();
+
+  if(!(out = std::fopen(tmp.c_str(), "wb")))
+    CV_Error(cv::Error::StsError, "saveMats: cannot write " + tmp);
+
+  ok = std::fwrite(&header, sizeof(header), 1, out) == 1;
+  ok = ok && std::fwrite(directory.data(), 1, directory.size(), out) == directory.size();
+  written = sizeof(header) + directory.size();
+
+  for(size_t i = 0; i < entries.size() && ok; ++i) {
+    const MatContainerEntry& record = records[i];
+
+    for(; written < record.offset && ok; ++written)
+      ok = std::fputc(0, out) != EOF;
+
+    if(record.codec == CODEC_ZSTD) {
+      ok = ok && std::fwrite(compressed[i].data(), 1, compressed[i].size(), out) == compressed[i].size();
+    } else if(record.raw_size > 0) {
+      const cv::Mat* arrays[] = {&entries[i].mat, nullptr};
+      uchar* planes[1];
+      cv::NAryMatIterator it(arrays, planes);
+      size_t plane_size = it.size * entries[i].mat.elemSize();
+
+      for(size_t p = 0; p < it.nplanes && ok; ++p, ++it)
+        ok = std::fwrite(planes[0], 1, plane_size, out) == plane_size;
+    }
+
+    written += record.stored_size;
+  }
+
+  ok = std::fclose(out) == 0 && ok;
+
+  /* rename() is atomic, so readers never map half a file */
+  if(!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    CV_Error(cv::Error::StsError, "saveMats: cannot write " + path);
+  }
+}
+
+std::vector<MatEntry>
+loadMats(const std::string& path, bool map) {
+  std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(path, true);
+  std::vector<MatEntry> entries;
+  MatContainerHeader header;
+  uint64_t pos, end;
+
+  if(file->size < sizeof(header))
+    corrupt(path);
+
+  std::memcpy(&header, file->data, sizeof(header));
+
+  if(std::memcmp(header.magic, mat_container_magic, sizeof(header.magic)))
+    corrupt(path);
+
+  if(header.byte_order != mat_container_byte_order)
+    CV_Error(cv::Error::StsNotImplemented, "loadMats: written on a host with another byte order: " + path);
+
+  if(header.directory_size > file->size - sizeof(header) || header.count > header.directory_size / sizeof(MatContainerEntry))
+    corrupt(path);
+
+  pos = sizeof(header);
+  end = pos + header.directory_size;
+  entries.resize(header.count);
+
+  for(MatEntry& entry : entries) {
+    MatContainerEntry record;
+    std::vector<int> sizes;
+    std::vector<size_t> steps;
+    uint64_t span;
+
+    if(end - pos < sizeof(record))
+      corrupt(path);
+
+    std::memcpy(&record, file->data + pos, sizeof(record));
+    pos += sizeof(record);
+
+    if(record.dims < 0 || record.dims > CV_MAX_DIM || CV_ELEM_SIZE(record.type) == 0 || record.codec > CODEC_ZSTD)
+      corrupt(path);
+
+    if(end - pos < record.name_size + record.dims * (sizeof(int32_t) + sizeof(uint64_t)))
+      corrupt(path);
+
+    entry.name.assign(file->data + pos, record.name_size);
+    pos += record.name_size;
+    sizes.resize(record.dims);
+    steps.resize(record.dims);
+
+    for(int d = 0; d < record.dims; ++d) {
+      int32_t size;
+
+      std::memcpy(&size, file->data + pos + d * sizeof(int32_t), sizeof(size));
+
+      if(size <= 0)
+        corrupt(path);
+
+      sizes[d] = size;
+    }
+
+    pos += record.dims * sizeof(int32_t);
+
+    for(int d = 0; d < record.dims; ++d) {
+      uint64_t step;
+
+      std::memcpy(&step, file->data + pos + d * sizeof(uint64_t), sizeof(step));
+      steps[d] = step;
+    }
+
+    pos += record.dims * sizeof(uint64_t);
+
+    if(record.dims == 0)
+      continue;
+
+    if(record.offset > file->size || record.stored_size > file->size - record.offset)
+      corrupt(path);
+
+    span = uint64_t(sizes[0]) * steps[0];
+
+    if(record.codec == CODEC_NONE) {
+      if(steps[record.dims - 1] != size_t(CV_ELEM_SIZE(record.type)) || steps[0] > record.stored_size)
+        corrupt(path);
+
+      /* every step has to cover the dimension inside it, or rows overlap */
+      for(int d = 0; d + 1 < record.dims; ++d)
+        if(steps[d + 1] > steps[d] || uint64_t(sizes[d + 1]) * steps[d + 1] > steps[d])
+          corrupt(path);
+
+      if(span > record.stored_size)
+        corrupt(path);
+
+      entry.mat = alias(file, record.offset, record.dims, sizes.data(), record.type, steps.data());
+
+      if(!map)
+        entry.mat = entry.mat.clone();
+    } else {
+#ifdef HAVE_ZSTD
+      size_t n;
+
+      entry.mat.create(record.dims, sizes.data(), record.type);
+
+      if(entry.mat.total() * entry.mat.elemSize() != record.raw_size)
+        corrupt(path);
+
+      n = ZSTD_decompress(entry.mat.data, record.raw_size, file->data + record.offset, record.stored_size);
+
+      if(ZSTD_isError(n) || n != record.raw_size)
+        corrupt(path);
+#else
+      CV_Error(cv::Error::StsNotImplemented, "loadMats: built without zstd, cannot read " + path);
+#endif
+    }
+  }
+
+  return entries;
+}
@@ -0,0 +1,173 @@
+#include "model_cache.hpp"
+#include <sys/stat.h>
+#include <map>
+#include <tuple>
+
+namespace {
+
+/* Entries are weak: the cache never keeps a model loaded by itself. The
+ * per-slot mutex makes concurrent first requests wait for a single load. */
+template<class Key, class T> struct ModelRegistry {
+  struct Slot {
+    std::mutex lock;
+    std::weak_ptr<T> ptr;
+  };
+
+  std::mutex lock;
+  std::map<Key, std::shared_ptr<Slot>> slots;
+
+  template<class Load>
+  std::shared_ptr<T>
+  get(const Key& key, Load&& load) {
+    std::shared_ptr<Slot> slot;
+
+    {
+      std::lock_guard<std::mutex> guard(lock);
+
+      /* drop expired slots nobody is loading into */
+      for(auto it = slots.begin(); it != slots.end();)
+        if(it->second->ptr.expired() && it->second.use_count() == 1 && it->first != key)
+          it = slots.erase(it);
+        else
+          ++it;
+
+      std::shared_ptr<Slot>& s = slots[key];
+
+      if(!s)
+        s = std::make_shared<Slot>();
+
+      slot = s;
+    }
+
+    std::lock_guard<std::mutex> guard(slot->lock);
+
+    if(std::shared_ptr<T> ptr = slot->ptr.lock())
+      return ptr;
+
+    std::shared_ptr<T> ptr = load();
+    slot->ptr = ptr;
+    return ptr;
+  }
+
+  template<class Visit>
+  void
+  each(Visit&& visit) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    for(auto& [key, slot] : slots)
+      if(std::shared_ptr<T> ptr = slot->ptr.lock())
+        visit(key, *ptr, ptr.use_count() - 1);
+  }
+};
+
+using BytesKey = std::tuple<std::string, int64_t, int64_t>;
+using NetKey = std::tuple<std::string, int64_t, int64_t, int, int>;
+
+ModelRegistry<BytesKey, const ModelBytes>&
+bytes_registry() {
+  static ModelRegistry<BytesKey, const ModelBytes> registry;
+
+  return registry;
+}
+
+ModelRegistry<NetKey, SharedNet>&
+net_registry() {
+  static ModelRegistry<NetKey, SharedNet> registry;
+
+  return registry;
+}
+
+void
+model_stat(const std::string& path, int64_t& mtime, int64_t& size) {
+  struct stat st;
+
+  if(::stat(path.c_str(), &st) != 0)
+    CV_Error(cv::Error::StsObjectNotFound, "Cannot stat model file: " + path);
+
+  mtime = st.st_mtime;
+  size = st.st_size;
+}
+
+bool
+model_from_memory(const std::string& path) {
+  return path.size() > 5 && path.compare(path.size() - 5, 5, ".onnx") == 0;
+}
+
+cv::dnn::Net
+model_read(const std::string& path, const ModelBytes* bytes, int backend, int target) {
+  cv::dnn::Net net = bytes ? cv::dnn::readNetFromONNX(bytes->data, bytes->size) : cv::dnn::readNet(path);
+
+  if(backend >= 0)
+    net.setPreferableBackend(backend);
+  if(target >= 0)
+    net.setPreferableTarget(target);
+
+  return net;
+}
+
+} // namespace
+
+std::shared_ptr<const ModelBytes>
+model_cache_bytes(const std::string& path) {
+  int64_t mtime, size;
+
+  model_stat(path, mtime, size);
+
+  return bytes_registry().get(BytesKey(path, mtime, size), [&]() { return std::make_shared<const ModelBytes>(path, mtime); });
+}
+
+cv::dnn::Net
+model_cache_read(const std::string& path, int backend, int target, std::shared_ptr<const ModelBytes>* bytes) {
+  if(!model_from_memory(path))
+    return model_read(path, nullptr, backend, target);
+
+  std::shared_ptr<const ModelBytes> mapping = model_cache_bytes(path);
+  cv::dnn::Net net = model_read(path, mapping.get(), backend, target);
+
+  if(bytes)
+    *bytes = mapping;
+
+  return net;
+}
+
+std::shared_ptr<SharedNet>
+model_cache_shared(const std::string& path, int backend, int target) {
+  int64_t mtime, size;
+
+  model_stat(path, mtime, size);
+
+  return net_registry().get(NetKey(path, mtime, size, backend, target), [&]() {
+    auto shared = std::make_shared<SharedNet>();
+
+    shared->net = model_cache_read(path, backend, target);
+    return shared;
+  });
+}
+
+std::vector<ModelCacheEntry>
+model_cache_entries() {
+  std::vector<ModelCacheEntry> entries;
+
+  bytes_registry().each([&](const BytesKey&, const ModelBytes& bytes, long refs) {
+    ModelCacheEntry& entry = entries.emplace_back();
+
+    entry.path = bytes.path;
+    entry.mtime = bytes.mtime;
+    entry.size = bytes.size;
+    entry.refs = refs;
+  });
+
+  net_registry().each([&](const NetKey& key, const SharedNet&, long refs) {
+    ModelCacheEntry& entry = entries.emplace_back();
+
+    entry.path = std::get<0>(key);
+    entry.mtime = std::get<1>(key);
+    entry.size = std::get<2>(key);
+    entry.backend = std::get<3>(key);
+    entry.target = std::get<4>(key);
+    entry.shared = true;
+    entry.refs = refs;
+  });
+
+  return entries;
+}
@@ -0,0 +1,144 @@
+#include "sampling.hpp"
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+/* Unseeded calls continue one stream per thread, so repeated calls differ. */
+static std::mt19937_64&
+sample_rng() {
+  static thread_local std::mt19937_64 rng{std::random_device{}()};
+
+  return rng;
+}
+
+/* Move the `m` largest weights to the front of `idx`, sorted descending. */
+static void
+select_top(std::vector<int32_t>& idx, const float* w, int m) {
+  auto greater = [w](int32_t a, int32_t b) { return w[a] > w[b]; };
+
+  if(size_t(m) < idx.size())
+    std::nth_element(idx.begin(), idx.begin() + m, idx.end(), greater);
+
+  std::sort(idx.begin(), idx.begin() + m, greater);
+}
+
+int32_t
+sample_logits(const float* logits, int n, const SampleOptions& options, std::vector<int32_t>* ids, std::vector<float>* probs) {
+  static thread_local std::vector<float> scratch;
+  static thread_local std::vector<int32_t> idx;
+  bool greedy = options.temperature <= 0 || options.topK == 1;
+  int k = options.topK > 0 ? std::min(options.topK, n) : n;
+  double maxVal, total;
+  cv::Point maxLoc;
+
+  CV_Assert(n > 0);
+
+  scratch.assign(logits, logits + n);
+  cv::Mat w(1, n, CV_32F, scratch.data());
+
+  if(options.repetitionPenalty != 1)
+    for(int32_t id : options.history)
+      if(id >= 0 && id < n && scratch[id] == logits[id])
+        scratch[id] = scratch[id] > 0 ? scratch[id] / options.repetitionPenalty : scratch[id] * options.repetitionPenalty;
+
+  cv::minMaxLoc(w, nullptr, &maxVal, nullptr, &maxLoc);
+
+  if(greedy && options.candidates <= 0)
+    return maxLoc.x;
+
+  /* unnormalized probabilities, vectorized by OpenCV */
+  w.convertTo(w, CV_32F, greedy ? 1.0 : 1.0 / options.temperature, -maxVal * (greedy ? 1.0 : 1.0 / options.temperature));
+  cv::exp(w, w);
+  total = cv::sum(w)[0];
+
+  const float* p = scratch.data();
+  int m = greedy ? 1 : k < n ? k : options.topP < 1 ? std::min(n, 256) : 0;
+  int c = greedy ? 1 : k;
+  double sum = total;
+
+  m = std::max(m, std::min(options.candidates, n));
+
+  if(m > 0) {
+    idx.resize(n);
+    std::iota(idx.begin(), idx.end(), 0);
+
+    for(;;) {
+      select_top(idx, p, m);
+
+      /* top-p without top-k: grow the sorted prefix until it holds enough mass */
+      if(greedy || options.topP >= 1 || k < n || m == n)
+        break;
+
+      double mass = 0;
+
+      for(int i = 0; i < m; ++i)
+        mass += p[idx[i]];
+
+      if(mass >= options.topP * total)
+        break;
+
+      m = std::min(n, m * 4);
+    }
+  }
+
+  if(!greedy && (k < n || options.topP < 1)) {
+    /* top-p is taken relative to what top-k left over */
+    double kept = k == n ? total : 0;
+
+    for(int i = 0; i < k && k < n; ++i)
+      kept += p[idx[i]];
+
+    if(options.topP < 1) {
+      int i = 0;
+
+      sum = 0;
+
+      while(i < std::min(c, m) - 1 && (sum += p[idx[i]]) < options.topP * kept)
+        ++i;
+
+      c = i + 1;
+    }
+
+    sum = 0;
+
+    for(int i = 0; i < c; ++i)
+      sum += p[idx[i]];
+  }
+
+  int32_t token = greedy ? maxLoc.x : 0;
+
+  if(!greedy) {
+    std::mt19937_64 seeded(options.seed);
+    std::uniform_real_distribution<double> uniform(0, sum);
+    double r = options.seeded ? uniform(seeded) : uniform(sample_rng());
+
+    if(c < n) {
+      for(int i = 0; i < c; ++i)
+        if((r -= p[idx[i]]) <= 0 || i == c - 1) {
+          token = idx[i];
+          break;
+        }
+    } else {
+      /* full vocabulary: walk the unsorted weights */
+      for(int i = 0; i < n; ++i)
+        if((r -= p[i]) <= 0 || i == n - 1) {
+          token = i;
+          break;
+        }
+    }
+  }
+
+  if(options.candidates > 0 && ids && probs) {
+    int count = std::min(options.candidates, greedy ? m : std::min(c, m));
+    double norm = greedy ? total : sum;
+
+    ids->assign(idx.begin(), idx.begin() + count);
+    probs->resize(count);
+
+    for(int i = 0; i < count; ++i)
+      (*probs)[i] = p[idx[i]] / norm;
+  }
+
+  return token;
+}
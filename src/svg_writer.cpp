@@ -0,0 +1,394 @@
+#include "svg_writer.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+/* `q` in units of 10^-precision, shortest form: no trailing zeros, no
+ * leading zero before the decimal point ("-.5", "12", "3.25") */
+size_t
+format_fixed(int64_t q, int precision, const int64_t scale, char* out) {
+  char* p = out;
+  uint64_t v = q < 0 ? uint64_t(-q) : uint64_t(q);
+  uint64_t ip = v / scale, fp = v % scale;
+  char digits[24];
+  int n = 0;
+
+  if(q < 0)
+    *p++ = '-';
+
+  if(ip != 0 || fp == 0) {
+    do
+      digits[n++] = '0' + ip % 10;
+    while(ip /= 10);
+
+    while(n)
+      *p++ = digits[--n];
+  }
+
+  if(fp != 0) {
+    int len = precision;
+
+    while(fp % 10 == 0) {
+      fp /= 10;
+      --len;
+    }
+
+    *p++ = '.';
+
+    for(int i = len - 1; i >= 0; --i, fp /= 10)
+      p[i] = '0' + fp % 10;
+
+    p += len;
+  }
+
+  return p - out;
+}
+
+} // namespace
+
+SvgWriter::SvgWriter(sink_type sink, int precision, bool relative, size_t chunkSize)
+    : sink(std::move(sink)), chunk_size(std::max<size_t>(chunkSize, 1)), precision(std::min(std::max(precision, 0), 9)), relative(relative) {
+  scale = std::pow(10.0, this->precision);
+  buffer.reserve(chunk_size + 256);
+}
+
+std::string
+SvgWriter::escape(const std::string& text) {
+  std::string ret;
+
+  ret.reserve(text.size());
+
+  for(char c : text)
+    switch(c) {
+      case '&': ret += "&amp;"; break;
+      case '<': ret += "&lt;"; break;
+      case '>': ret += "&gt;"; break;
+      case '"': ret += "&quot;"; break;
+      default: ret += c; break;
+    }
+
+  return ret;
+}
+
+void
+SvgWriter::flush(bool force) {
+  if(buffer.size() >= chunk_size || (force && !buffer.empty())) {
+    sink(buffer.data(), buffer.size());
+    written += buffer.size();
+    buffer.clear();
+  }
+}
+
+void
+SvgWriter::attribute(const std::string& name, const std::string& value) {
+  buffer += ' ';
+  buffer += name;
+  buffer += "=\"";
+  buffer += escape(value);
+  buffer += '"';
+}
+
+void
+SvgWriter::element(const char* name, const attributes_type& attrs, bool close) {
+  buffer += '<';
+  buffer += name;
+
+  for(const auto& [key, value] : attrs)
+    attribute(key, value);
+
+  buffer += close ? "/>\n" : ">\n";
+  flush();
+}
+
+void
+SvgWriter::begin(double width, double height, const attributes_type& attrs) {
+  char w[32], h[32];
+
+  w[format_fixed(std::llround(width * scale), precision, int64_t(scale), w)] = '\0';
+  h[format_fixed(std::llround(height * scale), precision, int64_t(scale), h)] = '\0';
+
+  buffer += "<svg xmlns=\"http://www.w3.org/2000/svg\"";
+
+  if(width > 0 && height > 0) {
+    attribute("width", w);
+    attribute("height", h);
+    attribute("viewBox", std::string("0 0 ") + w + " " + h);
+  }
+
+  for(const auto& [key, value] : attrs)
+    attribute(key, value);
+
+  buffer += ">\n";
+  open = true;
+  flush();
+}
+
+void
+SvgWriter::finish() {
+  while(groups > 0)
+    endGroup();
+
+  if(open) {
+    buffer += "</svg>\n";
+    open = false;
+  }
+
+  flush(true);
+}
+
+void
+SvgWriter::beginGroup(const attributes_type& attrs) {
+  element("g", attrs, false);
+  ++groups;
+}
+
+void
+SvgWriter::endGroup() {
+  if(groups > 0) {
+    buffer += "</g>\n";
+    --groups;
+    flush();
+  }
+}
+
+void
+SvgWriter::setTransform(const cv::Matx33d& matrix) {
+  transform = matrix;
+  affine = matrix(2, 0) == 0 && matrix(2, 1) == 0 && matrix(2, 2) == 1;
+  identity = affine && matrix == cv::Matx33d::eye();
+}
+
+void
+SvgWriter::resetTransform() {
+  setTransform(cv::Matx33d::eye());
+}
+
+cv::Point2d
+SvgWriter::place(double x, double y) const {
+  if(identity)
+    return cv::Point2d(x, y);
+
+  const cv::Matx33d& t = transform;
+  double px = t(0, 0) * x + t(0, 1) * y + t(0, 2), py = t(1, 0) * x + t(1, 1) * y + t(1, 2);
+
+  if(!affine) {
+    double w = t(2, 0) * x + t(2, 1) * y + t(2, 2);
+
+    px /= w;
+    py /= w;
+  }
+
+  return cv::Point2d(px, py);
+}
+
+void
+SvgWriter::number(int64_t q) {
+  char tmp[32];
+  size_t len = format_fixed(q, precision, int64_t(scale), tmp);
+
+  /* a sign, or a decimal point after a number that already has one, ends the previous number */
+  if(after_number && tmp[0] != '-' && !(tmp[0] == '.' && number_has_point))
+    buffer += ' ';
+
+  buffer.append(tmp, len);
+  after_number = true;
+  number_has_point = std::find(tmp, tmp + len, '.') != tmp + len;
+}
+
+void
+SvgWriter::op(char c) {
+  buffer += c;
+  command = c;
+  after_number = false;
+}
+
+void
+SvgWriter::moveTo(int64_t x, int64_t y) {
+  op(relative ? 'm' : 'M');
+  number(relative ? x - cur_x : x);
+  number(relative ? y - cur_y : y);
+
+  /* coordinates following a moveto are implicit linetos */
+  command = relative ? 'l' : 'L';
+  cur_x = start_x = x;
+  cur_y = start_y = y;
+}
+
+void
+SvgWriter::lineTo(int64_t x, int64_t y) {
+  int64_t dx = x - cur_x, dy = y - cur_y;
+  char c;
+
+  if(dx == 0 && dy == 0)
+    return;
+
+  c = dy == 0 ? 'h' : dx == 0 ? 'v' : 'l';
+
+  if(!relative)
+    c -= 'a' - 'A';
+
+  if(c != command)
+    op(c);
+
+  if(dy == 0) {
+    number(relative ? dx : x);
+  } else if(dx == 0) {
+    number(relative ? dy : y);
+  } else {
+    number(relative ? dx : x);
+    number(relative ? dy : y);
+  }
+
+  cur_x = x;
+  cur_y = y;
+}
+
+void
+SvgWriter::closePath() {
+  op(relative ? 'z' : 'Z');
+  cur_x = start_x;
+  cur_y = start_y;
+}
+
+template<class T>
+void
+SvgWriter::subpath(const cv::Mat& points, bool closed) {
+  const cv::Point_<T>* pts = points.ptr<cv::Point_<T>>();
+  int n = points.rows;
+
+  for(int i = 0; i < n; ++i) {
+    cv::Point2d p = place(pts[i].x, pts[i].y);
+    int64_t x = std::llround(p.x * scale), y = std::llround(p.y * scale);
+
+    if(i == 0)
+      moveTo(x, y);
+    else if(!(closed && i == n - 1 && x == start_x && y == start_y))
+      lineTo(x, y);
+  }
+
+  if(closed && n > 0)
+    closePath();
+
+  flush();
+}
+
+void
+SvgWriter::path(const std::vector<cv::Mat>& polylines, bool closed, const attributes_type& attrs) {
+  cur_x = cur_y = start_x = start_y = 0;
+  command = 0;
+  after_number = number_has_point = false;
+
+  buffer += "<path d=\"";
+
+  for(const cv::Mat& points : polylines) {
+    if(points.empty())
+      continue;
+
+    switch(points.depth()) {
+      case CV_32S: subpath<int>(points, closed); break;
+      case CV_32F: subpath<float>(points, closed); break;
+      default: subpath<double>(points, closed); break;
+    }
+  }
+
+  buffer += '"';
+
+  for(const auto& [key, value] : attrs)
+    attribute(key, value);
+
+  buffer += "/>\n";
+  flush();
+}
+
+void
+SvgWriter::lines(const cv::Mat& lines, const attributes_type& attrs) {
+  cv::Mat xyxy;
+
+  if(!lines.empty())
+    (lines.isContinuous() ? lines : lines.clone()).reshape(1, int(lines.total() * lines.channels() / 4)).convertTo(xyxy, CV_64F);
+
+  cur_x = cur_y = start_x = start_y = 0;
+  command = 0;
+  after_number = number_has_point = false;
+
+  buffer += "<path d=\"";
+
+  for(int i = 0; i < xyxy.rows; ++i) {
+    const double* l = xyxy.ptr<double>(i);
+    cv::Point2d a = place(l[0], l[1]), b = place(l[2], l[3]);
+
+    moveTo(std::llround(a.x * scale), std::llround(a.y * scale));
+    lineTo(std::llround(b.x * scale), std::llround(b.y * scale));
+    flush();
+  }
+
+  buffer += '"';
+
+  for(const auto& [key, value] : attrs)
+    attribute(key, value);
+
+  buffer += "/>\n";
+  flush();
+}
+
+void
+SvgWriter::ellipses(const cv::Mat& ellipses, const attributes_type& attrs) {
+  cv::Mat rows;
+  char num[32];
+  auto fmt = [&](double v) { return std::string(num, format_fixed(std::llround(v * scale), precision, int64_t(scale), num)); };
+
+  if(!ellipses.empty())
+    (ellipses.isContinuous() ? ellipses : ellipses.clone()).reshape(1, int(ellipses.total() * ellipses.channels() / 5)).convertTo(rows, CV_64F);
+
+  if(!attrs.empty())
+    beginGroup(attrs);
+
+  for(int i = 0; i < rows.rows; ++i) {
+    const double* e = rows.ptr<double>(i);
+    double rx = e[2] / 2, ry = e[3] / 2, a = e[4] * CV_PI / 180, c = std::cos(a), s = std::sin(a);
+
+    if(identity && e[4] == 0) {
+      buffer += "<ellipse cx=\"" + fmt(e[0]) + "\" cy=\"" + fmt(e[1]) + "\" rx=\"" + fmt(rx) + "\" ry=\"" + fmt(ry) + "\"/>\n";
+    } else if(affine) {
+      /* placement * translate(center) * rotate(angle) as one matrix, scale kept at full precision */
+      cv::Matx33d m = transform * cv::Matx33d(c, -s, e[0], s, c, e[1], 0, 0, 1);
+      std::string matrix = cv::format("matrix(%.9g %.9g %.9g %.9g ", m(0, 0), m(1, 0), m(0, 1), m(1, 1));
+
+      buffer += "<ellipse rx=\"" + fmt(rx) + "\" ry=\"" + fmt(ry) + "\" transform=\"" + matrix + fmt(m(0, 2)) + " " + fmt(m(1, 2)) + ")\"/>\n";
+    } else {
+      /* no SVG transform expresses a homography - sample the outline instead */
+      const int n = 64;
+      cur_x = cur_y = start_x = start_y = 0;
+      command = 0;
+      after_number = number_has_point = false;
+
+      buffer += "<path d=\"";
+
+      for(int k = 0; k < n; ++k) {
+        double t = 2 * CV_PI * k / n, x = rx * std::cos(t), y = ry * std::sin(t);
+        cv::Point2d p = place(e[0] + c * x - s * y, e[1] + s * x + c * y);
+        int64_t qx = std::llround(p.x * scale), qy = std::llround(p.y * scale);
+
+        if(k == 0)
+          moveTo(qx, qy);
+        else
+          lineTo(qx, qy);
+      }
+
+      closePath();
+      buffer += "\"/>\n";
+    }
+
+    flush();
+  }
+
+  if(!attrs.empty())
+    endGroup();
+}
+
+void
+SvgWriter::raw(const std::string& text) {
+  buffer += text;
+  flush();
+}
@@ -0,0 +1,324 @@
+#include "thumbnail.hpp"
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+static const char thumbnail_magic[8] = {'Q', 'J', 'S', 'T', 'H', 'M', 'B', '1'};
+
+/* Files up to this size are hashed in full, larger ones (videos, mostly) by
+ * their size plus the first and last chunk. */
+static const size_t thumbnail_hash_full = 16 << 20;
+static const size_t thumbnail_hash_chunk = 1 << 20;
+
+static uint64_t
+fnv1a(const uint8_t* data, size_t len, uint64_t h = 0xcbf29ce484222325ull) {
+  for(size_t i = 0; i < len; ++i) {
+    h ^= data[i];
+    h *= 0x100000001b3ull;
+  }
+
+  return h;
+}
+
+static bool
+read_file(const std::string& filename, std::vector<uint8_t>& buf) {
+  std::ifstream in(filename, std::ios::binary | std::ios::ate);
+
+  if(!in)
+    return false;
+
+  buf.resize(in.tellg());
+  in.seekg(0);
+
+  return bool(in.read(reinterpret_cast<char*>(buf.data()), buf.size()));
+}
+
+static bool
+is_jpeg(const std::vector<uint8_t>& buf) {
+  return buf.size() > 3 && buf[0] == 0xff && buf[1] == 0xd8 && buf[2] == 0xff;
+}
+
+/**
+ * @brief Read the frame size from a JPEG's SOFn segment without decoding.
+ */
+bool
+jpeg_dimensions(const uint8_t* data, size_t len, int& width, int& height) {
+  size_t i = 2;
+
+  if(len < 4 || data[0] != 0xff || data[1] != 0xd8)
+    return false;
+
+  while(i + 4 <= len) {
+    uint8_t marker;
+
+    if(data[i] != 0xff) {
+      ++i;
+      continue;
+    }
+
+    marker = data[i + 1];
+
+    /* fill bytes and segments without a length field */
+    if(marker == 0xff) {
+      ++i;
+      continue;
+    }
+
+    if(marker == 0x01 || (marker >= 0xd0 && marker <= 0xd8)) {
+      i += 2;
+      continue;
+    }
+
+    /* SOF0..SOF15, except DHT (c4), JPG (c8) and DAC (cc) */
+    if(marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc) {
+      if(i + 9 > len)
+        return false;
+
+      height = (data[i + 5] << 8) | data[i + 6];
+      width = (data[i + 7] << 8) | data[i + 8];
+      return width > 0 && height > 0;
+    }
+
+    /* start of scan: no frame header before the entropy-coded data */
+    if(marker == 0xda)
+      return false;
+
+    i += 2 + ((data[i + 2] << 8) | data[i + 3]);
+  }
+
+  return false;
+}
+
+uint64_t
+thumbnail_hash(const std::string& filename) {
+  std::ifstream in(filename, std::ios::binary | std::ios::ate);
+  std::vector<uint8_t> chunk;
+  uint64_t size, h;
+
+  if(!in)
+    return 0;
+
+  size = in.tellg();
+  h = fnv1a(reinterpret_cast<const uint8_t*>(&size), sizeof(size));
+  in.seekg(0);
+
+  if(size <= thumbnail_hash_full) {
+    chunk.resize(size);
+    in.read(reinterpret_cast<char*>(chunk.data()), size);
+    return fnv1a(chunk.data(), chunk.size(), h);
+  }
+
+  chunk.resize(thumbnail_hash_chunk);
+  in.read(reinterpret_cast<char*>(chunk.data()), chunk.size());
+  h = fnv1a(chunk.data(), chunk.size(), h);
+  in.seekg(size - thumbnail_hash_chunk);
+  in.read(reinterpret_cast<char*>(chunk.data()), chunk.size());
+  return fnv1a(chunk.data(), chunk.size(), h);
+}
+
+std::string
+thumbnail_cache_dir() {
+  const char* dir;
+
+  if((dir = getenv("XDG_CACHE_HOME")) && *dir)
+    return std::string(dir) + "/qjs-opencv/thumbnails";
+
+  if((dir = getenv("HOME")) && *dir)
+    return std::string(dir) + "/.cache/qjs-opencv/thumbnails";
+
+  return std::string();
+}
+
+static void
+thumbnail_fit(cv::Mat& image, int max_size) {
+  int longer = std::max(image.cols, image.rows);
+
+  if(longer > max_size) {
+    double f = double(max_size) / longer;
+    cv::Mat resized;
+
+    cv::resize(image, resized, cv::Size(), f, f, cv::INTER_AREA);
+    image = resized;
+  }
+}
+
+static bool
+thumbnail_video(const std::string& filename, int max_size, Thumbnail& out) {
+  cv::VideoCapture cap(filename);
+  cv::Mat frame;
+  double count;
+
+  if(!cap.isOpened())
+    return false;
+
+  /* skip fade-ins and black leaders, the first frame is rarely representative */
+  if((count = cap.get(cv::CAP_PROP_FRAME_COUNT)) > 10)
+    cap.set(cv::CAP_PROP_POS_FRAMES, int(count / 10));
+
+  if(!cap.read(frame) || frame.empty()) {
+    cap.set(cv::CAP_PROP_POS_FRAMES, 0);
+
+    if(!cap.read(frame) || frame.empty())
+      return false;
+  }
+
+  out.width = frame.cols;
+  out.height = frame.rows;
+  thumbnail_fit(frame, max_size);
+  out.image = frame;
+  return true;
+}
+
+bool
+thumbnail_make(const std::string& filename, int max_size, Thumbnail& out) {
+  std::vector<uint8_t> buf;
+  int width, height, scale = 1, flags = cv::IMREAD_COLOR;
+  cv::Mat image;
+
+  /* sniffs the signature only, so videos are never read into memory */
+  if(!cv::haveImageReader(filename))
+    return thumbnail_video(filename, max_size, out);
+
+  if(!read_file(filename, buf))
+    return false;
+
+  if(is_jpeg(buf) && jpeg_dimensions(buf.data(), buf.size(), width, height)) {
+    int longer = std::max(width, height);
+
+    while(scale < 8 && longer / (scale * 2) >= max_size)
+      scale *= 2;
+
+    switch(scale) {
+      case 2: flags = cv::IMREAD_REDUCED_COLOR_2; break;
+      case 4: flags = cv::IMREAD_REDUCED_COLOR_4; break;
+      case 8: flags = cv::IMREAD_REDUCED_COLOR_8; break;
+    }
+  }
+
+  image = cv::imdecode(buf, flags);
+  buf.clear();
+
+  if(image.empty())
+    return false;
+
+  if(scale > 1) {
+    /* EXIF orientation may have swapped the axes relative to the SOF header */
+    if((image.cols > image.rows) != (width > height))
+      std::swap(width, height);
+
+    out.width = width;
+    out.height = height;
+  } else {
+    out.width = image.cols;
+    out.height = image.rows;
+  }
+
+  thumbnail_fit(image, max_size);
+  out.image = image;
+  return true;
+}
+
+bool
+thumbnail_load(const std::string& cache_file, Thumbnail& out) {
+  std::vector<uint8_t> buf;
+  int32_t dims[2];
+
+  if(!read_file(cache_file, buf) || buf.size() <= sizeof(thumbnail_magic) + sizeof(dims))
+    return false;
+
+  if(memcmp(buf.data(), thumbnail_magic, sizeof(thumbnail_magic)))
+    return false;
+
+  memcpy(dims, buf.data() + sizeof(thumbnail_magic), sizeof(dims));
+
+  cv::Mat encoded(1, buf.size() - sizeof(thumbnail_magic) - sizeof(dims), CV_8UC1, buf.data() + sizeof(thumbnail_magic) + sizeof(dims));
+
+  if((out.image = cv::imdecode(encoded, cv::IMREAD_COLOR)).empty())
+    return false;
+
+  out.width = dims[0];
+  out.height = dims[1];
+  return true;
+}
+
+bool
+thumbnail_save(const std::string& cache_file, const Thumbnail& thumb) {
+  std::vector<uint8_t> encoded;
+  int32_t dims[2] = {thumb.width, thumb.height};
+  /* identical files in one batch, and other processes filling the same
+   * cache, write the same entry - keep the temp names apart */
+  static std::atomic<uint64_t> serial(0);
+  std::string tmp = cache_file + "." + std::to_string(getpid()) + "-" + std::to_string(serial++) + ".tmp";
+
+  if(!cv::imencode(".jpg", thumb.image, encoded, {cv::IMWRITE_JPEG_QUALITY, 90}))
+    return false;
+
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+
+    out.write(thumbnail_magic, sizeof(thumbnail_magic));
+    out.write(reinterpret_cast<const char*>(dims), sizeof(dims));
+    out.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+
+    if(!out.flush()) {
+      out.close();
+      std::remove(tmp.c_str());
+      return false;
+    }
+  }
+
+  return std::rename(tmp.c_str(), cache_file.c_str()) == 0;
+}
+
+std::vector<Thumbnail>
+thumbnails(const std::vector<std::string>& paths, int max_size, const std::string& cache_dir) {
+  std::vector<Thumbnail> result(paths.size());
+  bool cache = !cache_dir.empty();
+
+  if(cache) {
+    std::error_code ec;
+    std::filesystem::create_directories(cache_dir, ec);
+    cache = !ec;
+  }
+
+  cv::parallel_for_(cv::Range(0, paths.size()), [&](const cv::Range& range) {
+    for(int i = range.start; i < range.end; ++i) {
+      std::string cache_file;
+
+      try {
+        if(cache) {
+          char name[64];
+
+          snprintf(name, sizeof(name), "/%016llx-%d.thumb", (unsigned long long)thumbnail_hash(paths[i]), max_size);
+          cache_file = cache_dir + name;
+
+          if(thumbnail_load(cache_file, result[i]))
+            continue;
+        }
+
+        if(thumbnail_make(paths[i], max_size, result[i]) && cache)
+          thumbnail_save(cache_file, result[i]);
+
+      } catch(const std::exception&) { result[i] = Thumbnail(); }
+    }
+  });
+
+  return result;
+}
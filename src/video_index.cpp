@@ -0,0 +1,204 @@
+#include "video_index.hpp"
+#include <opencv2/core.hpp>
+#include <sys/stat.h>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+static const char video_index_magic[8] = {'Q', 'J', 'S', 'V', 'I', 'D', 'X', '1'};
+
+bool
+VideoFileKey::stat(const std::string& filename) {
+  struct stat st;
+
+  if(::stat(filename.c_str(), &st) == -1)
+    return false;
+
+  std::error_code ec;
+  std::filesystem::path abs = std::filesystem::absolute(filename, ec);
+
+  path = ec ? filename : abs.lexically_normal().string();
+  size = st.st_size;
+  mtime = st.st_mtime;
+  return true;
+}
+
+bool
+VideoSeekIndex::build(const std::string& filename) {
+  cv::VideoCapture cap;
+  bool raw;
+
+  if(!key.stat(filename))
+    return false;
+
+  keyframe.clear();
+  msec.clear();
+
+  /* Raw mode hands out the demuxed packets undecoded, which is what makes a
+   * full pass over the file cheap. Any other backend would decode the whole
+   * file, just to learn nothing about keyframes. */
+  try {
+    raw = cap.open(filename, cv::CAP_FFMPEG, {cv::CAP_PROP_FORMAT, -1});
+  } catch(const cv::Exception& e) { raw = false; }
+
+  if(!raw)
+    return false;
+
+  fps = cap.get(cv::CAP_PROP_FPS);
+
+  int32_t last_key = -1;
+
+  for(int32_t frame = 0; cap.grab(); ++frame) {
+    bool is_key = cap.get(cv::CAP_PROP_LRF_HAS_KEY_FRAME) != 0;
+
+    if(is_key || frame == 0)
+      last_key = frame;
+
+    keyframe.push_back(last_key);
+    msec.push_back(cap.get(cv::CAP_PROP_POS_MSEC));
+  }
+
+  /* Only the first frame flagged: the backend doesn't report keyframes.
+   * Make every frame its own keyframe so seeking falls back to the backend. */
+  if(keyframe.size() > 1 && keyframe.back() == 0)
+    for(size_t i = 0; i < keyframe.size(); ++i)
+      keyframe[i] = i;
+
+  return !keyframe.empty();
+}
+
+bool
+VideoSeekIndex::load(const std::string& sidecar) {
+  std::ifstream in(sidecar, std::ios::binary);
+  char magic[sizeof(video_index_magic)];
+  uint32_t pathlen, count;
+
+  if(!in.read(magic, sizeof(magic)) || memcmp(magic, video_index_magic, sizeof(magic)))
+    return false;
+
+  in.read(reinterpret_cast<char*>(&key.size), sizeof(key.size));
+  in.read(reinterpret_cast<char*>(&key.mtime), sizeof(key.mtime));
+  in.read(reinterpret_cast<char*>(&pathlen), sizeof(pathlen));
+
+  if(!in || pathlen > 65536)
+    return false;
+
+  key.path.resize(pathlen);
+  in.read(key.path.data(), pathlen);
+  in.read(reinterpret_cast<char*>(&fps), sizeof(fps));
+  in.read(reinterpret_cast<char*>(&count), sizeof(count));
+
+  if(!in)
+    return false;
+
+  /* a corrupt count must not size the vectors: the entries have to be there */
+  std::streamoff start = in.tellg();
+
+  if(!in.seekg(0, std::ios::end) || in.tellg() - start != std::streamoff(count) * std::streamoff(sizeof(int32_t) + sizeof(double)) || !in.seekg(start))
+    return false;
+
+  keyframe.resize(count);
+  msec.resize(count);
+  in.read(reinterpret_cast<char*>(keyframe.data()), count * sizeof(int32_t));
+  in.read(reinterpret_cast<char*>(msec.data()), count * sizeof(double));
+
+  if(!in) {
+    keyframe.clear();
+    msec.clear();
+    return false;
+  }
+
+  return true;
+}
+
+bool
+VideoSeekIndex::save(const std::string& sidecar) const {
+  std::string tmp = sidecar + ".tmp";
+  uint32_t pathlen = key.path.size(), count = keyframe.size();
+
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+
+    out.write(video_index_magic, sizeof(video_index_magic));
+    out.write(reinterpret_cast<const char*>(&key.size), sizeof(key.size));
+    out.write(reinterpret_cast<const char*>(&key.mtime), sizeof(key.mtime));
+    out.write(reinterpret_cast<const char*>(&pathlen), sizeof(pathlen));
+    out.write(key.path.data(), pathlen);
+    out.write(reinterpret_cast<const char*>(&fps), sizeof(fps));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char*>(keyframe.data()), count * sizeof(int32_t));
+    out.write(reinterpret_cast<const char*>(msec.data()), count * sizeof(double));
+
+    if(!out.flush()) {
+      out.close();
+      std::remove(tmp.c_str());
+      return false;
+    }
+  }
+
+  /* rename() is atomic, so a concurrent reader never sees half an index */
+  return std::rename(tmp.c_str(), sidecar.c_str()) == 0;
+}
+
+std::vector<int32_t>
+VideoSeekIndex::keyframes() const {
+  std::vector<int32_t> ret;
+
+  for(size_t i = 0; i < keyframe.size(); ++i)
+    if(keyframe[i] == int32_t(i))
+      ret.push_back(i);
+
+  return ret;
+}
+
+std::string
+VideoSeekIndex::sidecar_path(const std::string& filename) {
+  return filename + ".seekidx";
+}
+
+std::shared_ptr<VideoSeekIndex>
+VideoSeekIndex::get(const std::string& filename, const std::string& sidecar, bool rebuild) {
+  std::shared_ptr<VideoSeekIndex> index = std::make_shared<VideoSeekIndex>();
+  std::string path = sidecar.empty() ? sidecar_path(filename) : sidecar;
+  VideoFileKey key;
+
+  if(!key.stat(filename))
+    return nullptr;
+
+  if(!rebuild && index->load(path) && index->key == key)
+    return index;
+
+  if(!index->build(filename))
+    return nullptr;
+
+  /* a read-only directory just means the index isn't persisted */
+  index->save(path);
+
+  return index;
+}
+
+bool
+video_seek(cv::VideoCapture& cap, const VideoSeekIndex& index, int32_t frame) {
+  if(frame < 0 || size_t(frame) >= index.size())
+    return false;
+
+  int32_t key = index.keyframe[frame];
+  int32_t pos = cap.get(cv::CAP_PROP_POS_FRAMES);
+
+  if(pos < key || pos > frame) {
+    if(!cap.set(cv::CAP_PROP_POS_FRAMES, key))
+      return false;
+
+    pos = key;
+  }
+
+  while(pos < frame) {
+    if(!cap.grab())
+      return false;
+
+    ++pos;
+  }
+
+  return true;
+}
@@ -0,0 +1,36 @@
+/*
+ * One-node ONNX models encoded in memory, so dnn tests need no model
+ * download. Only as much protobuf as ModelProto needs: varints,
+ * length-delimited messages and strings.
+ */
+
+const bytes = s => [...s].map(c => c.charCodeAt(0));
+
+function varint(n) {
+  const out = [];
+  for (; n > 127; n = Math.floor(n / 128)) out.push((n % 128) | 128);
+  out.push(n);
+  return out;
+}
+
+const int = (field, v) => [...varint(field * 8), ...varint(v)];
+const msg = (field, body) => [...varint(field * 8 + 2), ...varint(body.length), ...body];
+const str = (field, s) => msg(field, bytes(s));
+
+/* ValueInfoProto: float tensor, a string dimension is symbolic */
+function valueInfo(name, shape) {
+  const dims = shape.map(d => (typeof d === 'string' ? str(2, d) : int(1, d)));
+  const tensor = [...int(1, 1), ...msg(2, dims.flatMap(d => msg(1, d)))];
+  return [...str(1, name), ...msg(2, msg(1, tensor))];
+}
+
+/*
+ * output = op(...inputs), every tensor float with `shape`; returns the
+ * serialized model as an ArrayBuffer.
+ */
+export function onnxModel({ op, inputs = ['x'], output = 'y', shape, name = op.toLowerCase() }) {
+  const node = [...inputs.flatMap(i => str(1, i)), ...str(2, output), ...str(3, name), ...str(4, op)];
+  const graph = [...msg(1, node), ...str(2, name), ...[...new Set(inputs)].flatMap(i => msg(11, valueInfo(i, shape))), ...msg(12, valueInfo(output, shape))];
+
+  return Uint8Array.from([...int(1, 7), ...str(2, 'qjs-opencv'), ...msg(7, graph), ...msg(8, int(2, 11))]).buffer;
+}
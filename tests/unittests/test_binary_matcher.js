@@ -0,0 +1,153 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+
+/*
+ * Exercises cv.BinaryMatcher: brute-force kNN against a plain JS Hamming
+ * search, descriptor widths that don't fill whole words, the LSH index,
+ * and the ratio test / cross-check filters of match().
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+let seed = 7;
+function random() {
+  seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+  return seed / 0x7fffffff;
+}
+
+function descriptors(rows, cols) {
+  const mat = new cv.Mat(rows, cols, cv.CV_8UC1);
+  const data = new Uint8Array(mat.buffer);
+  for (let i = 0; i < data.length; i++) data[i] = Math.floor(random() * 256);
+  return mat;
+}
+
+/* a copy of `mat` with `flips` random bits toggled per row */
+function perturbed(mat, flips) {
+  const out = mat.clone();
+  const data = new Uint8Array(out.buffer);
+  for (let r = 0; r < out.rows; r++)
+    for (let f = 0; f < flips; f++) {
+      const bit = Math.floor(random() * out.cols * 8);
+      data[r * out.cols + (bit >> 3)] ^= 1 << (bit & 7);
+    }
+  return out;
+}
+
+function hamming(a, ai, b, bi, cols) {
+  let d = 0;
+  for (let i = 0; i < cols; i++) {
+    let x = a[ai * cols + i] ^ b[bi * cols + i];
+    while (x) {
+      d += x & 1;
+      x >>= 1;
+    }
+  }
+  return d;
+}
+
+/* sorted distances of the k nearest train rows of every query row */
+function reference(train, query, k) {
+  const t = new Uint8Array(train.buffer), q = new Uint8Array(query.buffer);
+  const result = [];
+  for (let i = 0; i < query.rows; i++) {
+    const d = [];
+    for (let j = 0; j < train.rows; j++) d.push(hamming(q, i, t, j, train.cols));
+    result.push(d.sort((a, b) => a - b).slice(0, k));
+  }
+  return result;
+}
+
+for (const cols of [32, 61, 13])
+  addTest(`BinaryMatcher - brute-force kNN, ${cols} byte descriptors`, () => {
+    const train = descriptors(300, cols);
+    const query = descriptors(40, cols);
+    const matcher = new cv.BinaryMatcher(train);
+    const { k, trainIdx, distance } = matcher.knnMatch(query, 3);
+    const expected = reference(train, query, 3);
+    const t = new Uint8Array(train.buffer), q = new Uint8Array(query.buffer);
+
+    assert(matcher.size === 300 && matcher.descriptorSize === cols);
+    assert(k === 3 && trainIdx instanceof Int32Array && trainIdx.length === 120);
+
+    for (let i = 0; i < query.rows; i++)
+      for (let j = 0; j < k; j++) {
+        const n = i * k + j;
+        assert(distance[n] === expected[i][j], `query ${i} rank ${j}: ${distance[n]} != ${expected[i][j]}`);
+        assert(hamming(q, i, t, trainIdx[n], cols) === distance[n], 'index and distance agree');
+      }
+  });
+
+addTest('BinaryMatcher - rows from several add() calls, k beyond the train size', () => {
+  const a = descriptors(3, 32), b = descriptors(2, 32);
+  const matcher = new cv.BinaryMatcher();
+
+  matcher.add([a, b]);
+  const { trainIdx, distance } = matcher.knnMatch(b, 6);
+
+  assert(matcher.size === 5);
+  assert(trainIdx[0] === 3 && distance[0] === 0, 'rows are numbered across adds');
+  assert(trainIdx[6 + 0] === 4 && distance[6 + 0] === 0);
+  assert(trainIdx[5] === -1 && distance[5] === -1, 'missing neighbours are -1');
+
+  matcher.clear();
+  assert(matcher.size === 0 && matcher.descriptorSize === 0);
+
+  /* an empty matcher finds nothing, for any query */
+  const query = descriptors(20, 32);
+  const empty = matcher.knnMatch(query, 2);
+  assert(empty.trainIdx.length === 40 && empty.trainIdx.every(i => i === -1) && empty.distance.every(d => d === -1));
+  assert(matcher.match(query, { crossCheck: true }).queryIdx.length === 0);
+  assert(new cv.BinaryMatcher().match(query, { lsh: true }).queryIdx.length === 0);
+});
+
+addTest('BinaryMatcher - LSH finds near duplicates', () => {
+  const train = descriptors(2000, 32);
+  const query = perturbed(train, 6);
+  const matcher = new cv.BinaryMatcher(train, { tables: 8, keyBits: 14, probes: 2 });
+  const { trainIdx } = matcher.knnMatch(query, 1, { lsh: true });
+  let found = 0;
+
+  for (let i = 0; i < query.rows; i++) if (trainIdx[i] === i) found++;
+
+  assert(found > query.rows * 0.95, `${found} of ${query.rows} recalled`);
+});
+
+addTest('BinaryMatcher - ratio test and cross-check', () => {
+  const train = descriptors(500, 32);
+  const near = perturbed(train.rowRange(0, 50), 4);
+  const noise = descriptors(50, 32);
+  const query = new cv.Mat();
+  cv.vconcat([near, noise], query);
+  const matcher = new cv.BinaryMatcher(train);
+
+  const all = matcher.match(query);
+  assert(all.queryIdx.length === 100, 'without filters every query has a match');
+
+  const kept = matcher.match(query, { ratio: 0.8, crossCheck: true });
+  assert(kept.queryIdx.length >= 45 && kept.queryIdx.length < 60, `${kept.queryIdx.length} kept`);
+  for (let i = 0; i < kept.queryIdx.length; i++)
+    if (kept.queryIdx[i] < 50) assert(kept.trainIdx[i] === kept.queryIdx[i], `query ${kept.queryIdx[i]}`);
+
+  const close = matcher.match(query, { maxDistance: 10 });
+  assert(close.queryIdx.length === 50 && close.distance.every(d => d <= 10), 'maxDistance keeps the near duplicates');
+});
+
+addTest('BinaryMatcher - rejects mismatched descriptors', () => {
+  const matcher = new cv.BinaryMatcher(descriptors(10, 32));
+  let error;
+
+  try {
+    matcher.knnMatch(descriptors(5, 64), 1);
+  } catch (e) {
+    error = e;
+  }
+
+  assert(error !== undefined, 'a query of another width throws');
+});
+
+tests(testCases);
@@ -272,4 +272,45 @@ tests({
     }
   },
 
+  'contourStats - matches the per-contour functions'() {
+    const square = [new cv.Point(0, 0), new cv.Point(100, 0), new cv.Point(100, 50), new cv.Point(0, 50)];
+    const triangle = new cv.Mat(3, 1, cv.CV_32SC2);
+    triangle.data32S.set([10, 10, 50, 10, 10, 40]);
+
+    const stats = cv.contourStats([square, triangle], ['area', 'perimeter', 'boundingRect', 'centroid']);
+
+    eq(2, stats.count);
+    eq(true, stats.area instanceof Float64Array);
+    eq(5000, stats.area[0]);
+    eq(cv.contourArea(triangle), stats.area[1]);
+    eq(300, stats.perimeter[0]);
+    eq(cv.arcLength(triangle, true), stats.perimeter[1]);
+    eq('0,0,101,51,10,10,41,31', Array.from(stats.boundingRect).join());
+    eq(50, stats.centroid[0]);
+    eq(25, stats.centroid[1]);
+    eq(undefined, stats.minAreaRect);
+  },
+
+  'contourStats - packed contours and too few points to fit'() {
+    const points = new Int32Array([0, 0, 10, 0, 10, 10, 0, 10, 5, 5]);
+    const offsets = new Uint32Array([0, 4, 5, 5]);
+    const stats = cv.contourStats({ points, offsets }, ['area', 'fitEllipse', 'convexHullArea', 'huMoments']);
+
+    eq(3, stats.count);
+    eq('100,0,0', Array.from(stats.area).join());
+    eq(100, stats.convexHullArea[0]);
+    eq(true, isNaN(stats.fitEllipse[0]) && isNaN(stats.fitEllipse[5]));
+    eq(21, stats.huMoments.length);
+  },
+
+  'contourStats - unknown field'() {
+    let threw = false;
+    try {
+      cv.contourStats([], 'roundness');
+    } catch (e) {
+      threw = e instanceof RangeError;
+    }
+    eq(true, threw);
+  },
+
 });
@@ -0,0 +1,84 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+import { onnxModel } from './onnx_model.js';
+
+/*
+ * Exercises cv.dnn.BatchScheduler: requests are gathered into one forward
+ * pass, by size or by timer, and every Promise gets its own row of the
+ * batched output. The net is a single ONNX Add node computing 2x, with a
+ * free batch dimension, from onnx_model.js.
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+/* y = Add(x, x) over [N, 1, 4, 4] */
+const onnx = onnxModel({ op: 'Add', inputs: ['x', 'x'], name: 'double', shape: ['N', 1, 4, 4] });
+
+function model(Ctor = cv.dnn.Model) {
+  const net = cv.dnn.readNetFromONNX(onnx);
+  const m = new Ctor(net);
+
+  m.setInputSize(4, 4);
+  return m;
+}
+
+/* 4 x 4 filled with `value`, and `peak` at pixel `at` */
+function image(value, at = -1, peak = 0) {
+  const mat = new cv.Mat(4, 4, cv.CV_32FC1);
+  const data = new Float32Array(mat.buffer);
+
+  data.fill(value);
+  if (at >= 0) data[at] = peak;
+  return mat;
+}
+
+function values(mat) {
+  return [...new Float32Array(mat.buffer)];
+}
+
+addTest('BatchScheduler - a full batch runs at once, one row per request', async () => {
+  const scheduler = new cv.dnn.BatchScheduler(model(), 3, 10000);
+  const promises = [1, 2].map(v => scheduler.predict(image(v)));
+
+  assert(scheduler.pending === 2, `${scheduler.pending} pending`);
+
+  /* reusing a Mat before the batch runs doesn't change the request */
+  const frame = image(3);
+  promises.push(scheduler.predict(frame));
+  new Float32Array(frame.buffer).fill(100);
+
+  assert(scheduler.pending === 0, 'the third request filled the batch');
+
+  const results = await Promise.all(promises);
+
+  results.forEach((outs, i) => {
+    assert(outs.length === 1 && outs[0].matSize.join() === '1,1,4,4', `request ${i}: ${outs.length && outs[0].matSize}`);
+    assert(values(outs[0]).every(v => v === 2 * (i + 1)), `request ${i}: ${values(outs[0])}`);
+  });
+});
+
+addTest('BatchScheduler - a partial batch goes out after maxDelay', async () => {
+  const scheduler = new cv.dnn.BatchScheduler(model(), 8, 5);
+  const [a, b] = await Promise.all([scheduler.predict(image(4)), scheduler.predict(image(0))]);
+
+  assert(scheduler.pending === 0);
+  assert(values(a[0]).every(v => v === 8) && values(b[0]).every(v => v === 0), `${values(a[0])} / ${values(b[0])}`);
+});
+
+addTest('BatchScheduler - classify() maps each request to its own class', async () => {
+  const scheduler = new cv.dnn.BatchScheduler(model(cv.dnn.ClassificationModel), 4, 10000);
+  const promises = [5, 0, 11, 7].map(at => scheduler.classify(image(0, at, at + 1)));
+
+  assert(scheduler.flush() === 0, 'the batch of four already went out');
+
+  const results = await Promise.all(promises);
+
+  assert(results.map(r => r.classId).join() === '5,0,11,7', results.map(r => r.classId).join());
+  assert(results.every((r, i) => r.confidence === 2 * ([5, 0, 11, 7][i] + 1)), results.map(r => r.confidence).join());
+});
+
+tests(testCases);
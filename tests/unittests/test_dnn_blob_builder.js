@@ -0,0 +1,86 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+
+/*
+ * Exercises cv.dnn.BlobBuilder(params), the buffer-reusing
+ * blobFromImagesWithParams() from src/blob_builder.cpp. Results are compared
+ * against OpenCV's own blobFromImagesWithParams() on synthetic images.
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+function image(cols, rows, color) {
+  const mat = new cv.Mat(rows, cols, cv.CV_8UC3);
+  mat.setTo(color);
+  cv.rectangle(mat, { x: 2, y: 1, width: cols / 2, height: rows / 2 }, [255, 255, 255, 0], -1);
+  return mat;
+}
+
+/* IEEE 754 binary16 to number */
+function half(h) {
+  const e = (h >> 10) & 31, m = h & 1023, sign = h & 32768 ? -1 : 1;
+  if (e === 0) return sign * m * 2 ** -24;
+  if (e === 31) return m ? NaN : sign * Infinity;
+  return sign * (1024 + m) * 2 ** (e - 25);
+}
+
+const elements = {
+  [cv.CV_32F]: mat => new Float32Array(mat.buffer),
+  [cv.CV_16F]: mat => Array.from(new Uint16Array(mat.buffer), half),
+  [cv.CV_8S]: mat => new Int8Array(mat.buffer),
+};
+
+function maxAbsDiff(a, b) {
+  const x = elements[a.depth()](a), y = elements[b.depth()](b);
+  assert(x.length === y.length, `length: ${x.length} !== ${y.length}`);
+  let d = 0;
+  for (let i = 0; i < x.length; i++) d = Math.max(d, Math.abs(x[i] - y[i]));
+  return d;
+}
+
+const images = [image(32, 24, [10, 100, 200, 0]), image(40, 30, [200, 50, 0, 0])];
+
+addTest('BlobBuilder - NCHW matches blobFromImagesWithParams', () => {
+  const params = new cv.dnn.Image2BlobParams([1 / 255, 1 / 255, 1 / 255], { width: 16, height: 16 }, [10, 20, 30], true);
+  const blob = new cv.dnn.BlobBuilder(params).build(images);
+  const ref = cv.dnn.blobFromImagesWithParams(images, params);
+  assert(blob.total() === 2 * 3 * 16 * 16, `total: got ${blob.total()}`);
+  assert(maxAbsDiff(blob, ref) < 1e-3, 'values differ from blobFromImagesWithParams');
+});
+
+addTest('BlobBuilder - letterbox, NHWC', () => {
+  const params = new cv.dnn.Image2BlobParams([1, 1, 1], { width: 20, height: 20 }, [0, 0, 0], false, cv.CV_32F, cv.dnn.DNN_LAYOUT_NHWC, cv.dnn.DNN_PMODE_LETTERBOX);
+  const blob = new cv.dnn.BlobBuilder(params).build(images);
+  const ref = cv.dnn.blobFromImagesWithParams(images, params);
+  assert(maxAbsDiff(blob, ref) <= 1, 'values differ from blobFromImagesWithParams');
+});
+
+addTest('BlobBuilder - the blob is reused between calls', () => {
+  const builder = new cv.dnn.BlobBuilder(new cv.dnn.Image2BlobParams([1, 1, 1], { width: 8, height: 8 }));
+  const a = builder.build(images);
+  const first = new Float32Array(a.buffer)[0];
+  builder.build([images[1], images[0]]);
+  assert(new Float32Array(a.buffer)[0] !== first, 'second build should overwrite the first blob');
+});
+
+addTest('BlobBuilder - FP16 and INT8 match the FP32 blob', () => {
+  const blobParams = ddepth => new cv.dnn.Image2BlobParams([0.5, 0.5, 0.5], { width: 8, height: 8 }, [128, 128, 128], false, ddepth);
+  const ref = cv.dnn.blobFromImagesWithParams(images, blobParams(cv.CV_32F));
+
+  /* values are multiples of 0.5 in [-64, 64): exact in FP16, rounded to INT8 */
+  for (const [ddepth, tolerance] of [
+    [cv.CV_16F, 1e-3],
+    [cv.CV_8S, 0.5],
+  ]) {
+    const blob = new cv.dnn.BlobBuilder(blobParams(ddepth)).build(images);
+    assert(blob.depth() === ddepth, `depth: got ${blob.depth()}, expected ${ddepth}`);
+    const d = maxAbsDiff(blob, ref);
+    assert(d <= tolerance, `depth ${ddepth}: differs from FP32 by ${d}`);
+  }
+});
+
+tests(testCases);
@@ -0,0 +1,67 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+import { onnxModel } from './onnx_model.js';
+
+/*
+ * Exercises Net.forwardAsync() against the calls a script makes while the
+ * pass is pending: setInput() is recorded without waiting and applies to
+ * the next pass, and a Model on the same network waits its turn. The net
+ * is a single ONNX Add node computing 2x, from onnx_model.js.
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+/* y = Add(x, x) over [N, 1, 4, 4] */
+const onnx = onnxModel({ op: 'Add', inputs: ['x', 'x'], name: 'double', shape: ['N', 1, 4, 4] });
+
+function net() {
+  return cv.dnn.readNetFromONNX(onnx);
+}
+
+function image(value) {
+  const mat = new cv.Mat(4, 4, cv.CV_32FC1);
+  new Float32Array(mat.buffer).fill(value);
+  return mat;
+}
+
+function values(mat) {
+  return [...new Float32Array(mat.buffer)];
+}
+
+addTest('forwardAsync - setInput while pending applies to the next pass', async () => {
+  const n = net();
+  const blob = cv.dnn.blobFromImage(image(1));
+
+  n.setInput(blob);
+  const pending = n.forwardAsync();
+
+  /* refilling the blob must not reach the queued pass either */
+  new Float32Array(blob.buffer).fill(5);
+  n.setInput(cv.dnn.blobFromImage(image(3)));
+
+  const out = await pending;
+  assert(values(out).every(v => v === 2), `pending pass: ${values(out)}`);
+  assert(values(n.forward()).every(v => v === 6), 'the next pass sees the second input');
+});
+
+addTest('forwardAsync - a Model on the same Net waits for the pass', async () => {
+  const n = net();
+  const model = new cv.dnn.Model(n);
+  const outs = [];
+
+  model.setInputSize(4, 4);
+  n.setInput(cv.dnn.blobFromImage(image(2)));
+  const pending = n.forwardAsync();
+
+  model.predict(image(10), outs);
+  assert(outs.length === 1 && values(outs[0]).every(v => v === 20), `model: ${outs.length && values(outs[0])}`);
+
+  const out = await pending;
+  assert(values(out).every(v => v === 4), `pending pass: ${values(out)}`);
+});
+
+tests(testCases);
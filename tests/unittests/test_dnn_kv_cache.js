@@ -0,0 +1,126 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+
+/*
+ * Exercises cv.dnn.KVCache from src/kv_cache.cpp: append() takes the new
+ * timesteps out of hand-made present.* tensors, attentionMask() and
+ * positionIds() follow the cached length. No model needed.
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+const heads = 2, headDim = 3;
+
+/* attention_mask and position_ids are int64 on OpenCV 5, int32 before */
+const Index = cv.CV_64S !== undefined ? BigInt64Array : Int32Array;
+const indexType = cv.CV_64S !== undefined ? cv.CV_64S : cv.CV_32S;
+
+/* [1, heads, steps, headDim] holding fn(head, timestep, d) */
+function present(steps, fn) {
+  const mat = new cv.Mat([1, heads, steps, headDim], cv.CV_32F);
+  const data = new Float32Array(mat.buffer);
+
+  for (let h = 0; h < heads; h++)
+    for (let t = 0; t < steps; t++)
+      for (let d = 0; d < headDim; d++) data[(h * steps + t) * headDim + d] = fn(h, t, d);
+
+  return mat;
+}
+
+/* key and value of every layer, as a forward pass returns them */
+function outputs(layers, steps) {
+  const outs = [];
+
+  for (let l = 0; l < layers; l++) {
+    outs.push(present(steps, (h, t, d) => 1000 * l + 100 * h + 10 * t + d));
+    outs.push(present(steps, (h, t, d) => -(1000 * l + 100 * h + 10 * t + d)));
+  }
+
+  return outs;
+}
+
+function checkPrefix(mat, steps, fn) {
+  const sizes = mat.matSize;
+  assert(sizes.join() === `1,${heads},${steps},${headDim}`, `sizes ${sizes}`);
+
+  const data = new Float32Array(mat.clone().buffer);
+
+  for (let h = 0; h < heads; h++)
+    for (let t = 0; t < steps; t++)
+      for (let d = 0; d < headDim; d++) {
+        const v = data[(h * steps + t) * headDim + d];
+        assert(v === fn(h, t, d), `[${h}, ${t}, ${d}] = ${v}, expected ${fn(h, t, d)}`);
+      }
+}
+
+addTest('KVCache - append keeps only the new timesteps', () => {
+  const kv = new cv.dnn.KVCache(2, heads, headDim, 8);
+  const zero = (h, t, d) => 0;
+
+  assert(kv.offset === 1 && kv.length === 0);
+  checkPrefix(kv.key(1), 1, zero);
+
+  /* prefill of 3 tokens: present.* has the dummy slot plus 3 timesteps */
+  kv.append(outputs(2, 4), 3);
+  assert(kv.length === 3);
+
+  /* one more token: present.* repeats the prefix, only timestep 4 is taken */
+  const step = outputs(2, 5);
+  new Float32Array(step[2].buffer).fill(7, 0, 4 * headDim);
+  kv.append(step, 1);
+
+  assert(kv.length === 4);
+  checkPrefix(kv.key(1), 5, (h, t, d) => (t === 0 ? 0 : 1000 + 100 * h + 10 * t + d));
+  checkPrefix(kv.value(0), 5, (h, t, d) => (t === 0 ? 0 : -(100 * h + 10 * t + d)));
+});
+
+addTest('KVCache - append checks shapes and capacity', () => {
+  const kv = new cv.dnn.KVCache(1, heads, headDim, 2, false);
+  let error;
+
+  try {
+    kv.append(outputs(1, 2), 1);
+  } catch (e) {
+    error = e;
+  }
+  assert(error, 'present.* must have length + n timesteps');
+  assert(kv.length === 0);
+
+  kv.append(outputs(1, 2), 2);
+  error = undefined;
+
+  try {
+    kv.append(outputs(1, 3), 1);
+  } catch (e) {
+    error = e;
+  }
+  assert(error instanceof RangeError, `${error}`);
+  assert(kv.length === 2);
+});
+
+addTest('KVCache - attentionMask and positionIds follow the length', () => {
+  const kv = new cv.dnn.KVCache(1, heads, headDim, 8);
+
+  let mask = kv.attentionMask(3);
+  assert(mask.type() === indexType && mask.cols === 4, `${mask.cols} mask entries`);
+  assert([...new Index(mask.buffer)].join() === '0,1,1,1');
+  assert([...new Index(kv.positionIds(3).buffer)].join() === '0,1,2');
+
+  kv.append(outputs(1, 4), 3);
+
+  mask = kv.attentionMask(1);
+  assert([...new Index(mask.buffer)].join() === '0,1,1,1,1');
+  assert([...new Index(kv.positionIds(2).buffer)].join() === '3,4');
+
+  kv.reset();
+  assert(kv.length === 0 && kv.attentionMask(1).cols === 2);
+
+  const plain = new cv.dnn.KVCache(1, heads, headDim, 8, false);
+  assert([...new Index(plain.attentionMask(2).buffer)].join() === '1,1', 'no dummy slot');
+});
+
+tests(testCases);
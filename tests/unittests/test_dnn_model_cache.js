@@ -0,0 +1,80 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+import * as std from 'std';
+import { onnxModel } from './onnx_model.js';
+
+/*
+ * Exercises cv.dnn.readNetCached() and cv.dnn.modelCacheEntries() from
+ * src/model_cache.cpp on a one-node ONNX model (Relu over [1, 4]) from
+ * onnx_model.js, so no model download is needed.
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+const path = '/tmp/test_dnn_model_cache.onnx';
+
+function writeModel() {
+  const model = onnxModel({ op: 'Relu', shape: [1, 4] });
+  const f = std.open(path, 'wb');
+
+  f.write(model, 0, model.byteLength);
+  f.close();
+}
+
+function input(values) {
+  const mat = new cv.Mat(1, 4, cv.CV_32FC1);
+  new Float32Array(mat.buffer).set(values);
+  return mat;
+}
+
+function run(net, values) {
+  net.setInput(input(values));
+  return [...new Float32Array(net.forward().buffer)].join();
+}
+
+const entries = () => cv.dnn.modelCacheEntries().filter(e => e.path === path);
+
+addTest('readNetCached - private nets share one mapping', () => {
+  writeModel();
+
+  let a = cv.dnn.readNetCached(path);
+  let b = cv.dnn.readNetCached(path);
+  const [mapping, ...rest] = entries();
+
+  assert(rest.length === 0 && mapping && !mapping.shared, JSON.stringify(entries()));
+  assert(mapping.refs === 2, `${mapping.refs} references to the mapping`);
+  assert(run(a, [-1, 2, -3, 4]) === '0,2,0,4' && run(b, [5, -6, 7, -8]) === '5,0,7,0');
+
+  a = b = null;
+  std.gc();
+  assert(entries().length === 0, 'the mapping goes with its last Net');
+});
+
+addTest('readNetCached - shared nets keep their own inputs', () => {
+  writeModel();
+
+  let a = cv.dnn.readNetCached(path, { shared: true });
+  let b = cv.dnn.readNetCached(path, { shared: true });
+  const shared = entries().filter(e => e.shared);
+
+  assert(shared.length === 1 && shared[0].refs === 2, JSON.stringify(entries()));
+
+  a.setInput(input([-1, 2, -3, 4]));
+  b.setInput(input([5, -6, 7, -8]));
+  assert([...new Float32Array(a.forward().buffer)].join() === '0,2,0,4', 'a forwards its own input');
+  assert([...new Float32Array(b.forward().buffer)].join() === '5,0,7,0', 'b forwards its own input');
+
+  a = null;
+  std.gc();
+  assert(entries().filter(e => e.shared)[0].refs === 1, 'one Net left');
+
+  b = null;
+  std.gc();
+  assert(entries().length === 0, 'the network is unloaded after its last Net');
+});
+
+tests(testCases);
@@ -0,0 +1,59 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+
+/*
+ * Exercises cv.dnn.sample(logits, options), the native next-token picker
+ * from src/sampling.cpp. Logits are small hand-made Mats, no model needed.
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+function logitsMat(values, rows = 1) {
+  const mat = new cv.Mat(rows, values.length / rows, cv.CV_32F);
+  new Float32Array(mat.buffer).set(values);
+  return mat;
+}
+
+addTest('sample - temperature 0 is argmax', () => {
+  const id = cv.dnn.sample(logitsMat([0.1, 2.5, -1, 2.4]), { temperature: 0 });
+  assert(id === 1, `expected 1, got ${id}`);
+});
+
+addTest('sample - only the last row of [seq, vocab] is considered', () => {
+  const id = cv.dnn.sample(logitsMat([9, 0, 0, 0, 0, 3], 2), { temperature: 0 });
+  assert(id === 2, `expected 2, got ${id}`);
+});
+
+addTest('sample - topK 2 never leaves the two best tokens', () => {
+  const logits = logitsMat([5, 4.9, 0, 0, 0, 0, 0, 0]);
+  for (let i = 0; i < 50; i++) {
+    const id = cv.dnn.sample(logits, { temperature: 5, topK: 2 });
+    assert(id === 0 || id === 1, `got ${id}`);
+  }
+});
+
+addTest('sample - same seed, same token', () => {
+  const logits = logitsMat([1, 1, 1, 1, 1, 1, 1, 1]);
+  const a = cv.dnn.sample(logits, { temperature: 1, seed: 42 });
+  const b = cv.dnn.sample(logits, { temperature: 1, seed: 42 });
+  assert(a === b, `${a} !== ${b}`);
+});
+
+addTest('sample - repetitionPenalty demotes tokens from history', () => {
+  const id = cv.dnn.sample(logitsMat([2, 1.9, 0]), { temperature: 0, repetitionPenalty: 1.5, history: [0] });
+  assert(id === 1, `expected 1, got ${id}`);
+});
+
+addTest('sample - candidates reports sorted ids and probabilities', () => {
+  const r = cv.dnn.sample(logitsMat([0, 3, 1, 2]), { temperature: 0, candidates: 3 });
+  assert(r.token === 1, `token: got ${r.token}`);
+  assert(r.ids instanceof Int32Array && r.probs instanceof Float32Array, 'typed arrays expected');
+  assert(r.ids.join() === '1,3,2', `ids: got ${r.ids.join()}`);
+  assert(r.probs[0] > r.probs[1] && r.probs[1] > r.probs[2], 'probabilities must be descending');
+});
+
+tests(testCases);
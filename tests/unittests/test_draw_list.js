@@ -0,0 +1,85 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+
+/*
+ * Exercises cv.DrawList: recording primitives, replaying them onto a Mat
+ * sequentially and in bands, compared against the free drawing functions,
+ * plus offset/clip and replaying the same list more than once.
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+function differing(a, b) {
+  const diff = new cv.Mat();
+  cv.absdiff(a, b, diff);
+  return cv.countNonZero(diff);
+}
+
+function record(list) {
+  list.rectangle(new cv.Rect(10, 10, 40, 30), [255], -1, cv.LINE_8);
+  list.circle(new cv.Point(80, 60), 20, [128], -1, cv.LINE_8);
+  list.line(new cv.Point(0, 0), new cv.Point(119, 119), [64], 1, cv.LINE_8);
+}
+
+addTest('DrawList - replay matches the free functions', () => {
+  const list = new cv.DrawList();
+  record(list);
+  assert(list.length === 3, `length ${list.length}`);
+
+  const expected = cv.Mat.zeros(120, 120, cv.CV_8UC1);
+  cv.rectangle(expected, new cv.Rect(10, 10, 40, 30), [255], -1, cv.LINE_8);
+  cv.circle(expected, new cv.Point(80, 60), 20, [128], -1, cv.LINE_8);
+  cv.line(expected, new cv.Point(0, 0), new cv.Point(119, 119), [64], 1, false);
+
+  const mat = cv.Mat.zeros(120, 120, cv.CV_8UC1);
+  list.draw(mat);
+  assert(differing(mat, expected) === 0, `sequential replay differs in ${differing(mat, expected)} pixels`);
+});
+
+addTest('DrawList - band-parallel replay of fills', () => {
+  const list = new cv.DrawList();
+  record(list);
+  list.fillPoly([new cv.Point(5, 90), new cv.Point(60, 70), new cv.Point(40, 115)], [200], cv.LINE_8);
+
+  const sequential = cv.Mat.zeros(120, 120, cv.CV_8UC1);
+  const banded = cv.Mat.zeros(120, 120, cv.CV_8UC1);
+  list.draw(sequential);
+  list.draw(banded, { bands: 7 });
+  assert(differing(sequential, banded) <= 2, `banded replay differs in ${differing(sequential, banded)} pixels`);
+});
+
+addTest('DrawList - offset and clip', () => {
+  const list = new cv.DrawList();
+  list.rectangle(new cv.Rect(0, 0, 10, 10), [255], -1, cv.LINE_8);
+
+  const mat = cv.Mat.zeros(40, 40, cv.CV_8UC1);
+  list.draw(mat, { offset: new cv.Point(20, 20) });
+  assert(cv.countNonZero(mat) === 121 && mat.data[20 * 40 + 20] === 255, `offset: ${cv.countNonZero(mat)} pixels`);
+
+  const clipped = cv.Mat.zeros(40, 40, cv.CV_8UC1);
+  list.draw(clipped, { clip: new cv.Rect(0, 0, 5, 40), bands: 2 });
+  assert(cv.countNonZero(clipped) === 55, `clip: ${cv.countNonZero(clipped)} pixels`);
+});
+
+addTest('DrawList - bounds, text and clear', () => {
+  const list = new cv.DrawList();
+  list.putText('DrawList', new cv.Point(5, 30), cv.FONT_HERSHEY_SIMPLEX, 0.8, [255], 1);
+  list.polylines([new cv.Point(100, 100), new cv.Point(150, 100), new cv.Point(150, 140)], true, [255], 2);
+
+  const b = list.bounds;
+  assert(b.x <= 5 && b.y < 30 && b.x + b.width >= 150 && b.y + b.height >= 140, `bounds ${b}`);
+
+  const mat = cv.Mat.zeros(160, 160, cv.CV_8UC1);
+  list.draw(mat, { bands: 0 });
+  list.draw(mat, { bands: 0 });
+  assert(cv.countNonZero(mat) > 0, 'text and polyline drawn');
+
+  list.clear();
+  assert(list.length === 0, 'cleared');
+});
+
+tests(testCases);
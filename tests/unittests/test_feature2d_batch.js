@@ -0,0 +1,53 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+
+/*
+ * Exercises Feature2D.detectAndComputeBatch(): packed keypoint table,
+ * concatenated descriptors and per-image offsets, compared against
+ * detecting image by image.
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+function texture(seed) {
+  const img = cv.Mat.zeros(120, 160, cv.CV_8UC1);
+  for (let i = 0; i < 12; i++) {
+    const x = (seed * 37 + i * 53) % 140, y = (seed * 23 + i * 29) % 100;
+    cv.rectangle(img, { x, y, width: 12 + (i % 5) * 3, height: 10 + (i % 3) * 4 }, [80 + ((i * 40) % 170)], -1);
+  }
+  return img;
+}
+
+addTest('detectAndComputeBatch - layout', () => {
+  const orb = cv.ORB.create(200);
+  const images = [texture(1), texture(2), cv.Mat.zeros(50, 50, cv.CV_8UC1), texture(3)];
+  const { keypoints, descriptors, offsets } = orb.detectAndComputeBatch(images);
+
+  assert(offsets instanceof Uint32Array && offsets.length === images.length + 1, 'n + 1 offsets');
+  assert(offsets[0] === 0 && offsets[3] === offsets[2], 'a blank image contributes no keypoints');
+  assert(keypoints instanceof Float32Array && keypoints.length === offsets[images.length] * 7, '7 columns per keypoint');
+  assert(descriptors.rows === offsets[images.length] && descriptors.cols === orb.descriptorSize(), `${descriptors.rows}x${descriptors.cols}`);
+});
+
+addTest('detectAndComputeBatch - matches per-image detection', () => {
+  const orb = cv.ORB.create(200);
+  const images = Array.from({ length: 6 }, (_, i) => texture(i + 1));
+  const masks = images.map(() => null);
+  masks[1] = cv.Mat.zeros(120, 160, cv.CV_8UC1);
+  const { keypoints, offsets } = orb.detectAndComputeBatch(images, masks, { threads: 3 });
+
+  images.forEach((img, i) => {
+    const kps = [];
+    orb.detect(img, kps, i === 1 ? masks[1] : undefined);
+    assert(offsets[i + 1] - offsets[i] === kps.length, `image ${i}: ${offsets[i + 1] - offsets[i]} != ${kps.length}`);
+    if (kps.length) assert(Math.abs(keypoints[offsets[i] * 7] - kps[0].pt.x) < 1e-3, `image ${i}: first keypoint differs`);
+  });
+
+  assert(offsets[2] === offsets[1], 'an all-zero mask excludes every keypoint');
+});
+
+tests(testCases);
@@ -0,0 +1,120 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+
+/*
+ * Exercises FileNode.toJS(): scalars, typed-array sequences, Mats, the
+ * depth limit and lazy proxies, on a YAML document read from memory.
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+const yaml = `%YAML:1.0
+---
+name: "calibration"
+count: 3
+scale: 0.5
+missing: ~
+ints: [ 1, 2, 3, 4 ]
+reals: [ 1, 2.5, -3 ]
+mixed: [ 1, "two", { three: 3 } ]
+nested:
+   inner:
+      values: [ 7, 8 ]
+camera: !!opencv-matrix
+   rows: 2
+   cols: 3
+   dt: f
+   data: [ 1., 2., 3., 4., 5., 6. ]
+`;
+
+function open() {
+  return new cv.FileStorage(yaml, cv.FileStorage.READ | cv.FileStorage.MEMORY);
+}
+
+addTest('FileNode.toJS - scalars and typed sequences', () => {
+  const fs = open();
+  const doc = fs.root().toJS();
+
+  assert(doc.name === 'calibration' && doc.count === 3 && doc.scale === 0.5);
+  assert(doc.missing === null);
+  assert(doc.ints instanceof Int32Array && doc.ints.join() === '1,2,3,4', `${doc.ints}`);
+  assert(doc.reals instanceof Float64Array && doc.reals.join() === '1,2.5,-3', `${doc.reals}`);
+  assert(Array.isArray(doc.mixed) && doc.mixed[1] === 'two' && doc.mixed[2].three === 3);
+  assert(doc.nested.inner.values instanceof Int32Array);
+  assert(Object.keys(doc).join() === 'name,count,scale,missing,ints,reals,mixed,nested,camera', Object.keys(doc).join());
+});
+
+addTest('FileNode.toJS - Mats', () => {
+  const fs = open();
+  const { camera } = fs.root().toJS();
+
+  assert(camera instanceof cv.Mat && camera.rows === 2 && camera.cols === 3 && camera.type() === cv.CV_32FC1);
+  assert(new Float32Array(camera.buffer).join() === '1,2,3,4,5,6');
+
+  const typed = fs.getNode('camera').toJS({ matsAsTyped: true });
+
+  assert(typed instanceof Float32Array && typed.join() === '1,2,3,4,5,6');
+  assert(typed.rows === 2 && typed.cols === 3 && typed.channels === 1);
+});
+
+addTest('FileNode.toJS - depth keeps deeper collections as FileNodes', () => {
+  const fs = open();
+  const doc = fs.root().toJS({ depth: 1 });
+
+  assert(doc.count === 3 && doc.ints instanceof Int32Array, 'level 1 is converted');
+  assert(doc.nested instanceof cv.FileNode && doc.nested.isMap(), 'level 2 stays a FileNode');
+  assert(doc.nested.toJS().inner.values[1] === 8);
+  assert(fs.root().toJS({ depth: 0 }) instanceof cv.FileNode);
+});
+
+addTest('FileNode.toJS - lazy proxies', () => {
+  const fs = open();
+  const doc = fs.root().toJS({ lazy: true });
+
+  assert(!Array.isArray(doc) && 'count' in doc && !('absent' in doc));
+  assert(doc.count === 3 && doc.absent === undefined);
+  assert(Object.keys(doc).length === 9, Object.keys(doc).join());
+  assert(doc.nested === doc.nested, 'children are converted once');
+  assert(doc.nested.inner.values instanceof Int32Array, 'numeric sequences are still typed');
+
+  const mixed = doc.mixed;
+  assert(Array.isArray(mixed) === false && mixed instanceof Array, 'sequences have the Array prototype');
+  assert(mixed.length === 3 && mixed[0] === 1 && mixed[2].three === 3 && mixed[3] === undefined);
+  assert([...mixed].length === 3 && mixed.map(x => typeof x).join() === 'number,string,object');
+  assert(JSON.stringify(doc.nested) === '{"inner":{"values":{"0":7,"1":8}}}', JSON.stringify(doc.nested));
+});
+
+const mats = `%YAML:1.0
+---
+${[0, 1, 2, 3, 4, 5, 6, 7].map(i => `cam${i}: !!opencv-matrix
+   rows: 1
+   cols: 2
+   dt: d
+   data: [ ${i}., ${i + 1}. ]
+`).join('')}Symbol.iterator: 1
+`;
+
+addTest('FileNode.toJS - lazy enumeration converts nothing', () => {
+  const fs = new cv.FileStorage(mats, cv.FileStorage.READ | cv.FileStorage.MEMORY);
+  const doc = fs.root().toJS({ lazy: true });
+  /* converted children are data properties, the others still accessors */
+  const converted = () => Object.values(Object.getOwnPropertyDescriptors(doc)).filter(d => d.value instanceof cv.Mat).length;
+
+  assert(Object.keys(doc).length === 9 && 'cam3' in doc, Object.keys(doc).join());
+  for (const key in doc) assert(typeof key === 'string');
+  assert(Object.entries(Object.getOwnPropertyDescriptors(doc)).length === 9);
+  assert(converted() === 0, `enumerating converted ${converted()} Mats`);
+  assert(typeof Object.getOwnPropertyDescriptor(doc, 'cam3').get === 'function', 'cam3 converts on first read');
+
+  assert(doc.cam3 instanceof cv.Mat && new Float64Array(doc.cam3.buffer)[1] === 4);
+  assert(doc.cam3 === doc.cam3 && converted() === 1, `${converted()} conversions after reading cam3 twice`);
+
+  assert(doc['Symbol.iterator'] === 1, 'the YAML key is a string property');
+  assert(doc[Symbol.iterator] === undefined, 'symbols are not looked up as keys');
+});
+
+tests(testCases);
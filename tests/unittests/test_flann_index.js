@@ -0,0 +1,113 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+import * as os from 'os';
+
+/*
+ * Exercises FlannBasedMatcher's persistent index: incremental add() into
+ * a pending block, saveIndex()/loadIndex() round trips for float (KD-tree)
+ * and binary (LSH) descriptors.
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+let seed = 1;
+function random() {
+  seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+  return seed / 0x7fffffff;
+}
+
+function descriptors(rows, cols, type = cv.CV_32F) {
+  const mat = new cv.Mat(rows, cols, type);
+  const data = type === cv.CV_32F ? new Float32Array(mat.buffer) : new Uint8Array(mat.buffer);
+  for (let i = 0; i < data.length; i++) data[i] = type === cv.CV_32F ? random() * 100 : Math.floor(random() * 256);
+  return mat;
+}
+
+function bestMatches(matcher, query) {
+  const matches = [];
+  matcher.match(query, matches);
+  return matches;
+}
+
+addTest('FlannBasedMatcher - incremental add is searched before a rebuild', () => {
+  const base = descriptors(200, 16);
+  const extra = descriptors(20, 16);
+  const matcher = new cv.FlannBasedMatcher({ rebuildRatio: 0.5 });
+
+  assert(matcher.empty, 'a new matcher is empty');
+  matcher.add([base]);
+  assert(!matcher.empty, 'add() fills the train collection');
+  matcher.train();
+  assert(matcher.indexedCount === 200 && matcher.pendingCount === 0, 'first train() builds the index');
+
+  matcher.add([extra]);
+  matcher.train();
+  assert(matcher.pendingCount === 20, 'a small addition stays pending');
+
+  const matches = bestMatches(matcher, extra);
+  assert(matches.length === 20);
+  matches.forEach((m, i) => {
+    assert(m.imgIdx === 1 && m.trainIdx === i && m.distance === 0, `query ${i}: ${JSON.stringify(m)}`);
+  });
+
+  matcher.clear();
+  assert(matcher.empty && matcher.indexedCount === 0 && matcher.pendingCount === 0, 'clear() empties the matcher');
+});
+
+addTest('FlannBasedMatcher - saveIndex / loadIndex round trip', () => {
+  const path = '/tmp/test_flann_index.idx';
+  const sets = [descriptors(150, 32), descriptors(80, 32)];
+  const query = descriptors(25, 32);
+  const matcher = new cv.FlannBasedMatcher({ trees: 2, checks: 64 });
+
+  matcher.add(sets);
+  const before = bestMatches(matcher, query);
+  matcher.saveIndex(path);
+
+  const loaded = new cv.FlannBasedMatcher({ checks: 64 });
+  loaded.loadIndex(path);
+  os.remove(path);
+  assert(loaded.indexedCount === 230 && loaded.pendingCount === 0, `${loaded.indexedCount} rows loaded`);
+  assert(!loaded.empty, 'the loaded sets are in the train collection');
+
+  const after = bestMatches(loaded, query);
+  assert(after.length === before.length);
+  after.forEach((m, i) => {
+    const b = before[i];
+    assert(m.imgIdx === b.imgIdx && m.trainIdx === b.trainIdx && Math.abs(m.distance - b.distance) < 1e-3, `query ${i} differs`);
+  });
+
+  loaded.add([sets[0]]);
+  assert(bestMatches(loaded, sets[0]).every((m, i) => m.distance === 0 && (m.imgIdx === 0 || m.imgIdx === 2)), 'adding to a loaded index');
+});
+
+addTest('FlannBasedMatcher - binary descriptors use LSH', () => {
+  const path = '/tmp/test_flann_index_lsh.idx';
+  const train = descriptors(300, 32, cv.CV_8U);
+  const matcher = new cv.FlannBasedMatcher();
+
+  matcher.add([train]);
+  matcher.saveIndex(path);
+
+  const loaded = new cv.FlannBasedMatcher();
+  loaded.loadIndex(path);
+  os.remove(path);
+  const matches = bestMatches(loaded, train.rowRange(0, 10));
+  assert(matches.every((m, i) => m.trainIdx === i && m.distance === 0), 'exact rows are found');
+});
+
+addTest('saveIndex - needs a FlannBasedMatcher', () => {
+  let threw = false;
+  try {
+    new cv.BFMatcher().saveIndex('/tmp/never.idx');
+  } catch (e) {
+    threw = e instanceof TypeError;
+  }
+  assert(threw);
+});
+
+tests(testCases);
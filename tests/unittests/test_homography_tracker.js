@@ -0,0 +1,107 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+
+/*
+ * Exercises cv.HomographyTracker on a synthetic planar scene: the first
+ * frame is matched against the reference, later frames are followed by
+ * optical flow, and the fitted homographies follow the known warp.
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+let seed = 11;
+function random() {
+  seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+  return seed / 0x7fffffff;
+}
+
+function gray(width, height) {
+  const img = cv.Mat.zeros(height, width, cv.CV_8UC1);
+  new Uint8Array(img.buffer).fill(128);
+  return img;
+}
+
+/* random filled rectangles: plenty of corners for ORB and texture for LK */
+function scene(width, height) {
+  const img = gray(width, height);
+  for (let i = 0; i < 300; i++) {
+    const x = Math.floor(random() * width), y = Math.floor(random() * height);
+    const w = 4 + Math.floor(random() * 30), h = 4 + Math.floor(random() * 30);
+    cv.rectangle(img, { x, y, width: w, height: h }, Math.floor(random() * 256), -1);
+  }
+  return img;
+}
+
+function quad(dx, dy, skew) {
+  return [new cv.Point(dx, dy), new cv.Point(320 + dx + skew, dy), new cv.Point(320 + dx, 240 + dy + skew), new cv.Point(dx - skew, 240 + dy)];
+}
+
+const corners = quad(0, 0, 0);
+
+function warped(reference, M) {
+  const frame = new cv.Mat();
+  cv.warpPerspective(reference, frame, M, new cv.Size(320, 240), cv.INTER_LINEAR, cv.BORDER_CONSTANT, [128]);
+  return frame;
+}
+
+/* largest corner displacement between two homographies, in pixels */
+function cornerError(H, M) {
+  const h = new Float64Array(H.buffer), m = new Float64Array(M.buffer);
+  let worst = 0;
+  for (const { x, y } of corners) {
+    const project = a => {
+      const w = a[6] * x + a[7] * y + a[8];
+      return [(a[0] * x + a[1] * y + a[2]) / w, (a[3] * x + a[4] * y + a[5]) / w];
+    };
+    const [px, py] = project(h), [qx, qy] = project(m);
+    worst = Math.max(worst, Math.hypot(px - qx, py - qy));
+  }
+  return worst;
+}
+
+addTest('HomographyTracker - redetects once, then tracks', () => {
+  const reference = scene(320, 240);
+  const tracker = new cv.HomographyTracker(reference, { features: 800 });
+
+  assert(tracker.referenceSize > 100, `${tracker.referenceSize} reference keypoints`);
+
+  for (let i = 0; i < 6; i++) {
+    const M = cv.getPerspectiveTransform(corners, quad(2 * i, i, i / 2));
+    const result = tracker.update(warped(reference, M));
+
+    assert(result.found, `frame ${i}: no homography`);
+    assert(result.redetected === (i === 0), `frame ${i}: redetected = ${result.redetected}`);
+    assert(result.inliers >= 40 && result.inliers <= result.tracked, `frame ${i}: ${result.inliers} of ${result.tracked}`);
+    assert(result.H.rows === 3 && result.H.cols === 3 && result.H.type() === cv.CV_64F);
+    assert(cornerError(result.H, M) < 2, `frame ${i}: corners off by ${cornerError(result.H, M)}`);
+  }
+
+  assert(tracker.trackedCount >= 40);
+});
+
+addTest('HomographyTracker - redetectInterval and reset()', () => {
+  const reference = scene(320, 240);
+  const tracker = new cv.HomographyTracker(reference, { redetectInterval: 2 });
+  const flags = [];
+
+  for (let i = 0; i < 5; i++) flags.push(tracker.update(warped(reference, cv.getPerspectiveTransform(corners, quad(i, 0, 0)))).redetected);
+
+  assert(flags.join() === 'true,false,true,false,true', flags.join());
+
+  tracker.reset();
+  assert(tracker.trackedCount === 0);
+  assert(tracker.update(reference).redetected, 'reset() forces a redetection');
+});
+
+addTest('HomographyTracker - unrelated frame finds no homography', () => {
+  const tracker = new cv.HomographyTracker(scene(320, 240));
+  const result = tracker.update(gray(320, 240));
+
+  assert(!result.found && result.H === null && result.redetected);
+});
+
+tests(testCases);
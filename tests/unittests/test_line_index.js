@@ -0,0 +1,137 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+
+/*
+ * Exercises cv.LineIndex: construction from packed segments and Line
+ * objects, nearest/radius/box/endpoint queries, insert and remove. Results
+ * are checked against a brute-force scan over the same segments. Also
+ * covers cv.mergeSegments() and cv.joinSegments(), which are built on it.
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+// A pseudo-random but reproducible set of short segments.
+function segments(n, seed = 1) {
+  const out = new Float32Array(n * 4);
+  let s = seed;
+  const rnd = () => ((s = (s * 1103515245 + 12345) & 0x7fffffff) / 0x7fffffff) * 500;
+  for (let i = 0; i < n; i++) {
+    const x = rnd(), y = rnd();
+    out.set([x, y, x + rnd() / 20 - 12, y + rnd() / 20 - 12], i * 4);
+  }
+  return out;
+}
+
+function lineAt(arr, i) {
+  return new cv.Line(arr[i * 4], arr[i * 4 + 1], arr[i * 4 + 2], arr[i * 4 + 3]);
+}
+
+addTest('LineIndex - construction from a Float32Array', () => {
+  const index = new cv.LineIndex(segments(100));
+  assert(index.size === 100, `size: got ${index.size}`);
+  assert(index.cellSize > 0, 'cell size chosen from the segments');
+  const l = index.get(3);
+  assert(l instanceof cv.Line, 'get() returns a Line');
+});
+
+addTest('LineIndex - nearest() matches a linear scan', () => {
+  const segs = segments(300);
+  const index = new cv.LineIndex(segs);
+  const p = new cv.Point(250, 250);
+  let best = -1, bestDist = Infinity;
+  for (let i = 0; i < 300; i++) {
+    const d = lineAt(segs, i).distance(p);
+    if (d < bestDist) (bestDist = d), (best = i);
+  }
+  const ids = index.nearest(p);
+  assert(ids instanceof Int32Array && ids.length === 1, `got ${ids}`);
+  assert(Math.abs(lineAt(segs, ids[0]).distance(p) - bestDist) < 1e-4, `got ${ids[0]}, expected ${best}`);
+  assert(index.nearest(p, 5).length === 5, 'k = 5');
+});
+
+addTest('LineIndex - nearest(id) excludes the segment itself', () => {
+  const index = new cv.LineIndex([new cv.Line(0, 0, 10, 0), new cv.Line(0, 5, 10, 5), new cv.Line(0, 50, 10, 50)]);
+  const ids = index.nearest(0, 2);
+  assert(ids.length === 2 && ids[0] === 1 && ids[1] === 2, `got ${ids.join()}`);
+});
+
+addTest('LineIndex - radius() and box()', () => {
+  const index = new cv.LineIndex([new cv.Line(0, 0, 100, 0), new cv.Line(0, 20, 100, 20), new cv.Line(200, 200, 210, 210)], 16);
+  assert(index.radius(new cv.Point(50, 8), 10).join() === '0', 'radius 10');
+  assert(index.radius(new cv.Point(50, 8), 12).join() === '0,1', 'radius 12');
+  assert(index.box(new cv.Rect(90, -5, 200, 10)).join() === '0', 'box');
+  assert(index.box(new cv.Rect(205, 0, 10, 300)).join() === '2', 'box crossing a diagonal');
+});
+
+addTest('LineIndex - endpoints()', () => {
+  const index = new cv.LineIndex([new cv.Line(0, 0, 10, 0), new cv.Line(10, 1, 10, 20), new cv.Line(30, 30, 40, 40)]);
+  const { ids, ends } = index.endpoints(new cv.Point(10, 0), 2);
+  assert(ids.join() === '0,1' && ends.join() === '1,0', `ids ${ids.join()} ends ${ends.join()}`);
+});
+
+addTest('LineIndex - insert() and remove()', () => {
+  const index = new cv.LineIndex(8);
+  const id = index.insert(new cv.Line(0, 0, 10, 10));
+  const ids = index.insert(new Float32Array([100, 100, 110, 100, 5, 5, 6, 6]));
+  assert(id === 0 && ids.join() === '1,2', `ids ${id} ${ids.join()}`);
+  assert(index.size === 3, 'size after insert');
+  assert(index.remove(0) && !index.remove(0), 'remove once');
+  assert(index.nearest(new cv.Point(0, 0)).join() === '2', 'removed segment no longer found');
+  assert(index.get(0) === undefined && index.size === 2, 'removed');
+});
+
+addTest('mergeSegments - collinear fragments become one segment', () => {
+  const frags = new Float32Array([0, 0, 10, 0, 11, 0.2, 20, 0, 21, 0, 30, 0.1, 0, 10, 30, 10, 40, 0, 40, 30]);
+  const merged = cv.mergeSegments(frags, { angleTol: 0.05, gapTol: 2, offsetTol: 0.5 });
+  assert(merged instanceof Float32Array && merged.length === 3 * 4, `got ${merged.length / 4} segments`);
+  assert(Math.abs(merged[0]) < 0.5 && Math.abs(merged[2] - 30) < 0.5, `span ${merged[0]}..${merged[2]}`);
+  assert(cv.mergeSegments(frags, { gapTol: 0.5 }).length === 5 * 4, 'gaps larger than gapTol stay apart');
+});
+
+addTest('mergeSegments - a slowly curving chain is not straightened', () => {
+  const params = { angleTol: 0.05, gapTol: 2, offsetTol: 0.5 };
+  const radius = 500, arc = new Float32Array(20 * 4);
+
+  /* every fragment turns 0.02 rad and is within the tolerances of the next */
+  for (let i = 0; i < 20; i++) {
+    const a0 = i * 0.022, a1 = a0 + 0.02;
+    arc.set([radius * Math.sin(a0), radius - radius * Math.cos(a0), radius * Math.sin(a1), radius - radius * Math.cos(a1)], i * 4);
+  }
+
+  const merged = cv.mergeSegments(arc, params);
+  assert(merged.length > 4, 'the chain is split');
+
+  const undirected = a => ((a % Math.PI) + Math.PI) % Math.PI;
+  const angle = (v, i) => undirected(Math.atan2(v[i * 4 + 3] - v[i * 4 + 1], v[i * 4 + 2] - v[i * 4]));
+
+  /* each fragment lies along one of the merged segments */
+  for (let i = 0; i < 20; i++) {
+    let found = false;
+
+    for (let j = 0; j < merged.length / 4 && !found; j++) {
+      const [x0, y0, x1, y1] = merged.subarray(j * 4, j * 4 + 4);
+      const len = Math.hypot(x1 - x0, y1 - y0), nx = -(y1 - y0) / len, ny = (x1 - x0) / len;
+      const offset = (x, y) => Math.abs((x - x0) * nx + (y - y0) * ny);
+      const d = Math.abs(angle(arc, i) - angle(merged, j));
+
+      found = Math.min(d, Math.PI - d) <= params.angleTol && offset(arc[i * 4], arc[i * 4 + 1]) <= params.offsetTol && offset(arc[i * 4 + 2], arc[i * 4 + 3]) <= params.offsetTol;
+    }
+
+    assert(found, `fragment ${i} is off every merged segment`);
+  }
+});
+
+addTest('joinSegments - chains and closed loops', () => {
+  const segs = [new cv.Line(0, 0, 10, 0), new cv.Line(20, 0.5, 10.5, 0), new cv.Line(50, 50, 60, 50), new cv.Line(60, 50, 60, 60), new cv.Line(60, 60, 50, 50)];
+  const { points, offsets } = cv.joinSegments(segs, 1);
+  assert(offsets instanceof Uint32Array && offsets.length === 3, `offsets ${offsets.join()}`);
+  assert(offsets[1] === 3 && offsets[2] === 7, `offsets ${offsets.join()}`);
+  assert(points[2] === 10.25 && points[4] === 20, `chain ${Array.from(points.subarray(0, 6)).join()}`);
+  assert(points[6] === points[12] && points[7] === points[13], 'loop is closed');
+});
+
+tests(testCases);
@@ -0,0 +1,150 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+import * as std from 'std';
+
+/*
+ * Exercises cv.saveMat()/cv.loadMat(): single and named entries, types
+ * and non-continuous sources, mapped vs copied loading, and zstd entries
+ * where the build has zstd.
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+const path = '/tmp/test_mat_container.qjsmat';
+
+function filled(rows, cols, type, Ctor) {
+  const mat = new cv.Mat(rows, cols, type);
+  const data = new Ctor(mat.buffer);
+  for (let i = 0; i < data.length; i++) data[i] = (i * 37) % 251;
+  return mat;
+}
+
+function same(a, b, Ctor) {
+  if (a.rows !== b.rows || a.cols !== b.cols || a.type() !== b.type()) return false;
+  const x = new Ctor(a.buffer), y = new Ctor(b.buffer);
+  return x.length === y.length && x.every((v, i) => v === y[i]);
+}
+
+addTest('saveMat/loadMat - single Mat round trip', () => {
+  const mat = filled(120, 80, cv.CV_32FC1, Float32Array);
+
+  cv.saveMat(path, mat);
+  const loaded = cv.loadMat(path);
+
+  assert(loaded instanceof cv.Mat, 'a single Mat loads as a Mat');
+  assert(same(mat, loaded, Float32Array), 'contents match');
+});
+
+addTest('saveMat/loadMat - named entries of several types', () => {
+  const entries = {
+    distances: filled(64, 64, cv.CV_32FC1, Float32Array),
+    descriptors: filled(500, 32, cv.CV_8UC1, Uint8Array),
+    points: filled(10, 1, cv.CV_64FC2, Float64Array),
+    labels: filled(7, 9, cv.CV_16SC3, Int16Array),
+  };
+
+  cv.saveMat(path, entries);
+  const loaded = cv.loadMat(path);
+
+  assert(Object.keys(loaded).join() === Object.keys(entries).join(), Object.keys(loaded).join());
+  assert(same(entries.distances, loaded.distances, Float32Array));
+  assert(same(entries.descriptors, loaded.descriptors, Uint8Array));
+  assert(same(entries.points, loaded.points, Float64Array));
+  assert(same(entries.labels, loaded.labels, Int16Array));
+});
+
+addTest('saveMat/loadMat - non-continuous source is stored densely', () => {
+  const mat = filled(40, 40, cv.CV_8UC1, Uint8Array);
+  const roi = mat.colRange(5, 25);
+
+  cv.saveMat(path, { roi });
+  const { roi: loaded } = cv.loadMat(path);
+
+  assert(loaded.rows === 40 && loaded.cols === 20);
+  assert(same(roi.clone(), loaded, Uint8Array), 'rows are gathered from the strided source');
+});
+
+addTest('loadMat - writes to mapped Mats stay private', () => {
+  cv.saveMat(path, filled(16, 16, cv.CV_8UC1, Uint8Array));
+
+  const first = cv.loadMat(path);
+  new Uint8Array(first.buffer).fill(0);
+  const second = cv.loadMat(path);
+  const copy = cv.loadMat(path, { copy: true });
+
+  assert(new Uint8Array(second.buffer)[1] === 37, 'the file is unchanged');
+  assert(same(second, copy, Uint8Array), 'copied and mapped loads agree');
+});
+
+addTest('saveMat/loadMat - zstd entries', () => {
+  const mat = cv.Mat.zeros(256, 256, cv.CV_32FC1);
+
+  try {
+    cv.saveMat(path, { mat }, { compress: true });
+  } catch (e) {
+    assert(/zstd/.test(e.message), e.message);
+    return;
+  }
+
+  const loaded = cv.loadMat(path).mat;
+  assert(same(mat, loaded, Float32Array), 'decompressed contents match');
+});
+
+function patchFile(file, patch) {
+  let f = std.open(file, 'rb');
+  f.seek(0, std.SEEK_END);
+  const buf = new ArrayBuffer(f.tell());
+  f.seek(0, std.SEEK_SET);
+  f.read(buf, 0, buf.byteLength);
+  f.close();
+
+  patch(new DataView(buf));
+
+  f = std.open(file, 'wb');
+  f.write(buf, 0, buf.byteLength);
+  f.close();
+}
+
+addTest('loadMat - rejects overlapping steps', () => {
+  cv.saveMat(path, { m: filled(8, 8, cv.CV_8UC1, Uint8Array) });
+
+  /* header (24 bytes), entry record (40), name 'm', 2 sizes, then steps[0] */
+  const step0 = 24 + 40 + 1 + 2 * 4;
+
+  for (const step of [1, 7]) {
+    let error;
+
+    patchFile(path, view => view.setBigUint64(step0, BigInt(step), true));
+
+    try {
+      cv.loadMat(path);
+    } catch (e) {
+      error = e;
+    }
+
+    assert(error !== undefined, `steps [${step}, 1] for 8 x 8 are rejected`);
+  }
+
+  patchFile(path, view => view.setBigUint64(step0, 8n, true));
+  assert(cv.loadMat(path).m.rows === 8, 'the dense header loads again');
+});
+
+addTest('loadMat - rejects other files', () => {
+  let error;
+
+  cv.imwrite('/tmp/test_mat_container.png', filled(8, 8, cv.CV_8UC1, Uint8Array));
+
+  try {
+    cv.loadMat('/tmp/test_mat_container.png');
+  } catch (e) {
+    error = e;
+  }
+
+  assert(error !== undefined, 'a non-container file throws');
+});
+
+tests(testCases);
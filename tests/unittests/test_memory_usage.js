@@ -0,0 +1,94 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+import * as std from 'std';
+
+/*
+ * Exercises cv.memoryUsage()/cv.setMemoryThreshold(): pixel buffers are
+ * counted when allocated and released, and garbage holding large Mats is
+ * collected once the threshold is crossed.
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+const MB = 1 << 20;
+
+addTest('memoryUsage - counts buffers and objects', () => {
+  const before = cv.memoryUsage();
+  const mat = new cv.Mat(1024, 1024, cv.CV_32FC1);
+  const vector = new cv.MatVector();
+  const during = cv.memoryUsage();
+
+  assert(during.live - before.live >= 4 * MB, `live grew by ${during.live - before.live}`);
+  assert(during.peak >= during.live && during.buffers > before.buffers);
+  assert(during.Mat === before.Mat + 1 && during.Vector === before.Vector + 1, `${during.Mat} Mats, ${during.Vector} vectors`);
+
+  mat.release();
+  assert(cv.memoryUsage().live <= during.live - 4 * MB, 'release() returns the buffer');
+  vector.delete();
+});
+
+addTest('memoryUsage - views share the buffer', () => {
+  const mat = new cv.Mat(512, 512, cv.CV_8UC4);
+  const live = cv.memoryUsage().live;
+  const roi = mat.rowRange(0, 100);
+
+  assert(cv.memoryUsage().live === live, 'a view allocates nothing');
+  mat.release();
+  assert(cv.memoryUsage().live === live, 'the view keeps the buffer alive');
+  roi.release();
+  assert(cv.memoryUsage().live <= live - 512 * 512 * 4, 'the last reference frees it');
+});
+
+addTest('memoryUsage - UMats returned by methods are counted', () => {
+  const before = cv.memoryUsage().UMat;
+
+  (() => {
+    const umat = new cv.UMat(16, 16, cv.CV_8UC1);
+    const derived = [umat.row(1), umat.col(2), umat.rowRange(0, 4), umat.clone()];
+
+    assert(cv.memoryUsage().UMat === before + 1 + derived.length, `${cv.memoryUsage().UMat - before} UMats`);
+  })();
+
+  std.gc();
+  assert(cv.memoryUsage().UMat === before, `${cv.memoryUsage().UMat - before} UMats after collection`);
+});
+
+addTest('setMemoryThreshold - unreachable cycles holding Mats are collected', () => {
+  const { threshold } = cv.memoryUsage();
+  const { collections } = cv.memoryUsage();
+
+  cv.setMemoryThreshold(16 * MB);
+
+  try {
+    for (let i = 0; i < 64; i++) {
+      /* reference counting alone can't free a cycle */
+      const frame = { mat: new cv.Mat(1024, 1024, cv.CV_32FC1) };
+      frame.self = frame;
+    }
+
+    const after = cv.memoryUsage();
+
+    assert(after.collections > collections, 'the threshold triggered collections');
+    assert(after.live < 32 * MB, `${after.live} bytes still live after 256MB of frames`);
+  } finally {
+    cv.setMemoryThreshold(threshold);
+  }
+});
+
+addTest('setMemoryThreshold - rejects negative values', () => {
+  let error;
+
+  try {
+    cv.setMemoryThreshold(-1);
+  } catch (e) {
+    error = e;
+  }
+
+  assert(error instanceof RangeError);
+});
+
+tests(testCases);
@@ -0,0 +1,69 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+
+/*
+ * Exercises cv.PointArray: construction, zero-copy toMat(), the in-place
+ * translate/scale/transform operations, boundingRect/distanceTo/nearest,
+ * filter(), and passing a PointArray where OpenCV expects a point list.
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+const near = (a, b, eps = 1e-4) => Math.abs(a - b) < eps;
+
+addTest('PointArray - construction and element access', () => {
+  const pa = new cv.PointArray([new cv.Point(1, 2), new cv.Point(3, 4)]);
+  assert(pa.length === 2 && pa.depth === cv.CV_32F, `length ${pa.length} depth ${pa.depth}`);
+  assert(pa.at(1).x === 3 && pa.at(1).y === 4, 'at(1)');
+  assert(pa.push(new cv.Point(5, 6), new cv.Point(7, 8)) === 4, 'push returns the length');
+  pa.set(0, new cv.Point(-1, -2));
+  assert(pa.toTypedArray().join() === '-1,-2,3,4,5,6,7,8', `got ${pa.toTypedArray().join()}`);
+  const d = new cv.PointArray(new Float64Array([0.5, 1.5]));
+  assert(d.depth === cv.CV_64F && d.length === 1, 'Float64Array gives a CV_64F array');
+});
+
+addTest('PointArray - toMat() shares storage', () => {
+  const pa = new cv.PointArray(new Float32Array([1, 2, 3, 4]));
+  const mat = pa.toMat();
+  assert(mat.rows === 2 && mat.type() === cv.CV_32FC2, `rows ${mat.rows} type ${mat.type()}`);
+  pa.translate(10, 20);
+  const view = new cv.PointArray(mat);
+  assert(view.at(0).x === 11 && view.at(1).y === 24, 'Mat sees the translated points');
+});
+
+addTest('PointArray - scale and transform', () => {
+  const pa = new cv.PointArray(new Float32Array([2, 2, 4, 6]));
+  pa.scale(2, 3, new cv.Point(2, 2));
+  assert(pa.toTypedArray().join() === '2,2,6,14', `scale: ${pa.toTypedArray().join()}`);
+  pa.transform([0, -1, 0, 1, 0, 0]);
+  assert(pa.toTypedArray().join() === '-2,2,-14,6', `rotate: ${pa.toTypedArray().join()}`);
+});
+
+addTest('PointArray - boundingRect, distanceTo and nearest', () => {
+  const pa = new cv.PointArray(new Float32Array([0, 0, 3, 4, -1.5, 2, 10, 10]));
+  const r = pa.boundingRect();
+  assert(r.x === -1.5 && r.y === 0 && r.width === 11.5 && r.height === 10, `rect ${r}`);
+  const d = pa.distanceTo(new cv.Point(0, 0));
+  assert(d instanceof Float32Array && near(d[1], 5) && near(d[2], 2.5), `distances ${d.join()}`);
+  assert(pa.nearest(new cv.Point(9, 8)) === 3, 'nearest');
+});
+
+addTest('PointArray - filter by predicate and mask', () => {
+  const pa = new cv.PointArray(new Float32Array([0, 0, 5, 5, 10, 10]));
+  const far = pa.filter((x, y) => x > 1);
+  assert(far instanceof cv.PointArray && far.length === 2 && far.at(0).x === 5, 'predicate');
+  const masked = pa.filter(new Uint8Array([1, 0, 1]));
+  assert(masked.toTypedArray().join() === '0,0,10,10', `mask: ${masked.toTypedArray().join()}`);
+});
+
+addTest('PointArray - accepted as an OpenCV point list', () => {
+  const pa = new cv.PointArray(new Float32Array([0, 0, 10, 0, 10, 10, 0, 10]));
+  assert(near(cv.contourArea(pa), 100), `contourArea ${cv.contourArea(pa)}`);
+  assert(near(cv.arcLength(pa, true), 40), `arcLength ${cv.arcLength(pa, true)}`);
+});
+
+tests(testCases);
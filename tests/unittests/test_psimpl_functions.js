@@ -184,6 +184,72 @@ for (const { label, build, source, resultClass, eps } of INPUT_KINDS) {
   };
 }
 
+// ----- *Batch(): a contour set in, packed { points, offsets } out -----
+//
+// Each contour of the batch must come out exactly as the single-contour
+// call would simplify it on its own.
+
+function unpackBatch(r) {
+  const out = [];
+  for (let i = 0; i + 1 < r.offsets.length; i++) {
+    const pts = [];
+    for (let j = r.offsets[i]; j < r.offsets[i + 1]; j++)
+      pts.push({ x: r.points[j * 2], y: r.points[j * 2 + 1] });
+    out.push(pts);
+  }
+  return out;
+}
+
+function assertSameAsSingle(batch, contours, name, args) {
+  const got = unpackBatch(batch);
+  if (got.length !== contours.length)
+    throw new Error(`Expected ${contours.length} contours, got ${got.length}`);
+  contours.forEach((c, k) => {
+    if (c.length === 0) {
+      if (got[k].length !== 0) throw new Error(`Contour ${k}: expected no points, got ${got[k].length}`);
+      return;
+    }
+    const single = cv.psimpl[name](matFromPoints32S(c), ...args);
+    if (got[k].length !== countOf(single))
+      throw new Error(`Contour ${k}: ${got[k].length} points, single call gave ${countOf(single)}`);
+    got[k].forEach((p, i) => {
+      const q = pointAt(single, i);
+      if (p.x !== q.x || p.y !== q.y)
+        throw new Error(`Contour ${k} point ${i}: got ${JSON.stringify(p)}, expected ${JSON.stringify(q)}`);
+    });
+  });
+}
+
+const BATCH_CONTOURS = [INT_POINTS, INT_POINTS.slice(5, 30), INT_POINTS.slice(0, 2), []];
+
+for (const { name, args } of TOLERANCE_METHODS) {
+  testSuite[`psimpl.${name}Batch - array of Mats`] = () => {
+    const r = cv.psimpl[`${name}Batch`](BATCH_CONTOURS.map(matFromPoints32S), ...args);
+    if (!(r.points instanceof Int32Array) || !(r.offsets instanceof Uint32Array))
+      throw new Error('Expected Int32Array points and Uint32Array offsets');
+    assertSameAsSingle(r, BATCH_CONTOURS, name, args);
+  };
+}
+
+testSuite['psimpl.douglasPeuckerBatch - packed input'] = () => {
+  const points = new Int32Array(BATCH_CONTOURS.reduce((n, c) => n + c.length * 2, 0));
+  const offsets = new Uint32Array(BATCH_CONTOURS.length + 1);
+  let n = 0;
+  BATCH_CONTOURS.forEach((c, k) => {
+    c.forEach(p => { points[n * 2] = p.x; points[n * 2 + 1] = p.y; n++; });
+    offsets[k + 1] = n;
+  });
+  assertSameAsSingle(cv.psimpl.douglasPeuckerBatch({ points, offsets }, 3.0), BATCH_CONTOURS, 'douglasPeucker', [3.0]);
+};
+
+testSuite['psimpl.douglasPeuckerBatch - Point2fVector contours give Float32Array'] = () => {
+  const r = cv.psimpl.douglasPeuckerBatch([point2fVectorFromPoints(FLOAT_POINTS)], 3.0);
+  if (!(r.points instanceof Float32Array))
+    throw new Error(`Expected Float32Array, got ${r.points}`);
+  if (r.offsets[1] < 2 || r.offsets[1] >= FLOAT_POINTS.length)
+    throw new Error(`Expected a simplified contour, got ${r.offsets[1]} points`);
+};
+
 // ----- Argument-type validation -----
 
 testSuite['psimpl.douglasPeucker - rejects an unsupported input type'] = () => {
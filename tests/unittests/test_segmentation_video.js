@@ -118,6 +118,64 @@ addTest('createBackgroundSubtractorMOG2 + apply - foreground mask', () => {
   assert(fgmask.rows === 20 && fgmask.cols === 20, 'expected a full-size foreground mask');
 });
 
+addTest('applyBackgroundSubtractors - one call for several streams', () => {
+  const streams = 4;
+  const subtractors = [], parallel = [];
+  for (let i = 0; i < streams; i++) {
+    subtractors.push(cv.createBackgroundSubtractorMOG2(500, 16, false));
+    parallel.push(cv.createBackgroundSubtractorMOG2(500, 16, false));
+  }
+
+  const frame = i => {
+    const img = cv.Mat.zeros(40, 40, cv.CV_8UC3);
+    cv.rectangle(img, { x: 4 * i, y: 4 * i, width: 10, height: 10 }, [255, 255, 255], -1);
+    return img;
+  };
+
+  const given = new cv.Mat();
+  let masks;
+  for (let t = 0; t < 3; t++) {
+    const frames = Array.from({ length: streams }, (_, i) => frame(i + t));
+    masks = cv.applyBackgroundSubtractors(parallel, frames, [given], 0.5);
+    frames.forEach((f, i) => {
+      const expected = new cv.Mat();
+      subtractors[i].apply(f, expected, 0.5);
+      const diff = new cv.Mat();
+      cv.absdiff(expected, masks[i], diff);
+      assert(cv.countNonZero(diff) === 0, `stream ${i} differs from apply()`);
+    });
+  }
+
+  assert(masks.length === streams);
+  assert(masks[0] === given, 'a passed mask is filled in place');
+  assert(masks.every(m => m.rows === 40 && m.cols === 40));
+});
+
+addTest('applyBackgroundSubtractors - downscaled model', () => {
+  const subtractors = [cv.createBackgroundSubtractorKNN(), cv.createBackgroundSubtractorMOG2()];
+  const frames = [cv.Mat.zeros(64, 48, cv.CV_8UC1), cv.Mat.zeros(64, 48, cv.CV_8UC3)];
+  const masks = cv.applyBackgroundSubtractors(subtractors, frames, undefined, { scale: 0.5 });
+
+  assert(masks.every(m => m.rows === 64 && m.cols === 48), 'masks come back at frame size');
+
+  let threw = false;
+  try {
+    cv.applyBackgroundSubtractors([subtractors[0], subtractors[0]], frames);
+  } catch (e) {
+    threw = true;
+  }
+  assert(threw, 'the same subtractor twice is rejected');
+
+  const mask = new cv.Mat(64, 48, cv.CV_8UC1);
+  threw = false;
+  try {
+    cv.applyBackgroundSubtractors(subtractors, frames, [mask, mask]);
+  } catch (e) {
+    threw = e instanceof RangeError;
+  }
+  assert(threw, 'the same mask twice is rejected');
+});
+
 addTest('meanShift - fixed-window object tracking', () => {
   const prob = cv.Mat.zeros(60, 60, cv.CV_8UC1);
   cv.rectangle(prob, { x: 25, y: 25, width: 20, height: 20 }, 200, -1);
@@ -0,0 +1,63 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+
+/*
+ * Exercises the bulk and packed typed-array forms of cv.Subdiv2D:
+ * insert(Float32Array), getTriangleList(), getTriangleList({ indices: true }),
+ * getEdgeList() and getVoronoiFacetList().
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+// Unit square corners plus its center: 4 Delaunay triangles.
+const square = new Float32Array([10, 10, 90, 10, 90, 90, 10, 90, 50, 50]);
+
+function subdiv(points = square) {
+  const s = new cv.Subdiv2D(new cv.Rect(0, 0, 100, 100));
+  s.insert(points);
+  return s;
+}
+
+addTest('Subdiv2D - bulk insert returns one vertex id per point', () => {
+  const s = new cv.Subdiv2D(new cv.Rect(0, 0, 100, 100));
+  const ids = s.insert(new Float32Array([10, 10, 90, 10, 500, 500, 50, 50]));
+  assert(ids instanceof Int32Array && ids.length === 4, `got ${ids}`);
+  assert(ids[2] === -1, 'point outside the rect should be rejected');
+  assert(ids[0] >= 4 && ids[1] > ids[0] && ids[3] > ids[1], `ids: ${ids.join()}`);
+});
+
+addTest('Subdiv2D - getTriangleList() packs 6 floats per triangle', () => {
+  const tris = subdiv().getTriangleList();
+  assert(tris instanceof Float32Array, 'Float32Array expected');
+  assert(tris.length === 4 * 6, `length: got ${tris.length}`);
+});
+
+addTest('Subdiv2D - indexed triangles match the coordinate form', () => {
+  const s = subdiv();
+  const ids = s.insert(new Float32Array(0));
+  const tris = s.getTriangleList();
+  const idx = s.getTriangleList({ indices: true });
+  assert(ids.length === 0, 'empty insert');
+  assert(idx instanceof Int32Array && idx.length === tris.length / 2, `length: got ${idx.length}`);
+  for (let i = 0; i < idx.length; i++) {
+    const p = s.getVertex(idx[i]);
+    assert(p.x === tris[2 * i] && p.y === tris[2 * i + 1], `vertex ${i} differs`);
+  }
+});
+
+addTest('Subdiv2D - getEdgeList() packs 4 floats per edge', () => {
+  const edges = subdiv().getEdgeList();
+  assert(edges instanceof Float32Array && edges.length % 4 === 0 && edges.length > 0, `got ${edges.length}`);
+});
+
+addTest('Subdiv2D - packed Voronoi facets', () => {
+  const { points, offsets, centers } = subdiv().getVoronoiFacetList([]);
+  assert(centers.length === 5 * 2, `centers: got ${centers.length}`);
+  assert(offsets.length === 6 && offsets[0] === 0 && offsets[5] * 2 === points.length, `offsets: ${offsets.join()}`);
+});
+
+tests(testCases);
@@ -0,0 +1,99 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+
+/*
+ * Exercises cv.SvgWriter: in-memory and chunked output, path data
+ * compression in relative and absolute mode, placement transforms, and
+ * segment/ellipse output.
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+function text(buf) {
+  let s = '';
+  for (const c of new Uint8Array(buf)) s += String.fromCharCode(c);
+  return s;
+}
+
+const square = {
+  points: new Int32Array([0, 0, 10, 0, 10, 10, 0, 10]),
+  offsets: new Uint32Array([0, 4]),
+};
+
+addTest('SvgWriter - in-memory document', () => {
+  const svg = new cv.SvgWriter(undefined, { width: 100, height: 50 });
+  svg.contours(square, { fill: 'red' });
+  const out = text(svg.finish());
+
+  assert(out.startsWith('<svg xmlns="http://www.w3.org/2000/svg" width="100" height="50" viewBox="0 0 100 50">'), out);
+  assert(out.trimEnd().endsWith('</svg>'), out);
+  assert(out.includes('<path d="m0 0h10v10h-10z" fill="red"/>'), out);
+});
+
+addTest('SvgWriter - absolute coordinates and precision', () => {
+  const svg = new cv.SvgWriter(undefined, { precision: 2, relative: false });
+  svg.polylines([[new cv.Point(1.5, 2), new cv.Point(3.25, 2), new cv.Point(3.25, -0.5)]]);
+  const out = text(svg.finish());
+
+  assert(out.includes('d="M1.5 2H3.25V-.5"'), out);
+  assert(out.includes('fill="none"'), out);
+});
+
+addTest('SvgWriter - chunked callback matches in-memory output', () => {
+  const chunks = [];
+  const streamed = new cv.SvgWriter(buf => chunks.push(buf), { chunkSize: 64 });
+  const memory = new cv.SvgWriter();
+
+  for (const svg of [streamed, memory])
+    for (let i = 0; i < 20; i++) svg.contours([[new cv.Point(i, i), new cv.Point(i + 5, i), new cv.Point(i, i + 5)]]);
+
+  assert(streamed.finish() === undefined, 'callback output returns nothing');
+  const whole = text(memory.finish());
+
+  assert(chunks.length > 1, `${chunks.length} chunks`);
+  assert(chunks.every(c => c instanceof ArrayBuffer));
+  assert(chunks.map(text).join('') === whole, 'chunks concatenate to the in-memory document');
+  assert(streamed.bytesWritten === whole.length, `${streamed.bytesWritten} bytes`);
+});
+
+addTest('SvgWriter - placement transform', () => {
+  const svg = new cv.SvgWriter(undefined, { relative: false });
+  svg.setTransform([1, 0, 5, 0, 1, 7]);
+  svg.polylines([[new cv.Point(0, 0), new cv.Point(10, 0)]]);
+  svg.setTransform(null);
+  svg.polylines([[new cv.Point(0, 0), new cv.Point(10, 0)]]);
+  const out = text(svg.finish());
+
+  assert(out.includes('d="M5 7H15"'), out);
+  assert(out.includes('d="M0 0H10"'), out);
+});
+
+addTest('SvgWriter - lines and ellipses', () => {
+  const svg = new cv.SvgWriter();
+  svg.lines(new Float32Array([0, 0, 10, 10, 20, 20, 20, 30]), { stroke: 'blue' });
+  svg.ellipses([new cv.RotatedRect(new cv.Point(50, 40), new cv.Size(20, 10), 0)]);
+  svg.setTransform([1, 0, 0, 0, 1, 0, 0.001, 0, 1]);
+  svg.ellipses([new cv.RotatedRect(new cv.Point(50, 40), new cv.Size(20, 10), 0)]);
+  const out = text(svg.finish());
+
+  assert(out.includes('<path d="m0 0 10 10m10 10v10" fill="none" stroke="blue"/>'), out);
+  assert(out.includes('<ellipse cx="50" cy="40" rx="10" ry="5"/>'), out);
+  assert(/<path d="m[^"]+z"\/>/.test(out), 'perspective ellipse is sampled into a path');
+});
+
+addTest('SvgWriter - groups', () => {
+  const svg = new cv.SvgWriter();
+  svg.beginGroup({ strokeWidth: 2 });
+  assert(svg.depth === 1);
+  svg.beginGroup();
+  const out = text(svg.finish());
+
+  assert(out.includes('<g stroke-width="2">'), out);
+  assert(out.split('</g>').length === 3, 'open groups are closed by finish()');
+});
+
+tests(testCases);
@@ -0,0 +1,65 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+
+/*
+ * Exercises cv.thumbnails(paths, maxSize, options), the batch preview
+ * decoder used by js/vectorizer's stage 1 (src/thumbnail.cpp). Inputs are
+ * synthetic images written to /tmp, so the test needs no fixtures.
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+function writeImage(file, cols, rows) {
+  const mat = new cv.Mat(rows, cols, cv.CV_8UC3);
+  mat.setTo([40, 120, 200, 0]);
+  cv.rectangle(mat, { x: cols / 4, y: rows / 4, width: cols / 2, height: rows / 2 }, [255, 255, 255, 0], -1);
+  cv.imwrite(file, mat);
+  return file;
+}
+
+addTest('thumbnails - JPEG is fitted to maxSize, intrinsic size reported', () => {
+  const file = writeImage('/tmp/qjs-opencv-thumb-a.jpg', 1600, 1000);
+  const [t] = cv.thumbnails([file], 200, { cacheDir: false });
+  assert(t !== null, 'expected a thumbnail');
+  assert(t.width === 1600 && t.height === 1000, `intrinsic size: got ${t.width}x${t.height}`);
+  assert(Math.max(t.image.cols, t.image.rows) === 200, `longer side: got ${t.image.cols}x${t.image.rows}`);
+});
+
+addTest('thumbnails - small images are not upscaled', () => {
+  const file = writeImage('/tmp/qjs-opencv-thumb-b.png', 120, 80);
+  const [t] = cv.thumbnails([file], 256, { cacheDir: false });
+  assert(t.image.cols === 120 && t.image.rows === 80, `got ${t.image.cols}x${t.image.rows}`);
+});
+
+addTest('thumbnails - unreadable paths yield null, order is preserved', () => {
+  const a = writeImage('/tmp/qjs-opencv-thumb-c.jpg', 640, 480);
+  const r = cv.thumbnails(['/nonexistent/file.jpg', a], 64, { cacheDir: false });
+  assert(r.length === 2, `length: got ${r.length}`);
+  assert(r[0] === null, 'expected null for a missing file');
+  assert(r[1] && r[1].width === 640, 'expected the second entry to decode');
+});
+
+addTest('thumbnails - second call is served from the cache directory', () => {
+  const file = writeImage('/tmp/qjs-opencv-thumb-d.jpg', 800, 600);
+  const opts = { cacheDir: '/tmp/qjs-opencv-thumb-cache' };
+  const [first] = cv.thumbnails([file], 100, opts);
+  const [second] = cv.thumbnails([file], 100, opts);
+  assert(first.width === second.width && first.height === second.height, 'intrinsic size must survive the cache');
+  assert(first.image.cols === second.image.cols && first.image.rows === second.image.rows, 'thumbnail size must survive the cache');
+});
+
+addTest('thumbnails - a maxSize that fails to convert throws', () => {
+  let error;
+  try {
+    cv.thumbnails([], { valueOf() { throw new Error('not a size'); } });
+  } catch (e) {
+    error = e;
+  }
+  assert(error && error.message === 'not a size', `got ${error}`);
+});
+
+tests(testCases);
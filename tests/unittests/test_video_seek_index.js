@@ -0,0 +1,86 @@
+import { tests, assert } from './tinytest.js';
+import * as cv from 'opencv';
+import * as std from 'std';
+
+/*
+ * Exercises VideoCapture.seek() and its <file>.seekidx sidecar
+ * (src/video_index.cpp) on a short MJPEG clip written here: corrupt
+ * sidecars are rejected, and seek() works whether or not an index can be
+ * built on this machine.
+ */
+
+const testCases = {};
+function addTest(name, fn) {
+  if (testCases[name]) throw new Error(`duplicate test name: ${name}`);
+  testCases[name] = fn;
+}
+
+const video = '/tmp/test_video_seek_index.avi';
+const sidecar = video + '.seekidx';
+const frames = 12;
+
+function writeVideo() {
+  const writer = new cv.VideoWriter(video, cv.CAP_OPENCV_MJPEG, cv.VideoWriter.fourcc('MJPG'), 10, new cv.Size(32, 32));
+  const mat = new cv.Mat(32, 32, cv.CV_8UC3);
+
+  for (let i = 0; i < frames; i++) {
+    mat.setTo([20 * i, 20 * i, 20 * i, 0]);
+    writer.write(mat);
+  }
+
+  writer.release();
+}
+
+/* magic, size, mtime, path length 0, fps, count and `entries` bytes of entries */
+function writeSidecar(count, entries) {
+  const buf = new ArrayBuffer(8 + 8 + 8 + 4 + 8 + 4 + entries);
+  const view = new DataView(buf);
+
+  'QJSVIDX1'.split('').forEach((c, i) => view.setUint8(i, c.charCodeAt(0)));
+  view.setFloat64(28, 10, true);
+  view.setUint32(36, count, true);
+
+  const f = std.open(sidecar, 'wb');
+  f.write(buf, 0, buf.byteLength);
+  f.close();
+}
+
+function frameAt(cap, frame) {
+  const mat = new cv.Mat();
+
+  assert(cap.seek(frame), `seek(${frame}) failed`);
+  assert(cap.read(mat), `read after seek(${frame}) failed`);
+  return new Uint8Array(mat.buffer)[(16 * 32 + 16) * 3];
+}
+
+addTest('seek - corrupt sidecar counts are rejected', () => {
+  writeVideo();
+
+  /* a count far beyond the file, and one a few entries short */
+  for (const [count, entries] of [
+    [0xffffffff, 0],
+    [1000, 3 * 12],
+  ]) {
+    writeSidecar(count, entries);
+
+    const cap = new cv.VideoCapture(video);
+    const size = cap.buildSeekIndex(sidecar);
+
+    assert(size === 0 || size === frames, `index of ${size} frames`);
+    assert(Math.abs(frameAt(cap, 7) - 140) < 8, 'seek lands on frame 7');
+  }
+});
+
+addTest('seek - forward, backward and repeated', () => {
+  writeVideo();
+
+  const cap = new cv.VideoCapture(video);
+
+  /* forward, backward and repeated seeks, index or plain CAP_PROP_POS_FRAMES */
+  for (const frame of [3, 9, 2, 2, 10]) {
+    const v = frameAt(cap, frame);
+    assert(Math.abs(v - 20 * frame) < 8, `frame ${frame}: pixel ${v}`);
+  }
+});
+
+tests(testCases);